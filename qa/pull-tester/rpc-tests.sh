@@ -39,6 +39,8 @@ testScripts=(
     'txn_doublespend.py'
     'txn_doublespend.py --mineblock'
     'getchaintips.py'
+    'compactblocks.py'
+    'blockdownload.py'
     'rawtransactions.py'
     'getrawtransaction_insight.py'
     'rest.py'
@@ -63,6 +65,8 @@ testScripts=(
     'spentindex.py'
     'decodescript.py'
     'blockchain.py'
+    'assumevalid.py'
+    'chainsnapshot.py'
     'disablewallet.py'
     'zcjoinsplit.py'
     'zcjoinsplitdoublespend.py'
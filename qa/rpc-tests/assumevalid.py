@@ -0,0 +1,108 @@
+#!/usr/bin/env python
+# Copyright (c) 2023 The Verus developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+# Test that a node that syncs with -assumevalid, and so skips script,
+# signature and proof checks of the assumed valid block and its ancestors,
+# ends up with the same chain state as one that checks every block, and that
+# -developerskipscriptchecks, which lets a node mine a transaction with an
+# invalid signature, does not keep that node from rejecting the block.
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.util import assert_equal, initialize_chain_clean, \
+    start_nodes, start_node, connect_nodes, sync_blocks
+
+from decimal import Decimal
+import time
+
+starttime = 1388534400
+TWO_WEEKS = 60 * 60 * 24 * 7 * 2
+
+class AssumeValidTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 3)
+
+    def setup_network(self, split=False):
+        # node0 mines, the others sync from it once the chain is built. It does not check the scripts of transactions
+        # for its mempool and block templates, so that it can mine a transaction with an invalid signature.
+        self.nodes = start_nodes(1, self.options.tmpdir, [['-experimentalfeatures', '-developerskipscriptchecks']])
+        self.is_network_split=False
+
+    def corrupt_signature(self, node, txhex):
+        # flip a bit of the last byte of r in the signature of the first input, which keeps its encoding valid
+        scriptsig = node.decoderawtransaction(txhex)['vin'][0]['scriptSig']['hex']
+        pos = (5 + int(scriptsig[8:10], 16) - 1) * 2
+        badscriptsig = scriptsig[:pos] + '%02x' % (int(scriptsig[pos:pos + 2], 16) ^ 1) + scriptsig[pos + 2:]
+        return txhex.replace(scriptsig, badscriptsig)
+
+    def wait_for_invalid_tip(self, node, height):
+        # the invalid chain tip is the block at the given height, or one of its descendants if their headers arrived
+        for i in range(100):
+            if [tip for tip in node.getchaintips() if tip['height'] >= height and tip['status'] == 'invalid']:
+                return
+            time.sleep(0.2)
+        raise AssertionError("no invalid chain tip at or above height %d" % height)
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.setmocktime(starttime)
+        node.generate(101)
+
+        # spend some outputs, so that blocks have signatures to check
+        for i in range(5):
+            node.sendtoaddress(node.getnewaddress(), Decimal('1.5') + i)
+            node.generate(1)
+        for i in range(5):
+            node.sendtoaddress(node.getnewaddress(), Decimal('0.25'))
+        node.generate(1)
+        assumed = node.getbestblockhash()
+
+        # the best header has to be at least two weeks past a block by block time before it is assumed valid
+        node.setmocktime(starttime + TWO_WEEKS + 3600)
+        node.sendtoaddress(node.getnewaddress(), Decimal('2'))
+        node.generate(10)
+
+        # node1 skips the checks of the assumed valid block and its ancestors, node2 checks every block
+        self.nodes.append(start_node(1, self.options.tmpdir, ['-assumevalid=' + assumed]))
+        self.nodes.append(start_node(2, self.options.tmpdir, ['-assumevalid=0']))
+        connect_nodes(self.nodes[1], 0)
+        connect_nodes(self.nodes[2], 0)
+        sync_blocks(self.nodes)
+
+        expected = self.nodes[2].gettxoutsetinfo()
+        for n in self.nodes[0:2]:
+            assert_equal(n.getbestblockhash(), self.nodes[2].getbestblockhash())
+            info = n.gettxoutsetinfo()
+            for key in ['height', 'bestblock', 'transactions', 'txouts', 'bytes_serialized', 'hash_serialized', 'total_amount']:
+                assert_equal(info[key], expected[key])
+            assert_equal(n.getblockchaininfo()['valuePools'], self.nodes[2].getblockchaininfo()['valuePools'])
+
+        # node0 accepts a transaction with an invalid signature and mines it, but its own ConnectBlock rejects the block
+        utxo = [u for u in node.listunspent() if u['amount'] > 1][0]
+        rawtx = node.createrawtransaction([{'txid': utxo['txid'], 'vout': utxo['vout']}],
+                                          {node.getnewaddress(): utxo['amount'] - Decimal('0.0001')})
+        badtxid = node.sendrawtransaction(self.corrupt_signature(node, node.signrawtransaction(rawtx)['hex']))
+        assert(badtxid in node.getrawmempool())
+        goodtip = node.getbestblockhash()
+        try:
+            node.generate(1)
+        except JSONRPCException:
+            pass
+        self.wait_for_invalid_tip(node, node.getblockcount() + 1)
+        assert_equal(node.getbestblockhash(), goodtip)
+        badblock = [tip for tip in node.getchaintips() if tip['status'] == 'invalid'][0]['hash']
+        assert(badtxid in node.getblock(badblock)['tx'])
+
+        # the nodes that follow it never see the block
+        sync_blocks(self.nodes)
+        for n in self.nodes[1:3]:
+            assert_equal(n.getbestblockhash(), goodtip)
+
+if __name__ == '__main__':
+    AssumeValidTest().main()
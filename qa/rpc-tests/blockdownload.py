@@ -0,0 +1,44 @@
+#!/usr/bin/env python
+# Copyright (c) 2023 The Verus developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, connect_nodes, \
+    initialize_chain_clean, start_nodes, sync_blocks
+
+
+class BlockDownloadTest(BitcoinTestFramework):
+    '''
+    Test the per peer block download statistics that getpeerinfo reports
+    after a node has downloaded blocks from its peer.
+    '''
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 2)
+
+    def setup_network(self, split=False):
+        self.nodes = start_nodes(2, self.options.tmpdir)
+        self.is_network_split=False
+
+    def run_test(self):
+        self.nodes[0].generate(50)
+        connect_nodes(self.nodes[1], 0)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[1].getblockcount(), 50)
+
+        peers = self.nodes[1].getpeerinfo()
+        assert_equal(len(peers), 1)
+        peer = peers[0]
+        assert(peer['blocksdownloaded'] > 0)
+        assert(peer['blockdownloaddepth'] >= 2)
+        assert(peer['blockdownloaddepth'] <= 64)
+        assert(peer['blockdownloadrate'] > 0)
+        assert(peer['blocklatency'] >= 0)
+        assert('blocksreassigned' in peer)
+
+if __name__ == '__main__':
+    BlockDownloadTest().main()
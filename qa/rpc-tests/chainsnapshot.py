@@ -0,0 +1,85 @@
+#!/usr/bin/env python
+# Copyright (c) 2023 The Verus developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+# Test that two nodes with the same chain write the same chain snapshot, and
+# that a new node started from it has the same chain state, can disconnect the
+# last blocks of the snapshot and follows the chain.
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, \
+    start_nodes, start_node, connect_nodes, sync_blocks
+
+from decimal import Decimal
+
+class ChainSnapshotTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 3)
+
+    def setup_network(self, split=False):
+        # node1 is started from a snapshot once the chain is built
+        args = ['-exportdir=' + self.options.tmpdir]
+        self.nodes = start_nodes(1, self.options.tmpdir, [args])
+        self.nodes.append(None)
+        self.nodes.append(start_node(2, self.options.tmpdir, args))
+        connect_nodes(self.nodes[2], 0)
+        self.is_network_split=False
+
+    def assert_same_chain_state(self, node, expected):
+        assert_equal(node.getbestblockhash(), expected.getbestblockhash())
+        info = node.gettxoutsetinfo()
+        expectedInfo = expected.gettxoutsetinfo()
+        for key in ['height', 'bestblock', 'transactions', 'txouts', 'bytes_serialized', 'hash_serialized', 'total_amount']:
+            assert_equal(info[key], expectedInfo[key])
+        assert_equal(node.getblockchaininfo()['valuePools'], expected.getblockchaininfo()['valuePools'])
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(101)
+        for i in range(5):
+            node.sendtoaddress(node.getnewaddress(), Decimal('1.5') + i)
+        node.generate(1)
+        sync_blocks([self.nodes[0], self.nodes[2]])
+
+        # the same chain gives the same snapshot on every node
+        snapshot = node.dumpsnapshot('snapshot0')
+        assert_equal(snapshot['height'], 102)
+        assert_equal(snapshot['blockhash'], node.getbestblockhash())
+        assert_equal(snapshot['records']['blockindex'], 103)
+        assert_equal(snapshot['records']['blocks'], 102)
+        assert_equal(self.nodes[2].dumpsnapshot('snapshot2')['contenthash'], snapshot['contenthash'])
+
+        # a new node starts at the snapshot tip with the same coins and unspent transactions
+        self.nodes[1] = start_node(1, self.options.tmpdir,
+                                   ['-experimentalfeatures', '-loadsnapshot=' + snapshot['path'],
+                                    '-snapshothash=' + snapshot['contenthash']])
+        info = self.nodes[1].getblockchaininfo()
+        assert_equal(info['blocks'], 102)
+        assert_equal(info['snapshotheight'], 102)
+        self.assert_same_chain_state(self.nodes[1], node)
+        for utxo in node.listunspent():
+            assert_equal(self.nodes[1].getrawtransaction(utxo['txid']), node.getrawtransaction(utxo['txid']))
+
+        # the last blocks of the snapshot come with their undo data, so they can be disconnected
+        assert_equal(self.nodes[1].getblock(node.getblockhash(100), 0), node.getblock(node.getblockhash(100), 0))
+        self.nodes[1].invalidateblock(node.getblockhash(100))
+        assert_equal(self.nodes[1].getblockcount(), 99)
+        self.nodes[1].reconsiderblock(node.getblockhash(100))
+        assert_equal(self.nodes[1].getbestblockhash(), node.getbestblockhash())
+        self.assert_same_chain_state(self.nodes[1], node)
+
+        # and connects the blocks that follow it
+        connect_nodes(self.nodes[1], 0)
+        node.sendtoaddress(node.getnewaddress(), Decimal('2'))
+        node.generate(5)
+        sync_blocks(self.nodes)
+        self.assert_same_chain_state(self.nodes[1], node)
+        assert_equal(self.nodes[1].getblockchaininfo()['snapshotheight'], 102)
+
+if __name__ == '__main__':
+    ChainSnapshotTest().main()
@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+# Copyright (c) 2016 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Test compact block relay. Node 0 mines blocks full of transactions that
+# nodes 1 and 2 already have in their mempools. Node 1 requests new blocks
+# as compact blocks, node 2 runs with -compactblocks=0 and downloads them
+# in full. Compare the bytes each receives from node 0 and how long each
+# takes to get the block.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_greater_than, start_node, connect_nodes_bi
+
+import time
+
+class CompactBlocksTest(BitcoinTestFramework):
+
+    def setup_network(self):
+        args = ["-debug=cmpctblock", "-debug=net"]
+        self.nodes = []
+        self.nodes.append(start_node(0, self.options.tmpdir, args))
+        self.nodes.append(start_node(1, self.options.tmpdir, args))
+        self.nodes.append(start_node(2, self.options.tmpdir, args + ["-compactblocks=0"]))
+        connect_nodes_bi(self.nodes, 0, 1)
+        connect_nodes_bi(self.nodes, 0, 2)
+        self.is_network_split = False
+        self.sync_all()
+
+    def bytes_from_node0(self, node):
+        # node 0 is the only peer of nodes 1 and 2
+        return sum(peer['bytesrecv'] for peer in node.getpeerinfo())
+
+    def relay_block(self, num_txs):
+        for i in range(num_txs):
+            self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 0.01)
+        self.sync_all()
+        assert_equal(len(self.nodes[1].getrawmempool()), num_txs)
+        assert_equal(len(self.nodes[2].getrawmempool()), num_txs)
+
+        bytes_before = [self.bytes_from_node0(self.nodes[n]) for n in (1, 2)]
+        start = time.time()
+        blockhash = self.nodes[0].generate(1)[0]
+
+        latency = [None, None]
+        while None in latency:
+            for i, n in enumerate((1, 2)):
+                if latency[i] is None and self.nodes[n].getbestblockhash() == blockhash:
+                    latency[i] = time.time() - start
+            if time.time() - start > 60:
+                raise AssertionError("block was not relayed within 60 seconds")
+            time.sleep(0.05)
+
+        received = [self.bytes_from_node0(self.nodes[n]) - bytes_before[i] for i, n in enumerate((1, 2))]
+        block_size = self.nodes[0].getblock(blockhash)['size']
+        print "block of %d transactions, %d bytes" % (num_txs + 1, block_size)
+        print "  compact: %d bytes received in %.3fs" % (received[0], latency[0])
+        print "  full:    %d bytes received in %.3fs" % (received[1], latency[1])
+
+        # both nodes end up with the same block and an empty mempool
+        for n in (1, 2):
+            assert_equal(self.nodes[n].getbestblockhash(), blockhash)
+            assert_equal(len(self.nodes[n].getrawmempool()), 0)
+        return block_size, received
+
+    def run_test(self):
+        self.nodes[0].generate(101)
+        self.sync_all()
+
+        for num_txs in (10, 50):
+            block_size, received = self.relay_block(num_txs)
+            # the full block has to be received by node 2
+            assert_greater_than(received[1], block_size)
+            # node 1 only receives the header, the coinbase and a short ID for each transaction
+            assert_greater_than(received[1], received[0])
+
+        # a block with an empty mempool is still relayed, with just the coinbase prefilled
+        blockhash = self.nodes[0].generate(1)[0]
+        self.sync_all()
+        for n in (1, 2):
+            assert_equal(self.nodes[n].getbestblockhash(), blockhash)
+
+if __name__ == '__main__':
+    CompactBlocksTest().main()
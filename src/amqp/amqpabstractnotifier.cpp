@@ -19,3 +19,8 @@ bool AMQPAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool AMQPAbstractNotifier::NotifyPBaaSEvent(const CPBaaSEvent &/*event*/)
+{
+    return true;
+}
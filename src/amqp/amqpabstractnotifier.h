@@ -8,6 +8,7 @@
 #include "amqpconfig.h"
 
 class CBlockIndex;
+class CPBaaSEvent;
 class AMQPAbstractNotifier;
 
 typedef AMQPAbstractNotifier* (*AMQPNotifierFactory)();
@@ -34,6 +35,10 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyPBaaSEvent(const CPBaaSEvent &event);
+
+    // PBaaS event notifiers are called from the PBaaS event queue thread instead of the validation thread
+    virtual bool IsPBaaSEventNotifier() const { return false; }
 
 protected:
     std::string type;
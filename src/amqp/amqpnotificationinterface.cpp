@@ -9,6 +9,7 @@
 #include "main.h"
 #include "streams.h"
 #include "util.h"
+#include "pbaas/events.h"
 
 // AMQP 1.0 Support
 //
@@ -25,8 +26,12 @@
 //
 // Like the ZMQ notification interface, if a notifier fails to send a message, the notifier is shut down.
 //
+// PBaaS event notifiers are the exception: they publish from the thread of a CPBaaSEventQueue, which takes the events
+// of connected and disconnected blocks from ChainTip, so they are only taken out of use when sending fails, and are
+// shut down with the others.
+//
 
-AMQPNotificationInterface::AMQPNotificationInterface()
+AMQPNotificationInterface::AMQPNotificationInterface() : pEventQueue(nullptr)
 {
 }
 
@@ -49,6 +54,12 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
     factories["pubhashtx"] = AMQPAbstractNotifier::Create<AMQPPublishHashTransactionNotifier>;
     factories["pubrawblock"] = AMQPAbstractNotifier::Create<AMQPPublishRawBlockNotifier>;
     factories["pubrawtx"] = AMQPAbstractNotifier::Create<AMQPPublishRawTransactionNotifier>;
+    factories["pubidentity"] = AMQPAbstractNotifier::Create<AMQPPublishIdentityNotifier>;
+    factories["pubcurrencystate"] = AMQPAbstractNotifier::Create<AMQPPublishCurrencyStateNotifier>;
+    factories["pubexport"] = AMQPAbstractNotifier::Create<AMQPPublishExportNotifier>;
+    factories["pubimport"] = AMQPAbstractNotifier::Create<AMQPPublishImportNotifier>;
+    factories["pubreservetransfer"] = AMQPAbstractNotifier::Create<AMQPPublishReserveTransferNotifier>;
+    factories["pubnotarization"] = AMQPAbstractNotifier::Create<AMQPPublishNotarizationNotifier>;
 
     for (std::map<std::string, AMQPNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i) {
         std::map<std::string, std::string>::const_iterator j = args.find("-amqp" + i->first);
@@ -95,6 +106,17 @@ bool AMQPNotificationInterface::Initialize()
         return false;
     }
 
+    for (i = notifiers.begin(); i != notifiers.end(); ++i) {
+        if ((*i)->IsPBaaSEventNotifier()) {
+            eventNotifiers.push_back(*i);
+        }
+    }
+
+    if (!eventNotifiers.empty()) {
+        pEventQueue = new CPBaaSEventQueue(std::bind(&AMQPNotificationInterface::PublishPBaaSEvents, this, std::placeholders::_1));
+        pEventQueue->Start();
+    }
+
     return true;
 }
 
@@ -103,6 +125,12 @@ void AMQPNotificationInterface::Shutdown()
 {
     LogPrint("amqp", "amqp: Shutdown notification interface\n");
 
+    if (pEventQueue) {
+        delete pEventQueue;
+        pEventQueue = nullptr;
+    }
+    eventNotifiers.clear();
+
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ++i) {
         AMQPAbstractNotifier *notifier = *i;
         notifier->Shutdown();
@@ -134,3 +162,25 @@ void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+void AMQPNotificationInterface::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added)
+{
+    if (pEventQueue && pblock) {
+        pEventQueue->PushBlock(*pblock, pindex, added);
+    }
+}
+
+void AMQPNotificationInterface::PublishPBaaSEvents(const std::vector<CPBaaSEvent> &events)
+{
+    for (auto &oneEvent : events) {
+        for (std::list<AMQPAbstractNotifier*>::iterator i = eventNotifiers.begin(); i != eventNotifiers.end(); ) {
+            AMQPAbstractNotifier *notifier = *i;
+            if (notifier->NotifyPBaaSEvent(oneEvent)) {
+                i++;
+            } else {
+                LogPrint("amqp", "amqp: Stopped notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
+                i = eventNotifiers.erase(i);
+            }
+        }
+    }
+}
@@ -10,6 +10,8 @@
 #include <map>
 
 class CBlockIndex;
+class CPBaaSEvent;
+class CPBaaSEventQueue;
 class AMQPAbstractNotifier;
 
 class AMQPNotificationInterface : public CValidationInterface
@@ -26,11 +28,17 @@ protected:
     // CValidationInterface
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added);
+
+    // called on the PBaaS event queue thread
+    void PublishPBaaSEvents(const std::vector<CPBaaSEvent> &events);
 
 private:
     AMQPNotificationInterface();
 
     std::list<AMQPAbstractNotifier*> notifiers;
+    std::list<AMQPAbstractNotifier*> eventNotifiers;    // PBaaS event notifiers, used only by the event queue thread once it runs
+    CPBaaSEventQueue *pEventQueue;
 };
 
 #endif // ZCASH_AMQP_AMQPNOTIFICATIONINTERFACE_H
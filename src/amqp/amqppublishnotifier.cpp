@@ -177,3 +177,15 @@ bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool AMQPPublishPBaaSEventNotifier::NotifyPBaaSEvent(const CPBaaSEvent &event)
+{
+    if (event.nType != eventType)
+        return true;
+
+    const char *command = CPBaaSEvent::TypeName(eventType);
+    LogPrint("amqp", "amqp: Publish %s %s:%d, event %lu\n", command, event.txid.GetHex(), event.nOut, event.nSequence);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << event;
+    return SendMessage(command, &(*ss.begin()), ss.size());
+}
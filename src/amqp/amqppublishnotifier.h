@@ -8,6 +8,7 @@
 #include "amqpabstractnotifier.h"
 #include "amqpconfig.h"
 #include "amqpsender.h"
+#include "pbaas/events.h"
 
 #include <memory>
 #include <thread>
@@ -53,4 +54,53 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+// publishes the PBaaS events of one type, with the event type name as topic and the serialized CPBaaSEvent as body
+class AMQPPublishPBaaSEventNotifier : public AMQPAbstractPublishNotifier
+{
+private:
+    int eventType;
+
+public:
+    AMQPPublishPBaaSEventNotifier(int type) : eventType(type) {}
+
+    bool NotifyPBaaSEvent(const CPBaaSEvent &event);
+    bool IsPBaaSEventNotifier() const { return true; }
+};
+
+class AMQPPublishIdentityNotifier : public AMQPPublishPBaaSEventNotifier
+{
+public:
+    AMQPPublishIdentityNotifier() : AMQPPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_IDENTITY) {}
+};
+
+class AMQPPublishCurrencyStateNotifier : public AMQPPublishPBaaSEventNotifier
+{
+public:
+    AMQPPublishCurrencyStateNotifier() : AMQPPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_CURRENCYSTATE) {}
+};
+
+class AMQPPublishExportNotifier : public AMQPPublishPBaaSEventNotifier
+{
+public:
+    AMQPPublishExportNotifier() : AMQPPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_EXPORT) {}
+};
+
+class AMQPPublishImportNotifier : public AMQPPublishPBaaSEventNotifier
+{
+public:
+    AMQPPublishImportNotifier() : AMQPPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_IMPORT) {}
+};
+
+class AMQPPublishReserveTransferNotifier : public AMQPPublishPBaaSEventNotifier
+{
+public:
+    AMQPPublishReserveTransferNotifier() : AMQPPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_RESERVETRANSFER) {}
+};
+
+class AMQPPublishNotarizationNotifier : public AMQPPublishPBaaSEventNotifier
+{
+public:
+    AMQPPublishNotarizationNotifier() : AMQPPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_NOTARIZATION) {}
+};
+
 #endif // ZCASH_AMQP_AMQPPUBLISHNOTIFIER_H
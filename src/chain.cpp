@@ -4,9 +4,37 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
 #include "chain.h"
+#include "lrucache.h"
+#include "txdb.h"
 
 using namespace std;
 
+extern CBlockTreeDB *pblocktree;
+
+// solutions released from compact block index entries, loaded from blocks/index on demand
+static LRUCache<uint256, std::vector<unsigned char>> releasedSolutionCache(BLOCK_SOLUTION_CACHE_SIZE, 0.25, true);
+
+std::vector<unsigned char> CBlockIndex::GetSolution() const
+{
+    if (!fSolutionReleased)
+    {
+        return nSolution.nSolution();
+    }
+
+    std::vector<unsigned char> solution;
+    uint256 hash = GetBlockHash();
+    if (!releasedSolutionCache.Get(hash, solution))
+    {
+        if (!pblocktree || !pblocktree->ReadBlockSolution(hash, solution))
+        {
+            // the entry was released after being written, so failing to read it back means the index is corrupt
+            throw std::runtime_error("GetSolution(): unable to load released solution for block " + hash.GetHex());
+        }
+        releasedSolutionCache.Put(hash, solution);
+    }
+    return solution;
+}
+
 /**
  * CChain implementation
  */
@@ -56,7 +84,7 @@ bool CBlockIndex::GetRawVerusPOSHash(uint256 &ret) const
     //                          )
     //    hashWriter << height;
     //    return hashWriter.GetHash();
-    ret = CBlockHeader::GetRawVerusPOSHash(nVersion, CConstVerusSolutionVector::Version(nSolution.nSolution()), ASSETCHAINS_MAGIC, nNonce, GetHeight());
+    ret = CBlockHeader::GetRawVerusPOSHash(nVersion, GetSolutionVersion(), ASSETCHAINS_MAGIC, nNonce, GetHeight());
     return true;
 }
 
@@ -257,8 +285,7 @@ CPartialTransactionProof CChain::GetPreHeaderProof(const CBlock &block, uint32_t
     uint256 entropyHash;
     if (block.IsAdvancedHeader() != 0)
     {
-        std::vector<unsigned char> nSol((*this)[blockHeight]->nSolution.nSolution());
-        bool posEntropyInfo = CVerusSolutionVector(nSol).Version() >= CActivationHeight::ACTIVATE_PBAAS;
+        bool posEntropyInfo = (*this)[blockHeight]->GetSolutionVersion() >= CActivationHeight::ACTIVATE_PBAAS;
 
         if (posEntropyInfo)
         {
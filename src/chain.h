@@ -20,6 +20,14 @@ class CChainPower;
 static const int SPROUT_VALUE_VERSION = 1001400;
 static const int SAPLING_VALUE_VERSION = 1010100;
 
+//! -compactblockindex default, release block solutions from the in-memory index and load them on demand.
+//! on by default, since every entry carries the fixed width solution descriptor fields that make this possible.
+static const bool DEFAULT_COMPACT_BLOCK_INDEX = true;
+//! number of most recent blocks that always keep their solution resident in compact mode
+static const int COMPACT_BLOCK_INDEX_RESIDENT_DEPTH = 2000;
+//! number of released solutions kept in the on-demand LRU cache
+static const int BLOCK_SOLUTION_CACHE_SIZE = 4096;
+
 class CBlockFileInfo
 {
 public:
@@ -340,8 +348,22 @@ public:
     unsigned int nTime;
     unsigned int nBits;
     uint256 nNonce;
+
+    //! block solution, which may be released from memory in compact mode. use GetSolution() to read it.
     CCompactSolutionVector nSolution;
 
+    //! (memory only) solution descriptor fields in fixed width form, so that MMR roots and solution version
+    //! are available without the solution being resident
+    uint32_t nSolutionVersion;
+    uint256 hashPrevMMRRoot;
+    uint256 hashBlockMMRRoot;
+
+    //! (memory only) true if nSolution has been released and must be loaded from blocks/index on demand
+    bool fSolutionReleased;
+
+    //! (memory only) true if the Equihash solution was verified by the header check queue when the header was received
+    bool fSolutionChecked;
+
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId;
 
@@ -377,6 +399,11 @@ public:
         nBits          = 0;
         nNonce         = uint256();
         nSolution = CCompactSolutionVector();
+        nSolutionVersion = 0;
+        hashPrevMMRRoot = uint256();
+        hashBlockMMRRoot = uint256();
+        fSolutionReleased = false;
+        fSolutionChecked = false;
     }
 
     CBlockIndex()
@@ -395,6 +422,39 @@ public:
         nBits          = block.nBits;
         nNonce         = block.nNonce;
         nSolution      = block.nSolution;
+        CacheSolutionDescriptor(block.nSolution);
+    }
+
+    //! parse and store the fixed width solution descriptor fields, call whenever nSolution is set
+    void CacheSolutionDescriptor(const std::vector<unsigned char> &solution)
+    {
+        CPBaaSSolutionDescriptor descr = CConstVerusSolutionVector::GetDescriptor(solution);
+        nSolutionVersion = descr.version;
+        hashPrevMMRRoot = descr.hashPrevMMRRoot;
+        hashBlockMMRRoot = descr.hashBlockMMRRoot;
+    }
+
+    //! returns the full solution, loading it from the block tree database if it has been released
+    std::vector<unsigned char> GetSolution() const;
+
+    //! same result as CConstVerusSolutionVector::Version(GetSolution()), without needing the solution
+    uint32_t GetSolutionVersion() const
+    {
+        return CConstVerusSolutionVector::activationHeight.ActiveVersion(0x7fffffff) > 0 ? nSolutionVersion : 0;
+    }
+
+    //! release the in-memory solution, which must already be stored in the block tree database.
+    //! returns the number of heap bytes freed.
+    size_t ReleaseSolution()
+    {
+        if (fSolutionReleased)
+        {
+            return 0;
+        }
+        size_t freed = nSolution.DynamicMemoryUsage();
+        nSolution = CCompactSolutionVector();
+        fSolutionReleased = true;
+        return freed;
     }
 
     void SetHeight(int32_t height)
@@ -436,7 +496,7 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
-        block.nSolution      = nSolution.nSolution();
+        block.nSolution      = GetSolution();
         return block;
     }
 
@@ -504,14 +564,21 @@ public:
     CBlockIndex* GetAncestor(int height);
     const CBlockIndex* GetAncestor(int height) const;
 
+    // only nVersion and nNonce are needed for PoS checks, so avoid materializing the solution
     int32_t GetVerusPOSTarget() const
     {
-        return GetBlockHeader().GetVerusPOSTarget();
+        CBlockHeader block;
+        block.nVersion = nVersion;
+        block.nNonce = nNonce;
+        return block.GetVerusPOSTarget();
     }
 
     bool IsVerusPOSBlock() const
     {
-        return GetBlockHeader().IsVerusPOSBlock();
+        CBlockHeader block;
+        block.nVersion = nVersion;
+        block.nNonce = nNonce;
+        return block.IsVerusPOSBlock();
     }
 
     bool GetRawVerusPOSHash(uint256 &ret) const;
@@ -519,26 +586,18 @@ public:
 
     uint256 BlockMMRRoot() const
     {
-        if (nVersion == CBlockHeader::VERUS_V2)
+        if (nVersion == CBlockHeader::VERUS_V2 && nSolutionVersion >= CActivationHeight::ACTIVATE_PBAAS)
         {
-            CPBaaSSolutionDescriptor descr = CConstVerusSolutionVector::GetDescriptor((nSolution.nSolution()));
-            if (descr.version >= CActivationHeight::ACTIVATE_PBAAS)
-            {
-                return descr.hashBlockMMRRoot;
-            }
+            return hashBlockMMRRoot;
         }
         return hashMerkleRoot;
     }
 
-    uint256 PrevMMRRoot()
+    uint256 PrevMMRRoot() const
     {
-        if (nVersion == CBlockHeader::VERUS_V2)
+        if (nVersion == CBlockHeader::VERUS_V2 && nSolutionVersion >= CActivationHeight::ACTIVATE_PBAAS)
         {
-            CPBaaSSolutionDescriptor descr = CConstVerusSolutionVector::GetDescriptor(nSolution.nSolution());
-            if (descr.version >= CActivationHeight::ACTIVATE_PBAAS)
-            {
-                return descr.hashPrevMMRRoot;
-            }
+            return hashPrevMMRRoot;
         }
         return uint256();
     }
@@ -591,6 +650,11 @@ public:
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        if (fSolutionReleased)
+        {
+            nSolution = pindex->GetSolution();
+            fSolutionReleased = false;
+        }
     }
 
     ADD_SERIALIZE_METHODS;
@@ -646,6 +710,7 @@ public:
             {
                 READWRITE(tmpSolution);
                 nSolution = tmpSolution;
+                CacheSolutionDescriptor(tmpSolution);
             }
             else
             {
@@ -657,6 +722,10 @@ public:
         {
             READWRITE(nSolution.vch);
             nSolution._size = nSolution.vch.size();
+            if (ser_action.ForRead())
+            {
+                CacheSolutionDescriptor(nSolution.vch);
+            }
         }
 
         // Only read/write nSproutValue if the client version used to create
@@ -685,7 +754,7 @@ public:
         block.nTime           = nTime;
         block.nBits           = nBits;
         block.nNonce          = nNonce;
-        block.nSolution       = nSolution.nSolution();
+        block.nSolution       = GetSolution();
         return block.GetHash();
     }
 
@@ -701,11 +770,11 @@ public:
         block.nTime           = nTime;
         block.nBits           = nBits;
         block.nNonce          = nNonce;
-        block.nSolution       = nSolution.nSolution();
+        block.nSolution       = GetSolution();
         CPBaaSPreHeader preBlock(block);
 
         str += strprintf("block.nVersion=%x\npprev=%p\nnHeight=%d\nhashBlock=%s\nblock.hashPrevBlock=%s\nblock.hashMerkleRoot=%s\nblock.nBits=%d\nblock.nNonce=%s\nblock.nSolution=%s\npreBlock.hashPrevMMRRoot=%s\npreBlock.hashBlockMMRRoot=%s\n",
-            this->nVersion, pprev, this->chainPower.nHeight, GetBlockHash().ToString(), hashPrev.ToString(), hashMerkleRoot.ToString(), nBits, nNonce.ToString(), HexBytes(nSolution.nSolution().data(), nSolution.size()), preBlock.hashPrevMMRRoot.ToString(), preBlock.hashBlockMMRRoot.ToString());
+            this->nVersion, pprev, this->chainPower.nHeight, GetBlockHash().ToString(), hashPrev.ToString(), hashMerkleRoot.ToString(), nBits, nNonce.ToString(), HexBytes(block.nSolution.data(), block.nSolution.size()), preBlock.hashPrevMMRRoot.ToString(), preBlock.hashBlockMMRRoot.ToString());
 
         return str;
     }
@@ -132,6 +132,9 @@ public:
         // The best chain should have at least this much work.
         consensus.nMinimumChainWork = uint256S("000000000000000000000000000000000000000000000000017e73a331fae01c");
 
+        // Ancestors of this block have valid scripts, signatures and proofs. Set for Verus mainnet below.
+        consensus.defaultAssumeValid = uint256();
+
         /**
          * The message start string is designed to be unlikely to occur in normal data.
          * The characters are rarely used upper ASCII, not valid as UTF-8, and produce
@@ -323,6 +326,8 @@ void *chainparams_commandline(void *ptr)
                 };
 
             mainParams.consensus.nMinimumChainWork = uint256S("0x00000000000000000000000000000000000000026e5624a2f47b71ea49cda473");
+            // the last checkpoint, at height 2802250
+            mainParams.consensus.defaultAssumeValid = uint256S("0x000000000002a5c44fd73dab43b2e0cac0dd2b5be6a22d03df5283ca8ee1f8bc");
         }
         else
         {
@@ -554,6 +559,8 @@ public:
         // The best chain should have at least this much work.
         consensus.nMinimumChainWork = uint256S("0x00000000000000000000000000000000000000000000000000000001d0c4d9cd");
 
+        consensus.defaultAssumeValid = uint256();
+
         pchMessageStart[0] = 0x5A;
         pchMessageStart[1] = 0x1F;
         pchMessageStart[2] = 0x7E;
@@ -693,6 +700,8 @@ public:
         // The best chain should have at least this much work.
         consensus.nMinimumChainWork = uint256S("0x00");
 
+        consensus.defaultAssumeValid = uint256();
+
         pchMessageStart[0] = 0xaa;
         pchMessageStart[1] = 0x8e;
         pchMessageStart[2] = 0xf3;
@@ -60,6 +60,11 @@ public:
         int64_t nTransactionsLastCheckpoint;
         double fTransactionsPerDay;
     };
+    struct CSnapshotData {
+        int nHeight;
+        uint256 hashBlock;
+        uint256 hashContent;        // content hash of the chain snapshot written by dumpsnapshot at this block
+    };
 
     enum Bech32Type {
         SAPLING_PAYMENT_ADDRESS,
@@ -102,6 +107,8 @@ public:
     const std::string& Bech32HRP(Bech32Type type) const { return bech32HRPs[type]; }
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
+    /** Chain snapshots that -loadsnapshot accepts without -snapshothash */
+    const std::vector<CSnapshotData>& Snapshots() const { return vSnapshots; }
     /** Return the founder's reward address and script for a given block height */
     std::string GetFoundersRewardAddressAtHeight(int height) const;
     CScript GetFoundersRewardScriptAtHeight(int height) const;
@@ -148,6 +155,7 @@ protected:
     bool fMineBlocksOnDemand = false;
     bool fTestnetToBeDeprecatedFieldRPC = false;
     CCheckpointData checkpointData;
+    std::vector<CSnapshotData> vSnapshots;
     std::vector<std::string> vFoundersRewardAddress;
 
     CAmount nSproutValuePoolCheckpointHeight = 0;
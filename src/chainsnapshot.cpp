@@ -0,0 +1,644 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "chainsnapshot.h"
+
+#include "chainparams.h"
+#include "main.h"
+#include "streams.h"
+#include "txdb.h"
+#include "undo.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <unordered_set>
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <univalue.h>
+
+using namespace std;
+
+// records that are buffered before they are written to the databases while a snapshot is loaded
+static const size_t SNAPSHOT_LOAD_BATCH_RECORDS = 100000;
+
+// number of blocks at the end of the chain that a snapshot has with their undo data, which covers the deepest
+// reorganization that a node makes
+static int SnapshotRecentBlocks()
+{
+    return std::max((int)MIN_BLOCKS_TO_KEEP, (int)MAX_REORG_LENGTH + 1);
+}
+
+UniValue CChainSnapshotHeader::ToUniValue() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("version", (int64_t)nVersion));
+    obj.push_back(Pair("height", nHeight));
+    obj.push_back(Pair("blockhash", hashBlock.GetHex()));
+    obj.push_back(Pair("mmrroot", hashMMRRoot.GetHex()));
+    obj.push_back(Pair("contenthash", hashContent.GetHex()));
+    UniValue records(UniValue::VOBJ);
+    records.push_back(Pair("blockindex", nRecords[SECTION_BLOCKINDEX - 1]));
+    records.push_back(Pair("chainstate", nRecords[SECTION_CHAINSTATE - 1]));
+    records.push_back(Pair("indexes", nRecords[SECTION_INDEXES - 1]));
+    records.push_back(Pair("transactionblocks", nRecords[SECTION_TRANSACTIONS - 1]));
+    records.push_back(Pair("blocks", nRecords[SECTION_BLOCKS - 1]));
+    obj.push_back(Pair("records", records));
+    return obj;
+}
+
+CChainSnapshotWriter::CChainSnapshotWriter(const boost::filesystem::path &pathIn) :
+    path(pathIn), nWindowStart(0), nPos(CChainSnapshotHeader::SERIALIZED_SIZE), nSection(0)
+{
+    for (int i = 0; i < CChainSnapshotHeader::SECTION_LAST; i++)
+    {
+        nRecords[i] = 0;
+    }
+    FILE *file = fopen(path.string().c_str(), "wb");
+    if (!file)
+    {
+        throw std::runtime_error(strprintf("cannot create %s", path.string()));
+    }
+    fclose(file);
+}
+
+void CChainSnapshotWriter::MapWindow(uint64_t nStart)
+{
+    if (region.get_size())
+    {
+        region.flush();
+    }
+    boost::interprocess::mapped_region().swap(region);
+
+    // windows start on a page boundary and the file grows by a whole window at a time
+    nStart -= nStart % boost::interprocess::mapped_region::get_page_size();
+    boost::filesystem::resize_file(path, nStart + WINDOW_SIZE);
+    boost::interprocess::file_mapping mapping(path.string().c_str(), boost::interprocess::read_write);
+    boost::interprocess::mapped_region(mapping, boost::interprocess::read_write, nStart, WINDOW_SIZE).swap(region);
+    nWindowStart = nStart;
+}
+
+void CChainSnapshotWriter::write(const char *pch, size_t nSize)
+{
+    hasher.Write((const unsigned char *)pch, nSize);
+    while (nSize > 0)
+    {
+        if (nPos < nWindowStart || nPos >= nWindowStart + region.get_size())
+        {
+            MapWindow(nPos);
+        }
+        size_t nOffset = nPos - nWindowStart;
+        size_t nChunk = std::min(nSize, region.get_size() - nOffset);
+        memcpy((char *)region.get_address() + nOffset, pch, nChunk);
+        pch += nChunk;
+        nSize -= nChunk;
+        nPos += nChunk;
+    }
+}
+
+void CChainSnapshotWriter::WriteRecord(int section, const std::string &key, const std::string &value)
+{
+    if (section < nSection || section < 1 || section > CChainSnapshotHeader::SECTION_LAST)
+    {
+        throw std::logic_error(strprintf("snapshot record of section %d out of order", section));
+    }
+    nSection = section;
+    nRecords[section - 1]++;
+    *this << (unsigned char)section << key << value;
+}
+
+void CChainSnapshotWriter::Finish(CChainSnapshotHeader &header)
+{
+    if (region.get_size())
+    {
+        region.flush();
+    }
+    boost::interprocess::mapped_region().swap(region);
+    boost::filesystem::resize_file(path, nPos);
+
+    for (int i = 0; i < CChainSnapshotHeader::SECTION_LAST; i++)
+    {
+        header.nRecords[i] = nRecords[i];
+    }
+    hasher.Finalize(header.hashContent.begin());
+
+    CDataStream ss(SER_DISK, SNAPSHOT_STREAM_VERSION);
+    ss << header;
+    assert(ss.size() == CChainSnapshotHeader::SERIALIZED_SIZE);
+
+    boost::interprocess::file_mapping mapping(path.string().c_str(), boost::interprocess::read_write);
+    boost::interprocess::mapped_region headerRegion(mapping, boost::interprocess::read_write, 0, ss.size());
+    memcpy(headerRegion.get_address(), &ss[0], ss.size());
+    headerRegion.flush();
+}
+
+CChainSnapshotReader::CChainSnapshotReader(const boost::filesystem::path &path) :
+    mapping(path.string().c_str(), boost::interprocess::read_only),
+    region(mapping, boost::interprocess::read_only),
+    pBegin((const char *)region.get_address()),
+    nSize(region.get_size()),
+    nPos(0)
+{
+    region.advise(boost::interprocess::mapped_region::advice_sequential);
+}
+
+void CChainSnapshotReader::ReadHeader(CChainSnapshotHeader &header)
+{
+    nPos = 0;
+    *this >> header;
+}
+
+uint256 CChainSnapshotReader::HashContent() const
+{
+    uint256 hash;
+    if (nSize > CChainSnapshotHeader::SERIALIZED_SIZE)
+    {
+        CSHA256().Write((const unsigned char *)pBegin + CChainSnapshotHeader::SERIALIZED_SIZE,
+                        nSize - CChainSnapshotHeader::SERIALIZED_SIZE).Finalize(hash.begin());
+    }
+    return hash;
+}
+
+void CChainSnapshotReader::ReadRecord(int &section, std::string &key, std::string &value)
+{
+    unsigned char sectionByte;
+    *this >> sectionByte >> key >> value;
+    section = sectionByte;
+}
+
+bool DumpChainSnapshot(const CChainParams &chainparams, const boost::filesystem::path &path, CChainSnapshotHeader &header, std::string &strError)
+{
+    std::vector<CBlockIndex *> vChain;
+    boost::scoped_ptr<CDBIterator> pcoinsCursor;
+    boost::scoped_ptr<CDBIterator> pindexCursor;
+
+    // flush the coins and capture the chain and both databases at the tip, then write without holding cs_main
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        CBlockIndex *pindexTip = chainActive.Tip();
+        if (!pindexTip || !pcoinsdbview)
+        {
+            strError = "No chain to write a snapshot of";
+            return false;
+        }
+        header.SetNull();
+        header.hashGenesisBlock = chainparams.GetConsensus().hashGenesisBlock;
+        header.hashBlock = pindexTip->GetBlockHash();
+        header.nHeight = pindexTip->GetHeight();
+        header.hashMMRRoot = chainActive.GetMMV().GetRoot();
+        vChain.resize(header.nHeight + 1);
+        for (int i = 0; i <= header.nHeight; i++)
+        {
+            vChain[i] = chainActive[i];
+        }
+        pcoinsCursor.reset(pcoinsdbview->NewScanIterator());
+        pindexCursor.reset(pblocktree->NewScanIterator());
+    }
+
+    std::unordered_set<uint256, BlockHasher> setChain;
+    setChain.reserve(vChain.size());
+    for (auto pindex : vChain)
+    {
+        setChain.insert(pindex->GetBlockHash());
+    }
+    boost::function<bool(const uint256 &)> isInChain = [&setChain](const uint256 &hash) { return setChain.count(hash) != 0; };
+
+    LogPrintf("Writing chain snapshot of block %s at height %d to %s\n", header.hashBlock.GetHex(), header.nHeight, path.string());
+    int64_t nStart = GetTimeMillis();
+
+    // the snapshot only gets its name once it is complete
+    boost::filesystem::path pathTmp = path;
+    pathTmp += ".tmp";
+    try
+    {
+        CChainSnapshotWriter writer(pathTmp);
+        std::vector<std::pair<int, uint256>> unspentTxids;
+
+        if (!pblocktree->WriteChainSnapshotBlockIndex(*pindexCursor, isInChain, writer) ||
+            !pcoinsdbview->WriteChainSnapshot(*pcoinsCursor, writer, unspentTxids) ||
+            !pblocktree->WriteChainSnapshotIndexes(*pindexCursor, isInChain, writer))
+        {
+            strError = "Unable to read the block index or coins database";
+            boost::filesystem::remove(pathTmp);
+            return false;
+        }
+
+        // the transactions with unspent outputs, with the header of their block, in the order of the chain
+        std::sort(unspentTxids.begin(), unspentTxids.end());
+        for (auto it = unspentTxids.begin(); it != unspentTxids.end(); )
+        {
+            boost::this_thread::interruption_point();
+            int nHeight = it->first;
+            std::set<uint256> txids;
+            for (; it != unspentTxids.end() && it->first == nHeight; it++)
+            {
+                txids.insert(it->second);
+            }
+
+            CBlock block;
+            if (nHeight < 0 ||
+                nHeight > header.nHeight ||
+                !(vChain[nHeight]->nStatus & BLOCK_HAVE_DATA) ||
+                !ReadBlockFromDisk(block, vChain[nHeight], chainparams.GetConsensus(), false))
+            {
+                strError = strprintf("Block at height %d, which has unspent transactions, is not available", nHeight);
+                boost::filesystem::remove(pathTmp);
+                return false;
+            }
+
+            std::vector<CTransaction> vtx;
+            for (auto &tx : block.vtx)
+            {
+                if (txids.count(tx.GetHash()))
+                {
+                    vtx.push_back(tx);
+                }
+            }
+            if (vtx.size() != txids.size())
+            {
+                strError = strprintf("Block at height %d does not have all of its unspent transactions", nHeight);
+                boost::filesystem::remove(pathTmp);
+                return false;
+            }
+
+            CDataStream ssKey(SER_DISK, SNAPSHOT_STREAM_VERSION);
+            ssKey << (int32_t)nHeight << block.GetBlockHeader();
+            CDataStream ssValue(SER_DISK, SNAPSHOT_STREAM_VERSION);
+            ssValue << vtx;
+            writer.WriteRecord(CChainSnapshotHeader::SECTION_TRANSACTIONS, ssKey.str(), ssValue.str());
+        }
+
+        // the last blocks of the chain with their undo data
+        for (int nHeight = std::max(1, header.nHeight - SnapshotRecentBlocks() + 1); nHeight <= header.nHeight; nHeight++)
+        {
+            boost::this_thread::interruption_point();
+            CBlockIndex *pindex = vChain[nHeight];
+            CBlock block;
+            CBlockUndo blockUndo;
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA) ||
+                !(pindex->nStatus & BLOCK_HAVE_UNDO) ||
+                !ReadBlockFromDisk(block, pindex, chainparams.GetConsensus(), false) ||
+                !UndoReadFromDisk(blockUndo, pindex->GetUndoPos(), vChain[nHeight - 1]->GetBlockHash()))
+            {
+                strError = strprintf("Block or undo data of the block at height %d is not available", nHeight);
+                boost::filesystem::remove(pathTmp);
+                return false;
+            }
+
+            CDataStream ssKey(SER_DISK, SNAPSHOT_STREAM_VERSION);
+            ssKey << (int32_t)nHeight << pindex->GetBlockHash();
+            CDataStream ssValue(SER_DISK, SNAPSHOT_STREAM_VERSION);
+            ssValue << block << blockUndo;
+            writer.WriteRecord(CChainSnapshotHeader::SECTION_BLOCKS, ssKey.str(), ssValue.str());
+        }
+
+        writer.Finish(header);
+        boost::filesystem::rename(pathTmp, path);
+    }
+    catch (const boost::thread_interrupted &)
+    {
+        boost::filesystem::remove(pathTmp);
+        throw;
+    }
+    catch (const std::exception &e)
+    {
+        strError = strprintf("Unable to write snapshot: %s", e.what());
+        boost::system::error_code ec;
+        boost::filesystem::remove(pathTmp, ec);
+        return false;
+    }
+
+    LogPrintf("Wrote chain snapshot with content hash %s in %.2fs\n", header.hashContent.GetHex(), (GetTimeMillis() - nStart) * 0.001);
+    return true;
+}
+
+bool LoadChainSnapshot(const CChainParams &chainparams, const boost::filesystem::path &path, const uint256 &hashExpected, CChainSnapshotHeader &header, std::string &strError)
+{
+    int nLastFile;
+    if (!pcoinsdbview->GetBestBlock().IsNull() || pblocktree->ReadLastBlockFile(nLastFile))
+    {
+        strError = _("A chain snapshot can only be loaded into a new data directory");
+        return false;
+    }
+
+    try
+    {
+        CChainSnapshotReader reader(path);
+        reader.ReadHeader(header);
+
+        if (header.nVersion != CChainSnapshotHeader::VERSION_CURRENT)
+        {
+            strError = strprintf(_("Chain snapshot %s has unknown version %u"), path.string(), header.nVersion);
+            return false;
+        }
+        if (header.hashGenesisBlock != chainparams.GetConsensus().hashGenesisBlock)
+        {
+            strError = strprintf(_("Chain snapshot %s is of another chain"), path.string());
+            return false;
+        }
+
+        uint256 hashPinned;
+        for (auto &snapshot : chainparams.Snapshots())
+        {
+            if (snapshot.nHeight == header.nHeight && snapshot.hashBlock == header.hashBlock)
+            {
+                hashPinned = snapshot.hashContent;
+            }
+        }
+        // history below a snapshot is never validated by the node that loads it, so outside of regtest only a snapshot
+        // pinned in a release is trusted
+        if (!hashExpected.IsNull() && hashPinned.IsNull() && chainparams.NetworkIDString() != "regtest")
+        {
+            strError = _("-snapshothash is only accepted on regtest, other chains only load snapshots pinned in the chain parameters");
+            return false;
+        }
+        if (hashPinned.IsNull() && hashExpected.IsNull())
+        {
+            strError = strprintf(_("Chain snapshot of block %s at height %d is not pinned in the chain parameters"),
+                                 header.hashBlock.GetHex(), header.nHeight);
+            return false;
+        }
+        if (!hashPinned.IsNull() && !hashExpected.IsNull() && hashPinned != hashExpected)
+        {
+            strError = strprintf(_("-snapshothash does not match the content hash %s pinned for block %s"), hashPinned.GetHex(), header.hashBlock.GetHex());
+            return false;
+        }
+
+        LogPrintf("Loading chain snapshot of block %s at height %d from %s\n", header.hashBlock.GetHex(), header.nHeight, path.string());
+        int64_t nStart = GetTimeMillis();
+
+        uint256 hashContent = reader.HashContent();
+        if (hashContent != (hashPinned.IsNull() ? hashExpected : hashPinned) || hashContent != header.hashContent)
+        {
+            strError = strprintf(_("Chain snapshot %s has content hash %s, which is not the expected content hash"), path.string(), hashContent.GetHex());
+            return false;
+        }
+
+        // a height of -1 marks a load that has not completed, so that an interrupted load is not mistaken for a chain
+        pblocktree->WriteSnapshotHeight(-1);
+
+        std::vector<std::pair<std::string, std::string>> indexRecords;
+        std::vector<std::pair<std::string, std::string>> coinsRecords;
+        std::vector<std::pair<uint256, CDiskTxPos>> txIndex;
+        std::vector<CBlockFileInfo> vinfoFiles(1);
+        uint64_t nRecords[CChainSnapshotHeader::SECTION_LAST] = {};
+        int nLastSection = 0;
+
+        // block index records of the blocks that come with their block and undo data, which are written again with
+        // their positions in the block and undo files
+        int64_t nFirstBlockHeight = (int64_t)header.nHeight - (int64_t)header.nRecords[CChainSnapshotHeader::SECTION_BLOCKS - 1] + 1;
+        int64_t nNextBlockHeight = nFirstBlockHeight;
+        std::map<uint256, std::pair<std::string, CDiskBlockIndex>> recentBlockIndex;
+
+        // transactions are written to block files as the header of their block followed by the transactions, which
+        // is the layout that GetTransaction reads through the transaction index
+        CDiskBlockPos pos(0, 0);
+        boost::scoped_ptr<CAutoFile> pfile(new CAutoFile(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION));
+        if (pfile->IsNull())
+        {
+            strError = _("Unable to open block file to load chain snapshot");
+            return false;
+        }
+
+        // moves on to the next block file if nSize more bytes do not fit in this one
+        auto nextBlockFile = [&](unsigned int nSize) {
+            if (pos.nPos > 0 && pos.nPos + nSize >= MAX_BLOCKFILE_SIZE)
+            {
+                FileCommit(pfile->Get());
+                pos.nFile++;
+                pos.nPos = 0;
+                vinfoFiles.resize(pos.nFile + 1);
+                pfile.reset(new CAutoFile(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION));
+            }
+            return !pfile->IsNull();
+        };
+
+        auto flush = [&]() {
+            if ((indexRecords.size() && !pblocktree->WriteSnapshotRecords(indexRecords)) ||
+                (coinsRecords.size() && !pcoinsdbview->WriteSnapshotRecords(coinsRecords)) ||
+                (txIndex.size() && !pblocktree->WriteTxIndex(txIndex)))
+            {
+                return false;
+            }
+            indexRecords.clear();
+            coinsRecords.clear();
+            txIndex.clear();
+            return true;
+        };
+
+        while (!reader.eof())
+        {
+            boost::this_thread::interruption_point();
+            int section;
+            std::string key, value;
+            reader.ReadRecord(section, key, value);
+            if (section < nLastSection || section < 1 || section > CChainSnapshotHeader::SECTION_LAST)
+            {
+                strError = strprintf(_("Chain snapshot %s has records out of order"), path.string());
+                return false;
+            }
+            nLastSection = section;
+            nRecords[section - 1]++;
+
+            switch (section)
+            {
+                case CChainSnapshotHeader::SECTION_BLOCKINDEX:
+                {
+                    CDataStream ss(value.data(), value.data() + value.size(), SER_DISK, SNAPSHOT_STREAM_VERSION);
+                    CDiskBlockIndex diskindex;
+                    ss >> diskindex;
+                    if (diskindex.nStatus & BLOCK_HAVE_MASK)
+                    {
+                        strError = strprintf(_("Chain snapshot %s has block index records with block files"), path.string());
+                        return false;
+                    }
+                    if (diskindex.GetHeight() >= nFirstBlockHeight)
+                    {
+                        recentBlockIndex[diskindex.GetBlockHash()] = std::make_pair(key, diskindex);
+                    }
+                    CDataStream ssDisk(SER_DISK, CLIENT_VERSION);
+                    ssDisk << diskindex;
+                    indexRecords.push_back(std::make_pair(key, ssDisk.str()));
+                    break;
+                }
+
+                case CChainSnapshotHeader::SECTION_CHAINSTATE:
+                {
+                    coinsRecords.push_back(std::make_pair(key, value));
+                    break;
+                }
+
+                case CChainSnapshotHeader::SECTION_INDEXES:
+                {
+                    indexRecords.push_back(std::make_pair(key, value));
+                    break;
+                }
+
+                case CChainSnapshotHeader::SECTION_TRANSACTIONS:
+                {
+                    CDataStream ssKey(key.data(), key.data() + key.size(), SER_DISK, SNAPSHOT_STREAM_VERSION);
+                    int32_t nHeight;
+                    CBlockHeader blockHeader;
+                    ssKey >> nHeight >> blockHeader;
+                    CDataStream ssValue(value.data(), value.data() + value.size(), SER_DISK, SNAPSHOT_STREAM_VERSION);
+                    std::vector<CTransaction> vtx;
+                    ssValue >> vtx;
+
+                    unsigned int nHeaderSize = ::GetSerializeSize(blockHeader, SER_DISK, CLIENT_VERSION);
+                    unsigned int nSize = nHeaderSize;
+                    for (auto &tx : vtx)
+                    {
+                        nSize += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+                    }
+                    if (!nextBlockFile(nSize))
+                    {
+                        strError = _("Unable to open block file to load chain snapshot");
+                        return false;
+                    }
+
+                    *pfile << blockHeader;
+                    unsigned int nTxOffset = 0;
+                    for (auto &tx : vtx)
+                    {
+                        txIndex.push_back(std::make_pair(tx.GetHash(), CDiskTxPos(pos, nTxOffset)));
+                        *pfile << tx;
+                        nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+                    }
+                    pos.nPos += nSize;
+                    vinfoFiles[pos.nFile].AddBlock(nHeight, blockHeader.GetBlockTime());
+                    vinfoFiles[pos.nFile].nSize = pos.nPos;
+                    break;
+                }
+
+                case CChainSnapshotHeader::SECTION_BLOCKS:
+                {
+                    CDataStream ssKey(key.data(), key.data() + key.size(), SER_DISK, SNAPSHOT_STREAM_VERSION);
+                    int32_t nHeight;
+                    uint256 hashBlock;
+                    ssKey >> nHeight >> hashBlock;
+                    CDataStream ssValue(value.data(), value.data() + value.size(), SER_DISK, SNAPSHOT_STREAM_VERSION);
+                    CBlock block;
+                    CBlockUndo blockUndo;
+                    ssValue >> block >> blockUndo;
+
+                    auto it = recentBlockIndex.find(hashBlock);
+                    if (nHeight != nNextBlockHeight ||
+                        block.GetHash() != hashBlock ||
+                        it == recentBlockIndex.end() ||
+                        it->second.second.GetHeight() != nHeight)
+                    {
+                        strError = strprintf(_("Chain snapshot %s has a block that is not the block of its chain at height %d"), path.string(), nHeight);
+                        return false;
+                    }
+                    nNextBlockHeight++;
+
+                    // the block goes into the block files as it would when it is connected, and its undo data into the
+                    // undo file of the same number
+                    unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+                    if (!nextBlockFile(nBlockSize + 8))
+                    {
+                        strError = _("Unable to open block file to load chain snapshot");
+                        return false;
+                    }
+                    *pfile << FLATDATA(chainparams.MessageStart()) << nBlockSize << block;
+                    CDiskBlockIndex &diskindex = it->second.second;
+                    diskindex.nFile = pos.nFile;
+                    diskindex.nDataPos = pos.nPos + 8;
+                    pos.nPos += nBlockSize + 8;
+                    vinfoFiles[pos.nFile].AddBlock(nHeight, block.GetBlockTime());
+                    vinfoFiles[pos.nFile].nSize = pos.nPos;
+
+                    CDiskBlockPos undoPos(pos.nFile, vinfoFiles[pos.nFile].nUndoSize);
+                    if (!UndoWriteToDisk(blockUndo, undoPos, block.hashPrevBlock, chainparams.MessageStart()))
+                    {
+                        strError = _("Unable to write undo data to load chain snapshot");
+                        return false;
+                    }
+                    diskindex.nUndoPos = undoPos.nPos;
+                    vinfoFiles[pos.nFile].nUndoSize = undoPos.nPos + ::GetSerializeSize(blockUndo, SER_DISK, CLIENT_VERSION) + sizeof(uint256);
+                    diskindex.nStatus |= BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO;
+
+                    CDataStream ssDisk(SER_DISK, CLIENT_VERSION);
+                    ssDisk << diskindex;
+                    indexRecords.push_back(std::make_pair(it->second.first, ssDisk.str()));
+                    break;
+                }
+            }
+
+            if (indexRecords.size() + coinsRecords.size() + txIndex.size() >= SNAPSHOT_LOAD_BATCH_RECORDS && !flush())
+            {
+                strError = _("Unable to write chain snapshot to the databases");
+                return false;
+            }
+        }
+        FileCommit(pfile->Get());
+        pfile.reset();
+
+        for (int i = 0; i < CChainSnapshotHeader::SECTION_LAST; i++)
+        {
+            if (nRecords[i] != header.nRecords[i])
+            {
+                strError = strprintf(_("Chain snapshot %s does not have the number of records in its header"), path.string());
+                return false;
+            }
+        }
+        if (nRecords[CChainSnapshotHeader::SECTION_BLOCKINDEX - 1] != (uint64_t)header.nHeight + 1)
+        {
+            strError = strprintf(_("Chain snapshot %s does not have the block index of every block of its chain"), path.string());
+            return false;
+        }
+        if (nNextBlockHeight != (int64_t)header.nHeight + 1 ||
+            nRecords[CChainSnapshotHeader::SECTION_BLOCKS - 1] < (uint64_t)std::min(header.nHeight, SnapshotRecentBlocks()))
+        {
+            strError = strprintf(_("Chain snapshot %s does not have the last blocks of its chain"), path.string());
+            return false;
+        }
+
+        std::vector<std::pair<int, const CBlockFileInfo *>> vFiles;
+        for (int i = 0; i < vinfoFiles.size(); i++)
+        {
+            vFiles.push_back(std::make_pair(i, &vinfoFiles[i]));
+        }
+        if (!flush() ||
+            !pblocktree->WriteBatchSync(vFiles, pos.nFile, std::vector<const CBlockIndex *>()) ||
+            !pblocktree->WriteFlag("prunedblockfiles", true) ||
+            !pblocktree->WriteSnapshotHeight(header.nHeight))
+        {
+            strError = _("Unable to write chain snapshot to the databases");
+            return false;
+        }
+
+        LogPrintf("Loaded chain snapshot in %.2fs\n", (GetTimeMillis() - nStart) * 0.001);
+    }
+    catch (const boost::thread_interrupted &)
+    {
+        throw;
+    }
+    catch (const std::exception &e)
+    {
+        strError = strprintf(_("Unable to load chain snapshot %s: %s"), path.string(), e.what());
+        return false;
+    }
+    return true;
+}
+
+bool CheckLoadedChainSnapshot(const CChainSnapshotHeader &header, std::string &strError)
+{
+    AssertLockHeld(cs_main);
+    CBlockIndex *pindexTip = chainActive.Tip();
+    if (!pindexTip || pindexTip->GetBlockHash() != header.hashBlock || pindexTip->GetHeight() != header.nHeight)
+    {
+        strError = strprintf(_("The chain loaded from the snapshot does not end at block %s"), header.hashBlock.GetHex());
+        return false;
+    }
+    if (chainActive.GetMMV().GetRoot() != header.hashMMRRoot)
+    {
+        strError = strprintf(_("The chain loaded from the snapshot does not have chain MMR root %s"), header.hashMMRRoot.GetHex());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,201 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_CHAINSNAPSHOT_H
+#define BITCOIN_CHAINSNAPSHOT_H
+
+#include "crypto/sha256.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <ios>
+#include <string.h>
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+class CChainParams;
+class UniValue;
+
+/**
+ * A chain snapshot holds what a new node needs to continue the chain from one block without replaying its history:
+ * the block index of the chain up to that block, every record of the coin database, the address, spent, timestamp,
+ * offer and identity index records, the transactions that still have unspent outputs, so that they can be found
+ * through the transaction index, and the last blocks with their undo data, so that the node can disconnect them in a
+ * reorganization. Records come in a fixed order and are serialized the same way by every node, so the
+ * same chain at the same height always gives the same content hash, which can be pinned in the chain parameters.
+ */
+
+//! stream version of everything in a snapshot, fixed so that the bytes do not depend on the version of the node
+static const int SNAPSHOT_STREAM_VERSION = 170010;
+
+class CChainSnapshotHeader
+{
+public:
+    enum ESections {
+        SECTION_BLOCKINDEX = 1,         // block index records of the chain, without block and undo data
+        SECTION_CHAINSTATE = 2,         // every record of the coin database
+        SECTION_INDEXES = 3,            // address, spent, timestamp, offer and identity index records and index flags
+        SECTION_TRANSACTIONS = 4,       // height, header and the transactions with unspent outputs of each block
+        SECTION_BLOCKS = 5,             // height, hash, block and undo data of the last blocks of the chain
+        SECTION_LAST = SECTION_BLOCKS
+    };
+
+    static const uint32_t VERSION_CURRENT = 2;
+    static const size_t SERIALIZED_SIZE = 184;
+
+    uint32_t nVersion;
+    uint256 hashGenesisBlock;
+    uint256 hashBlock;
+    int32_t nHeight;
+    uint256 hashMMRRoot;                // root of the chain MMR with hashBlock as its last block
+    uint64_t nRecords[SECTION_LAST];    // number of records in each section
+    uint256 hashContent;                // SHA256 of everything after the header
+
+    CChainSnapshotHeader()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        nVersion = VERSION_CURRENT;
+        hashGenesisBlock.SetNull();
+        hashBlock.SetNull();
+        nHeight = 0;
+        hashMMRRoot.SetNull();
+        for (int i = 0; i < SECTION_LAST; i++)
+        {
+            nRecords[i] = 0;
+        }
+        hashContent.SetNull();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        static const char SNAPSHOT_MAGIC[8] = {'V', 'R', 'S', 'C', 'S', 'N', 'A', 'P'};
+        char magic[8];
+        if (!ser_action.ForRead())
+        {
+            memcpy(magic, SNAPSHOT_MAGIC, sizeof(magic));
+        }
+        READWRITE(FLATDATA(magic));
+        if (ser_action.ForRead() && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)))
+        {
+            throw std::ios_base::failure("not a chain snapshot");
+        }
+        READWRITE(nVersion);
+        READWRITE(hashGenesisBlock);
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(hashMMRRoot);
+        for (int i = 0; i < SECTION_LAST; i++)
+        {
+            READWRITE(nRecords[i]);
+        }
+        READWRITE(hashContent);
+    }
+
+    UniValue ToUniValue() const;
+};
+
+/** Streams a chain snapshot into a file through a memory mapped window that moves forward as it fills */
+class CChainSnapshotWriter
+{
+private:
+    boost::filesystem::path path;
+    boost::interprocess::mapped_region region;
+    uint64_t nWindowStart;              // file position of the mapped window
+    uint64_t nPos;                      // file position of the next byte
+    int nSection;
+    uint64_t nRecords[CChainSnapshotHeader::SECTION_LAST];
+    CSHA256 hasher;
+
+    void MapWindow(uint64_t nStart);
+
+public:
+    static const uint64_t WINDOW_SIZE = 64 << 20;
+
+    //! creates the file, throws on failure
+    CChainSnapshotWriter(const boost::filesystem::path &pathIn);
+
+    int GetType() const { return SER_DISK; }
+    int GetVersion() const { return SNAPSHOT_STREAM_VERSION; }
+
+    void write(const char *pch, size_t nSize);
+
+    template<typename T>
+    CChainSnapshotWriter& operator<<(const T& obj) {
+        ::Serialize(*this, obj);
+        return (*this);
+    }
+
+    //! records must be written in the order of their sections
+    void WriteRecord(int section, const std::string &key, const std::string &value);
+
+    //! fills in the record counts and content hash of header and writes it at the start of the file
+    void Finish(CChainSnapshotHeader &header);
+};
+
+/** Reads a chain snapshot from a file that is memory mapped as a whole */
+class CChainSnapshotReader
+{
+private:
+    boost::interprocess::file_mapping mapping;
+    boost::interprocess::mapped_region region;
+    const char *pBegin;
+    uint64_t nSize;
+    uint64_t nPos;
+
+public:
+    //! maps the file read only, throws on failure
+    CChainSnapshotReader(const boost::filesystem::path &path);
+
+    int GetType() const { return SER_DISK; }
+    int GetVersion() const { return SNAPSHOT_STREAM_VERSION; }
+
+    void read(char *pch, size_t nReadSize)
+    {
+        if (nReadSize > nSize - nPos)
+        {
+            throw std::ios_base::failure("CChainSnapshotReader::read(): end of data");
+        }
+        memcpy(pch, pBegin + nPos, nReadSize);
+        nPos += nReadSize;
+    }
+
+    template<typename T>
+    CChainSnapshotReader& operator>>(T& obj) {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    bool eof() const { return nPos == nSize; }
+
+    //! reads the header and leaves the reader at the first record
+    void ReadHeader(CChainSnapshotHeader &header);
+
+    //! SHA256 of everything after the header
+    uint256 HashContent() const;
+
+    void ReadRecord(int &section, std::string &key, std::string &value);
+};
+
+/** Writes a snapshot of the chain at the current tip, which takes cs_main only while it captures the tip */
+bool DumpChainSnapshot(const CChainParams &chainparams, const boost::filesystem::path &path, CChainSnapshotHeader &header, std::string &strError);
+
+/**
+ * Loads a snapshot into empty block tree and coin databases, before the block index is loaded. The content hash must
+ * be pinned for its block in the chain parameters. On regtest it may instead be equal to hashExpected.
+ */
+bool LoadChainSnapshot(const CChainParams &chainparams, const boost::filesystem::path &path, const uint256 &hashExpected, CChainSnapshotHeader &header, std::string &strError);
+
+/** Checks the chain loaded from a snapshot against its header once the block index is loaded, needs cs_main */
+bool CheckLoadedChainSnapshot(const CChainSnapshotHeader &header, std::string &strError);
+
+#endif // BITCOIN_CHAINSNAPSHOT_H
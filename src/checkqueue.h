@@ -52,6 +52,10 @@ private:
     //! The temporary evaluation result.
     bool fAllOk;
 
+    //! The first verification that failed since the last Wait(), if fFailed is set.
+    T failedCheck;
+    bool fFailed;
+
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
@@ -66,19 +70,26 @@ private:
     unsigned int nBatchSize;
 
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    bool Loop(bool fMaster = false, T* pFailedCheck = NULL)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
         unsigned int nNow = 0;
         bool fOk = true;
+        T failedLocal;
+        bool fFailedLocal = false;
         do {
             {
                 boost::unique_lock<boost::mutex> lock(mutex);
                 // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
                 if (nNow) {
                     fAllOk &= fOk;
+                    if (fFailedLocal && !fFailed) {
+                        failedCheck.swap(failedLocal);
+                        fFailed = true;
+                    }
+                    fFailedLocal = false;
                     nTodo -= nNow;
                     if (nTodo == 0 && !fMaster)
                         // We processed the last element; inform the master it can exit and return the result
@@ -93,8 +104,14 @@ private:
                         nTotal--;
                         bool fRet = fAllOk;
                         // reset the status for new work later
-                        if (fMaster)
+                        if (fMaster) {
                             fAllOk = true;
+                            if (fFailed && pFailedCheck != NULL)
+                                pFailedCheck->swap(failedCheck);
+                            T cleared;
+                            failedCheck.swap(cleared);
+                            fFailed = false;
+                        }
                         // return the current status
                         return fRet;
                     }
@@ -120,15 +137,17 @@ private:
             }
             // execute work
             BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
+                if (fOk && !(fOk = check())) {
+                    failedLocal.swap(check);
+                    fFailedLocal = true;
+                }
             vChecks.clear();
         } while (true);
     }
 
 public:
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), fFailed(false), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
@@ -137,9 +156,10 @@ public:
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
-    bool Wait()
+    //! If one failed and pFailedCheck is set, the first failed verification is swapped into it.
+    bool Wait(T* pFailedCheck = NULL)
     {
-        return Loop(true);
+        return Loop(true, pFailedCheck);
     }
 
     //! Add a batch of checks to the queue
@@ -190,11 +210,11 @@ public:
         }
     }
 
-    bool Wait()
+    bool Wait(T* pFailedCheck = NULL)
     {
         if (pqueue == NULL)
             return true;
-        bool fRet = pqueue->Wait();
+        bool fRet = pqueue->Wait(pFailedCheck);
         fDone = true;
         return fRet;
     }
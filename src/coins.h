@@ -562,6 +562,13 @@ public:
      */
     CCoinsModifier ModifyNewCoins(const uint256 &txid);
 
+    /**
+     * Add coins for txid that were read from the base view ahead of time, unless the cache already has an
+     * entry for txid. The caller must be sure that the base view has not changed since they were read.
+     * Returns true if they were added.
+     */
+    bool PrefetchCoins(const uint256 &txid, CCoins &coins);
+
     /**
      * Push the modifications applied to this cache to its base.
      * Failure to call this method before destruction will cause the changes to be forgotten.
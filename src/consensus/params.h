@@ -152,6 +152,8 @@ struct Params {
     int64_t nPreBlossomPowTargetSpacing;
     int64_t nPostBlossomPowTargetSpacing;
     uint256 nMinimumChainWork;
+    // by default, scripts, signatures and proofs of ancestors of this block are not checked, see doc/assumevalid.md
+    uint256 defaultAssumeValid;
 };
 } // namespace Consensus
 
@@ -0,0 +1,206 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+// BLAKE2b (RFC 7693) specialized to inputs of exactly 64 bytes and a 32-byte digest with no key. Such an input
+// fits in a single, final 128-byte block, so each hash is one compression from a state that only depends on the
+// personalization string. That is the shape of every parent node of a BLAKE2b merkle mountain range.
+
+#include "crypto/blake2b.h"
+
+#include "crypto/common.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace blake2b64_avx2
+{
+void Hash_4way(unsigned char* out, const unsigned char* in, const uint64_t* h0);
+}
+#endif
+
+// Internal implementation code.
+namespace
+{
+/// Internal BLAKE2b implementation.
+namespace blake2b
+{
+const uint64_t IV[8] = {
+    0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull, 0xa54ff53a5f1d36f1ull,
+    0x510e527fade682d1ull, 0x9b05688c2b3e6c1full, 0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull
+};
+
+const uint8_t SIGMA[12][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+    { 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+    { 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+    { 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+    { 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+    { 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+    { 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+    { 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+    { 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+};
+
+uint64_t inline Rot(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+void inline G(uint64_t& a, uint64_t& b, uint64_t& c, uint64_t& d, uint64_t x, uint64_t y)
+{
+    a = a + b + x;
+    d = Rot(d ^ a, 32);
+    c = c + d;
+    b = Rot(b ^ c, 24);
+    a = a + b + y;
+    d = Rot(d ^ a, 16);
+    c = c + d;
+    b = Rot(b ^ c, 63);
+}
+
+/** The initial state for a 32-byte, unkeyed digest with the given personalization. */
+void Initialize(uint64_t* h, const unsigned char* personal)
+{
+    std::copy(IV, IV + 8, h);
+    h[0] ^= 0x01010020ull; // digest length 32, no key, fanout 1, depth 1
+    h[6] ^= ReadLE64(personal);
+    h[7] ^= ReadLE64(personal + 8);
+}
+
+/** Hash one 64-byte input as the first and final block, starting from the state h0. */
+void Hash(unsigned char* out, const unsigned char* in, const uint64_t* h0)
+{
+    uint64_t m[16], v[16];
+    for (int i = 0; i < 8; i++) {
+        m[i] = ReadLE64(in + 8 * i);
+        m[i + 8] = 0;
+        v[i] = h0[i];
+        v[i + 8] = IV[i];
+    }
+    v[12] ^= 64;  // bytes hashed
+    v[14] = ~v[14]; // final block
+
+    for (int r = 0; r < 12; r++) {
+        const uint8_t* s = SIGMA[r];
+        G(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+        G(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+        G(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+        G(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+        G(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+        G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        G(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+        G(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        WriteLE64(out + 8 * i, h0[i] ^ v[i] ^ v[i + 8]);
+    }
+}
+} // namespace blake2b
+
+typedef void (*Hash4wayType)(unsigned char*, const unsigned char*, const uint64_t*);
+
+// Selected once by BLAKE2b64AutoDetect() at startup, only the portable implementation until then
+Hash4wayType Hash_4way = nullptr;
+
+bool SelfTest()
+{
+    static const unsigned char personal[16] = {'V','e','r','u','s','D','e','f','a','u','l','t','H','a','s','h'};
+    // Some random input data to test with
+    static const unsigned char data[258] = "-" // Intentionally not aligned
+        "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+        "eiusmod tempor incididunt ut labore et dolore magna aliqua. Et m"
+        "olestie ac feugiat sed lectus vestibulum mattis ullamcorper. Mor"
+        "bi blandit cursus risus at ultrices mi tempus imperdiet nulla. N";
+    // Expected output for each of the 4 64-byte messages above.
+    static const unsigned char result[128] = {
+        0x54, 0x3f, 0xb2, 0x0e, 0x40, 0xeb, 0x69, 0x51, 0x19, 0x6a, 0x18, 0x0b, 0x4e, 0xc6, 0x0e, 0x8d,
+        0x7a, 0x4e, 0xf8, 0x2c, 0x14, 0x98, 0x95, 0xf1, 0x06, 0x41, 0xe2, 0xf4, 0xa3, 0x42, 0x08, 0x51,
+        0x61, 0xd3, 0x0e, 0x1d, 0x7b, 0x4d, 0xc8, 0x03, 0x6c, 0xb4, 0xdd, 0x49, 0x26, 0x6e, 0x94, 0xd1,
+        0x6e, 0x8c, 0xac, 0x0b, 0x4d, 0xe6, 0x47, 0x55, 0xf0, 0xe7, 0x17, 0xe3, 0x8a, 0x39, 0x52, 0x5b,
+        0x7d, 0xfd, 0x96, 0x0b, 0x16, 0x52, 0xb7, 0xd3, 0xed, 0x2d, 0xa2, 0x7a, 0x41, 0x5b, 0x61, 0x69,
+        0x1f, 0x2e, 0xe6, 0x4f, 0x7d, 0xfd, 0x61, 0x7d, 0x4a, 0xec, 0x37, 0xab, 0xcd, 0x83, 0xcb, 0xc8,
+        0xf3, 0x8c, 0xe2, 0x98, 0x02, 0x54, 0x69, 0xda, 0xf2, 0xd9, 0x9c, 0xfc, 0xeb, 0xac, 0x2a, 0x32,
+        0xc5, 0x8b, 0x7e, 0xc6, 0xc0, 0xa5, 0xee, 0xd7, 0x01, 0xb7, 0x5a, 0xd6, 0x82, 0x86, 0x76, 0x82
+    };
+
+    uint64_t h0[8];
+    blake2b::Initialize(h0, personal);
+
+    unsigned char out[128];
+    for (int i = 0; i < 4; i++) {
+        blake2b::Hash(out + 32 * i, data + 1 + 64 * i, h0);
+    }
+    if (!std::equal(out, out + 128, result)) return false;
+
+    // Test Hash_4way, if available.
+    if (Hash_4way) {
+        memset(out, 0, sizeof(out));
+        Hash_4way(out, data + 1, h0);
+        if (!std::equal(out, out + 128, result)) return false;
+    }
+
+    return true;
+}
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+} // namespace
+
+std::string BLAKE2b64AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    uint32_t eax, ebx, ecx, edx;
+    __cpuid(1, eax, ebx, ecx, edx);
+    bool have_xsave = (ecx >> 27) & 1;
+    bool have_avx = (ecx >> 28) & 1;
+    bool have_avx2 = false;
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+    if (have_xsave && have_avx && have_avx2 && AVXEnabled()) {
+        Hash_4way = blake2b64_avx2::Hash_4way;
+        ret = "standard(1way),avx2(4way)";
+    }
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
+void BLAKE2b64(unsigned char* out, const unsigned char* in, size_t blocks, const unsigned char* personal)
+{
+    uint64_t h0[8];
+    blake2b::Initialize(h0, personal);
+
+    if (Hash_4way) {
+        while (blocks >= 4) {
+            Hash_4way(out, in, h0);
+            out += 128;
+            in += 256;
+            blocks -= 4;
+        }
+    }
+    while (blocks) {
+        blake2b::Hash(out, in, h0);
+        out += 32;
+        in += 64;
+        blocks -= 1;
+    }
+}
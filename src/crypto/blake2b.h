@@ -0,0 +1,19 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_CRYPTO_BLAKE2B_H
+#define BITCOIN_CRYPTO_BLAKE2B_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** Autodetect the best available BLAKE2b implementation for 64-byte inputs. Returns the name of the implementation. */
+std::string BLAKE2b64AutoDetect();
+
+/** Compute the 32-byte, personalized BLAKE2b hashes of blocks 64-byte inputs, such as the pairs of node hashes of
+ *  a merkle mountain range layer. personal must point to crypto_generichash_blake2b_PERSONALBYTES (16) bytes. */
+void BLAKE2b64(unsigned char* output, const unsigned char* input, size_t blocks, const unsigned char* personal);
+
+#endif // BITCOIN_CRYPTO_BLAKE2B_H
@@ -0,0 +1,204 @@
+// Copyright (c) 2018-2023 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+// This is an implementation of SHA-256 using the x86 SHA extensions, following the
+// instruction sequence in Intel's "Intel SHA Extensions" white paper. The state is kept
+// in the ABEF/CDGH register layout that sha256rnds2 expects between blocks.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace {
+
+alignas(__m128i) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+alignas(__m128i) const uint32_t IV[8] = {
+    0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul
+};
+
+/** Byte order mask that turns each 32-bit word of a block from big endian to native. */
+__m128i inline ByteSwapMask() { return _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL); }
+
+/** Convert a state in word order s[0..7] to the ABEF/CDGH layout. */
+void inline Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1); // CDAB
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B); // EFGH
+    s0 = _mm_alignr_epi8(t1, t2, 0x08); // ABEF
+    s1 = _mm_blend_epi16(t2, t1, 0xF0); // CDGH
+}
+
+/** Convert a state from the ABEF/CDGH layout back to word order. */
+void inline Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B); // FEBA
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1); // DCHG
+    s0 = _mm_blend_epi16(t1, t2, 0xF0); // DCBA
+    s1 = _mm_alignr_epi8(t2, t1, 0x08); // HGFE
+}
+
+/** One transformation of the 64-byte block in w, which is consumed as the message schedule. */
+void inline Block(__m128i& s0, __m128i& s1, __m128i* w)
+{
+    const __m128i save0 = s0, save1 = s1;
+
+    for (int i = 0; i < 16; i++) {
+        __m128i msg = _mm_add_epi32(w[i & 3], _mm_load_si128((const __m128i*)(K + 4 * i)));
+        s1 = _mm_sha256rnds2_epu32(s1, s0, msg);
+        if (i >= 3 && i < 15) {
+            const __m128i tmp = _mm_alignr_epi8(w[i & 3], w[(i - 1) & 3], 4);
+            w[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(i + 1) & 3], tmp), w[i & 3]);
+        }
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        s0 = _mm_sha256rnds2_epu32(s0, s1, msg);
+        if (i >= 1 && i < 13) {
+            w[(i - 1) & 3] = _mm_sha256msg1_epu32(w[(i - 1) & 3], w[i & 3]);
+        }
+    }
+
+    s0 = _mm_add_epi32(s0, save0);
+    s1 = _mm_add_epi32(s1, save1);
+}
+
+/** The same transformation for two independent streams, interleaved for instruction level parallelism. */
+void inline Block2(__m128i& as0, __m128i& as1, __m128i* aw, __m128i& bs0, __m128i& bs1, __m128i* bw)
+{
+    const __m128i asave0 = as0, asave1 = as1, bsave0 = bs0, bsave1 = bs1;
+
+    for (int i = 0; i < 16; i++) {
+        const __m128i k = _mm_load_si128((const __m128i*)(K + 4 * i));
+        __m128i amsg = _mm_add_epi32(aw[i & 3], k);
+        __m128i bmsg = _mm_add_epi32(bw[i & 3], k);
+        as1 = _mm_sha256rnds2_epu32(as1, as0, amsg);
+        bs1 = _mm_sha256rnds2_epu32(bs1, bs0, bmsg);
+        if (i >= 3 && i < 15) {
+            const __m128i atmp = _mm_alignr_epi8(aw[i & 3], aw[(i - 1) & 3], 4);
+            const __m128i btmp = _mm_alignr_epi8(bw[i & 3], bw[(i - 1) & 3], 4);
+            aw[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(aw[(i + 1) & 3], atmp), aw[i & 3]);
+            bw[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(bw[(i + 1) & 3], btmp), bw[i & 3]);
+        }
+        amsg = _mm_shuffle_epi32(amsg, 0x0E);
+        bmsg = _mm_shuffle_epi32(bmsg, 0x0E);
+        as0 = _mm_sha256rnds2_epu32(as0, as1, amsg);
+        bs0 = _mm_sha256rnds2_epu32(bs0, bs1, bmsg);
+        if (i >= 1 && i < 13) {
+            aw[(i - 1) & 3] = _mm_sha256msg1_epu32(aw[(i - 1) & 3], aw[i & 3]);
+            bw[(i - 1) & 3] = _mm_sha256msg1_epu32(bw[(i - 1) & 3], bw[i & 3]);
+        }
+    }
+
+    as0 = _mm_add_epi32(as0, asave0);
+    as1 = _mm_add_epi32(as1, asave1);
+    bs0 = _mm_add_epi32(bs0, bsave0);
+    bs1 = _mm_add_epi32(bs1, bsave1);
+}
+
+void inline Load(__m128i* w, const unsigned char* chunk)
+{
+    const __m128i mask = ByteSwapMask();
+    for (int i = 0; i < 4; i++) {
+        w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 16 * i)), mask);
+    }
+}
+
+void inline InitState(__m128i& s0, __m128i& s1)
+{
+    s0 = _mm_load_si128((const __m128i*)IV);
+    s1 = _mm_load_si128((const __m128i*)(IV + 4));
+    Shuffle(s0, s1);
+}
+
+/** Message words for the padding block that follows a 64-byte input. */
+void inline PaddingBlock64(__m128i* w)
+{
+    w[0] = _mm_set_epi32(0, 0, 0, 0x80000000ul);
+    w[1] = _mm_setzero_si128();
+    w[2] = _mm_setzero_si128();
+    w[3] = _mm_set_epi32(512, 0, 0, 0);
+}
+
+/** Message words for a padded 32-byte digest, taken from a state in the ABEF/CDGH layout. */
+void inline DigestBlock(__m128i* w, __m128i s0, __m128i s1)
+{
+    Unshuffle(s0, s1);
+    w[0] = s0;
+    w[1] = s1;
+    w[2] = _mm_set_epi32(0, 0, 0, 0x80000000ul);
+    w[3] = _mm_set_epi32(256, 0, 0, 0);
+}
+
+void inline Store(unsigned char* out, __m128i s0, __m128i s1)
+{
+    const __m128i mask = ByteSwapMask();
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(s0, mask));
+    _mm_storeu_si128((__m128i*)(out + 16), _mm_shuffle_epi8(s1, mask));
+}
+
+}
+
+namespace sha256_shani {
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i*)s);
+    __m128i s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    __m128i w[4];
+    Shuffle(s0, s1);
+
+    while (blocks--) {
+        Load(w, chunk);
+        Block(s0, s1, w);
+        chunk += 64;
+    }
+
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+}
+
+namespace sha256d64_shani {
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    __m128i as0, as1, bs0, bs1;
+    __m128i aw[4], bw[4];
+
+    // the two 64-byte inputs
+    InitState(as0, as1);
+    InitState(bs0, bs1);
+    Load(aw, in);
+    Load(bw, in + 64);
+    Block2(as0, as1, aw, bs0, bs1, bw);
+
+    // their padding blocks
+    PaddingBlock64(aw);
+    PaddingBlock64(bw);
+    Block2(as0, as1, aw, bs0, bs1, bw);
+
+    // the second hashes, of the 32-byte digests
+    DigestBlock(aw, as0, as1);
+    DigestBlock(bw, bs0, bs1);
+    InitState(as0, as1);
+    InitState(bs0, bs1);
+    Block2(as0, as1, aw, bs0, bs1, bw);
+
+    Store(out, as0, as1);
+    Store(out + 32, bs0, bs1);
+}
+}
+
+#endif
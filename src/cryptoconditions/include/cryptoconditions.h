@@ -111,6 +111,13 @@ uint32_t        cc_typeMask(const CC *cond);
 int             cc_isAnon(const CC *cond);
 void            cc_free(struct CC *cond);
 
+/*
+ * Open and close an arena on the calling thread for the ASN.1 structures that reading and writing
+ * conditions and fulfillments allocate. Arenas nest, and closing the outermost one frees them all at once.
+ */
+void            cc_arenaBegin(void);
+void            cc_arenaEnd(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * Copyright © 2014-2018 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * Per thread arena for the ASN.1 decoder and encoder. While an arena is open on a thread,
+ * the CALLOC, MALLOC and REALLOC of the asn1c runtime allocate from it and FREEMEM of
+ * its memory does nothing. Closing the outermost arena releases everything at once.
+ *
+ * Crypto-condition nodes (CC) are not allocated here, so they may outlive the arena.
+ * ASN.1 structures must not: every one decoded or built while an arena is open has to be
+ * freed before it is closed.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cryptoconditions.h"
+
+#define ARENA_CHUNK_SIZE 16384
+#define ARENA_ALIGN 16
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;
+    size_t used;
+    unsigned char *data;
+} ArenaChunk;
+
+// each allocation is preceded by its size, so that it can be reallocated
+typedef union ArenaHeader {
+    size_t size;
+    unsigned char align[ARENA_ALIGN];
+} ArenaHeader;
+
+static _Thread_local ArenaChunk *arenaChunks = NULL;
+static _Thread_local int arenaDepth = 0;
+
+
+static ArenaChunk *arenaNewChunk(size_t minSize) {
+    size_t size = minSize > ARENA_CHUNK_SIZE ? minSize : ARENA_CHUNK_SIZE;
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + size + ARENA_ALIGN);
+    if (!chunk) return NULL;
+    chunk->next = arenaChunks;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->data = (unsigned char *)(((uintptr_t)(chunk + 1) + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1));
+    arenaChunks = chunk;
+    return chunk;
+}
+
+
+static int arenaOwns(const void *ptr) {
+    for (ArenaChunk *chunk = arenaChunks; chunk; chunk = chunk->next) {
+        if ((const unsigned char *)ptr >= chunk->data && (const unsigned char *)ptr < chunk->data + chunk->size) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static void *arenaAlloc(size_t size) {
+    size_t needed = sizeof(ArenaHeader) + ((size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1));
+    if (needed < size) return NULL;
+    ArenaChunk *chunk = arenaChunks;
+    if (!chunk || chunk->size - chunk->used < needed) {
+        chunk = arenaNewChunk(needed);
+        if (!chunk) return NULL;
+    }
+    ArenaHeader *header = (ArenaHeader *)(chunk->data + chunk->used);
+    chunk->used += needed;
+    header->size = size;
+    return header + 1;
+}
+
+
+void cc_arenaBegin(void) {
+    arenaDepth++;
+}
+
+
+void cc_arenaEnd(void) {
+    if (arenaDepth == 0 || --arenaDepth > 0) return;
+
+    // keep one standard chunk for the next arena on this thread
+    ArenaChunk *keep = NULL;
+    ArenaChunk *chunk = arenaChunks;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        if (!keep && chunk->size == ARENA_CHUNK_SIZE) {
+            keep = chunk;
+        } else {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    if (keep) {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    arenaChunks = keep;
+}
+
+
+void *cc_arenaMalloc(size_t size) {
+    return arenaDepth ? arenaAlloc(size) : malloc(size);
+}
+
+
+void *cc_arenaCalloc(size_t nmemb, size_t size) {
+    if (!arenaDepth) return calloc(nmemb, size);
+    if (size && nmemb > SIZE_MAX / size) return NULL;
+    void *ptr = arenaAlloc(nmemb * size);
+    if (ptr) memset(ptr, 0, nmemb * size);
+    return ptr;
+}
+
+
+void *cc_arenaRealloc(void *ptr, size_t size) {
+    if (!ptr) return cc_arenaMalloc(size);
+    if (!arenaOwns(ptr)) return realloc(ptr, size);
+
+    size_t oldSize = ((ArenaHeader *)ptr - 1)->size;
+    void *newPtr = arenaDepth ? arenaAlloc(size) : malloc(size);
+    if (newPtr) memcpy(newPtr, ptr, oldSize < size ? oldSize : size);
+    return newPtr;
+}
+
+
+void cc_arenaFree(void *ptr) {
+    if (ptr && !arenaOwns(ptr)) free(ptr);
+}
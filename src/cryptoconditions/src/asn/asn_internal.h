@@ -23,10 +23,16 @@ extern "C" {
 #define	ASN1C_ENVIRONMENT_VERSION	923	/* Compile-time version */
 int get_asn1c_environment_version(void);	/* Run-time version */
 
-#define	CALLOC(nmemb, size)	calloc(nmemb, size)
-#define	MALLOC(size)		malloc(size)
-#define	REALLOC(oldptr, size)	realloc(oldptr, size)
-#define	FREEMEM(ptr)		free(ptr)
+/* Allocations go to the thread's arena while one is open, see cryptoconditions src/arena.c */
+#define	CALLOC(nmemb, size)	cc_arenaCalloc(nmemb, size)
+#define	MALLOC(size)		cc_arenaMalloc(size)
+#define	REALLOC(oldptr, size)	cc_arenaRealloc(oldptr, size)
+#define	FREEMEM(ptr)		cc_arenaFree(ptr)
+
+void *cc_arenaCalloc(size_t nmemb, size_t size);
+void *cc_arenaMalloc(size_t size);
+void *cc_arenaRealloc(void *ptr, size_t size);
+void cc_arenaFree(void *ptr);
 
 #define	asn_debug_indent	0
 #define ASN_DEBUG_INDENT_ADD(i) do{}while(0)
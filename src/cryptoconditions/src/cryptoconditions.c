@@ -17,6 +17,7 @@
 #include "asn/Condition.h"
 #include "asn/Fulfillment.h"
 #include "asn/OCTET_STRING.h"
+#include "asn/asn_internal.h"
 #include "include/cryptoconditions.h"
 #include "src/internal.h"
 #include "src/threshold.c"
@@ -245,7 +246,7 @@ CC *partialFulfillmentToCC(Fulfillment_t *ffill) {
 
 CC *cc_readFulfillmentBinary(const unsigned char *ffill_bin, size_t ffill_bin_len) {
     CC *cond = 0;
-    unsigned char *buf = calloc(1,ffill_bin_len);
+    unsigned char *buf = CALLOC(1,ffill_bin_len);
     Fulfillment_t *ffill = 0;
     asn_dec_rval_t rval = ber_decode(0, &asn_DEF_Fulfillment, (void **)&ffill, ffill_bin, ffill_bin_len);
     if (rval.code != RC_OK) {
@@ -263,7 +264,7 @@ CC *cc_readFulfillmentBinary(const unsigned char *ffill_bin, size_t ffill_bin_le
     
     cond = fulfillmentToCC(ffill);
 end:
-    free(buf);
+    FREEMEM(buf);
     if (ffill) ASN_STRUCT_FREE(asn_DEF_Fulfillment, ffill);
     return cond;
 }
@@ -271,7 +272,7 @@ end:
 int cc_readFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ffill_bin_len, CC **ppcc) {
 
     int error = 0;
-    unsigned char *buf = calloc(1,ffill_bin_len);
+    unsigned char *buf = CALLOC(1,ffill_bin_len);
     Fulfillment_t *ffill = 0;
     asn_dec_rval_t rval = ber_decode(0, &asn_DEF_Fulfillment, (void **)&ffill, ffill_bin, ffill_bin_len);
     if (rval.code != RC_OK) {
@@ -305,7 +306,7 @@ int cc_readFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ffill_bin
     
     *ppcc = fulfillmentToCC(ffill);
 end:
-    free(buf);
+    FREEMEM(buf);
     if (ffill) ASN_STRUCT_FREE(asn_DEF_Fulfillment, ffill);
     return error;
 }
@@ -313,7 +314,7 @@ end:
 int cc_readPartialFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ffill_bin_len, CC **ppcc) {
 
     int error = 0;
-    unsigned char *buf = calloc(1,ffill_bin_len);
+    unsigned char *buf = CALLOC(1,ffill_bin_len);
     Fulfillment_t *ffill = 0;
     asn_dec_rval_t rval = ber_decode(0, &asn_DEF_Fulfillment, (void **)&ffill, ffill_bin, ffill_bin_len);
     if (rval.code != RC_OK) {
@@ -347,7 +348,7 @@ int cc_readPartialFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ff
     
     *ppcc = partialFulfillmentToCC(ffill);
 end:
-    free(buf);
+    FREEMEM(buf);
     if (ffill) ASN_STRUCT_FREE(asn_DEF_Fulfillment, ffill);
     return error;
 }
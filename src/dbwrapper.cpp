@@ -4,6 +4,7 @@
 
 #include "dbwrapper.h"
 
+#include "sync.h"
 #include "util.h"
 
 #include <boost/filesystem.hpp>
@@ -14,10 +15,51 @@
 #include <memenv.h>
 #include <stdint.h>
 
+namespace {
+
+/** LRU block cache that counts its lookups and hits */
+class CCountingCache : public leveldb::Cache
+{
+private:
+    leveldb::Cache *pcache;
+
+public:
+    std::atomic<uint64_t> nLookups;
+    std::atomic<uint64_t> nHits;
+
+    CCountingCache(size_t capacity) : pcache(leveldb::NewLRUCache(capacity)), nLookups(0), nHits(0) {}
+    ~CCountingCache() { delete pcache; }
+
+    Handle* Insert(const leveldb::Slice& key, void* value, size_t charge, void (*deleter)(const leveldb::Slice& key, void* value))
+    {
+        return pcache->Insert(key, value, charge, deleter);
+    }
+
+    Handle* Lookup(const leveldb::Slice& key)
+    {
+        Handle *handle = pcache->Lookup(key);
+        nLookups++;
+        if (handle) {
+            nHits++;
+        }
+        return handle;
+    }
+
+    void Release(Handle* handle) { pcache->Release(handle); }
+    void* Value(Handle* handle) { return pcache->Value(handle); }
+    void Erase(const leveldb::Slice& key) { pcache->Erase(key); }
+    uint64_t NewId() { return pcache->NewId(); }
+};
+
+CCriticalSection cs_dbwrappers;
+std::vector<const CDBWrapper*> vDBWrappers;
+
+}
+
 static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxOpenFiles)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
+    options.block_cache = new CCountingCache(nCacheSize / 2);
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
     options.compression = compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
@@ -33,6 +75,9 @@ static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxO
 CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles)
 {
     penv = NULL;
+    name = path.filename().string();
+    nReads = 0;
+    nReadsFound = 0;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
@@ -54,10 +99,17 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+
+    LOCK(cs_dbwrappers);
+    vDBWrappers.push_back(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(cs_dbwrappers);
+        vDBWrappers.erase(std::remove(vDBWrappers.begin(), vDBWrappers.end(), this), vDBWrappers.end());
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
@@ -82,7 +134,42 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
-CDBIterator::~CDBIterator() { delete piter; }
+CDBIterator *CDBWrapper::NewScanIterator() const
+{
+    leveldb::ReadOptions scanoptions = iteroptions;
+    scanoptions.snapshot = pdb->GetSnapshot();
+    return new CDBIterator(*this, pdb->NewIterator(scanoptions), scanoptions.snapshot);
+}
+
+CDBStats CDBWrapper::GetStats() const
+{
+    CDBStats stats;
+    stats.name = name;
+    stats.reads = nReads;
+    stats.readsFound = nReadsFound;
+    const CCountingCache *pcache = static_cast<const CCountingCache*>(options.block_cache);
+    stats.cacheLookups = pcache->nLookups;
+    stats.cacheHits = pcache->nHits;
+    return stats;
+}
+
+std::vector<CDBStats> GetDBStats()
+{
+    std::vector<CDBStats> vStats;
+    LOCK(cs_dbwrappers);
+    for (const CDBWrapper *pdbw : vDBWrappers) {
+        vStats.push_back(pdbw->GetStats());
+    }
+    return vStats;
+}
+
+CDBIterator::~CDBIterator()
+{
+    delete piter;
+    if (psnapshot) {
+        parent.pdb->ReleaseSnapshot(psnapshot);
+    }
+}
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
 void CDBIterator::SeekToLast() { piter->SeekToLast(); }
@@ -105,4 +192,11 @@ void HandleError(const leveldb::Status& status)
     throw dbwrapper_error("Unknown database error");
 }
 
+CDataStream& GetKeyBuffer()
+{
+    static thread_local CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+    return ssKey;
+}
+
 };
@@ -13,6 +13,9 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <atomic>
+#include <vector>
+
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
@@ -35,6 +38,22 @@ namespace dbwrapper_private {
  */
 void HandleError(const leveldb::Status& status);
 
+/** Key buffer of the calling thread for point reads, which is reused so that encoding a key does not allocate.
+ */
+CDataStream& GetKeyBuffer();
+
+};
+
+/** Read and block cache counters of one database */
+struct CDBStats
+{
+    std::string name;
+    uint64_t reads;             //!< point reads
+    uint64_t readsFound;        //!< point reads that found their key
+    uint64_t cacheLookups;      //!< block cache lookups, from point reads and iterators
+    uint64_t cacheHits;         //!< block cache lookups that did not need to read the block from disk
+
+    CDBStats() : reads(0), readsFound(0), cacheLookups(0), cacheHits(0) {}
 };
 
 /** Batch of changes queued to be written to a CDBWrapper */
@@ -68,6 +87,12 @@ public:
         batch.Put(slKey, slValue);
     }
 
+    //! write a key and value that are already serialized, as read with CDBIterator::GetRawKey and GetRawValue
+    void WriteRaw(const std::string &key, const std::string &value)
+    {
+        batch.Put(key, value);
+    }
+
     template <typename K>
     void Erase(const K& key)
     {
@@ -85,15 +110,17 @@ class CDBIterator
 private:
     const CDBWrapper &parent;
     leveldb::Iterator *piter;
+    const leveldb::Snapshot *psnapshot;
 
 public:
 
     /**
      * @param[in] _parent          Parent CDBWrapper instance.
      * @param[in] _piter           The original leveldb iterator.
+     * @param[in] _psnapshot       Snapshot that the iterator reads from and releases when done, if any.
      */
-    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter) :
-        parent(_parent), piter(_piter) { };
+    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter, const leveldb::Snapshot *_psnapshot = NULL) :
+        parent(_parent), piter(_piter), psnapshot(_psnapshot) { };
     ~CDBIterator();
 
     bool Valid();
@@ -127,6 +154,10 @@ public:
         return piter->key().size();
     }
 
+    std::string GetRawKey() {
+        return piter->key().ToString();
+    }
+
     template<typename V> bool GetValue(V& value) {
         leveldb::Slice slValue = piter->value();
         try {
@@ -142,10 +173,15 @@ public:
         return piter->value().size();
     }
 
+    std::string GetRawValue() {
+        return piter->value().ToString();
+    }
+
 };
 
 class CDBWrapper
 {
+    friend class CDBIterator;
 private:
     //! custom environment this database is using (may be NULL in case of default environment)
     leveldb::Env* penv;
@@ -168,6 +204,13 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! name of the database in its statistics
+    std::string name;
+
+    //! point read counters
+    mutable std::atomic<uint64_t> nReads;
+    mutable std::atomic<uint64_t> nReadsFound;
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -181,19 +224,21 @@ public:
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        CDataStream& ssKey = dbwrapper_private::GetKeyBuffer();
+        ssKey.clear();
         ssKey << key;
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        nReads++;
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        nReadsFound++;
         try {
             CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> value;
@@ -214,19 +259,21 @@ public:
     template <typename K>
     bool Exists(const K& key) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        CDataStream& ssKey = dbwrapper_private::GetKeyBuffer();
+        ssKey.clear();
         ssKey << key;
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        nReads++;
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        nReadsFound++;
         return true;
     }
 
@@ -257,11 +304,22 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /**
+     * Return an iterator for a bulk scan, which reads from its own snapshot, so that a long scan sees one consistent
+     * state of the database without holding any lock. Like all iterators, it does not fill the block cache.
+     */
+    CDBIterator *NewScanIterator() const;
+
+    CDBStats GetStats() const;
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
 };
 
+/** Return the statistics of every open database */
+std::vector<CDBStats> GetDBStats();
+
 #endif // BITCOIN_DBWRAPPER_H
 
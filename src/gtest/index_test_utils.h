@@ -0,0 +1,91 @@
+#ifndef GTEST_INDEX_TEST_UTILS_H
+#define GTEST_INDEX_TEST_UTILS_H
+
+#include "clientversion.h"
+#include "main.h"
+#include "streams.h"
+#include "txdb.h"
+
+#include <list>
+
+// a key of a block tree database index as it is on disk, in the order that range scans see it
+template <typename KEYTYPE>
+std::vector<unsigned char> SerializedIndexKey(char prefix, const KEYTYPE &key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << std::make_pair(prefix, key);
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+inline uint160 TestID(unsigned char fill)
+{
+    return uint160(std::vector<unsigned char>(20, fill));
+}
+
+// An in-memory block tree database with the offer and identity history indexes enabled, which is the node's
+// until it goes out of scope
+class TestIndexDB
+{
+public:
+    CBlockTreeDB db;
+
+    TestIndexDB() : db(1 << 20, true), pSavedDB(pblocktree), fSavedOfferIndex(fOfferIndex), fSavedIdHistoryIndex(fIdHistoryIndex)
+    {
+        pblocktree = &db;
+        fOfferIndex = true;
+        fIdHistoryIndex = true;
+    }
+
+    ~TestIndexDB()
+    {
+        pblocktree = pSavedDB;
+        fOfferIndex = fSavedOfferIndex;
+        fIdHistoryIndex = fSavedIdHistoryIndex;
+    }
+
+private:
+    CBlockTreeDB *pSavedDB;
+    bool fSavedOfferIndex;
+    bool fSavedIdHistoryIndex;
+};
+
+// Blocks of the active chain and block index from height 0, which leave both when they are disconnected or when it
+// goes out of scope. Only the hash and height of each block are set.
+class TestIndexChain
+{
+public:
+    ~TestIndexChain()
+    {
+        chainActive.SetTip(NULL);
+        for (auto &oneBlock : blocks)
+        {
+            mapBlockIndex.erase(oneBlock.first);
+        }
+    }
+
+    const CBlockIndex *Connect(const CBlock &block)
+    {
+        CBlockIndex *pprev = blocks.size() ? &blocks.back().second : NULL;
+        blocks.emplace_back();
+        blocks.back().first = block.GetHash();
+        CBlockIndex *pindex = &blocks.back().second;
+        pindex->phashBlock = &blocks.back().first;
+        pindex->pprev = pprev;
+        pindex->SetHeight(blocks.size() - 1);
+        mapBlockIndex.insert(std::make_pair(blocks.back().first, pindex));
+        chainActive.SetTip(pindex);
+        return pindex;
+    }
+
+    void Disconnect()
+    {
+        chainActive.SetTip(blocks.back().second.pprev);
+        mapBlockIndex.erase(blocks.back().first);
+        blocks.pop_back();
+    }
+
+private:
+    std::list<std::pair<uint256, CBlockIndex>> blocks;
+};
+
+#endif // GTEST_INDEX_TEST_UTILS_H
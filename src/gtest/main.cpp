@@ -1,5 +1,7 @@
 #include "gmock/gmock.h"
 #include "crypto/common.h"
+#include "crypto/blake2b.h"
+#include "crypto/sha256.h"
 #include "key.h"
 #include "pubkey.h"
 #include "zcash/JoinSplit.hpp"
@@ -18,6 +20,8 @@ ZCJoinSplit* params;
 
 int main(int argc, char **argv) {
   assert(init_and_check_sodium() != -1);
+  SHA256AutoDetect();
+  BLAKE2b64AutoDetect();
   ECC_Start();
 
   params = ZCJoinSplit::Prepared();
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "key.h"
+#include "random.h"
+#include "script/cc.h"
+#include "cc/eval.h"
+
+namespace {
+
+std::vector<unsigned char> SignedFulfillment(CC *cond, const CKey &key)
+{
+    uint256 msg = GetRandHash();
+    cc_signTreeSecp256k1Msg32(cond, key.begin(), msg.begin());
+    std::vector<unsigned char> ffill(MAX_BINARY_CC_SIZE);
+    ffill.resize(cc_fulfillmentBinary(cond, ffill.data(), ffill.size()));
+    return ffill;
+}
+
+std::vector<unsigned char> ConditionBinary(const CC *cond)
+{
+    std::vector<unsigned char> condBin(MAX_BINARY_CC_SIZE);
+    condBin.resize(cc_conditionBinary(cond, condBin.data(), condBin.size()));
+    return condBin;
+}
+
+}
+
+TEST(CCArena, ReadsTheSameInAndOutOfArena) {
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    CC *cond = CCNewThreshold(2, {CCNewEval(std::vector<unsigned char>(1, EVAL_RESERVE_OUTPUT)),
+                                  CCNewThreshold(1, {CCNewSecp256k1(key1.GetPubKey()), CCNewSecp256k1(key2.GetPubKey())})});
+    std::vector<unsigned char> ffill = SignedFulfillment(cond, key1);
+    std::vector<unsigned char> condBin = ConditionBinary(cond);
+    ASSERT_FALSE(ffill.empty());
+    ASSERT_FALSE(condBin.empty());
+
+    CC *plainCond = NULL;
+    ASSERT_EQ(cc_readFulfillmentBinaryExt(ffill.data(), ffill.size(), &plainCond), 0);
+
+    for (int i = 0; i < 3; i++)
+    {
+        CC *arenaCond = NULL;
+        {
+            CCArenaScope arena;
+            // nested scopes share the outer arena
+            CCArenaScope inner;
+            ASSERT_EQ(cc_readFulfillmentBinaryExt(ffill.data(), ffill.size(), &arenaCond), 0);
+            CC *readCond = cc_readConditionBinary(condBin.data(), condBin.size());
+            ASSERT_NE(readCond, nullptr);
+            EXPECT_EQ(ConditionBinary(readCond), condBin);
+            cc_free(readCond);
+        }
+        // conditions read in an arena remain usable after it is closed
+        ASSERT_NE(arenaCond, nullptr);
+        EXPECT_EQ(ConditionBinary(arenaCond), ConditionBinary(plainCond));
+        EXPECT_EQ(cc_typeMask(arenaCond), cc_typeMask(plainCond));
+        cc_free(arenaCond);
+    }
+
+    // a non canonical encoding is rejected in an arena as well
+    std::vector<unsigned char> badFfill = ffill;
+    badFfill.push_back(0);
+    {
+        CCArenaScope arena;
+        CC *badCond = NULL;
+        EXPECT_NE(cc_readFulfillmentBinaryExt(badFfill.data(), badFfill.size(), &badCond), 0);
+        if (badCond) {
+            cc_free(badCond);
+        }
+    }
+
+    cc_free(plainCond);
+    cc_free(cond);
+}
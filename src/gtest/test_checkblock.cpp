@@ -23,6 +23,8 @@ public:
     MOCK_CONST_METHOD0(GetRejectReason, std::string());
 };
 
+extern uint32_t ASSETCHAINS_ALGO, ASSETCHAINS_EQUIHASH;
+
 int32_t futureblock;
 TEST(CheckBlock, VersionTooLow) {
     auto verifier = libzcash::ProofVerifier::Strict();
@@ -36,6 +38,42 @@ TEST(CheckBlock, VersionTooLow) {
 }
 
 
+TEST(CheckBlock, HeaderCheckHashes) {
+    // Equihash solutions are not checked on regtest
+    SelectParams(CBaseChainParams::REGTEST);
+
+    std::vector<CBlockHeader> headers(4);
+    std::vector<CHeaderCheckResult> results(headers.size());
+    for (int i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 4;
+        headers[i].nTime = 1600000000 + i;
+        headers[i].nNonce = ArithToUint256(arith_uint256(i + 1));
+        EXPECT_FALSE(results[i].fChecked);
+    }
+
+    for (int i = 0; i < headers.size(); i++) {
+        CHeaderCheck check(headers[i], results[i]);
+        CHeaderCheck swapped;
+        swapped.swap(check);
+        EXPECT_TRUE(swapped());
+        EXPECT_TRUE(results[i].fChecked);
+        EXPECT_TRUE(results[i].fValid);
+        EXPECT_EQ(headers[i].GetHash(), results[i].hash);
+    }
+    EXPECT_NE(results[0].hash, results[1].hash);
+
+    // with Equihash, a header without a valid solution fails, but is still hashed
+    if (ASSETCHAINS_ALGO == ASSETCHAINS_EQUIHASH) {
+        SelectParams(CBaseChainParams::MAIN);
+        CHeaderCheckResult badResult;
+        EXPECT_FALSE(CHeaderCheck(headers[0], badResult)());
+        EXPECT_TRUE(badResult.fChecked);
+        EXPECT_FALSE(badResult.fValid);
+        EXPECT_EQ(headers[0].GetHash(), badResult.hash);
+    }
+    SelectParams(CBaseChainParams::MAIN);
+}
+
 // Test that a Sprout tx with negative version is still rejected
 // by CheckBlock under Sprout consensus rules.
 TEST(CheckBlock, BlockSproutRejectsBadVersion) {
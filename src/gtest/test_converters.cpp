@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include "pbaas/converters.h"
+
+namespace {
+
+CConversionHop TestHop(CAmount amountOut, CAmount spotAmountOut)
+{
+    CConversionHop hop;
+    hop.amountIn = spotAmountOut;
+    hop.amountOut = amountOut;
+    hop.spotAmountOut = spotAmountOut;
+    return hop;
+}
+
+}
+
+TEST(ConverterGraph, RouteSlippageCompoundsOverHops) {
+    CConversionRoute route;
+    route.hops.push_back(TestHop(100000000, 100000000));
+    EXPECT_EQ(route.Slippage(), 0);
+
+    // 10% on the first hop and 10% on the second is 19% for the route
+    route.hops[0] = TestHop(90000000, 100000000);
+    EXPECT_EQ(route.Slippage(), 10000000);
+    route.hops.push_back(TestHop(45000000, 50000000));
+    EXPECT_EQ(route.Slippage(), 19000000);
+
+    // a better than spot estimate is no slippage
+    route.hops.clear();
+    route.hops.push_back(TestHop(110000000, 100000000));
+    EXPECT_EQ(route.Slippage(), 0);
+}
+
+TEST(ConverterGraph, HopKinds) {
+    CConversionHop hop;
+    hop.converterID = uint160(std::vector<unsigned char>(20, 1));
+    hop.sourceID = uint160(std::vector<unsigned char>(20, 2));
+    hop.destID = uint160(std::vector<unsigned char>(20, 3));
+    EXPECT_TRUE(hop.IsReserveToReserve());
+    hop.destID = hop.converterID;
+    EXPECT_FALSE(hop.IsReserveToReserve());
+}
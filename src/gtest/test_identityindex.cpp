@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+
+#include "cc/CCinclude.h"
+#include "gtest/index_test_utils.h"
+#include "hash.h"
+#include "identityindex.h"
+#include "main.h"
+#include "pbaas/identity.h"
+#include "random.h"
+#include "clientversion.h"
+#include "streams.h"
+
+namespace {
+
+// a block with a coinbase and a transaction that defines or updates identity
+CBlock IdentityBlock(const CIdentity &identity)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.push_back(CTxOut(1, CScript() << OP_TRUE));
+    block.vtx.push_back(coinbase);
+
+    std::vector<CTxDestination> dests({CTxDestination(CIdentityID(identity.GetID()))});
+    CMutableTransaction mtx;
+    mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+    mtx.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CIdentity>(EVAL_IDENTITY_PRIMARY, dests, 1, &identity))));
+    block.vtx.push_back(mtx);
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+
+// a content multimap entry that removes one entry of vdxfKey with value
+std::vector<unsigned char> RemoveEntry(const uint160 &vdxfKey, const std::vector<unsigned char> &value)
+{
+    CContentMultiMapRemove remove;
+    remove.version = CContentMultiMapRemove::VERSION_CURRENT;
+    remove.action = CContentMultiMapRemove::ACTION_REMOVE_ONE_KEYVALUE;
+    remove.entryKey = vdxfKey;
+    CNativeHashWriter hw;
+    hw.write((const char *)&value[0], value.size());
+    remove.valueHash = hw.GetHash();
+
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << CVDXF_Data::ContentMultiMapRemoveKey();
+    ss << VARINT(remove.version);
+    ss << COMPACTSIZE((uint64_t)GetSerializeSize(ss, remove));
+    ss << remove;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+CIdentity TestIdentity(const std::multimap<uint160, std::vector<unsigned char>> &content)
+{
+    return CIdentity(CIdentity::VERSION_PBAAS,
+                     0,
+                     std::vector<CTxDestination>({CTxDestination(CKeyID(TestID(0x44)))}),
+                     1,
+                     uint160(),
+                     "indextest",
+                     std::vector<std::pair<uint160, uint256>>(),
+                     content,
+                     TestID(0x55),
+                     TestID(0x66));
+}
+
+bool ConnectIdentities(const CBlock &block, const CBlockIndex *pindex)
+{
+    std::vector<CIdentityRevisionDbEntry> revisions;
+    std::vector<CIdentityContentDbEntry> content;
+    GetIdentityHistoryIndexEntries(block, pindex, revisions, content);
+    return pblocktree->WriteIdentityIndex(revisions, content);
+}
+
+bool DisconnectIdentities(const CBlock &block, const CBlockIndex *pindex)
+{
+    std::vector<CIdentityRevisionDbEntry> revisions;
+    std::vector<CIdentityContentDbEntry> content;
+    GetIdentityHistoryIndexEntries(block, pindex, revisions, content);
+    return pblocktree->EraseIdentityIndex(revisions, content);
+}
+
+std::vector<std::vector<unsigned char>> ContentByKey(const uint160 &identityID, const uint160 &vdxfKey, bool keepDeleted)
+{
+    LOCK(cs_main);
+    std::vector<std::vector<unsigned char>> values;
+    for (auto &oneEntry : CIdentity::GetIdentityContentByKey(identityID, vdxfKey, 0, 0, false, false, 0, keepDeleted))
+    {
+        values.push_back(std::get<0>(oneEntry));
+    }
+    return values;
+}
+
+}
+
+TEST(IdentityIndex, RevisionsSortByHeightOnDisk) {
+    uint160 identityID = TestID(0x11);
+    uint256 txid = uint256S("0xff");
+
+    std::vector<unsigned int> heights({0, 1, 255, 256, 65536, 0xffffffff});
+    for (int i = 1; i < heights.size(); i++)
+    {
+        CIdentityRevisionKey lower(identityID, heights[i - 1], 100, txid, 5);
+        CIdentityRevisionKey higher(identityID, heights[i], 0, uint256(), 0);
+        EXPECT_TRUE(SerializedIndexKey('I', lower) < SerializedIndexKey('I', higher));
+    }
+
+    // the first key of an identity at a height is where a range scan of its revisions starts
+    CIdentityRevisionKey start(identityID, 256);
+    CIdentityRevisionKey first(identityID, 256, 0, txid, 1);
+    EXPECT_TRUE(SerializedIndexKey('I', start) < SerializedIndexKey('I', first));
+    EXPECT_TRUE(SerializedIndexKey('I', first) < SerializedIndexKey('I', CIdentityRevisionKey(TestID(0x12))));
+
+    CIdentityRevisionKey roundTrip;
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << first;
+    EXPECT_EQ(ss.size(), first.GetSerializeSize(SER_DISK, CLIENT_VERSION));
+    ss >> roundTrip;
+    EXPECT_EQ(roundTrip.identityID, first.identityID);
+    EXPECT_EQ(roundTrip.blockHeight, first.blockHeight);
+    EXPECT_EQ(roundTrip.txhash, first.txhash);
+    EXPECT_EQ(roundTrip.voutNum, first.voutNum);
+}
+
+TEST(IdentityIndex, ContentSortsInApplicationOrder) {
+    uint160 identityID = TestID(0x11);
+    uint160 vdxfKey = TestID(0x33);
+    uint256 txid = uint256S("0x01");
+
+    // entries of one key in one revision keep their order in the content multimap
+    CIdentityContentKey a(identityID, vdxfKey, 10, 1, txid, 0, 3);
+    CIdentityContentKey b(identityID, vdxfKey, 10, 1, txid, 0, 7);
+    CIdentityContentKey c(identityID, vdxfKey, 11, 0, uint256(), 0, 0);
+    EXPECT_TRUE(a.AppliesBefore(b));
+    EXPECT_TRUE(b.AppliesBefore(c));
+    EXPECT_FALSE(c.AppliesBefore(a));
+    EXPECT_TRUE(SerializedIndexKey('V', a) < SerializedIndexKey('V', b));
+    EXPECT_TRUE(SerializedIndexKey('V', b) < SerializedIndexKey('V', c));
+
+    // entries of another key in the same revision merge by their position in the revision
+    CIdentityContentKey other(identityID, TestID(0x01), 10, 1, txid, 0, 5);
+    EXPECT_TRUE(a.AppliesBefore(other));
+    EXPECT_TRUE(other.AppliesBefore(b));
+    EXPECT_TRUE(other.SameRevision(a));
+    EXPECT_FALSE(other.SameRevision(c));
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << c;
+    EXPECT_EQ(ss.size(), c.GetSerializeSize(SER_DISK, CLIENT_VERSION));
+}
+
+TEST(IdentityIndex, RevisionsFollowConnectAndDisconnect) {
+    TestIndexDB indexDB;
+    TestIndexChain chain;
+    uint160 vdxfKey = TestID(0x33);
+    std::vector<unsigned char> a({'a'}), b({'b'});
+
+    CBlock block0 = IdentityBlock(TestIdentity({{vdxfKey, a}}));
+    CBlock block1 = IdentityBlock(TestIdentity({{vdxfKey, b}}));
+    uint160 identityID = TestIdentity({}).GetID();
+    ASSERT_TRUE(ConnectIdentities(block0, chain.Connect(block0)));
+    const CBlockIndex *pindex1 = chain.Connect(block1);
+    ASSERT_TRUE(ConnectIdentities(block1, pindex1));
+
+    std::vector<CIdentityRevisionDbEntry> revisions;
+    ASSERT_TRUE(GetIdentityRevisions(identityID, revisions));
+    ASSERT_EQ(revisions.size(), 2);
+    EXPECT_EQ(revisions[0].first.blockHeight, 0);
+    EXPECT_EQ(revisions[1].first.blockHeight, 1);
+    EXPECT_EQ(revisions[1].first.txhash, block1.vtx[1].GetHash());
+    EXPECT_EQ(revisions[1].second.blockHash, block1.GetHash());
+    EXPECT_EQ(ContentByKey(identityID, vdxfKey, false), std::vector<std::vector<unsigned char>>({a, b}));
+
+    // a disconnected block takes its revision and content out of the index
+    ASSERT_TRUE(DisconnectIdentities(block1, pindex1));
+    chain.Disconnect();
+    std::vector<CIdentityRevisionDbEntry> afterDisconnect;
+    ASSERT_TRUE(GetIdentityRevisions(identityID, afterDisconnect));
+    ASSERT_EQ(afterDisconnect.size(), 1);
+    EXPECT_EQ(afterDisconnect[0].second.blockHash, block0.GetHash());
+    std::vector<CIdentityContentDbEntry> content;
+    ASSERT_TRUE(GetIdentityContent(identityID, vdxfKey, content));
+    ASSERT_EQ(content.size(), 1);
+    EXPECT_EQ(content[0].second.data, a);
+}
+
+TEST(IdentityIndex, ContentRemovalsAndKeepDeleted) {
+    TestIndexDB indexDB;
+    TestIndexChain chain;
+    uint160 vdxfKey = TestID(0x33);
+    std::vector<unsigned char> a({'a'}), b({'b'});
+
+    // the second revision replaces a with b, and the third removes b without updating the key
+    CBlock block0 = IdentityBlock(TestIdentity({{vdxfKey, a}}));
+    CBlock block1 = IdentityBlock(TestIdentity({{vdxfKey, b}, {CVDXF_Data::ContentMultiMapRemoveKey(), RemoveEntry(vdxfKey, a)}}));
+    CBlock block2 = IdentityBlock(TestIdentity({{CVDXF_Data::ContentMultiMapRemoveKey(), RemoveEntry(vdxfKey, b)}}));
+    uint160 identityID = TestIdentity({}).GetID();
+    ASSERT_TRUE(ConnectIdentities(block0, chain.Connect(block0)));
+    ASSERT_TRUE(ConnectIdentities(block1, chain.Connect(block1)));
+    EXPECT_EQ(ContentByKey(identityID, vdxfKey, false), std::vector<std::vector<unsigned char>>({b}));
+    EXPECT_EQ(ContentByKey(identityID, vdxfKey, true), std::vector<std::vector<unsigned char>>({b}));
+
+    // a removal in a revision that does not update the key only applies when deleted entries are not kept
+    const CBlockIndex *pindex2 = chain.Connect(block2);
+    ASSERT_TRUE(ConnectIdentities(block2, pindex2));
+    EXPECT_EQ(ContentByKey(identityID, vdxfKey, false).size(), 0);
+    EXPECT_EQ(ContentByKey(identityID, vdxfKey, true), std::vector<std::vector<unsigned char>>({b}));
+
+    ASSERT_TRUE(DisconnectIdentities(block2, pindex2));
+    chain.Disconnect();
+    EXPECT_EQ(ContentByKey(identityID, vdxfKey, false), std::vector<std::vector<unsigned char>>({b}));
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <univalue.h>
+
+#include "jsonstream.h"
+
+// writes value through the stream writer, one member or element at a time for objects and arrays
+static void StreamValue(CJSONStreamWriter &writer, const UniValue &value)
+{
+    if (value.isObject())
+    {
+        writer.BeginObject();
+        for (size_t i = 0; i < value.size(); i++)
+        {
+            writer.Key(value.getKeys()[i]);
+            StreamValue(writer, value.getValues()[i]);
+        }
+        writer.EndObject();
+    }
+    else if (value.isArray())
+    {
+        writer.BeginArray();
+        for (size_t i = 0; i < value.size(); i++)
+        {
+            StreamValue(writer, value[i]);
+        }
+        writer.EndArray();
+    }
+    else
+    {
+        writer.Value(value);
+    }
+}
+
+static std::string StreamToString(const UniValue &value, size_t flushSize)
+{
+    std::string out;
+    size_t nWrites = 0;
+    CJSONStreamWriter writer([&out, &nWrites](const char *data, size_t len) { out.append(data, len); nWrites++; }, flushSize);
+    StreamValue(writer, value);
+    writer.Flush();
+    EXPECT_EQ(writer.BytesWritten(), out.size());
+    return out;
+}
+
+TEST(jsonstream, matches_univalue_write) {
+    UniValue doc;
+    ASSERT_TRUE(doc.read("{\"hash\":\"00ff\",\"empty\":{},\"none\":[],\"tx\":[{\"vin\":[{\"n\":0,\"ok\":true}],"
+                         "\"vout\":[1,2.5,-3,null,\"a\\\"b\\\\c\\n\"]},{\"k\\u0001\":false}],\"nested\":[[[]],[{}]]}"));
+
+    for (size_t flushSize : std::vector<size_t>{1, 2, 7, 64, CJSONStreamWriter::DEFAULT_BUFFER_SIZE})
+    {
+        EXPECT_EQ(doc.write(), StreamToString(doc, flushSize));
+    }
+
+    UniValue scalar("top level string");
+    EXPECT_EQ(scalar.write(), StreamToString(scalar, 4));
+}
+
+TEST(jsonstream, mixes_whole_values_and_raw_text) {
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("a", 1);
+    inner.pushKV("b", "two");
+
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("result", inner);
+    expected.pushKV("error", NullUniValue);
+    expected.pushKV("id", 7);
+
+    std::string out;
+    CJSONStreamWriter writer([&out](const char *data, size_t len) { out.append(data, len); });
+    writer.BeginObject();
+    writer.Key("result");
+    writer.Value(inner);
+    writer.KeyValue("error", NullUniValue);
+    writer.KeyValue("id", 7);
+    writer.EndObject();
+    writer.Raw("\n");
+
+    // nothing reaches the sink before a flush, while under the buffer size
+    EXPECT_TRUE(out.empty());
+    writer.Flush();
+    EXPECT_EQ(expected.write() + "\n", out);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include "pbaas/notarization.h"
+
+namespace {
+
+CChainNotarizationData TestNotarizationData(int lastConfirmed)
+{
+    CChainNotarizationData data(CChainNotarizationData::CURRENT_VERSION);
+    data.lastConfirmed = lastConfirmed;
+    return data;
+}
+
+}
+
+TEST(NotarizationDataCache, KeepsDataUntilInvalidated) {
+    CNotarizationDataCache cache;
+    uint160 currencyA(std::vector<unsigned char>(20, 1));
+    uint160 currencyB(std::vector<unsigned char>(20, 2));
+
+    CChainNotarizationData data;
+    std::vector<std::pair<CTransaction, uint256>> txes;
+    EXPECT_FALSE(cache.Get(currencyA, true, data, txes));
+
+    cache.Put(currencyA, cache.GetGeneration(currencyA), true, TestNotarizationData(3), txes);
+    ASSERT_TRUE(cache.Get(currencyA, true, data, txes));
+    EXPECT_EQ(data.lastConfirmed, 3);
+
+    // data built under the other notarization order rule is not returned
+    EXPECT_FALSE(cache.Get(currencyA, false, data, txes));
+
+    // invalidating another currency leaves it alone
+    cache.Invalidate(std::set<uint160>({currencyB}));
+    EXPECT_TRUE(cache.Get(currencyA, true, data, txes));
+
+    cache.Invalidate(std::set<uint160>({currencyA}));
+    EXPECT_FALSE(cache.Get(currencyA, true, data, txes));
+}
+
+TEST(NotarizationDataCache, DropsDataBuiltFromStaleState) {
+    CNotarizationDataCache cache;
+    uint160 currencyA(std::vector<unsigned char>(20, 1));
+    std::vector<std::pair<CTransaction, uint256>> txes;
+
+    // a change to the currency while its data is being built means that data is never stored
+    uint64_t generation = cache.GetGeneration(currencyA);
+    cache.Invalidate(std::set<uint160>({currencyA}));
+    cache.Put(currencyA, generation, true, TestNotarizationData(1), txes);
+
+    CChainNotarizationData data;
+    EXPECT_FALSE(cache.Get(currencyA, true, data, txes));
+
+    cache.Put(currencyA, cache.GetGeneration(currencyA), true, TestNotarizationData(1), txes);
+    EXPECT_TRUE(cache.Get(currencyA, true, data, txes));
+}
@@ -0,0 +1,261 @@
+#include <gtest/gtest.h>
+
+#include "cc/CCinclude.h"
+#include "gtest/index_test_utils.h"
+#include "main.h"
+#include "offerindex.h"
+#include "pbaas/identity.h"
+#include "random.h"
+#include "clientversion.h"
+#include "streams.h"
+
+namespace {
+
+CTransaction FundingTx(CAmount value)
+{
+    CMutableTransaction mtx;
+    mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+    mtx.vout.push_back(CTxOut(value, CScript() << OP_TRUE));
+    return mtx;
+}
+
+// a transaction that posts, in its op_return, an offer of output 0 of fundingTx for requested native coin that expires at
+// expiryHeight, with the offer output at its own output 0 and its fee paid by output 0 of feeTx
+CTransaction OfferPostingTx(const CTransaction &fundingTx, const CTransaction &feeTx, CAmount requested, uint32_t expiryHeight)
+{
+    CMutableTransaction offerTx;
+    offerTx.fOverwintered = true;
+    offerTx.nVersion = SAPLING_TX_VERSION;
+    offerTx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+    offerTx.nExpiryHeight = expiryHeight;
+    offerTx.vin.push_back(CTxIn(fundingTx.GetHash(), 0));
+    offerTx.vout.push_back(CTxOut(requested, CScript() << OP_TRUE));
+
+    CCrossChainProof opRetProof;
+    opRetProof << CPartialTransactionProof(CMMRProof(), CTransaction(offerTx));
+
+    CCommitmentHash commitment(GetRandHash());
+    std::vector<CTxDestination> dests({CTxDestination(CKeyID(TestID(0x44)))});
+    CMutableTransaction postingTx;
+    postingTx.vin.push_back(CTxIn(feeTx.GetHash(), 0));
+    postingTx.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CCommitmentHash>(EVAL_IDENTITY_COMMITMENT, dests, 1, &commitment))));
+    postingTx.vout.push_back(CTxOut(0, StoreOpRetArray(opRetProof.chainObjects)));
+    return postingTx;
+}
+
+// a transaction that takes the offer posted by postingTx, spending its offer output and what it offers
+CTransaction TakeOfferTx(const CTransaction &postingTx, const CTransaction &fundingTx)
+{
+    CMutableTransaction mtx;
+    mtx.vin.push_back(CTxIn(postingTx.GetHash(), 0));
+    mtx.vin.push_back(CTxIn(fundingTx.GetHash(), 0));
+    mtx.vout.push_back(CTxOut(fundingTx.vout[0].nValue, CScript() << OP_TRUE));
+    return mtx;
+}
+
+void AddCoins(CCoinsViewCache &view, const CTransaction &tx, int height)
+{
+    view.ModifyCoins(tx.GetHash())->FromTx(tx, height);
+}
+
+// the offers of native coin for native coin that are open at height, including those in the mempool
+std::vector<COfferIndexDbEntry> OpenOffers(uint32_t height)
+{
+    LOCK(cs_main);
+    std::vector<COfferIndexDbEntry> offers;
+    EXPECT_TRUE(GetOfferIndex(COfferIndexKey::OFFERED, ASSETCHAINS_CHAINID, uint160(), height, offers));
+    return offers;
+}
+
+bool ConnectOffers(const std::vector<CTransaction> &txs, CCoinsViewCache &view, uint32_t height)
+{
+    LOCK(cs_main);
+    COfferIndexUpdate update;
+    for (auto &tx : txs)
+    {
+        update.ConnectTransaction(tx, view, height);
+        for (auto &oneIn : tx.vin)
+        {
+            view.ModifyCoins(oneIn.prevout.hash)->Spend(oneIn.prevout.n);
+        }
+        AddCoins(view, tx, height);
+    }
+    update.ExpireOffers(height);
+    return update.Write();
+}
+
+// view is the state before the block
+bool DisconnectOffers(const std::vector<CTransaction> &txs, const CCoinsViewCache &view, uint32_t height)
+{
+    LOCK(cs_main);
+    COfferIndexUpdate update;
+    for (auto it = txs.rbegin(); it != txs.rend(); it++)
+    {
+        update.DisconnectTransaction(*it);
+    }
+    update.ReopenOffers(view, height);
+    return update.Write();
+}
+
+}
+
+TEST(OfferIndex, KeysSortByPriceOnDisk) {
+    uint160 offered = TestID(0x11);
+    uint160 requested = TestID(0x22);
+    uint256 txid = uint256S("0x01");
+
+    std::vector<int64_t> prices({0, 1, 255, 256, 100000000, 0x7fffffffffffffffLL});
+    for (int i = 1; i < prices.size(); i++)
+    {
+        COfferIndexKey lower(COfferIndexKey::OFFERED, offered, requested, prices[i - 1], txid);
+        COfferIndexKey higher(COfferIndexKey::OFFERED, offered, requested, prices[i], uint256());
+        EXPECT_TRUE(lower < higher);
+        EXPECT_TRUE(SerializedIndexKey('O', lower) < SerializedIndexKey('O', higher));
+    }
+
+    // a key with only the primary set is where iteration over all of its offers starts
+    COfferIndexKey start(COfferIndexKey::OFFERED, offered);
+    COfferIndexKey first(COfferIndexKey::OFFERED, offered, TestID(0x01), 0, txid);
+    EXPECT_TRUE(SerializedIndexKey('O', start) < SerializedIndexKey('O', first));
+
+    COfferIndexKey roundTrip;
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << first;
+    EXPECT_EQ(ss.size(), first.GetSerializeSize(SER_DISK, CLIENT_VERSION));
+    ss >> roundTrip;
+    EXPECT_FALSE(roundTrip < first || first < roundTrip);
+}
+
+TEST(OfferIndex, Price) {
+    // 2 of the secondary for 4 of the primary is 0.5 per unit
+    EXPECT_EQ(COfferIndexValue::Price(2 * COIN, false, 4 * COIN, false), COIN / 2);
+    // an ID counts as one whole unit on either side
+    EXPECT_EQ(COfferIndexValue::Price(150 * COIN, false, 0, true), 150 * COIN);
+    EXPECT_EQ(COfferIndexValue::Price(0, true, 4 * COIN, false), COIN / 4);
+    EXPECT_EQ(COfferIndexValue::Price(COIN, false, 0, false), 0);
+
+    COfferIndexValue offer;
+    offer.offeredID = TestID(0x11);
+    offer.requestedID = TestID(0x22);
+    offer.offeredAmount = 4 * COIN;
+    offer.requestedAmount = 2 * COIN;
+    offer.offerOutput = COutPoint(uint256S("0x01"), 0);
+
+    COfferIndexKey ask = offer.GetKey(COfferIndexKey::OFFERED);
+    EXPECT_EQ(ask.primaryID, offer.offeredID);
+    EXPECT_EQ(ask.secondaryID, offer.requestedID);
+    EXPECT_EQ(ask.price, COIN / 2);
+
+    COfferIndexKey bid = offer.GetKey(COfferIndexKey::REQUESTED);
+    EXPECT_EQ(bid.primaryID, offer.requestedID);
+    EXPECT_EQ(bid.secondaryID, offer.offeredID);
+    EXPECT_EQ(bid.price, 2 * COIN);
+    EXPECT_EQ(bid.txhash, offer.offerOutput.hash);
+}
+
+TEST(OfferIndex, TakenOffersCloseAndReopen) {
+    TestIndexDB indexDB;
+    CCoinsView coinsDummy;
+    CCoinsViewCache before(&coinsDummy);
+
+    CTransaction fundingTx = FundingTx(5 * COIN);
+    CTransaction feeTx = FundingTx(COIN);
+    AddCoins(before, fundingTx, 1);
+    AddCoins(before, feeTx, 1);
+    CTransaction postingTx = OfferPostingTx(fundingTx, feeTx, 2 * COIN, 100);
+    CTransaction takeTx = TakeOfferTx(postingTx, fundingTx);
+
+    CCoinsViewCache posted(&before);
+    ASSERT_TRUE(ConnectOffers({postingTx}, posted, 10));
+    std::vector<COfferIndexDbEntry> offers = OpenOffers(10);
+    ASSERT_EQ(offers.size(), 1);
+    EXPECT_EQ(offers[0].second.postingTxid, postingTx.GetHash());
+    EXPECT_EQ(offers[0].second.offerOutput, COutPoint(postingTx.GetHash(), 0));
+    EXPECT_EQ(offers[0].second.fundingOutput, COutPoint(fundingTx.GetHash(), 0));
+    EXPECT_EQ(offers[0].second.offeredAmount, 5 * COIN);
+    EXPECT_EQ(offers[0].second.requestedAmount, 2 * COIN);
+    EXPECT_EQ(offers[0].second.expiryHeight, 100);
+
+    CCoinsViewCache taken(&posted);
+    ASSERT_TRUE(ConnectOffers({takeTx}, taken, 11));
+    EXPECT_EQ(OpenOffers(11).size(), 0);
+
+    // disconnecting the block that took it reopens it, and disconnecting the block that posted it removes it with its
+    // outpoint and expiry records
+    ASSERT_TRUE(DisconnectOffers({takeTx}, posted, 11));
+    EXPECT_EQ(OpenOffers(10).size(), 1);
+    ASSERT_TRUE(DisconnectOffers({postingTx}, before, 10));
+    EXPECT_EQ(OpenOffers(9).size(), 0);
+
+    std::vector<COfferIndexValue> outPointRecords, expiryRecords;
+    ASSERT_TRUE(indexDB.db.ReadOfferOutPoint(COutPoint(fundingTx.GetHash(), 0), outPointRecords));
+    EXPECT_EQ(outPointRecords.size(), 0);
+    ASSERT_TRUE(indexDB.db.ReadOfferExpiries(100, expiryRecords));
+    EXPECT_EQ(expiryRecords.size(), 0);
+
+    // an offer posted and taken in the same block is never open
+    CCoinsViewCache both(&before);
+    ASSERT_TRUE(ConnectOffers({postingTx, takeTx}, both, 10));
+    EXPECT_EQ(OpenOffers(10).size(), 0);
+}
+
+TEST(OfferIndex, ExpiredOffersCloseAndReopen) {
+    TestIndexDB indexDB;
+    CCoinsView coinsDummy;
+    CCoinsViewCache before(&coinsDummy);
+
+    CTransaction fundingTx = FundingTx(5 * COIN);
+    CTransaction feeTx = FundingTx(COIN);
+    AddCoins(before, fundingTx, 1);
+    AddCoins(before, feeTx, 1);
+
+    // an offer that has expired by the block that posts it is not indexed
+    CCoinsViewCache expired(&before);
+    ASSERT_TRUE(ConnectOffers({OfferPostingTx(fundingTx, feeTx, 2 * COIN, 10)}, expired, 10));
+    std::vector<COfferIndexDbEntry> indexed;
+    ASSERT_TRUE(indexDB.db.ReadOfferIndex(COfferIndexKey::OFFERED, ASSETCHAINS_CHAINID, uint160(), indexed));
+    EXPECT_EQ(indexed.size(), 0);
+
+    CCoinsViewCache posted(&before);
+    ASSERT_TRUE(ConnectOffers({OfferPostingTx(fundingTx, feeTx, 2 * COIN, 12)}, posted, 10));
+    ASSERT_TRUE(ConnectOffers({}, posted, 11));
+    EXPECT_EQ(OpenOffers(11).size(), 1);
+
+    // it leaves the index at its expiry height, and comes back when that block is disconnected
+    ASSERT_TRUE(ConnectOffers({}, posted, 12));
+    std::vector<COfferIndexDbEntry> afterExpiry;
+    ASSERT_TRUE(indexDB.db.ReadOfferIndex(COfferIndexKey::OFFERED, ASSETCHAINS_CHAINID, uint160(), afterExpiry));
+    EXPECT_EQ(afterExpiry.size(), 0);
+    ASSERT_TRUE(DisconnectOffers({}, posted, 12));
+    EXPECT_EQ(OpenOffers(11).size(), 1);
+}
+
+TEST(OfferIndex, MempoolOffers) {
+    TestIndexDB indexDB;
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+
+    CTransaction fundingTx = FundingTx(5 * COIN);
+    CTransaction feeTx = FundingTx(COIN);
+    AddCoins(view, fundingTx, 1);
+    AddCoins(view, feeTx, 1);
+    CTransaction postingTx = OfferPostingTx(fundingTx, feeTx, 2 * COIN, 100);
+    CTransaction takeTx = TakeOfferTx(postingTx, fundingTx);
+
+    // an offer is open from when it enters the mempool, and closed by a mempool transaction that takes it
+    CTxMemPoolEntry postingEntry(postingTx, 0, 0, 0, 10, true, false, SAPLING_BRANCH_ID);
+    mempool.addUnchecked(postingTx.GetHash(), postingEntry);
+    mempool.addOfferIndex(postingEntry, view);
+    std::vector<COfferIndexDbEntry> offers = OpenOffers(10);
+    ASSERT_EQ(offers.size(), 1);
+    EXPECT_EQ(offers[0].second.postingTxid, postingTx.GetHash());
+
+    CTxMemPoolEntry takeEntry(takeTx, 0, 0, 0, 10, false, false, SAPLING_BRANCH_ID);
+    mempool.addUnchecked(takeTx.GetHash(), takeEntry);
+    EXPECT_EQ(OpenOffers(10).size(), 0);
+
+    std::list<CTransaction> removed;
+    mempool.remove(postingTx, removed, true);
+    EXPECT_EQ(removed.size(), 2);
+    EXPECT_EQ(OpenOffers(10).size(), 0);
+}
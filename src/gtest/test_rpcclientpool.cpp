@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+
+#include "pbaas/crosschainrpc.h"
+#include "utiltime.h"
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/http.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// Minimal stand-in for a daemon's JSON-RPC server. It answers every request with the method name as
+// the result, handles batches, and records which server side connections were used. It can also drop
+// requests by closing their connection without a reply, as a daemon that closed an idle connection would.
+class StandInDaemon
+{
+public:
+    struct event_base *base;
+    struct evhttp *http;
+    int port;
+    std::atomic<bool> stop;
+    std::atomic<int> dropRequests;
+    std::thread serverThread;
+    std::mutex connectionsLock;
+    std::set<struct evhttp_connection *> connections;
+
+    StandInDaemon() : base(event_base_new()), http(evhttp_new(base)), port(0), stop(false), dropRequests(0)
+    {
+        evhttp_set_gencb(http, HandleRequest, this);
+        struct evhttp_bound_socket *bound = evhttp_bind_socket_with_handle(http, "127.0.0.1", 0);
+        struct sockaddr_in addr;
+        socklen_t addrLen = sizeof(addr);
+        getsockname(evhttp_bound_socket_get_fd(bound), (struct sockaddr *)&addr, &addrLen);
+        port = ntohs(addr.sin_port);
+
+        // the loop is polled rather than dispatched, so that it can be stopped without enabling
+        // libevent thread support
+        serverThread = std::thread([this]() {
+            while (!stop)
+            {
+                event_base_loop(base, EVLOOP_NONBLOCK);
+                MilliSleep(1);
+            }
+        });
+    }
+
+    ~StandInDaemon()
+    {
+        stop = true;
+        serverThread.join();
+        evhttp_free(http);
+        event_base_free(base);
+    }
+
+    size_t ConnectionCount()
+    {
+        std::lock_guard<std::mutex> lock(connectionsLock);
+        return connections.size();
+    }
+
+    static UniValue Reply(const UniValue &request)
+    {
+        UniValue reply(UniValue::VOBJ);
+        reply.push_back(Pair("result", find_value(request, "method")));
+        reply.push_back(Pair("error", NullUniValue));
+        reply.push_back(Pair("id", find_value(request, "id")));
+        return reply;
+    }
+
+    static void HandleRequest(struct evhttp_request *req, void *ctx)
+    {
+        StandInDaemon *daemon = static_cast<StandInDaemon *>(ctx);
+        {
+            std::lock_guard<std::mutex> lock(daemon->connectionsLock);
+            daemon->connections.insert(evhttp_request_get_connection(req));
+        }
+
+        if (daemon->dropRequests > 0)
+        {
+            // libevent frees the request and connection once it sees the socket is closed
+            daemon->dropRequests--;
+            shutdown(bufferevent_getfd(evhttp_connection_get_bufferevent(evhttp_request_get_connection(req))), SHUT_RDWR);
+            return;
+        }
+
+        struct evbuffer *input = evhttp_request_get_input_buffer(req);
+        size_t size = evbuffer_get_length(input);
+        std::string body((const char *)evbuffer_pullup(input, size), size);
+
+        UniValue request;
+        request.read(body);
+        UniValue reply;
+        if (request.isArray())
+        {
+            // answer batches in reverse order to make sure the client matches replies by id
+            reply = UniValue(UniValue::VARR);
+            for (int i = request.size() - 1; i >= 0; i--)
+            {
+                reply.push_back(Reply(request[i]));
+            }
+        }
+        else
+        {
+            reply = Reply(request);
+        }
+
+        std::string strReply = reply.write() + "\n";
+        struct evbuffer *output = evbuffer_new();
+        evbuffer_add(output, strReply.data(), strReply.size());
+        evhttp_send_reply(req, HTTP_OK, "OK", output);
+        evbuffer_free(output);
+    }
+};
+
+TEST(RPCClientPool, ReusesConnection) {
+    StandInDaemon daemon;
+    CRPCClientPool pool;
+
+    for (int i = 0; i < 5; i++)
+    {
+        UniValue reply = pool.Call("getinfo", UniValue(UniValue::VARR), "user:pass", daemon.port, "127.0.0.1", 10);
+        EXPECT_EQ(find_value(reply, "result").get_str(), "getinfo");
+    }
+
+    CRPCEndpointStats stats = pool.GetStats("127.0.0.1", daemon.port, "user:pass");
+    EXPECT_EQ(stats.requests, 5);
+    EXPECT_EQ(stats.httpRequests, 5);
+    EXPECT_EQ(stats.failures, 0);
+    EXPECT_EQ(stats.inFlight, 0);
+    EXPECT_EQ(stats.connectionsOpened, 1);
+    EXPECT_EQ(daemon.ConnectionCount(), 1);
+}
+
+TEST(RPCClientPool, BatchRepliesInCallOrder) {
+    StandInDaemon daemon;
+    CRPCClientPool pool;
+
+    std::vector<std::pair<std::string, UniValue>> calls;
+    calls.push_back(std::make_pair("getinfo", UniValue(UniValue::VARR)));
+    calls.push_back(std::make_pair("getexports", UniValue(UniValue::VARR)));
+    calls.push_back(std::make_pair("submitblock", UniValue(UniValue::VARR)));
+
+    std::vector<UniValue> replies = pool.CallBatch(calls, "user:pass", daemon.port, "127.0.0.1", 10);
+    ASSERT_EQ(replies.size(), calls.size());
+    for (int i = 0; i < calls.size(); i++)
+    {
+        EXPECT_EQ(find_value(replies[i], "result").get_str(), calls[i].first);
+    }
+
+    CRPCEndpointStats stats = pool.GetStats("127.0.0.1", daemon.port, "user:pass");
+    EXPECT_EQ(stats.requests, 3);
+    EXPECT_EQ(stats.httpRequests, 1);
+    EXPECT_EQ(stats.batches, 1);
+}
+
+TEST(RPCClientPool, ConcurrentCalls) {
+    StandInDaemon daemon;
+    CRPCClientPool pool;
+
+    std::atomic<int> succeeded(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 10; j++)
+            {
+                UniValue reply = pool.Call("getblockcount", UniValue(UniValue::VARR), "user:pass", daemon.port, "127.0.0.1", 10);
+                if (find_value(reply, "result").get_str() == "getblockcount")
+                {
+                    succeeded++;
+                }
+            }
+        });
+    }
+    for (auto &oneThread : threads)
+    {
+        oneThread.join();
+    }
+
+    EXPECT_EQ(succeeded, 40);
+    CRPCEndpointStats stats = pool.GetStats("127.0.0.1", daemon.port, "user:pass");
+    EXPECT_EQ(stats.httpRequests, 40);
+    EXPECT_EQ(stats.inFlight, 0);
+    EXPECT_LE(stats.connectionsOpened, 4);
+}
+
+TEST(RPCClientPool, ConnectionFailureIsCounted) {
+    CRPCClientPool pool;
+    int port;
+    {
+        // bind and release a port so that nothing is listening on it
+        StandInDaemon daemon;
+        port = daemon.port;
+    }
+    EXPECT_ANY_THROW(pool.Call("getinfo", UniValue(UniValue::VARR), "user:pass", port, "127.0.0.1", 10));
+    CRPCEndpointStats stats = pool.GetStats("127.0.0.1", port, "user:pass");
+    EXPECT_EQ(stats.failures, 1);
+    EXPECT_EQ(stats.inFlight, 0);
+}
+
+TEST(RPCClientPool, RetriesOnlyReadOnlyCalls) {
+    StandInDaemon daemon;
+    CRPCClientPool pool;
+
+    EXPECT_TRUE(CRPCClientPool::IsRetriable("getinfo"));
+    EXPECT_FALSE(CRPCClientPool::IsRetriable("submitblock"));
+    EXPECT_FALSE(CRPCClientPool::IsRetriable("submitimports"));
+
+    pool.Call("getinfo", UniValue(UniValue::VARR), "user:pass", daemon.port, "127.0.0.1", 10);
+
+    // a read only call on a reused connection that fails is sent again on a new connection
+    daemon.dropRequests = 1;
+    UniValue reply = pool.Call("getinfo", UniValue(UniValue::VARR), "user:pass", daemon.port, "127.0.0.1", 10);
+    EXPECT_EQ(find_value(reply, "result").get_str(), "getinfo");
+    CRPCEndpointStats stats = pool.GetStats("127.0.0.1", daemon.port, "user:pass");
+    EXPECT_EQ(stats.retries, 1);
+    EXPECT_EQ(stats.failures, 0);
+    EXPECT_EQ(stats.connectionsOpened, 2);
+
+    // one that may change state is not, since the daemon may have received and processed it
+    daemon.dropRequests = 1;
+    EXPECT_ANY_THROW(pool.Call("submitblock", UniValue(UniValue::VARR), "user:pass", daemon.port, "127.0.0.1", 10));
+    stats = pool.GetStats("127.0.0.1", daemon.port, "user:pass");
+    EXPECT_EQ(stats.retries, 1);
+    EXPECT_EQ(stats.failures, 1);
+    EXPECT_EQ(stats.connectionsOpened, 2);
+
+    // nor is a batch that contains one
+    pool.Call("getinfo", UniValue(UniValue::VARR), "user:pass", daemon.port, "127.0.0.1", 10);
+    std::vector<std::pair<std::string, UniValue>> calls;
+    calls.push_back(std::make_pair("getinfo", UniValue(UniValue::VARR)));
+    calls.push_back(std::make_pair("submitblock", UniValue(UniValue::VARR)));
+    daemon.dropRequests = 1;
+    EXPECT_ANY_THROW(pool.CallBatch(calls, "user:pass", daemon.port, "127.0.0.1", 10));
+    EXPECT_EQ(pool.GetStats("127.0.0.1", daemon.port, "user:pass").retries, 1);
+}
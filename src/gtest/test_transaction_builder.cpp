@@ -150,6 +150,55 @@ TEST(TransactionBuilder, SaplingToSapling) {
     RegtestDeactivateSapling();
 }
 
+TEST(TransactionBuilder, PrepareSaplingDescriptionsOnThreads) {
+    auto consensusParams = RegtestActivateSapling();
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    auto pa = sk.default_address();
+
+    // spends of several notes in one tree, and an output
+    std::vector<libzcash::SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    SaplingMerkleTree tree;
+    for (int i = 0; i < 5; i++) {
+        libzcash::SaplingNote note(pa, 10000 * (i + 1));
+        for (auto &witness : witnesses) {
+            witness.append(note.cm().get());
+        }
+        tree.append(note.cm().get());
+        witnesses.push_back(tree.witness());
+        notes.push_back(note);
+    }
+
+    // the same descriptions are prepared however many threads prepare them
+    std::vector<PreparedSaplingSpend> spendsByThreads[2];
+    std::vector<PreparedSaplingOutput> outputsByThreads[2];
+    int nThreads[2] = {1, 4};
+    for (int t = 0; t < 2; t++) {
+        auto builder = TransactionBuilder(consensusParams, 2);
+        builder.SetPrepareThreads(nThreads[t]);
+        for (int i = 0; i < notes.size(); i++) {
+            builder.AddSaplingSpend(expsk, notes[i], tree.root(), witnesses[i]);
+        }
+        builder.AddSaplingOutput(fvk.ovk, pa, 25000, {});
+        builder.PrepareSaplingDescriptions(spendsByThreads[t], outputsByThreads[t]);
+        ASSERT_EQ(spendsByThreads[t].size(), notes.size());
+        ASSERT_EQ(outputsByThreads[t].size(), 1);
+    }
+    for (int i = 0; i < notes.size(); i++) {
+        EXPECT_TRUE(spendsByThreads[0][i].nf == notes[i].nullifier(fvk, witnesses[i].position()));
+        EXPECT_TRUE(spendsByThreads[1][i].nf == spendsByThreads[0][i].nf);
+        EXPECT_EQ(spendsByThreads[1][i].witness, spendsByThreads[0][i].witness);
+    }
+    EXPECT_TRUE(outputsByThreads[0][0].cm && outputsByThreads[1][0].cm);
+    EXPECT_TRUE(outputsByThreads[0][0].enc && outputsByThreads[1][0].enc);
+
+    // Revert to default
+    RegtestDeactivateSapling();
+}
+
 TEST(TransactionBuilder, SaplingToSprout) {
     auto consensusParams = RegtestActivateSapling();
 
@@ -2,6 +2,7 @@
 
 #include "chainparams.h"
 #include "httpserver.h"
+#include "jsonstream.h"
 #include "key_io.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
@@ -87,6 +88,35 @@ static bool RPCAuthorized(const std::string& strAuth)
     return TimingResistantEqual(strUserPass, strRPCUserColonPass);
 }
 
+/** Writes the same reply as JSONRPCReply into the request as the result is produced */
+static void WriteStreamedJSONRPCReply(HTTPRequest* req, const RPCResultWriter& resultWriter, const UniValue& id)
+{
+    CJSONStreamWriter writer([req](const char *data, size_t len) { req->WriteReplyData(data, len); });
+    try
+    {
+        writer.BeginObject();
+        writer.Key("result");
+        resultWriter(writer);
+        writer.KeyValue("error", NullUniValue);
+        writer.KeyValue("id", id);
+        writer.EndObject();
+        writer.Raw("\n");
+        writer.Flush();
+    }
+    catch (const std::exception& e)
+    {
+        req->DiscardReplyData();
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+    catch (...)
+    {
+        req->DiscardReplyData();
+        throw;
+    }
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK);
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -163,7 +193,19 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             }
             LogPrint("rpcapi", "%s %s\n", jreq.strMethod.c_str(), jreq.params.write().c_str());
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+            UniValue result;
+            RPCResultWriter resultWriter;
+            {
+                CRPCStreamScope streamScope;
+                result = tableRPC.execute(jreq.strMethod, jreq.params);
+                resultWriter = streamScope.resultWriter;
+            }
+
+            if (resultWriter)
+            {
+                WriteStreamedJSONRPCReply(req, resultWriter, jreq.id);
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -109,6 +109,19 @@ public:
      */
     virtual void WriteHeader(const std::string& hdr, const std::string& value);
 
+    /**
+     * Append to the body of the reply, ahead of the strReply passed to WriteReply.
+     * This lets a large reply be written in pieces without first building it in memory.
+     *
+     * @note call this before calling WriteReply.
+     */
+    virtual void WriteReplyData(const char* data, size_t len);
+
+    /**
+     * Discard anything appended with WriteReplyData, e.g. to send an error reply instead.
+     */
+    virtual void DiscardReplyData();
+
     /**
      * Write HTTP reply.
      * nStatus is the HTTP status code to send.
@@ -0,0 +1,181 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_IDENTITYINDEX_H
+#define BITCOIN_IDENTITYINDEX_H
+
+#include "uint256.h"
+#include "serialize.h"
+
+#include <vector>
+
+// One revision of an identity, which is one identity primary output, in the order it was mined
+struct CIdentityRevisionKey {
+    uint160 identityID;
+    unsigned int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+    unsigned int voutNum;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 64;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        identityID.Serialize(s);
+        // Heights and indexes are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s);
+        ser_writedata32be(s, voutNum);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        identityID.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        voutNum = ser_readdata32be(s);
+    }
+
+    CIdentityRevisionKey(const uint160 &id, unsigned int height=0, unsigned int txIdx=0, const uint256 &txid=uint256(), unsigned int n=0) :
+        identityID(id), blockHeight(height), txindex(txIdx), txhash(txid), voutNum(n) {}
+
+    CIdentityRevisionKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        identityID.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+        voutNum = 0;
+    }
+};
+
+// The block and serialized identity of a revision, which is all that is needed to return it without the transaction
+struct CIdentityRevisionValue {
+    uint256 blockHash;
+    std::vector<unsigned char> identity;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(blockHash);
+        READWRITE(identity);
+    }
+
+    CIdentityRevisionValue(const uint256 &hash, const std::vector<unsigned char> &identityData) : blockHash(hash), identity(identityData) {}
+
+    CIdentityRevisionValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        blockHash.SetNull();
+        identity.clear();
+    }
+
+    bool IsNull() const {
+        return blockHash.IsNull();
+    }
+};
+
+// One content multimap entry of an identity revision under its VDXF key. entryNum is the entry's position in the
+// revision's whole content multimap, so entries of several keys merge back into the order they are applied in.
+struct CIdentityContentKey {
+    uint160 identityID;
+    uint160 vdxfKey;
+    unsigned int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+    unsigned int voutNum;
+    unsigned int entryNum;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 88;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        identityID.Serialize(s);
+        vdxfKey.Serialize(s);
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s);
+        ser_writedata32be(s, voutNum);
+        ser_writedata32be(s, entryNum);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        identityID.Unserialize(s);
+        vdxfKey.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        voutNum = ser_readdata32be(s);
+        entryNum = ser_readdata32be(s);
+    }
+
+    CIdentityContentKey(const uint160 &id, const uint160 &key, unsigned int height=0, unsigned int txIdx=0, const uint256 &txid=uint256(), unsigned int n=0, unsigned int entry=0) :
+        identityID(id), vdxfKey(key), blockHeight(height), txindex(txIdx), txhash(txid), voutNum(n), entryNum(entry) {}
+
+    CIdentityContentKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        identityID.SetNull();
+        vdxfKey.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+        voutNum = 0;
+        entryNum = 0;
+    }
+
+    // order of application, by revision and then by position in the revision's content multimap
+    bool AppliesBefore(const CIdentityContentKey &b) const {
+        if (blockHeight != b.blockHeight) return blockHeight < b.blockHeight;
+        if (txindex != b.txindex) return txindex < b.txindex;
+        if (txhash != b.txhash) return txhash < b.txhash;
+        if (voutNum != b.voutNum) return voutNum < b.voutNum;
+        return entryNum < b.entryNum;
+    }
+
+    bool SameRevision(const CIdentityContentKey &b) const {
+        return blockHeight == b.blockHeight && txindex == b.txindex && txhash == b.txhash && voutNum == b.voutNum;
+    }
+};
+
+struct CIdentityContentValue {
+    uint256 blockHash;
+    std::vector<unsigned char> data;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(blockHash);
+        READWRITE(data);
+    }
+
+    CIdentityContentValue(const uint256 &hash, const std::vector<unsigned char> &entryData) : blockHash(hash), data(entryData) {}
+
+    CIdentityContentValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        blockHash.SetNull();
+        data.clear();
+    }
+
+    bool IsNull() const {
+        return blockHash.IsNull();
+    }
+};
+
+#endif // BITCOIN_IDENTITYINDEX_H
@@ -9,9 +9,12 @@
 
 #include "init.h"
 #include "crypto/common.h"
+#include "crypto/blake2b.h"
+#include "crypto/sha256.h"
 #include "primitives/block.h"
 #include "addrman.h"
 #include "amount.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
@@ -173,7 +176,7 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
+CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle;
 
@@ -241,6 +244,7 @@ void Shutdown()
         }
         delete pcoinsTip;
         pcoinsTip = NULL;
+        SetBlockPrefetchCoinsView(NULL);
         delete pcoinscatcher;
         pcoinscatcher = NULL;
         delete pcoinsdbview;
@@ -353,10 +357,14 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("This help message"));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-assumevalid=<hex>", _("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script, signature and proof verification (0 to verify all, default: the last checkpoint on Verus mainnet, 0 elsewhere)"));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
+    strUsage += HelpMessageOpt("-blockprefetch=<n>", strprintf(_("While a block is connected, read and check up to <n> of the blocks that follow it and prefetch the coins they spend (0 to %d, default: %d)"),
+        MAX_BLOCK_PREFETCH, DEFAULT_BLOCK_PREFETCH));
     strUsage += HelpMessageOpt("-bootstrap", _("Removes previous chain data (if present), downloads and extracts the bootstrap archive."));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), 288));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), 3));
+    strUsage += HelpMessageOpt("-compactblockindex", strprintf(_("Release block solutions from the in-memory block index and load them from disk on demand (default: %u)"), DEFAULT_COMPACT_BLOCK_INDEX));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), "komodo.conf"));
     if (mode == HMM_BITCOIND)
     {
@@ -385,7 +393,9 @@ std::string HelpMessage(HelpMessageMode mode)
 #endif
     strUsage += HelpMessageGroup(_("Index options:"));
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-idhistoryindex", strprintf(_("Maintain an index of identity revisions and content, enabling getidentityhistory and getidentitycontent to answer without reading transactions (default: %u)"), 0));
     strUsage += HelpMessageOpt("-idindex", strprintf(_("Maintain a full identity index, enabling queries to select IDs with addresses, revocation or recovery IDs (default: %u)"), 0));
+    strUsage += HelpMessageOpt("-offerindex", strprintf(_("Maintain an index of open on-chain offers by currency or ID offered and requested, enabling price ordered and paged getoffers queries (default: %u)"), 0));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     if (showDebug)  
         strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), 0));
@@ -395,6 +405,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-banscore=<n>", strprintf(_("Threshold for disconnecting misbehaving peers (default: %u)"), 100));
     strUsage += HelpMessageOpt("-bantime=<n>", strprintf(_("Number of seconds to keep misbehaving peers from reconnecting (default: %u)"), 86400));
     strUsage += HelpMessageOpt("-bind=<addr>", _("Bind to given address and always listen on it. Use [host]:port notation for IPv6"));
+    strUsage += HelpMessageOpt("-compactblocks", strprintf(_("Request new blocks from peers as compact blocks, reconstructed from the mempool (default: %u)"), DEFAULT_COMPACT_BLOCKS));
     strUsage += HelpMessageOpt("-connect=<ip>", _("Connect only to the specified node(s)"));
     strUsage += HelpMessageOpt("-discover", _("Discover own IP addresses (default: 1 when listening and no -externalip or -proxy)"));
     strUsage += HelpMessageOpt("-dns", _("Allow DNS lookups for -addnode, -seednode and -connect") + " " + _("(default: 1)"));
@@ -437,6 +448,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-arbitragecurrencies", _("Either a JSON array or a comma separated list of currency names."));
     strUsage += HelpMessageOpt("-arbitrageaddress", _("A valid wallet address or identity controlled by this wallet that will hold the arbitrage currencies to use."));
     strUsage += HelpMessageOpt("-storagefeefactor", _("Defaults to 6.0, which is used for 6K outputs to price storage in a currency's TransactionExportFee (ie. 6.0 = 1 TransactionExportFee per K)."));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-checkwalletbalances", strprintf("Check the incrementally maintained wallet balances against a full recalculation on every balance query (default: %u, regtest: %u)", 0, 1));
     strUsage += HelpMessageOpt("-cheatcatcher=<sapling-address>", _("same as \"-defaultzaddr\""));
     strUsage += HelpMessageOpt("-defaultid=<i-address>", _("VerusID used for default change out and staking reward recipient"));
     strUsage += HelpMessageOpt("-defaultzaddr=<sapling-address>", _("sapling address to receive fraud proof rewards and if used with \"-privatechange=1\", z-change address for the sendcurrency command"));
@@ -473,6 +486,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubidentity=<address>", _("Enable publish identity updates in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubcurrencystate=<address>", _("Enable publish currency state changes in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubexport=<address>", _("Enable publish cross-chain exports in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubimport=<address>", _("Enable publish cross-chain imports in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubreservetransfer=<address>", _("Enable publish reserve transfers in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubnotarization=<address>", _("Enable publish notarization confirmations in <address>"));
 #endif
 
 #if ENABLE_PROTON
@@ -481,6 +500,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-amqppubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-amqppubidentity=<address>", _("Enable publish identity updates in <address>"));
+    strUsage += HelpMessageOpt("-amqppubcurrencystate=<address>", _("Enable publish currency state changes in <address>"));
+    strUsage += HelpMessageOpt("-amqppubexport=<address>", _("Enable publish cross-chain exports in <address>"));
+    strUsage += HelpMessageOpt("-amqppubimport=<address>", _("Enable publish cross-chain imports in <address>"));
+    strUsage += HelpMessageOpt("-amqppubreservetransfer=<address>", _("Enable publish reserve transfers in <address>"));
+    strUsage += HelpMessageOpt("-amqppubnotarization=<address>", _("Enable publish notarization confirmations in <address>"));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -495,9 +520,11 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-flushwallet", strprintf("Run a thread to flush wallet periodically (default: %u)", 1));
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", 0));
         strUsage += HelpMessageOpt("-nuparams=hexBranchId:activationHeight", "Use given activation height for specified network upgrade (regtest-only)");
+        strUsage += HelpMessageOpt("-loadsnapshot=<file>", "Start a new data directory from a chain snapshot written by dumpsnapshot, without the blocks before it (regtest-only, requires -experimentalfeatures)");
+        strUsage += HelpMessageOpt("-snapshothash=<hex>", "Content hash of the chain snapshot given with -loadsnapshot, if it is not pinned in the chain parameters (regtest-only)");
     }
-    string debugCategories = "addrman, alert, bench, coindb, db, estimatefee, http, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
-                             "rand, reindex, rpc, selectcoins, tor, zmq, zrpc, zrpcunsafe (implies zrpc)"; // Don't translate these
+    string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, estimatefee, http, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
+                             "rand, reindex, rpc, rpcclient, selectcoins, tor, zmq, zrpc, zrpcunsafe (implies zrpc)"; // Don't translate these
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
         _("If <category> is not supplied or if <category> = 1, output all debugging information.") + " " + _("<category> can be:") + " " + debugCategories + ".");
     strUsage += HelpMessageOpt("-experimentalfeatures", _("Enable use of experimental features"));
@@ -506,6 +533,10 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), 1));
     if (showDebug)
     {
+        strUsage += HelpMessageOpt("-limitancestorcount=<n>", strprintf("Do not accept transactions if number of in-mempool ancestors is <n> or more (default: %u)", DEFAULT_ANCESTOR_LIMIT));
+        strUsage += HelpMessageOpt("-limitancestorsize=<n>", strprintf("Do not accept transactions whose size with all in-mempool ancestors exceeds <n> kilobytes (default: %u)", DEFAULT_ANCESTOR_SIZE_LIMIT));
+        strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u)", DEFAULT_DESCENDANT_LIMIT));
+        strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", 0));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
@@ -911,10 +942,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(_("Wallet encryption requires -experimentalfeatures."));
         } else if (mapArgs.count("-developersetpoolsizezero")) {
             return InitError(_("Setting the size of shielded pools to zero requires -experimentalfeatures."));
+        } else if (mapArgs.count("-developerskipscriptchecks")) {
+            return InitError(_("Skipping script checks requires -experimentalfeatures."));
         } else if (mapArgs.count("-paymentdisclosure")) {
             return InitError(_("Payment disclosure requires -experimentalfeatures."));
         } else if (mapArgs.count("-zmergetoaddress")) {
             return InitError(_("RPC method z_mergetoaddress requires -experimentalfeatures."));
+        } else if (mapArgs.count("-loadsnapshot")) {
+            return InitError(_("Loading a chain snapshot requires -experimentalfeatures."));
         }
     }
 
@@ -1046,6 +1081,22 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", true);
 
+    hashAssumeValid = uint256S(GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
+    if (!hashAssumeValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid scripts, signatures and proofs.\n", hashAssumeValid.GetHex());
+    else
+        LogPrintf("Validating scripts, signatures and proofs of all blocks.\n");
+
+    // lets regtest nodes put transactions with invalid signatures in their mempool and block templates, to test that blocks are still checked
+    fDeveloperSkipScriptChecks = GetBoolArg("-developerskipscriptchecks", false);
+    if (fDeveloperSkipScriptChecks && chainparams.NetworkIDString() != "regtest")
+        return InitError(_("-developerskipscriptchecks is only allowed on regtest."));
+    // no snapshot is pinned and the chain below a loaded snapshot is never validated, so only tests may load one
+    if (mapArgs.count("-loadsnapshot") && chainparams.NetworkIDString() != "regtest")
+        return InitError(_("-loadsnapshot is only allowed on regtest."));
+    fCompactBlockIndex = GetBoolArg("-compactblockindex", DEFAULT_COMPACT_BLOCK_INDEX);
+    fCompactBlocks = GetBoolArg("-compactblocks", DEFAULT_COMPACT_BLOCKS);
+
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
     if (nScriptCheckThreads <= 0)
@@ -1055,6 +1106,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    nBlockPrefetch = std::max(0, std::min<int>(GetArg("-blockprefetch", DEFAULT_BLOCK_PREFETCH), MAX_BLOCK_PREFETCH));
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MB) to allot for block & undo files
@@ -1144,6 +1197,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         expiryDeltaArg = expiryDelta;
     }
     bSpendZeroConfChange = GetBoolArg("-spendzeroconfchange", true);
+    fCheckWalletBalances = GetBoolArg("-checkwalletbalances", chainparams.DefaultConsistencyChecks());
     fSendFreeTransactions = GetBoolArg("-sendfreetransactions", false);
 
     std::string strWalletFile = GetArg("-wallet", "wallet.dat");
@@ -1231,6 +1285,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         return false;
     }
 
+    // Select the fastest SHA256 and BLAKE2b implementations this CPU supports, before anything is hashed
+    std::string sha256_algo = SHA256AutoDetect();
+    std::string blake2b_algo = BLAKE2b64AutoDetect();
+
     // Initialize elliptic curve code
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1414,6 +1472,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (fPrintToDebugLog)
         OpenDebugLog();
     LogPrintf("Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LogPrintf("Using the '%s' BLAKE2b MMR node implementation\n", blake2b_algo);
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
@@ -1428,7 +1488,15 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
+        {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadSaplingCheck);
+            threadGroup.create_thread(&ThreadHeaderCheck);
+        }
+        for (int i=0; nBlockPrefetch && i<std::min(nScriptCheckThreads-1, MAX_BLOCK_PREFETCH_THREADS); i++)
+        {
+            threadGroup.create_thread(&ThreadBlockPrefetch);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1786,6 +1854,24 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             fReindex = true;
         }
 
+        pblocktree->ReadFlag("offerindex", checkval);
+        fOfferIndex = GetBoolArg("-offerindex", checkval);
+        if ( checkval != fOfferIndex )
+        {
+            pblocktree->WriteFlag("offerindex", fOfferIndex);
+            fprintf(stderr,"set offerindex, will reindex. sorry will take a while.\n");
+            fReindex = true;
+        }
+
+        pblocktree->ReadFlag("idhistoryindex", checkval);
+        fIdHistoryIndex = GetBoolArg("-idhistoryindex", checkval);
+        if ( checkval != fIdHistoryIndex )
+        {
+            pblocktree->WriteFlag("idhistoryindex", fIdHistoryIndex);
+            fprintf(stderr,"set idhistoryindex, will reindex. sorry will take a while.\n");
+            fReindex = true;
+        }
+
         /* 
         pblocktree->ReadFlag("conversionindex", checkval);
         fConversionIndex = GetBoolArg("-conversionindex", checkval);
@@ -1829,6 +1915,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         do {
             try {
                 UnloadBlockIndex();
+                SetBlockPrefetchCoinsView(NULL);
                 delete pcoinsTip;
                 delete pcoinsdbview;
                 delete pcoinscatcher;
@@ -1839,6 +1926,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+                SetBlockPrefetchCoinsView(pcoinsdbview);
                 pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
 
 
@@ -1849,6 +1937,20 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                         CleanupBlockRevFiles();
                 }
 
+                bool fSnapshotLoaded = false;
+                CChainSnapshotHeader snapshotHeader;
+                if (!fReindex && mapArgs.count("-loadsnapshot")) {
+                    if (pcoinsdbview->GetBestBlock().IsNull()) {
+                        uiInterface.InitMessage(_("Loading chain snapshot..."));
+                        std::string strSnapshotError;
+                        if (!LoadChainSnapshot(chainparams, GetArg("-loadsnapshot", ""), uint256S(GetArg("-snapshothash", "")), snapshotHeader, strSnapshotError))
+                            return InitError(strSnapshotError);
+                        fSnapshotLoaded = true;
+                    } else {
+                        LogPrintf("Ignoring -loadsnapshot, the data directory already has a chain\n");
+                    }
+                }
+
                 if (!LoadBlockIndex()) {
                     strLoadError = _("Error loading block database");
                     break;
@@ -1864,6 +1966,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     strLoadError = _("Error initializing block database");
                     break;
                 }
+
+                if (fSnapshotLoaded) {
+                    LOCK(cs_main);
+                    std::string strSnapshotError;
+                    if (!CheckLoadedChainSnapshot(snapshotHeader, strSnapshotError))
+                        return InitError(strSnapshotError + ". " + _("Remove the blocks and chainstate directories before starting again"));
+                }
+
                 KOMODO_LOADINGBLOCKS = 0;
 
                 // Check for changed -txindex state
@@ -1878,6 +1988,18 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                pblocktree->ReadFlag("offerindex", fOfferIndex);
+                if (!fReindex && fOfferIndex != GetBoolArg("-offerindex", fOfferIndex) ) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -offerindex");
+                    break;
+                }
+
+                pblocktree->ReadFlag("idhistoryindex", fIdHistoryIndex);
+                if (!fReindex && fIdHistoryIndex != GetBoolArg("-idhistoryindex", fIdHistoryIndex) ) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -idhistoryindex");
+                    break;
+                }
+
                 /*
                 pblocktree->ReadFlag("conversionindex", fConversionIndex);
                 if (!fReindex && fConversionIndex != GetBoolArg("-conversionindex", fConversionIndex) ) {
@@ -1895,7 +2017,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
-                if (!fReindex && fHavePruned && !fPruneMode) {
+                if (!fReindex && fHavePruned && !fPruneMode && !nSnapshotHeight) {
                     strLoadError = _("You need to rebuild the database using -reindex to go back to unpruned mode.  This will redownload the entire blockchain");
                     break;
                 }
@@ -2146,6 +2268,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             else
                 pindexRescan = chainActive.Genesis();
         }
+        if (chainActive.Tip() && chainActive.Tip() != pindexRescan && pindexRescan->GetHeight() < nSnapshotHeight)
+        {
+            return InitError(strprintf(_("The wallet needs a rescan from height %d, but this node was started from a chain snapshot at height %d and has no blocks before it"),
+                                       pindexRescan->GetHeight(), nSnapshotHeight));
+        }
         if (chainActive.Tip() && chainActive.Tip() != pindexRescan)
         {
             uiInterface.InitMessage(_("Rescanning..."));
@@ -2260,6 +2387,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             uiInterface.InitMessage(_("Pruning blockstore..."));
             PruneAndFlush();
         }
+    } else if (nSnapshotHeight) {
+        LogPrintf("Unsetting NODE_NETWORK, started from a chain snapshot\n");
+        nLocalServices &= ~NODE_NETWORK;
     }
 
     // ********************************************************* Step 10: import blocks
@@ -0,0 +1,103 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "jsonstream.h"
+
+#include <assert.h>
+
+CJSONStreamWriter::CJSONStreamWriter(const Sink &outSink, size_t bufferSize) :
+    sink(outSink), flushSize(bufferSize), afterKey(false), bytesWritten(0)
+{
+    buffer.reserve(flushSize);
+}
+
+void CJSONStreamWriter::Separate()
+{
+    if (afterKey)
+    {
+        afterKey = false;
+        return;
+    }
+    if (!firstInContainer.empty())
+    {
+        if (!firstInContainer.back())
+        {
+            Append(",", 1);
+        }
+        firstInContainer.back() = false;
+    }
+}
+
+void CJSONStreamWriter::Append(const char *data, size_t len)
+{
+    bytesWritten += len;
+    if (buffer.size() + len > flushSize)
+    {
+        Flush();
+        if (len >= flushSize)
+        {
+            sink(data, len);
+            return;
+        }
+    }
+    buffer.append(data, len);
+}
+
+void CJSONStreamWriter::BeginObject()
+{
+    Separate();
+    Append("{", 1);
+    firstInContainer.push_back(true);
+}
+
+void CJSONStreamWriter::EndObject()
+{
+    assert(!firstInContainer.empty() && !afterKey);
+    firstInContainer.pop_back();
+    Append("}", 1);
+}
+
+void CJSONStreamWriter::BeginArray()
+{
+    Separate();
+    Append("[", 1);
+    firstInContainer.push_back(true);
+}
+
+void CJSONStreamWriter::EndArray()
+{
+    assert(!firstInContainer.empty() && !afterKey);
+    firstInContainer.pop_back();
+    Append("]", 1);
+}
+
+void CJSONStreamWriter::Key(const std::string &key)
+{
+    assert(!afterKey);
+    Separate();
+    // a string value is written with the same escaping as an object key
+    Append(UniValue(key).write());
+    Append(":", 1);
+    afterKey = true;
+}
+
+void CJSONStreamWriter::Value(const UniValue &value)
+{
+    Separate();
+    Append(value.write());
+}
+
+void CJSONStreamWriter::Raw(const std::string &text)
+{
+    Append(text);
+}
+
+void CJSONStreamWriter::Flush()
+{
+    if (!buffer.empty())
+    {
+        sink(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_JSONSTREAM_H
+#define BITCOIN_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <univalue.h>
+
+/**
+ * Writes compact JSON to a sink in pieces, producing exactly what UniValue::write() would for the same
+ * document. Large results can be written one element at a time, so that only the element being written,
+ * not the whole document, has to be held as a UniValue.
+ */
+class CJSONStreamWriter
+{
+public:
+    typedef std::function<void(const char *data, size_t len)> Sink;
+
+    static const size_t DEFAULT_BUFFER_SIZE = 65536;
+
+    explicit CJSONStreamWriter(const Sink &outSink, size_t flushSize=DEFAULT_BUFFER_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    // a key in the current object, to be followed by its value
+    void Key(const std::string &key);
+
+    // a complete value, either an element of the current array or the value of the last key
+    void Value(const UniValue &value);
+
+    void KeyValue(const std::string &key, const UniValue &value)
+    {
+        Key(key);
+        Value(value);
+    }
+
+    // text outside of the document, such as a trailing newline
+    void Raw(const std::string &text);
+
+    // passes everything written so far to the sink
+    void Flush();
+
+    size_t BytesWritten() const { return bytesWritten; }
+
+private:
+    Sink sink;
+    size_t flushSize;
+    std::string buffer;
+    std::vector<bool> firstInContainer;
+    bool afterKey;
+    size_t bytesWritten;
+
+    void Separate();
+    void Append(const char *data, size_t len);
+    void Append(const std::string &text) { Append(text.data(), text.size()); }
+};
+
+#endif // BITCOIN_JSONSTREAM_H
@@ -13,6 +13,7 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockencodings.h"
 #include "importcoin.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -30,6 +31,7 @@
 #include "pbaas/pbaas.h"
 #include "pbaas/notarization.h"
 #include "pbaas/identity.h"
+#include "pbaas/converters.h"
 #include "pow.h"
 #include "script/interpreter.h"
 #include "txdb.h"
@@ -45,6 +47,8 @@
 #include <cstring>
 #include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <deque>
 #include <sstream>
 #include <map>
 #include <unordered_map>
@@ -83,21 +87,29 @@ static int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nBlockPrefetch = DEFAULT_BLOCK_PREFETCH;
+uint256 hashAssumeValid;
 bool fExperimentalMode = false;
+bool fDeveloperSkipScriptChecks = false;
 bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = true;
 bool fIdIndex = false;
 bool fConversionIndex = false;      // index conversions by final destination
+bool fOfferIndex = false;           // index open on-chain offers by what they offer, what they request and price
+bool fIdHistoryIndex = false;       // index identity revisions and content multimap entries by identity and height
 bool fInsightExplorer = false;      // this ensures that the primary address and spent indexes are active, enabling advanced CCs
 bool fAddressIndex = true;
 bool fSpentIndex = true;
 bool fTimestampIndex = false;
 bool fHavePruned = false;
+int nSnapshotHeight = 0;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = true;
+bool fCompactBlockIndex = DEFAULT_COMPACT_BLOCK_INDEX;
+bool fCompactBlocks = DEFAULT_COMPACT_BLOCKS;
 bool fCoinbaseEnforcedProtectionEnabled = true;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
@@ -248,6 +260,7 @@ namespace {
         int64_t nTime;           //!< Time of "getdata" request in microseconds.
         bool fValidatedHeaders;  //!< Whether this block has validated headers at the time of request.
         int64_t nTimeDisconnect; //!< The timeout for this block request (for disconnecting a slow peer)
+        std::shared_ptr<PartiallyDownloadedBlock> partialBlock;  //!< Optional, set while waiting for "blocktxn" after a compact block.
     };
     map<uint256, pair<NodeId, list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
@@ -311,6 +324,18 @@ namespace {
         int nBlocksInFlightValidHeaders;
         //! Whether we consider this a preferred download peer.
         bool fPreferredDownload;
+        //! Moving averages of the block delivery rate in bytes per second, block size and block latency from request
+        //! to delivery in microseconds, measured on blocks requested from this peer.
+        double dBlockBytesPerSecond;
+        double dAvgBlockSize;
+        int64_t nBlockLatency;
+        //! When the last requested block from this peer arrived (in microseconds), or 0.
+        int64_t nLastBlockReceived;
+        int nBlocksDownloaded;
+        //! Blocks that were asked of another peer, because this one held back the download window.
+        int nBlocksReassigned;
+        //! Number of blocks to keep in flight from this peer.
+        int nBlockDownloadDepth;
 
         CNodeState() {
             fCurrentlyConnected = false;
@@ -324,6 +349,13 @@ namespace {
             nBlocksInFlight = 0;
             nBlocksInFlightValidHeaders = 0;
             fPreferredDownload = false;
+            dBlockBytesPerSecond = 0;
+            dAvgBlockSize = 0;
+            nBlockLatency = 0;
+            nLastBlockReceived = 0;
+            nBlocksDownloaded = 0;
+            nBlocksReassigned = 0;
+            nBlockDownloadDepth = DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER;
         }
     };
 
@@ -432,6 +464,59 @@ namespace {
         mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
     }
 
+    // Requires cs_main.
+    // Measures the delivery of a block that was requested from this peer, before it is marked as received.
+    void RecordBlockDelivery(NodeId nodeid, const uint256& hash, unsigned int nSize) {
+        map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+        if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != nodeid)
+            return;
+        CNodeState *state = State(nodeid);
+        assert(state != NULL);
+
+        int64_t nNow = GetTimeMicros();
+        const QueuedBlock &queuedBlock = *itInFlight->second.second;
+
+        // A peer sends blocks in the order they were requested, so it started sending this one when it was requested
+        // or when the one before it arrived, whichever was later. Time that the peer spent waiting on our requests
+        // is not counted against it.
+        int64_t nSendTime = std::max<int64_t>(nNow - std::max(queuedBlock.nTime, state->nLastBlockReceived), 1000);
+        double dBytesPerSecond = (double)nSize * 1000000 / nSendTime;
+        int64_t nLatency = nNow - queuedBlock.nTime;
+        if (state->nBlocksDownloaded == 0) {
+            state->dBlockBytesPerSecond = dBytesPerSecond;
+            state->dAvgBlockSize = nSize;
+            state->nBlockLatency = nLatency;
+        } else {
+            // moving averages over roughly the last 8 blocks
+            state->dBlockBytesPerSecond += (dBytesPerSecond - state->dBlockBytesPerSecond) / 8;
+            state->dAvgBlockSize += (nSize - state->dAvgBlockSize) / 8;
+            state->nBlockLatency += (nLatency - state->nBlockLatency) / 8;
+        }
+        state->nLastBlockReceived = nNow;
+        state->nBlocksDownloaded++;
+    }
+
+    // Requires cs_main.
+    // Keeps enough blocks in flight from a peer to cover a round trip and BLOCK_DOWNLOAD_QUEUE_SECONDS of its
+    // measured delivery, so that fast peers are kept busy, while slow peers and large blocks get fewer.
+    void UpdateBlockDownloadDepth(CNodeState *state, int64_t nPingUsecTime) {
+        if (state->nBlocksDownloaded == 0 || state->dAvgBlockSize < 1) {
+            state->nBlockDownloadDepth = DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER;
+            return;
+        }
+        double dSeconds = BLOCK_DOWNLOAD_QUEUE_SECONDS + std::max<int64_t>(nPingUsecTime, 0) / 1000000.0;
+        double dDepth = std::ceil(state->dBlockBytesPerSecond * dSeconds / state->dAvgBlockSize);
+        state->nBlockDownloadDepth = (int)std::max<double>(MIN_BLOCKS_IN_TRANSIT_PER_PEER, std::min<double>(MAX_BLOCKS_IN_TRANSIT_PER_PEER, dDepth));
+    }
+
+    // Requires cs_main.
+    // Expected time in microseconds for a peer to deliver one more block, or -1 if it has not delivered any yet.
+    int64_t ExpectedBlockDeliveryTime(const CNodeState *state) {
+        if (state->nBlocksDownloaded == 0 || state->dBlockBytesPerSecond <= 0)
+            return -1;
+        return (int64_t)(state->dAvgBlockSize * 1000000 / state->dBlockBytesPerSecond) * (state->nBlocksInFlight + 1);
+    }
+
     /** Check whether the last unknown block a peer advertized is not yet known. */
     void ProcessBlockAvailability(NodeId nodeid) {
         CNodeState *state = State(nodeid);
@@ -488,7 +573,7 @@ namespace {
 
     /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
      *  at most count entries. */
-    void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller) {
+    void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller, CBlockIndex** ppindexStalled = NULL) {
         if (count == 0)
             return;
 
@@ -524,6 +609,7 @@ namespace {
         int nWindowEnd = state->pindexLastCommonBlock->GetHeight() + BLOCK_DOWNLOAD_WINDOW;
         int nMaxHeight = std::min<int>(state->pindexBestKnownBlock->GetHeight(), nWindowEnd + 1);
         NodeId waitingfor = -1;
+        CBlockIndex *pindexWaitingFor = NULL;
         while (pindexWalk->GetHeight() < nMaxHeight) {
             // Read up to 128 (or more, if more blocks than that are needed) successors of pindexWalk (towards
             // pindexBestKnownBlock) into vToFetch. We fetch 128, because CBlockIndex::GetAncestor may be as expensive
@@ -555,6 +641,8 @@ namespace {
                         if (vBlocks.size() == 0 && waitingfor != nodeid) {
                             // We aren't able to fetch anything, but we would be if the download window was one larger.
                             nodeStaller = waitingfor;
+                            if (ppindexStalled)
+                                *ppindexStalled = pindexWaitingFor;
                         }
                         return;
                     }
@@ -565,6 +653,7 @@ namespace {
                 } else if (waitingfor == -1) {
                     // This is the first already-in-flight block.
                     waitingfor = mapBlocksInFlight[pindex->GetBlockHash()].first;
+                    pindexWaitingFor = pindex;
                 }
             }
         }
@@ -584,6 +673,11 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->GetHeight());
     }
+    stats.nBlockDownloadDepth = state->nBlockDownloadDepth;
+    stats.dBlockBytesPerSecond = state->dBlockBytesPerSecond;
+    stats.nBlockLatency = state->nBlockLatency;
+    stats.nBlocksDownloaded = state->nBlocksDownloaded;
+    stats.nBlocksReassigned = state->nBlocksReassigned;
     return true;
 }
 
@@ -1217,6 +1311,70 @@ bool ContextualCheckCoinbaseTransaction(const CTransaction &tx, uint32_t nHeight
     return valid;
 }
 
+bool CheckSaplingProofs(const CTransaction& tx, const uint256 &dataToBeSigned, CValidationState &state)
+{
+    auto ctx = librustzcash_sapling_verification_ctx_init();
+
+    for (const SpendDescription &spend : tx.vShieldedSpend) {
+        if (!librustzcash_sapling_check_spend(
+            ctx,
+            spend.cv.begin(),
+            spend.anchor.begin(),
+            spend.nullifier.begin(),
+            spend.rk.begin(),
+            spend.zkproof.begin(),
+            spend.spendAuthSig.begin(),
+            dataToBeSigned.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("CheckSaplingProofs(): Sapling spend description invalid"),
+                                  REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
+        }
+    }
+
+    for (const OutputDescription &output : tx.vShieldedOutput) {
+        if (!librustzcash_sapling_check_output(
+            ctx,
+            output.cv.begin(),
+            output.cm.begin(),
+            output.ephemeralKey.begin(),
+            output.zkproof.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("CheckSaplingProofs(): Sapling output description invalid"),
+                                  REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
+        }
+    }
+
+    if (!librustzcash_sapling_final_check(
+        ctx,
+        tx.valueBalance,
+        tx.bindingSig.begin(),
+        dataToBeSigned.begin()
+    ))
+    {
+        librustzcash_sapling_verification_ctx_free(ctx);
+        return state.DoS(100, error("CheckSaplingProofs(): Sapling binding signature invalid"),
+                              REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+    }
+
+    librustzcash_sapling_verification_ctx_free(ctx);
+    return true;
+}
+
+bool CSaplingCheck::operator()()
+{
+    CValidationState state;
+    if (!CheckSaplingProofs(*ptx, dataToBeSigned, state))
+    {
+        strRejectReason = state.GetRejectReason();
+        return false;
+    }
+    return true;
+}
+
 /**
  * Check a transaction contextually against a set of consensus rules valid at a given block height.
  *
@@ -1232,7 +1390,8 @@ bool ContextualCheckTransaction(
         const CChainParams& chainparams,
         const int nHeight,
         const int dosLevel,
-        bool (*isInitBlockDownload)(const CChainParams&))
+        bool (*isInitBlockDownload)(const CChainParams&),
+        std::vector<CSaplingCheck> *pvSaplingChecks)
 {
     bool overwinterActive = chainparams.GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_OVERWINTER);
     bool saplingActive = chainparams.GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_SAPLING);
@@ -1406,54 +1565,14 @@ bool ContextualCheckTransaction(
     if (!tx.vShieldedSpend.empty() ||
         !tx.vShieldedOutput.empty())
     {
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription &spend : tx.vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                ctx,
-                spend.cv.begin(),
-                spend.anchor.begin(),
-                spend.nullifier.begin(),
-                spend.rk.begin(),
-                spend.zkproof.begin(),
-                spend.spendAuthSig.begin(),
-                dataToBeSigned.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
-        }
-
-        for (const OutputDescription &output : tx.vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                ctx,
-                output.cv.begin(),
-                output.cm.begin(),
-                output.ephemeralKey.begin(),
-                output.zkproof.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
-            }
+        if (pvSaplingChecks)
+        {
+            pvSaplingChecks->push_back(CSaplingCheck(tx, dataToBeSigned));
         }
-
-        if (!librustzcash_sapling_final_check(
-            ctx,
-            tx.valueBalance,
-            tx.bindingSig.begin(),
-            dataToBeSigned.begin()
-        ))
+        else if (!CheckSaplingProofs(tx, dataToBeSigned, state))
         {
-            librustzcash_sapling_verification_ctx_free(ctx);
-            return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
-                                  REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+            return false;
         }
-
-        librustzcash_sapling_verification_ctx_free(ctx);
     }
 
     // precheck all crypto conditions
@@ -1929,10 +2048,12 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         fprintf(stderr,"Cannot accept coinbase as individual tx\n");
         return state.DoS(100, error("AcceptToMemoryPool: coinbase as individual tx"),REJECT_INVALID, "coinbase");
     }
-    return AcceptToMemoryPoolInt(pool, state, tx, fLimitFree, fLimitDust, pfMissingInputs, fRejectAbsurdFee, dosLevel);
+    // -developerskipscriptchecks only reaches transactions offered to the mempool, never those of blocks
+    return AcceptToMemoryPoolInt(pool, state, tx, fLimitFree, fLimitDust, pfMissingInputs, fRejectAbsurdFee, dosLevel,
+                                 0, TX_EXPIRING_SOON_THRESHOLD, NULL, true, fDeveloperSkipScriptChecks);
 }
 
-bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree, bool fLimitDust, bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel, int32_t simHeight, int expireThreshold)
+bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree, bool fLimitDust, bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel, int32_t simHeight, int expireThreshold, std::vector<CSaplingCheck> *pvSaplingChecks, bool fExpensiveChecks, bool fSkipScriptChecks, bool fLimitPackages)
 {
     AssertLockHeld(cs_main);
     if (pfMissingInputs)
@@ -1964,12 +2085,13 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
     }
 
     auto verifier = libzcash::ProofVerifier::Strict();
+    auto disabledVerifier = libzcash::ProofVerifier::Disabled();
     if ( komodo_validate_interest(tx,chainActive.LastTip()->GetHeight()+1,chainActive.LastTip()->GetMedianTimePast() + 777,0) < 0 )
     {
         //fprintf(stderr,"AcceptToMemoryPool komodo_validate_interest failure\n");
         return error("AcceptToMemoryPool: komodo_validate_interest failed");
     }
-    if (!CheckTransaction(tx, state, verifier))
+    if (!CheckTransaction(tx, state, fExpensiveChecks ? verifier : disabledVerifier))
     {
         return error("AcceptToMemoryPool: CheckTransaction failed");
     }
@@ -1978,7 +2100,7 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
 
     // DoS level set to 1 to be more forgiving.
     // Check transaction contextually against the set of consensus rules which apply in the next block to be mined.
-    if (!ContextualCheckTransaction(tx, state, chainParams, nextBlockHeight, (dosLevel == -1) ? 1 : dosLevel))
+    if (!ContextualCheckTransaction(tx, state, chainParams, nextBlockHeight, (dosLevel == -1) ? 1 : dosLevel, IsInitialBlockDownload, pvSaplingChecks))
     {
         return error("AcceptToMemoryPool: ContextualCheckTransaction failed");
     }
@@ -2375,10 +2497,27 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
             return state.Error("AcceptToMemoryPool: " + errmsg);
         }
 
+        // Limiting the in-mempool ancestors and descendants of a transaction bounds the package updates that adding
+        // and removing it make. Transactions of a block being connected are not limited.
+        if (fLimitPackages)
+        {
+            CTxMemPool::setEntries setAncestors;
+            std::string errString;
+            if (!pool.CalculateMemPoolAncestors(entry, setAncestors,
+                                                GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT),
+                                                GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT) * 1000,
+                                                GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT),
+                                                GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000,
+                                                errString))
+            {
+                return state.DoS(0, error("AcceptToMemoryPool: %s %s", errString, hash.ToString()), REJECT_NONSTANDARD, "too-long-mempool-chain");
+            }
+        }
+
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
         PrecomputedTransactionData txdata(tx);
-        if (!ContextualCheckInputs(tx, state, view, nextBlockHeight, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
+        if (!ContextualCheckInputs(tx, state, view, nextBlockHeight, fExpensiveChecks && !fSkipScriptChecks, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId, NULL, &txDesc))
         {
             //fprintf(stderr,"accept failure.9\n");
             //UniValue jsonTx(UniValue::VOBJ);
@@ -2402,7 +2541,7 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
             flag = 1;
             KOMODO_CONNECTING = (1<<30) + (int32_t)chainActive.LastTip()->GetHeight() + 1;
         }
-        if (!ContextualCheckInputs(tx, state, view, nextBlockHeight, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
+        if (!ContextualCheckInputs(tx, state, view, nextBlockHeight, fExpensiveChecks && !fSkipScriptChecks, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId, NULL, &txDesc))
         {
             //ContextualCheckInputs(tx, state, view, nextBlockHeight, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId);
             if ( flag != 0 )
@@ -2429,7 +2568,12 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
         {
             txDesc.ptx = &(entry.GetTx());
             mempool.PrioritiseReserveTransaction(txDesc);
+            if (txDesc.IsReserveTransfer())
+            {
+                ConverterGraph.AddMempoolTransaction(entry.GetTx());
+            }
         }
+        NotarizationDataCache.AddMempoolTransaction(entry.GetTx(), view);
 
         if (!tx.IsCoinImport())
         {
@@ -2442,6 +2586,11 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
             if (fSpentIndex) {
                 pool.addSpentIndex(entry, view);
             }
+
+            // Add memory offer index
+            if (fOfferIndex) {
+                pool.addOfferIndex(entry, view);
+            }
         }
     }
 
@@ -2476,6 +2625,306 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return true;
 }
 
+int64_t COfferIndexValue::Price(CAmount secondaryAmount, bool secondaryIsID, CAmount primaryAmount, bool primaryIsID)
+{
+    // an ID is one whole unit on either side
+    arith_uint256 bigSecondary(secondaryIsID ? COIN : secondaryAmount);
+    arith_uint256 bigPrimary(primaryIsID ? COIN : primaryAmount);
+    if (bigPrimary == 0)
+    {
+        return 0;
+    }
+    arith_uint256 bigPrice = (bigSecondary * arith_uint256(COIN)) / bigPrimary;
+    return bigPrice > arith_uint256(INT64_MAX) ? INT64_MAX : (int64_t)bigPrice.GetLow64();
+}
+
+// gets the ID or currency that an output of an offer pays, preferring a non-native currency to native, since
+// offers of other currencies also carry native fees
+static bool GetOfferOutputValue(const CTxOut &out, uint160 &currencyOrID, CAmount &amount, bool &isID)
+{
+    COptCCParams p;
+    if (out.scriptPubKey.IsPayToCryptoCondition(p) &&
+        p.IsValid() &&
+        p.evalCode == EVAL_IDENTITY_PRIMARY &&
+        p.vData.size())
+    {
+        CIdentity identity(p.vData[0]);
+        if (!identity.IsValid())
+        {
+            return false;
+        }
+        currencyOrID = identity.GetID();
+        amount = 0;
+        isID = true;
+        return true;
+    }
+
+    CCurrencyValueMap reserves = out.ReserveOutValue();
+    reserves.valueMap.erase(ASSETCHAINS_CHAINID);
+    reserves = reserves.CanonicalMap();
+    isID = false;
+    if (reserves.valueMap.size())
+    {
+        currencyOrID = reserves.valueMap.begin()->first;
+        amount = reserves.valueMap.begin()->second;
+    }
+    else
+    {
+        currencyOrID = ASSETCHAINS_CHAINID;
+        amount = out.nValue;
+    }
+    return amount > 0;
+}
+
+// If tx posts an on-chain offer in its op_return, gets the offer's index value. The posted offer output is either
+// output 0 of tx or, for offers that fund their own output, output 0 of the transaction whose output 1 tx spends.
+// view must include the outputs that tx spends.
+bool GetOfferIndexValue(const CTransaction &tx, const CCoinsViewCache &view, int height, COfferIndexValue &offer)
+{
+    if (tx.IsCoinBase() || tx.vout.size() < 2 || !tx.vout.back().scriptPubKey.IsOpReturn())
+    {
+        return false;
+    }
+
+    COutPoint offerOutput;
+    COptCCParams p;
+    if (tx.vout[0].scriptPubKey.IsPayToCryptoCondition(p) &&
+        p.IsValid() &&
+        (p.evalCode == EVAL_IDENTITY_COMMITMENT || p.evalCode == EVAL_IDENTITY_PRIMARY))
+    {
+        offerOutput = COutPoint(tx.GetHash(), 0);
+    }
+    else
+    {
+        for (auto &oneIn : tx.vin)
+        {
+            const CCoins *coins;
+            p = COptCCParams();
+            if (oneIn.prevout.n == 1 &&
+                (coins = view.AccessCoins(oneIn.prevout.hash)) &&
+                coins->IsAvailable(0) &&
+                coins->vout[0].scriptPubKey.IsPayToCryptoCondition(p) &&
+                p.IsValid() &&
+                (p.evalCode == EVAL_IDENTITY_COMMITMENT || p.evalCode == EVAL_IDENTITY_PRIMARY))
+            {
+                offerOutput = COutPoint(oneIn.prevout.hash, 0);
+                break;
+            }
+        }
+        if (offerOutput.IsNull())
+        {
+            return false;
+        }
+    }
+
+    std::vector<CBaseChainObject *> opRetArray = RetrieveOpRetArray(tx.vout.back().scriptPubKey);
+    CTransaction offerTx;
+    bool isPartial = true;
+    if (opRetArray.size() == 1 &&
+        opRetArray[0]->objectType == CHAINOBJ_TRANSACTION_PROOF &&
+        ((CChainObject<CPartialTransactionProof> *)(opRetArray[0]))->object.IsValid())
+    {
+        if (((CChainObject<CPartialTransactionProof> *)(opRetArray[0]))->object.GetPartialTransaction(offerTx, &isPartial).IsNull())
+        {
+            isPartial = true;
+        }
+    }
+    DeleteOpRetObjects(opRetArray);
+
+    if (isPartial ||
+        offerTx.vout.size() != 1 ||
+        offerTx.vin.size() != 1 ||
+        offerTx.vShieldedSpend.size() != 0)
+    {
+        return false;
+    }
+
+    // what the offer pays must not be spent
+    const CCoins *fundingCoins = view.AccessCoins(offerTx.vin[0].prevout.hash);
+    if (!fundingCoins || !fundingCoins->IsAvailable(offerTx.vin[0].prevout.n))
+    {
+        return false;
+    }
+
+    CTxOut requestedOut = offerTx.vout[0];
+    if (offerTx.vShieldedOutput.size() != 0)
+    {
+        requestedOut.nValue -= offerTx.valueBalance;
+    }
+
+    bool offersID = false, requestsID = false;
+    offer = COfferIndexValue();
+    if (!GetOfferOutputValue(fundingCoins->vout[offerTx.vin[0].prevout.n], offer.offeredID, offer.offeredAmount, offersID) ||
+        !GetOfferOutputValue(requestedOut, offer.requestedID, offer.requestedAmount, requestsID))
+    {
+        offer.SetNull();
+        return false;
+    }
+    offer.flags = (offersID ? COfferIndexValue::FLAG_OFFERS_ID : 0) | (requestsID ? COfferIndexValue::FLAG_REQUESTS_ID : 0);
+    offer.blockHeight = height;
+    offer.expiryHeight = offerTx.nExpiryHeight;
+    offer.offerOutput = offerOutput;
+    offer.fundingOutput = offerTx.vin[0].prevout;
+    offer.postingTxid = tx.GetHash();
+    return true;
+}
+
+// outputs that have offer outpoint records, loaded at startup and added to as offers are connected, so that only spends
+// of these need an offer index lookup. Records outlive the spends of their outputs, so that a disconnect can reopen the
+// offers, and entries are never removed. Protected by cs_main.
+static std::set<COutPoint> setOfferOutPoints;
+
+// gets all unexpired offers of one index type for the primary currency or ID, and optionally only in exchange for
+// secondaryID, from both the index and the mempool, leaving out those taken or closed in the mempool
+bool GetOfferIndex(unsigned int type, const uint160 &primaryID, const uint160 &secondaryID, uint32_t height, std::vector<COfferIndexDbEntry> &offers)
+{
+    AssertLockHeld(cs_main);
+    if (!fOfferIndex)
+        return error("Offer index not enabled");
+
+    std::vector<COfferIndexDbEntry> indexedOffers;
+    if (!pblocktree->ReadOfferIndex(type, primaryID, secondaryID, indexedOffers))
+        return error("Unable to read offer index");
+
+    mempool.getOfferIndex(type, primaryID, secondaryID, indexedOffers);
+
+    LOCK(mempool.cs);
+    for (auto &oneOffer : indexedOffers)
+    {
+        if (oneOffer.second.expiryHeight > height &&
+            !mempool.mapNextTx.count(oneOffer.second.offerOutput) &&
+            !mempool.mapNextTx.count(oneOffer.second.fundingOutput))
+        {
+            offers.push_back(oneOffer);
+        }
+    }
+    std::sort(offers.begin(), offers.end(),
+              [](const COfferIndexDbEntry &a, const COfferIndexDbEntry &b) { return a.first < b.first; });
+    return true;
+}
+
+void COfferIndexUpdate::ConnectTransaction(const CTransaction &tx, const CCoinsViewCache &view, uint32_t height)
+{
+    uint256 txhash = tx.GetHash();
+
+    // offers posted in, funded by or carried by outputs that this transaction spends are no longer open
+    if (!tx.IsCoinBase())
+    {
+        for (auto &oneIn : tx.vin)
+        {
+            // most inputs never held or funded an offer
+            if (!setOfferOutPoints.count(oneIn.prevout))
+            {
+                continue;
+            }
+            std::vector<COfferIndexValue> spentOffers;
+            for (auto it = blockOffers.lower_bound(oneIn.prevout); it != blockOffers.end() && it->first == oneIn.prevout; it++)
+            {
+                spentOffers.push_back(it->second);
+            }
+            pblocktree->ReadOfferOutPoint(oneIn.prevout, spentOffers);
+            for (auto &oneOffer : spentOffers)
+            {
+                offers.push_back(make_pair(oneOffer.GetKey(COfferIndexKey::OFFERED), COfferIndexValue()));
+                offers.push_back(make_pair(oneOffer.GetKey(COfferIndexKey::REQUESTED), COfferIndexValue()));
+            }
+        }
+    }
+
+    // offers that are already expired are not indexed
+    COfferIndexValue newOffer;
+    if (GetOfferIndexValue(tx, view, height, newOffer) &&
+        newOffer.expiryHeight > height)
+    {
+        offers.push_back(make_pair(newOffer.GetKey(COfferIndexKey::OFFERED), newOffer));
+        offers.push_back(make_pair(newOffer.GetKey(COfferIndexKey::REQUESTED), newOffer));
+        for (auto &oneOutPoint : {newOffer.offerOutput, newOffer.fundingOutput, COutPoint(txhash, tx.vout.size() - 1)})
+        {
+            outPoints.push_back(make_pair(make_pair(oneOutPoint, txhash), newOffer));
+            blockOffers.insert(make_pair(oneOutPoint, newOffer));
+            setOfferOutPoints.insert(oneOutPoint);
+        }
+        expiries.push_back(make_pair(make_pair(newOffer.expiryHeight, txhash), newOffer));
+    }
+}
+
+void COfferIndexUpdate::ExpireOffers(uint32_t height)
+{
+    // a disconnect of this block puts back those that are still open
+    std::vector<COfferIndexValue> expiredOffers;
+    pblocktree->ReadOfferExpiries(height, expiredOffers);
+    for (auto &oneOffer : expiredOffers)
+    {
+        offers.push_back(make_pair(oneOffer.GetKey(COfferIndexKey::OFFERED), COfferIndexValue()));
+        offers.push_back(make_pair(oneOffer.GetKey(COfferIndexKey::REQUESTED), COfferIndexValue()));
+    }
+}
+
+void COfferIndexUpdate::DisconnectTransaction(const CTransaction &tx)
+{
+    uint256 hash = tx.GetHash();
+    if (tx.vout.size() > 1 &&
+        tx.vout.back().scriptPubKey.IsOpReturn() &&
+        setOfferOutPoints.count(COutPoint(hash, tx.vout.size() - 1)))
+    {
+        std::vector<COfferIndexValue> postedOffers;
+        pblocktree->ReadOfferOutPoint(COutPoint(hash, tx.vout.size() - 1), postedOffers);
+        for (auto &oneOffer : postedOffers)
+        {
+            if (oneOffer.postingTxid != hash)
+            {
+                continue;
+            }
+            offers.push_back(make_pair(oneOffer.GetKey(COfferIndexKey::OFFERED), COfferIndexValue()));
+            offers.push_back(make_pair(oneOffer.GetKey(COfferIndexKey::REQUESTED), COfferIndexValue()));
+            for (auto &oneOutPoint : {oneOffer.offerOutput, oneOffer.fundingOutput, COutPoint(hash, tx.vout.size() - 1)})
+            {
+                outPoints.push_back(make_pair(make_pair(oneOutPoint, hash), COfferIndexValue()));
+            }
+            expiries.push_back(make_pair(make_pair(oneOffer.expiryHeight, hash), COfferIndexValue()));
+            removedOffers.insert(hash);
+        }
+    }
+    if (!tx.IsMint())
+    {
+        for (auto &oneIn : tx.vin)
+        {
+            if (setOfferOutPoints.count(oneIn.prevout))
+            {
+                pblocktree->ReadOfferOutPoint(oneIn.prevout, reopenedOffers);
+            }
+        }
+    }
+}
+
+void COfferIndexUpdate::ReopenOffers(const CCoinsViewCache &view, uint32_t height)
+{
+    // offers that expired at this height are unexpired again
+    pblocktree->ReadOfferExpiries(height, reopenedOffers);
+
+    // an offer is open again if it has not expired before this block, and neither its offer output nor what it pays
+    // is spent without this block
+    for (auto &oneOffer : reopenedOffers)
+    {
+        const CCoins *offerCoins = view.AccessCoins(oneOffer.offerOutput.hash);
+        const CCoins *fundingCoins = view.AccessCoins(oneOffer.fundingOutput.hash);
+        if (!removedOffers.count(oneOffer.postingTxid) &&
+            oneOffer.expiryHeight >= height &&
+            offerCoins && offerCoins->IsAvailable(oneOffer.offerOutput.n) &&
+            fundingCoins && fundingCoins->IsAvailable(oneOffer.fundingOutput.n))
+        {
+            offers.push_back(make_pair(oneOffer.GetKey(COfferIndexKey::OFFERED), oneOffer));
+            offers.push_back(make_pair(oneOffer.GetKey(COfferIndexKey::REQUESTED), oneOffer));
+        }
+    }
+}
+
+bool COfferIndexUpdate::Write() const
+{
+    return !(offers.size() || outPoints.size() || expiries.size()) ||
+           pblocktree->UpdateOfferIndex(offers, outPoints, expiries);
+}
+
 bool GetAddressIndex(const uint160& addressHash, int type,
                      std::vector<CAddressIndexDbEntry>& addressIndex,
                      int start, int end)
@@ -2489,6 +2938,36 @@ bool GetAddressIndex(const uint160& addressHash, int type,
     return true;
 }
 
+bool GetIdentityRevision(const CIdentityRevisionKey &key, CIdentityRevisionValue &revision)
+{
+    if (!fIdHistoryIndex)
+        return error("identity history index not enabled");
+
+    return pblocktree->ReadIdentityRevision(key, revision);
+}
+
+bool GetIdentityRevisions(const uint160 &identityID, std::vector<CIdentityRevisionDbEntry> &revisions, int start, int end)
+{
+    if (!fIdHistoryIndex)
+        return error("identity history index not enabled");
+
+    if (!pblocktree->ReadIdentityRevisions(identityID, revisions, start, end))
+        return error("unable to get identity revisions");
+
+    return true;
+}
+
+bool GetIdentityContent(const uint160 &identityID, const uint160 &vdxfKey, std::vector<CIdentityContentDbEntry> &content, int start, int end)
+{
+    if (!fIdHistoryIndex)
+        return error("identity history index not enabled");
+
+    if (!pblocktree->ReadIdentityContent(identityID, vdxfKey, content, start, end))
+        return error("unable to get identity content");
+
+    return true;
+}
+
 bool GetAddressUnspent(const uint160& addressHash, int type,
                        std::vector<CAddressUnspentDbEntry>& unspentOutputs)
 {
@@ -3014,6 +3493,7 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
 }
 
 bool CScriptCheck::operator()() {
+    CCArenaScope ccArena;
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     ServerTransactionSignatureChecker checker(ptxTo, nIn, amount, cacheStore, *txdata);
     checker.SetIDMap(idMap);
@@ -3050,7 +3530,8 @@ bool IsCoinbaseFromBlockN(const CTransaction &cbTx, uint32_t N)
 }
 
 namespace Consensus {
-    bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, uint32_t nSpendHeight, const Consensus::Params& consensusParams)
+    bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, uint32_t nSpendHeight, const Consensus::Params& consensusParams,
+                       const CReserveTransactionDescriptor *pReserveDesc)
     {
         // This doesn't trigger the DoS code on purpose; if it did, it would make it easier
         // for an attacker to attempt to split the network.
@@ -3068,7 +3549,7 @@ namespace Consensus {
 
         bool isPBaaS = CConstVerusSolutionVector::GetVersionByHeight(nSpendHeight) >= CActivationHeight::ACTIVATE_PBAAS;
 
-        CReserveTransactionDescriptor rtxd(tx, inputs, nSpendHeight);
+        CReserveTransactionDescriptor rtxd = pReserveDesc ? *pReserveDesc : CReserveTransactionDescriptor(tx, inputs, nSpendHeight);
         if (isPBaaS && !rtxd.IsValid())
         {
             return state.DoS(10, error("Invalid reserve transaction"), REJECT_INVALID, "bad-txns-invalid-reservetx");
@@ -3221,12 +3702,13 @@ bool ContextualCheckInputs(const CTransaction& tx,
                            PrecomputedTransactionData& txdata,
                            const Consensus::Params& consensusParams,
                            uint32_t consensusBranchId,
-                           std::vector<CScriptCheck> *pvChecks)
+                           std::vector<CScriptCheck> *pvChecks,
+                           const CReserveTransactionDescriptor *pReserveDesc)
 {
     if (!tx.IsMint())
     {
         //uint32_t spendHeight = GetSpendHeight(inputs);
-        if (!Consensus::CheckTxInputs(tx, state, inputs, spendHeight, consensusParams)) {
+        if (!Consensus::CheckTxInputs(tx, state, inputs, spendHeight, consensusParams, pReserveDesc)) {
             return false;
         }
 
@@ -3329,60 +3811,60 @@ bool ContextualCheckInputs(const CTransaction& tx,
  return true;
  }*/
 
-namespace {
+bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // Open history file to append
+    CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: OpenUndoFile failed", __func__);
 
-    bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
-    {
-        // Open history file to append
-        CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
-        if (fileout.IsNull())
-            return error("%s: OpenUndoFile failed", __func__);
+    // Write index header
+    unsigned int nSize = GetSerializeSize(fileout, blockundo);
+    fileout << FLATDATA(messageStart) << nSize;
 
-        // Write index header
-        unsigned int nSize = GetSerializeSize(fileout, blockundo);
-        fileout << FLATDATA(messageStart) << nSize;
+    // Write undo data
+    long fileOutPos = ftell(fileout.Get());
+    if (fileOutPos < 0)
+        return error("%s: ftell failed", __func__);
+    pos.nPos = (unsigned int)fileOutPos;
+    fileout << blockundo;
 
-        // Write undo data
-        long fileOutPos = ftell(fileout.Get());
-        if (fileOutPos < 0)
-            return error("%s: ftell failed", __func__);
-        pos.nPos = (unsigned int)fileOutPos;
-        fileout << blockundo;
+    // calculate & write checksum
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << hashBlock;
+    hasher << blockundo;
+    fileout << hasher.GetHash();
 
-        // calculate & write checksum
-        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
-        hasher << hashBlock;
-        hasher << blockundo;
-        fileout << hasher.GetHash();
+    return true;
+}
 
-        return true;
-    }
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
+{
+    // Open history file to read
+    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed", __func__);
 
-    bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
-    {
-        // Open history file to read
-        CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-        if (filein.IsNull())
-            return error("%s: OpenBlockFile failed", __func__);
+    // Read block
+    uint256 hashChecksum;
+    try {
+        filein >> blockundo;
+        filein >> hashChecksum;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    // Verify checksum
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << hashBlock;
+    hasher << blockundo;
+    if (hashChecksum != hasher.GetHash())
+        return error("%s: Checksum mismatch", __func__);
 
-        // Read block
-        uint256 hashChecksum;
-        try {
-            filein >> blockundo;
-            filein >> hashChecksum;
-        }
-        catch (const std::exception& e) {
-            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-        }
-        // Verify checksum
-        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
-        hasher << hashBlock;
-        hasher << blockundo;
-        if (hashChecksum != hasher.GetHash())
-            return error("%s: Checksum mismatch", __func__);
+    return true;
+}
 
-        return true;
-    }
+namespace {
 
     /** Abort with a message */
     bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
@@ -3482,6 +3964,42 @@ void SetMaxScriptElementSize(uint32_t height)
     }
 }
 
+// gets the revision of each identity and each of its content multimap entries that a block mines, which are the
+// same entries to write when it is connected and erase when it is disconnected
+void GetIdentityHistoryIndexEntries(const CBlock &block, const CBlockIndex *pindex,
+                                    std::vector<CIdentityRevisionDbEntry> &revisions,
+                                    std::vector<CIdentityContentDbEntry> &content)
+{
+    uint256 blockHash = pindex->GetBlockHash();
+    for (int i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = block.vtx[i];
+        uint256 hash = tx.GetHash();
+        for (int j = 0; j < tx.vout.size(); j++)
+        {
+            COptCCParams p;
+            CIdentity identity;
+            if (!(tx.vout[j].scriptPubKey.IsPayToCryptoCondition(p) &&
+                  p.IsValid() &&
+                  p.evalCode == EVAL_IDENTITY_PRIMARY &&
+                  p.vData.size() &&
+                  (identity = CIdentity(p.vData[0])).IsValid()))
+            {
+                continue;
+            }
+            uint160 identityID = identity.GetID();
+            revisions.push_back(make_pair(CIdentityRevisionKey(identityID, pindex->GetHeight(), i, hash, j),
+                                          CIdentityRevisionValue(blockHash, p.vData[0])));
+            unsigned int entryNum = 0;
+            for (auto &oneEntry : identity.contentMultiMap)
+            {
+                content.push_back(make_pair(CIdentityContentKey(identityID, oneEntry.first, pindex->GetHeight(), i, hash, j, entryNum++),
+                                            CIdentityContentValue(blockHash, oneEntry.second)));
+            }
+        }
+    }
+}
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state.
  *  The addressIndex and spentIndex will be updated if requested.
@@ -3512,6 +4030,8 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
     std::vector<CAddressIndexDbEntry> addressIndex;
     std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
     std::vector<CSpentIndexDbEntry> spentIndex;
+    COfferIndexUpdate offerUpdate;
+    std::set<uint160> notarizationCurrencies;
 
     uint32_t nHeight = pindex->GetHeight();
 
@@ -3519,6 +4039,14 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = block.vtx[i];
         uint256 const hash = tx.GetHash();
+        for (auto &oneOut : tx.vout)
+        {
+            CNotarizationDataCache::GetNotarizationCurrencies(oneOut, notarizationCurrencies);
+        }
+
+        if (fOfferIndex && updateIndices) {
+            offerUpdate.DisconnectTransaction(tx);
+        }
 
         if (fAddressIndex && updateIndices) {
             for (unsigned int k = tx.vout.size(); k-- > 0;) {
@@ -3627,6 +4155,7 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
                 const COutPoint &out = tx.vin[j].prevout;
                 const CTxInUndo &undo = txundo.vprevout[j];
+                CNotarizationDataCache::GetNotarizationCurrencies(undo.txout, notarizationCurrencies);
                 if (!ApplyTxInUndo(undo, view, out))
                     fClean = false;
 
@@ -3748,6 +4277,25 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
             return DISCONNECT_FAILED;
         }
     }
+    if (fOfferIndex && updateIndices) {
+        offerUpdate.ReopenOffers(view, nHeight);
+        if (!offerUpdate.Write()) {
+            AbortNode(state, "Failed to write offer index");
+            return DISCONNECT_FAILED;
+        }
+    }
+    if (fIdHistoryIndex && updateIndices) {
+        std::vector<CIdentityRevisionDbEntry> identityRevisions;
+        std::vector<CIdentityContentDbEntry> identityContent;
+        GetIdentityHistoryIndexEntries(block, pindex, identityRevisions, identityContent);
+        if ((identityRevisions.size() || identityContent.size()) &&
+            !pblocktree->EraseIdentityIndex(identityRevisions, identityContent)) {
+            AbortNode(state, "Failed to write identity history index");
+            return DISCONNECT_FAILED;
+        }
+    }
+    ConverterGraph.DisconnectBlock(block);
+    NotarizationDataCache.Invalidate(notarizationCurrencies);
     // unwind any consensus upgrades that may have been removed in the block
     ConnectedChains.CheckOracleUpgrades();
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
@@ -3779,12 +4327,62 @@ void static FlushBlockFile(bool fFinalize = false)
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CSaplingCheck> saplingcheckqueue(4);
+static CCheckQueue<CHeaderCheck> headercheckqueue(16);
 
 void ThreadScriptCheck() {
     RenameThread("verus-scriptch");
     scriptcheckqueue.Thread();
 }
 
+void ThreadSaplingCheck() {
+    RenameThread("verus-saplingch");
+    saplingcheckqueue.Thread();
+}
+
+void ThreadHeaderCheck() {
+    RenameThread("verus-headerch");
+    headercheckqueue.Thread();
+}
+
+bool CHeaderCheck::operator()()
+{
+    presult->hash = pheader->GetHash();
+    presult->fValid = CheckEquihashSolution(pheader, Params().GetConsensus());
+    presult->fChecked = true;
+    return presult->fValid;
+}
+
+// count of new headers added to the block index by each headers message over the last minute, by time received
+static CCriticalSection cs_headerSyncRate;
+static std::deque<std::pair<int64_t, unsigned int>> headerSyncCounts;
+static const int64_t HEADER_SYNC_RATE_WINDOW = 60 * 1000000;
+
+static void RecordHeaderSync(int64_t nTimeMicros, unsigned int nNewHeaders)
+{
+    LOCK(cs_headerSyncRate);
+    if (nNewHeaders)
+    {
+        headerSyncCounts.push_back(std::make_pair(nTimeMicros, nNewHeaders));
+    }
+    while (!headerSyncCounts.empty() && headerSyncCounts.front().first < nTimeMicros - HEADER_SYNC_RATE_WINDOW)
+    {
+        headerSyncCounts.pop_front();
+    }
+}
+
+double GetHeaderSyncRate()
+{
+    RecordHeaderSync(GetTimeMicros(), 0);
+    LOCK(cs_headerSyncRate);
+    uint64_t nHeaders = 0;
+    for (auto &oneCount : headerSyncCounts)
+    {
+        nHeaders += oneCount.second;
+    }
+    return (double)nHeaders * 1000000 / HEADER_SYNC_RATE_WINDOW;
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3859,7 +4457,58 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
-bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck, bool fCheckPOW)
+// script, signature and proof checks are skipped for blocks that are ancestors of the last checkpoint, or of the
+// assumed valid block once the best header is at least ASSUMEVALID_MIN_AGE past them, see doc/assumevalid.md
+static bool ExpensiveChecksEnabled(const CChainParams& chainparams, const CBlockIndex *pindex)
+{
+    if (fCheckpointsEnabled) {
+        CBlockIndex *pindexLastCheckpoint = Checkpoints::GetLastCheckpoint(chainparams.Checkpoints());
+        if (pindexLastCheckpoint && pindexLastCheckpoint->GetAncestor(pindex->GetHeight()) == pindex) {
+            return false;
+        }
+    }
+    if (!hashAssumeValid.IsNull() && pindexBestHeader) {
+        BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValid);
+        if (it != mapBlockIndex.end() &&
+            it->second->GetAncestor(pindex->GetHeight()) == pindex &&
+            pindexBestHeader->GetAncestor(it->second->GetHeight()) == it->second &&
+            pindexBestHeader->chainPower >= CChainPower(pindexBestHeader, arith_uint256(), UintToArith256(chainparams.GetConsensus().nMinimumChainWork)) &&
+            pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() >= ASSUMEVALID_MIN_AGE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ConnectBlock puts block transactions in the mempool before their deferred checks have completed, or without script
+// and proof checks for assumed valid blocks. Unless Release is called once the block's checks have passed, every
+// transaction added here is removed from the mempool again when ConnectBlock returns.
+class CUncheckedMempoolAdditions
+{
+    std::vector<const CTransaction *> vAdded;
+
+public:
+    ~CUncheckedMempoolAdditions()
+    {
+        for (auto it = vAdded.rbegin(); it != vAdded.rend(); it++)
+        {
+            std::list<CTransaction> removed;
+            mempool.remove(**it, removed, true);
+        }
+    }
+
+    void Add(const CTransaction &tx)
+    {
+        vAdded.push_back(&tx);
+    }
+
+    void Release()
+    {
+        vAdded.clear();
+    }
+};
+
+bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck, bool fCheckPOW, bool fTransactionsChecked, bool fTransactionsCheckedExpensive)
 {
     uint32_t nHeight = pindex->GetHeight();
     if (KOMODO_STOPAT != 0 && nHeight > KOMODO_STOPAT)
@@ -3883,21 +4532,20 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         ConnectedChains.ConfigureEthBridge();
     }
 
-    bool fExpensiveChecks = true;
-    if (fCheckpointsEnabled) {
-        CBlockIndex *pindexLastCheckpoint = Checkpoints::GetLastCheckpoint(chainparams.Checkpoints());
-        if (pindexLastCheckpoint && pindexLastCheckpoint->GetAncestor(nHeight) == pindex) {
-            // This block is an ancestor of a checkpoint: disable script checks
-            fExpensiveChecks = false;
-        }
-    }
+    bool fExpensiveChecks = ExpensiveChecksEnabled(chainparams, pindex);
     auto verifier = libzcash::ProofVerifier::Strict();
     auto disabledVerifier = libzcash::ProofVerifier::Disabled();
     int32_t futureblock;
 
+    // transactions checked before expensive checks were turned on for this block, or off, are checked again
+    fTransactionsChecked = fTransactionsChecked && fTransactionsCheckedExpensive == fExpensiveChecks;
+
     {
-        // Check it again to verify JoinSplit proofs, and in case a previous version let a bad block in
-        if (!CheckBlock(&futureblock, pindex->GetHeight(), pindex, block, state, chainparams, fExpensiveChecks ? verifier : disabledVerifier, fCheckPOW, !fJustCheck, !fJustCheck) || futureblock != 0 )
+        // Check it again to verify JoinSplit proofs, and in case a previous version let a bad block in.
+        // If a prefetch thread already ran CheckBlockTransactions on it, its merkle root and proofs are not checked again.
+        if (!CheckBlock(&futureblock, pindex->GetHeight(), pindex, block, state, chainparams,
+                        fExpensiveChecks && !fTransactionsChecked ? verifier : disabledVerifier,
+                        fCheckPOW, !fJustCheck && !fTransactionsChecked, !fJustCheck) || futureblock != 0 )
         {
             if (futureblock)
             {
@@ -3931,8 +4579,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<CAddressIndexDbEntry> addressIndex;
     std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
     std::vector<CSpentIndexDbEntry> spentIndex;
+    COfferIndexUpdate offerUpdate;
+    std::set<uint160> notarizationCurrencies;
 
+    // declared before the check queue controls, so that it is destroyed after their checks are done
+    CUncheckedMempoolAdditions uncheckedMempoolTxs;
     CCheckQueueControl<CScriptCheck> control(fExpensiveChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
+    // Sapling proofs are verified on the worker pool when we have one, otherwise inline, unless expensive checks are off
+    CCheckQueueControl<CSaplingCheck> saplingControl(fExpensiveChecks && nScriptCheckThreads ? &saplingcheckqueue : NULL);
+    std::vector<CSaplingCheck> vSaplingChecks;
+    std::vector<CSaplingCheck> *pvSaplingChecks = !fExpensiveChecks || nScriptCheckThreads ? &vSaplingChecks : NULL;
     CCurrencyDefinition newThisChain;
     std::vector<uint256> vOrphanErase;
 
@@ -4150,13 +4806,14 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             }
 
             bool missingInputs = false;
+            bool addedToMempool = false;
             bool isPosTx = block.IsVerusPOSBlock() && (i + 1) == block.vtx.size();
             if (((tx.IsCoinBase() ||
                   isPosTx ||
                   chainActive.Height() >= pindex->GetHeight()) &&
-                 !ContextualCheckTransaction(tx, state, chainparams, nHeight, 10)) ||
+                 !ContextualCheckTransaction(tx, state, chainparams, nHeight, 10, IsInitialBlockDownload, pvSaplingChecks)) ||
                 (!(tx.IsCoinBase() || isPosTx || chainActive.Height() >= pindex->GetHeight()) &&
-                 !AcceptToMemoryPoolInt(mempool, state, tx, false, !ConnectedChains.IsEnhancedDustCheck(nHeight), &missingInputs, false, 10, nHeight, 0) &&
+                 !(addedToMempool = AcceptToMemoryPoolInt(mempool, state, tx, false, !ConnectedChains.IsEnhancedDustCheck(nHeight), &missingInputs, false, 10, nHeight, 0, pvSaplingChecks, fExpensiveChecks, false, false)) &&
                  !(state.GetRejectReason() == "already in mempool" ||
                    state.GetRejectReason() == "already have coins") &&
                  !(state.GetRejectReason() == "staking" &&
@@ -4171,7 +4828,15 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 return false; // Failure reason has been set in validation state object
             }
             state = CValidationState();
+            if (addedToMempool && (!fExpensiveChecks || vSaplingChecks.size()))
+            {
+                uncheckedMempoolTxs.Add(tx);
+            }
+            saplingControl.Add(vSaplingChecks);
+            vSaplingChecks.clear();
 
+            // not taken from the mempool, because a descriptor also depends on the chain, currency and notarization
+            // state it is built on, not only on the coins that tx spends. It is built once and passed to the input checks.
             CReserveTransactionDescriptor rtxd(tx, view, nHeight);
             if (rtxd.IsReject())
             {
@@ -4585,7 +5250,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
                 std::vector<CScriptCheck> vChecks;
                 bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-                if (!ContextualCheckInputs(tx, state, view, nHeight, fExpensiveChecks, flags, fCacheResults, txdata[i], chainparams.GetConsensus(), consensusBranchId, nScriptCheckThreads ? &vChecks : NULL))
+                if (!ContextualCheckInputs(tx, state, view, nHeight, fExpensiveChecks, flags, fCacheResults, txdata[i], chainparams.GetConsensus(), consensusBranchId, nScriptCheckThreads ? &vChecks : NULL, &rtxd))
                     return false;
                 control.Add(vChecks);
             }
@@ -4939,11 +5604,18 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 }
             }
 
+            if (fOfferIndex)
+            {
+                offerUpdate.ConnectTransaction(tx, view, pindex->GetHeight());
+            }
+
             CTxUndo undoDummy;
             if (i > 0) {
                 blockundo.vtxundo.push_back(CTxUndo());
             }
 
+            // collect notarization currencies before the inputs are spent in the view
+            CNotarizationDataCache::GetNotarizationCurrencies(tx, view, notarizationCurrencies);
             UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->GetHeight());
 
             BOOST_FOREACH(const JSDescription &joinsplit, tx.vJoinSplit) {
@@ -5133,6 +5805,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     if (!control.Wait())
         return state.DoS(100, false);
+    CSaplingCheck failedSaplingCheck;
+    if (!saplingControl.Wait(&failedSaplingCheck))
+        return state.DoS(100, error("ConnectBlock(): Sapling proof or binding signature invalid (%s)", failedSaplingCheck.GetRejectReason()),
+                         REJECT_INVALID, failedSaplingCheck.GetRejectReason());
+    // the checks of the block passed, so what it added to the mempool can stay there
+    uncheckedMempoolTxs.Release();
     int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs-1), nTimeVerify * 0.000001);
 
@@ -5189,6 +5867,25 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->UpdateSpentIndex(spentIndex))
             return AbortNode(state, "Failed to write transaction index");
 
+    if (fOfferIndex)
+    {
+        offerUpdate.ExpireOffers(pindex->GetHeight());
+        if (!offerUpdate.Write())
+            return AbortNode(state, "Failed to write offer index");
+    }
+
+    if (fIdHistoryIndex) {
+        std::vector<CIdentityRevisionDbEntry> identityRevisions;
+        std::vector<CIdentityContentDbEntry> identityContent;
+        GetIdentityHistoryIndexEntries(block, pindex, identityRevisions, identityContent);
+        if ((identityRevisions.size() || identityContent.size()) &&
+            !pblocktree->WriteIdentityIndex(identityRevisions, identityContent))
+            return AbortNode(state, "Failed to write identity history index");
+    }
+
+    ConverterGraph.ConnectBlock(block, pindex->GetHeight());
+    NotarizationDataCache.Invalidate(notarizationCurrencies);
+
     if (fTimestampIndex) {
         unsigned int logicalTS = pindex->nTime;
         unsigned int prevLogicalTS = 0;
@@ -5461,6 +6158,10 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
 {
     CBlockIndex *pindexDelete = chainActive.Tip();
     assert(pindexDelete);
+    // a node started from a chain snapshot has no block or undo data before the last blocks of the snapshot
+    if ((pindexDelete->nStatus & (BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO)) != (BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO))
+        return state.Error(strprintf("%s: block %s at height %d has no block or undo data to disconnect it with",
+                                     __func__, pindexDelete->GetBlockHash().GetHex(), pindexDelete->GetHeight()));
     // Read block from disk.
     CBlock block;
     if (!ReadBlockFromDisk(block, pindexDelete, chainparams.GetConsensus(), 1))
@@ -5554,42 +6255,343 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
             // in which case we don't want to evict from the mempool yet!
             mempool.removeWithAnchor(sproutAnchorBeforeDisconnect, SPROUT);
         }
-        if (saplingAnchorBeforeDisconnect != saplingAnchorAfterDisconnect) {
-            // The anchor may not change between block disconnects,
-            // in which case we don't want to evict from the mempool yet!
-            mempool.removeWithAnchor(saplingAnchorBeforeDisconnect, SAPLING);
+        if (saplingAnchorBeforeDisconnect != saplingAnchorAfterDisconnect) {
+            // The anchor may not change between block disconnects,
+            // in which case we don't want to evict from the mempool yet!
+            mempool.removeWithAnchor(saplingAnchorBeforeDisconnect, SAPLING);
+        }
+    }
+
+    // Update chainActive and related variables.
+    UpdateTip(pindexDelete->pprev, chainparams);
+
+    // Get the current commitment tree
+    SproutMerkleTree newSproutTree;
+    SaplingMerkleTree newSaplingTree;
+    assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), newSproutTree));
+    assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), newSaplingTree));
+    // Let wallets know transactions went from 1-confirmed to
+    // 0-confirmed or conflicted:
+    for (int i = 0; i < block.vtx.size(); i++)
+    {
+        CTransaction &tx = block.vtx[i];
+        //if ((i == (block.vtx.size() - 1)) && ((ASSETCHAINS_LWMAPOS && block.IsVerusPOSBlock()) || (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0))))
+        if ((i == (block.vtx.size() - 1)) && (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0)))
+        {
+            EraseFromWallets(tx.GetHash());
+        }
+        else
+        {
+            SyncWithWallets(tx, NULL);
+        }
+    }
+    // Update cached incremental witnesses
+    GetMainSignals().ChainTip(pindexDelete, &block, newSproutTree, newSaplingTree, false);
+    return true;
+}
+
+/**
+ * Reads the blocks that ActivateBestChainStep is about to connect on a few threads while the tip is being
+ * connected. Each block is deserialized and checked with CheckBlockTransactions, and the coins it spends that are
+ * in the coins database are read into a staging list, which is added to pcoinsTip when the block is connected,
+ * if the database has not been written since.
+ */
+class CBlockPrefetcher
+{
+public:
+    struct CPrefetchedBlock
+    {
+        enum EStatus {
+            QUEUED,
+            LOADING,
+            READY
+        };
+
+        EStatus status;
+        bool fWanted;                   // still in the last set of blocks to prefetch
+        int nHeight;
+        CDiskBlockPos pos;
+        bool fExpensiveChecks;
+        bool fLoaded;
+        bool fTransactionsChecked;
+        CBlock block;
+        std::vector<std::pair<uint256, CCoins>> vCoins;
+        uint64_t nCoinsSequence;        // write sequence of the coins database that vCoins were read at
+        int64_t nLoadTime;              // time spent reading, checking and prefetching, in microseconds
+
+        CPrefetchedBlock() : status(QUEUED), fWanted(true), nHeight(0), fExpensiveChecks(true), fLoaded(false),
+                             fTransactionsChecked(false), nCoinsSequence(0), nLoadTime(0) {}
+    };
+
+    CBlockPrefetcher() : nThreads(0), nLoading(0), pcoinsdb(NULL) {}
+
+    void Thread();
+
+    void SetCoinsView(CCoinsViewDB *pcoinsdbIn)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (nLoading)
+            condReady.wait(lock);
+        pcoinsdb = pcoinsdbIn;
+        for (auto &entry : mapBlocks)
+            entry.second.vCoins.clear();
+    }
+
+    // makes the given blocks, in the order they will be connected, the ones to prefetch, needs cs_main
+    void Prefetch(const CChainParams& chainparams, const std::vector<CBlockIndex*> &vpindex);
+
+    // moves a prefetched block into block and adds the coins it spends to pcoinsTip, returning false if it
+    // was not prefetched, or could not be read. fTransactionsCheckedExpensive is whether proofs were verified when its
+    // transactions were checked.
+    bool Take(const uint256 &hash, CBlock &block, bool &fTransactionsChecked, bool &fTransactionsCheckedExpensive,
+              int64_t &nLoadTime, int64_t &nWaitTime);
+
+private:
+    boost::mutex mutex;
+    boost::condition_variable condWork;
+    boost::condition_variable condReady;
+    std::map<uint256, CPrefetchedBlock> mapBlocks;
+    std::deque<uint256> queue;
+    int nThreads;
+    int nLoading;
+    CCoinsViewDB *pcoinsdb;
+
+    void Load(const uint256 &hash, CPrefetchedBlock &entry, CCoinsViewDB *pcoinsdbIn);
+};
+
+static CBlockPrefetcher blockPrefetcher;
+
+void ThreadBlockPrefetch() {
+    RenameThread("verus-prefetch");
+    blockPrefetcher.Thread();
+}
+
+void SetBlockPrefetchCoinsView(CCoinsViewDB *pcoinsdb)
+{
+    blockPrefetcher.SetCoinsView(pcoinsdb);
+}
+
+void CBlockPrefetcher::Thread()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nThreads++;
+    }
+    while (true)
+    {
+        uint256 hash;
+        CPrefetchedBlock entry;
+        CCoinsViewDB *pcoinsdbIn;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty())
+            {
+                condWork.wait(lock);
+            }
+            hash = queue.front();
+            queue.pop_front();
+            auto it = mapBlocks.find(hash);
+            if (it == mapBlocks.end() || it->second.status != CPrefetchedBlock::QUEUED)
+            {
+                continue;
+            }
+            it->second.status = CPrefetchedBlock::LOADING;
+            entry.nHeight = it->second.nHeight;
+            entry.pos = it->second.pos;
+            entry.fExpensiveChecks = it->second.fExpensiveChecks;
+            pcoinsdbIn = pcoinsdb;
+            nLoading++;
+        }
+
+        try {
+            Load(hash, entry, pcoinsdbIn);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: error prefetching block %s: %s\n", __func__, hash.GetHex(), e.what());
+            entry.fLoaded = false;
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            nLoading--;
+            auto it = mapBlocks.find(hash);
+            if (it != mapBlocks.end())
+            {
+                if (it->second.fWanted)
+                {
+                    entry.status = CPrefetchedBlock::READY;
+                    entry.fWanted = true;
+                    it->second = std::move(entry);
+                }
+                else
+                {
+                    mapBlocks.erase(it);
+                }
+            }
+            condReady.notify_all();
+        }
+    }
+}
+
+void CBlockPrefetcher::Load(const uint256 &hash, CPrefetchedBlock &entry, CCoinsViewDB *pcoinsdbIn)
+{
+    int64_t nTimeStart = GetTimeMicros();
+    const Consensus::Params &consensusParams = Params().GetConsensus();
+
+    // the rest of the proof of work checks that ConnectTip makes when it reads a block are made by ConnectBlock
+    entry.fLoaded = ReadBlockFromDisk(entry.nHeight, entry.block, entry.pos, consensusParams, false) &&
+                    entry.block.GetHash() == hash &&
+                    (entry.nHeight == 0 || CheckEquihashSolution(&entry.block, consensusParams));
+    if (entry.fLoaded)
+    {
+        auto verifier = libzcash::ProofVerifier::Strict();
+        auto disabledVerifier = libzcash::ProofVerifier::Disabled();
+        CValidationState state;
+        entry.fTransactionsChecked = CheckBlockTransactions(entry.block, state, entry.fExpensiveChecks ? verifier : disabledVerifier);
+    }
+
+    // coins created in this block are not in the database yet, and the ones in the database are only valid if
+    // it was not written while they were read
+    uint64_t nSequence = pcoinsdbIn ? pcoinsdbIn->GetWriteSequence() : 1;
+    if (entry.fTransactionsChecked && !(nSequence & 1))
+    {
+        std::set<uint256> setSeen;
+        for (const CTransaction &tx : entry.block.vtx)
+        {
+            setSeen.insert(tx.GetHash());
+        }
+        for (const CTransaction &tx : entry.block.vtx)
+        {
+            for (const CTxIn &txin : tx.vin)
+            {
+                if (tx.IsCoinBase() || !setSeen.insert(txin.prevout.hash).second)
+                {
+                    continue;
+                }
+                CCoins coins;
+                if (pcoinsdbIn->GetCoins(txin.prevout.hash, coins))
+                {
+                    entry.vCoins.push_back(std::make_pair(txin.prevout.hash, CCoins()));
+                    entry.vCoins.back().second.swap(coins);
+                }
+            }
+        }
+        if (pcoinsdbIn->GetWriteSequence() != nSequence)
+        {
+            entry.vCoins.clear();
         }
+        entry.nCoinsSequence = nSequence;
     }
+    entry.nLoadTime = GetTimeMicros() - nTimeStart;
+}
 
-    // Update chainActive and related variables.
-    UpdateTip(pindexDelete->pprev, chainparams);
+void CBlockPrefetcher::Prefetch(const CChainParams& chainparams, const std::vector<CBlockIndex*> &vpindex)
+{
+    AssertLockHeld(cs_main);
 
-    // Get the current commitment tree
-    SproutMerkleTree newSproutTree;
-    SaplingMerkleTree newSaplingTree;
-    assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), newSproutTree));
-    assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), newSaplingTree));
-    // Let wallets know transactions went from 1-confirmed to
-    // 0-confirmed or conflicted:
-    for (int i = 0; i < block.vtx.size(); i++)
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (!nThreads || nBlockPrefetch <= 0)
     {
-        CTransaction &tx = block.vtx[i];
-        //if ((i == (block.vtx.size() - 1)) && ((ASSETCHAINS_LWMAPOS && block.IsVerusPOSBlock()) || (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0))))
-        if ((i == (block.vtx.size() - 1)) && (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0)))
+        return;
+    }
+
+    for (auto &entry : mapBlocks)
+    {
+        entry.second.fWanted = false;
+    }
+    int nQueued = 0;
+    for (size_t i = 0; i < vpindex.size() && i <= nBlockPrefetch; i++)
+    {
+        CBlockIndex *pindex = vpindex[i];
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA))
         {
-            EraseFromWallets(tx.GetHash());
+            break;
+        }
+        auto it = mapBlocks.find(pindex->GetBlockHash());
+        if (it != mapBlocks.end())
+        {
+            it->second.fWanted = true;
+            continue;
+        }
+        CPrefetchedBlock &entry = mapBlocks[pindex->GetBlockHash()];
+        entry.nHeight = pindex->GetHeight();
+        entry.pos = pindex->GetBlockPos();
+        entry.fExpensiveChecks = ExpensiveChecksEnabled(chainparams, pindex);
+        queue.push_back(pindex->GetBlockHash());
+        nQueued++;
+    }
+
+    // blocks still being loaded are dropped when they are done
+    for (auto it = mapBlocks.begin(); it != mapBlocks.end();)
+    {
+        if (!it->second.fWanted && it->second.status != CPrefetchedBlock::LOADING)
+        {
+            it = mapBlocks.erase(it);
         }
         else
         {
-            SyncWithWallets(tx, NULL);
+            it++;
         }
     }
-    // Update cached incremental witnesses
-    GetMainSignals().ChainTip(pindexDelete, &block, newSproutTree, newSaplingTree, false);
+    if (nQueued)
+    {
+        condWork.notify_all();
+    }
+}
+
+bool CBlockPrefetcher::Take(const uint256 &hash, CBlock &block, bool &fTransactionsChecked, bool &fTransactionsCheckedExpensive,
+                            int64_t &nLoadTime, int64_t &nWaitTime)
+{
+    AssertLockHeld(cs_main);
+
+    CPrefetchedBlock entry;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        auto it = mapBlocks.find(hash);
+        if (it == mapBlocks.end())
+        {
+            return false;
+        }
+        if (it->second.status == CPrefetchedBlock::QUEUED)
+        {
+            // reading it here is no slower than waiting for a thread to start on it
+            mapBlocks.erase(it);
+            return false;
+        }
+        int64_t nWaitStart = GetTimeMicros();
+        while ((it = mapBlocks.find(hash)) != mapBlocks.end() && it->second.status == CPrefetchedBlock::LOADING)
+        {
+            condReady.wait(lock);
+        }
+        nWaitTime = GetTimeMicros() - nWaitStart;
+        if (it == mapBlocks.end())
+        {
+            return false;
+        }
+        entry = std::move(it->second);
+        mapBlocks.erase(it);
+        if (entry.fLoaded && !entry.vCoins.empty() && (!pcoinsdb || pcoinsdb->GetWriteSequence() != entry.nCoinsSequence))
+        {
+            entry.vCoins.clear();
+        }
+    }
+    if (!entry.fLoaded)
+    {
+        return false;
+    }
+
+    for (auto &coins : entry.vCoins)
+    {
+        pcoinsTip->PrefetchCoins(coins.first, coins.second);
+    }
+    block = std::move(entry.block);
+    fTransactionsChecked = entry.fTransactionsChecked;
+    fTransactionsCheckedExpensive = entry.fExpensiveChecks;
+    nLoadTime = entry.nLoadTime;
     return true;
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetchSaved = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -5606,9 +6608,17 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     CBlock block;
+    bool fTransactionsChecked = false, fTransactionsCheckedExpensive = false;
     if (!pblock) {
-        if (!ReadBlockFromDisk(block, pindexNew, chainparams.GetConsensus(), 1))
+        int64_t nLoadTime = 0, nWaitTime = 0;
+        if (blockPrefetcher.Take(pindexNew->GetBlockHash(), block, fTransactionsChecked, fTransactionsCheckedExpensive, nLoadTime, nWaitTime)) {
+            int64_t nSaved = std::max<int64_t>(nLoadTime - nWaitTime, 0);
+            nTimePrefetchSaved += nSaved;
+            LogPrint("bench", "  - Prefetch stall saved: %.2fms, waited %.2fms [%.2fs]\n",
+                     nSaved * 0.001, nWaitTime * 0.001, nTimePrefetchSaved * 0.000001);
+        } else if (!ReadBlockFromDisk(block, pindexNew, chainparams.GetConsensus(), 1)) {
             return AbortNode(state, "Failed to read block");
+        }
         pblock = &block;
     }
     KOMODO_CONNECTING = (int32_t)pindexNew->GetHeight();
@@ -5624,7 +6634,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
         CCoinsViewCache view(pcoinsTip);
-        bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainparams, false, true);
+        bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainparams, false, true, fTransactionsChecked, fTransactionsCheckedExpensive);
         KOMODO_CONNECTING = -1;
         GetMainSignals().BlockChecked(*pblock, state);
         if (!rv) {
@@ -5898,6 +6908,15 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
         }
         nHeight = nTargetHeight;
 
+        // Read the blocks after the next one while it is connected. The one we were given is not read.
+        std::vector<CBlockIndex*> vpindexPrefetch;
+        BOOST_REVERSE_FOREACH(CBlockIndex *pindexConnect, vpindexToConnect) {
+            if (pindexConnect == pindexMostWork && pblock)
+                break;
+            vpindexPrefetch.push_back(pindexConnect);
+        }
+        blockPrefetcher.Prefetch(chainparams, vpindexPrefetch);
+
         // Connect new blocks
         BOOST_REVERSE_FOREACH(CBlockIndex *pindexConnect, vpindexToConnect) {
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : NULL)) {
@@ -6076,10 +7095,9 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex) {
     return true;
 }
 
-CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256 &hash)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
     //printf("Hash of new index entry: %s\n\n", hash.GetHex().c_str());
 
     BlockMap::iterator it = mapBlockIndex.find(hash);
@@ -6144,6 +7162,11 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     return pindexNew;
 }
 
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+{
+    return AddToBlockIndex(block, block.GetHash());
+}
+
 void FallbackSproutValuePoolBalance(
     CBlockIndex *pindex,
     const CChainParams& chainparams
@@ -6359,7 +7382,7 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
     return true;
 }
 
-bool CheckBlockHeader(int32_t *futureblockp, int32_t height, CBlockIndex *pindex, const CBlockHeader& blockhdr, CValidationState& state, const CChainParams& chainparams, bool fCheckPOW)
+bool CheckBlockHeader(int32_t *futureblockp, int32_t height, CBlockIndex *pindex, const CBlockHeader& blockhdr, CValidationState& state, const CChainParams& chainparams, bool fCheckPOW, bool fCheckSolution)
 {
     // Check timestamp
     if ( 0 )
@@ -6402,7 +7425,7 @@ bool CheckBlockHeader(int32_t *futureblockp, int32_t height, CBlockIndex *pindex
         return state.DoS(100, error("CheckBlockHeader(): block version too low"),REJECT_INVALID, "version-too-low");
 
     // Check Equihash solution is valid
-    if ( fCheckPOW )
+    if ( fCheckPOW && fCheckSolution )
     {
         if ( !CheckEquihashSolution(&blockhdr, chainparams.GetConsensus()) )
             return state.DoS(100, error("CheckBlockHeader(): Equihash solution invalid"),REJECT_INVALID, "invalid-solution");
@@ -6431,7 +7454,9 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
     // These are checks that are independent of context.
     hash = block.GetHash();
     // Check that the header is valid (particularly PoW).  This is mostly redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(futureblockp, height, pindex, block, state, chainparams, fCheckPOW))
+    // The solution of a header that the header check queue verified when it was received is not checked again.
+    bool fSolutionChecked = pindex != NULL && pindex->fSolutionChecked && pindex->GetBlockHash() == hash;
+    if (!CheckBlockHeader(futureblockp, height, pindex, block, state, chainparams, fCheckPOW, !fSolutionChecked))
     {
         if ( *futureblockp == 0 )
         {
@@ -6470,6 +7495,11 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
         if ( komodo_checkPOW(1,(CBlock *)&block,height) < 0 ) // checks Equihash
             return state.DoS(100, error("CheckBlock: failed slow_checkPOW"),REJECT_INVALID, "failed-slow_checkPOW");
     }
+    return CheckBlockTransactions(block, state, verifier, fCheckMerkleRoot);
+}
+
+bool CheckBlockTransactions(const CBlock& block, CValidationState& state, libzcash::ProofVerifier& verifier, bool fCheckMerkleRoot)
+{
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
@@ -6530,9 +7560,15 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
 bool ContextualCheckBlockHeader(
     const CBlockHeader& block, CValidationState& state,
     const CChainParams& chainParams, CBlockIndex * const pindexPrev)
+{
+    return ContextualCheckBlockHeader(block, block.GetHash(), state, chainParams, pindexPrev);
+}
+
+bool ContextualCheckBlockHeader(
+    const CBlockHeader& block, const uint256& hash, CValidationState& state,
+    const CChainParams& chainParams, CBlockIndex * const pindexPrev)
 {
     const Consensus::Params& consensusParams = chainParams.GetConsensus();
-    uint256 hash = block.GetHash();
     if (hash == consensusParams.hashGenesisBlock)
         return true;
 
@@ -6742,20 +7778,19 @@ bool ContextualCheckBlock(
     return true;
 }
 
-static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL)
+static bool AcceptBlockHeader(int32_t *futureblockp, const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
 {
     static uint256 zero;
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
     if (miSelf != mapBlockIndex.end())
     {
         // Block header is already known.
         if ( (pindex = miSelf->second) == 0 )
-            miSelf->second = pindex = AddToBlockIndex(block);
+            miSelf->second = pindex = AddToBlockIndex(block, hash);
         if (ppindex)
             *ppindex = pindex;
         if ( pindex != 0 && pindex->nStatus & BLOCK_FAILED_MASK )
@@ -6803,7 +7838,7 @@ static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, C
         if ( (pindexPrev->nStatus & BLOCK_FAILED_MASK) )
             return state.DoS(100, error("%s: prev block invalid", __func__), REJECT_INVALID, "bad-prevblk");
     }
-    if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev))
+    if (!ContextualCheckBlockHeader(block, hash, state, chainparams, pindexPrev))
     {
         //fprintf(stderr,"AcceptBlockHeader ContextualCheckBlockHeader failed\n");
         LogPrintf("AcceptBlockHeader ContextualCheckBlockHeader failed\n");
@@ -6811,7 +7846,7 @@ static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, C
     }
     if (pindex == NULL)
     {
-        if ( (pindex= AddToBlockIndex(block)) != 0 )
+        if ( (pindex= AddToBlockIndex(block, hash)) != 0 )
         {
             miSelf = mapBlockIndex.find(hash);
             if (miSelf != mapBlockIndex.end())
@@ -6830,6 +7865,11 @@ static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, C
     return true;
 }
 
+static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL)
+{
+    return AcceptBlockHeader(futureblockp, block, block.GetHash(), state, chainparams, ppindex);
+}
+
 static bool AcceptBlock(int32_t *futureblockp, const CBlock& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, CDiskBlockPos* dbp)
 {
     AssertLockHeld(cs_main);
@@ -7380,6 +8420,26 @@ bool static LoadBlockIndexDB()
     }
     //fprintf(stderr,"load blockindexDB chained %u\n",(uint32_t)time(NULL));
 
+    // In compact mode, keep only fixed width header fields in memory for all but the most recent blocks.
+    // Solutions of released entries are loaded on demand from blocks/index through a small LRU.
+    if (fCompactBlockIndex && pindexBestHeader)
+    {
+        int releaseBelow = pindexBestHeader->GetHeight() - COMPACT_BLOCK_INDEX_RESIDENT_DEPTH;
+        uint64_t nReleased = 0;
+        uint64_t nBytesFreed = 0;
+        BOOST_FOREACH(const PAIRTYPE(int, CBlockIndex*)& item, vSortedByHeight)
+        {
+            if (item.first >= releaseBelow)
+            {
+                break;
+            }
+            nBytesFreed += item.second->ReleaseSolution();
+            nReleased++;
+        }
+        LogPrintf("%s: released solutions of %lu block index entries, %lu bytes freed (%.1f MB per million headers)\n",
+                  __func__, nReleased, nBytesFreed, nReleased ? ((double)nBytesFreed / nReleased) : 0.0);
+    }
+
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
     vinfoBlockFile.resize(nLastBlockFile + 1);
@@ -7422,6 +8482,14 @@ bool static LoadBlockIndexDB()
     if (fHavePruned)
         LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
 
+    // Check whether this node was started from a chain snapshot
+    nSnapshotHeight = 0;
+    pblocktree->ReadSnapshotHeight(nSnapshotHeight);
+    if (nSnapshotHeight < 0)
+        return error("LoadBlockIndexDB(): loading a chain snapshot did not complete, remove the blocks and chainstate directories to start again");
+    if (nSnapshotHeight)
+        LogPrintf("LoadBlockIndexDB(): Started from a chain snapshot at height %d\n", nSnapshotHeight);
+
     // Check whether we need to continue reindexing
     bool fReindexing = false;
     pblocktree->ReadReindexing(fReindexing);
@@ -7437,6 +8505,14 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("conversionindex", fConversionIndex);
     LogPrintf("%s: conversion index %s\n", __func__, fConversionIndex ? "enabled" : "disabled");
 
+    pblocktree->ReadFlag("offerindex", fOfferIndex);
+    LogPrintf("%s: offer index %s\n", __func__, fOfferIndex ? "enabled" : "disabled");
+    if (fOfferIndex && !pblocktree->ReadOfferOutPoints(setOfferOutPoints))
+        return error("%s: unable to read offer outpoints", __func__);
+
+    pblocktree->ReadFlag("idhistoryindex", fIdHistoryIndex);
+    LogPrintf("%s: identity history index %s\n", __func__, fIdHistoryIndex ? "enabled" : "disabled");
+
     // Check whether we have an address index
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
@@ -7546,6 +8622,11 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->GetHeight())) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
         if (pindex->GetHeight() < chainActive.Height()-nCheckDepth)
             break;
+        if (fHavePruned && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // only go back as far as there are blocks after pruning or starting from a chain snapshot
+            LogPrintf("VerifyDB(): block verification stopping at height %d (no data)\n", pindex->GetHeight());
+            break;
+        }
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus(), 0))
@@ -7828,6 +8909,8 @@ void UnloadBlockIndex()
     }
     mapBlockIndex.clear();
     fHavePruned = false;
+    nSnapshotHeight = 0;
+    setOfferOutPoints.clear();
 }
 
 bool LoadBlockIndex()
@@ -7863,6 +8946,14 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fIdIndex = GetBoolArg("-idindex", false);
     pblocktree->WriteFlag("idindex", fIdIndex);
 
+    // Use the provided setting for -offerindex in the new database
+    fOfferIndex = GetBoolArg("-offerindex", false);
+    pblocktree->WriteFlag("offerindex", fOfferIndex);
+
+    // Use the provided setting for -idhistoryindex in the new database
+    fIdHistoryIndex = GetBoolArg("-idhistoryindex", false);
+    pblocktree->WriteFlag("idhistoryindex", fIdHistoryIndex);
+
     // Use the provided setting for -conversionindex in the new database
     /*
     fConversionIndex = GetBoolArg("-conversionindex", false);
@@ -8329,9 +9420,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
             {
-                LogPrint("getdata", "%s: inv %s\n", __func__, inv.type == MSG_BLOCK ? "MSG_BLOCK" : "MSG_FILTERED_BLOCK");
+                LogPrint("getdata", "%s: inv %s\n", __func__, inv.type == MSG_BLOCK ? "MSG_BLOCK" : inv.type == MSG_CMPCT_BLOCK ? "MSG_CMPCT_BLOCK" : "MSG_FILTERED_BLOCK");
 
                 bool send = false;
                 BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
@@ -8366,7 +9457,20 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                     }
                     else
                     {
-                        if (inv.type == MSG_BLOCK)
+                        if (inv.type == MSG_CMPCT_BLOCK)
+                        {
+                            // older blocks are unlikely to be reconstructable from the peer's mempool
+                            if (mi->second->GetHeight() >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH)
+                            {
+                                CBlockHeaderAndShortTxIDs cmpctblock(block);
+                                pfrom->PushMessage("cmpctblock", cmpctblock);
+                            }
+                            else
+                            {
+                                pfrom->PushMessage("block", block);
+                            }
+                        }
+                        else if (inv.type == MSG_BLOCK)
                         {
                             //uint256 hash; int32_t z;
                             //hash = block.GetHash();
@@ -8461,7 +9565,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
             }
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -8539,6 +9643,29 @@ void static ProcessOrphanTx(const CChainParams& chainparams, std::set<uint256>&
     }
 }
 
+// Process a block received, or reconstructed from a compact block, in response to a peer message
+void static ProcessReceivedBlock(CNode* pfrom, const string& strCommand, CBlock& block, const CChainParams& chainparams)
+{
+    uint256 hash = block.GetHash();
+
+    CValidationState state;
+    // Process all blocks from whitelisted peers, even if not requested,
+    // unless we're still syncing with the network.
+    // Such an unrequested block may still be processed, subject to the
+    // conditions in AcceptBlock().
+    bool forceProcessing = pfrom->fWhitelisted && !IsInitialBlockDownload(chainparams);
+    ProcessNewBlock(0, 0, state, chainparams, pfrom, &block, forceProcessing, NULL);
+    int nDoS;
+    if (state.IsInvalid(nDoS)) {
+        pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
+                           state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), hash);
+        if (nDoS > 0) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), nDoS);
+        }
+    }
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     const CChainParams& chainparams = Params();
@@ -9294,13 +10421,42 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
-        LOCK(cs_main);
-
         if (nCount == 0) {
             // Nothing interesting. Stop asking this peers for more headers.
             return true;
         }
 
+        // Hash and check the proof of work of all headers in parallel before taking cs_main. If one fails,
+        // the checks after it may be skipped, and any of those still needed are done below, in order.
+        int64_t nTimeStart = GetTimeMicros();
+        std::vector<CHeaderCheckResult> headerResults(nCount);
+        {
+            std::vector<CHeaderCheck> vChecks;
+            vChecks.reserve(nCount);
+            for (unsigned int n = 0; n < nCount; n++) {
+                vChecks.push_back(CHeaderCheck(headers[n], headerResults[n]));
+            }
+            if (nScriptCheckThreads) {
+                CCheckQueueControl<CHeaderCheck> control(&headercheckqueue);
+                control.Add(vChecks);
+                control.Wait();
+            } else {
+                for (auto &check : vChecks) {
+                    check();
+                }
+            }
+        }
+        int64_t nTimeChecked = GetTimeMicros();
+
+        LOCK(cs_main);
+
+        auto checkedHeader = [&headers, &headerResults](unsigned int n) -> const CHeaderCheckResult & {
+            if (!headerResults[n].fChecked) {
+                CHeaderCheck(headers[n], headerResults[n])();
+            }
+            return headerResults[n];
+        };
+
         // If we already know the last header in the message, then it contains
         // no new information for us.  In this case, we do not request
         // more headers later.  This prevents multiple chains of redundant
@@ -9310,11 +10466,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // (Allow disabling optimization in case there are unexpected problems.)
         bool hasNewHeaders = true;
         if (GetBoolArg("-optimize-getheaders", false) && IsInitialBlockDownload(chainparams)) {
-            hasNewHeaders = (mapBlockIndex.count(headers.back().GetHash()) == 0);
+            hasNewHeaders = (mapBlockIndex.count(checkedHeader(nCount - 1).hash) == 0);
         }
 
         CBlockIndex *pindexLast = NULL;
-        BOOST_FOREACH(const CBlockHeader& header, headers) {
+        size_t nPriorBlockIndex = mapBlockIndex.size();
+        for (unsigned int n = 0; n < nCount; n++) {
+            const CBlockHeader& header = headers[n];
             /*
             auto lastIndex = mapBlockIndex.find(header.hashPrevBlock);
             auto thisIndex = mapBlockIndex.find(header.GetHash());
@@ -9370,17 +10528,30 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 Misbehaving(pfrom->GetId(), 20);
                 return error("non-continuous headers sequence");
             }
+            const CHeaderCheckResult &checkResult = checkedHeader(n);
+            if (!checkResult.fValid) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("invalid header received: Equihash solution invalid");
+            }
             int32_t futureblock;
-            if (!AcceptBlockHeader(&futureblock, header, state, chainparams, &pindexLast)) {
+            if (!AcceptBlockHeader(&futureblock, header, checkResult.hash, state, chainparams, &pindexLast)) {
                 int nDoS;
                 if (state.IsInvalid(nDoS) && (futureblock == 0 || nDoS >= 100))
                 {
                     Misbehaving(pfrom->GetId(), nDoS);
                     return error("invalid header received");
                 }
+            } else if (pindexLast != NULL && pindexLast->GetBlockHash() == checkResult.hash) {
+                pindexLast->fSolutionChecked = true;
             }
         }
 
+        int64_t nTimeConnected = GetTimeMicros();
+        unsigned int nNewHeaders = mapBlockIndex.size() - nPriorBlockIndex;
+        RecordHeaderSync(nTimeConnected, nNewHeaders);
+        LogPrint("bench", "    - %u headers, %u new: checked in %.2fms, connected in %.2fms\n", nCount, nNewHeaders,
+                 0.001 * (nTimeChecked - nTimeStart), 0.001 * (nTimeConnected - nTimeChecked));
+
         if (pindexLast)
             UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
 
@@ -9406,27 +10577,200 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
     else if (strCommand == "block" && !fImporting && !fReindex) // Ignore blocks received while importing
     {
+        unsigned int nBlockSize = vRecv.size();
         CBlock block;
         vRecv >> block;
 
-        CInv inv(MSG_BLOCK, block.GetHash());
-        LogPrint("net", "received block %s peer=%d\n", inv.hash.ToString(), pfrom->id);
+        uint256 hash = block.GetHash();
+        LogPrint("net", "received block %s peer=%d\n", hash.ToString(), pfrom->id);
 
-        CValidationState state;
-        // Process all blocks from whitelisted peers, even if not requested,
-        // unless we're still syncing with the network.
-        // Such an unrequested block may still be processed, subject to the
-        // conditions in AcceptBlock().
-        bool forceProcessing = pfrom->fWhitelisted && !IsInitialBlockDownload(chainparams);
-        ProcessNewBlock(0, 0, state, chainparams, pfrom, &block, forceProcessing, NULL);
-        int nDoS;
-        if (state.IsInvalid(nDoS)) {
-            pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
-                               state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
-            if (nDoS > 0) {
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), nDoS);
+        {
+            LOCK(cs_main);
+            RecordBlockDelivery(pfrom->GetId(), hash, nBlockSize);
+        }
+
+        ProcessReceivedBlock(pfrom, strCommand, block, chainparams);
+    }
+
+    else if (strCommand == "cmpctblock" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+
+        uint256 hash = cmpctblock.header.GetHash();
+        LogPrint("net", "received cmpctblock %s peer=%d\n", hash.ToString(), pfrom->id);
+
+        CBlock block;
+        bool fBlockReconstructed = false;
+        {
+            LOCK(cs_main);
+
+            // we only ask for compact blocks, so anything we are not waiting on from this peer is late or unsolicited
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+            if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != pfrom->GetId())
+            {
+                LogPrint("net", "ignoring unrequested cmpctblock %s peer=%d\n", hash.ToString(), pfrom->id);
+                return true;
+            }
+
+            CValidationState state;
+            CBlockIndex *pindex = NULL;
+            int32_t futureblock = 0;
+            if (!AcceptBlockHeader(&futureblock, cmpctblock.header, state, chainparams, &pindex))
+            {
+                int nDoS;
+                if (state.IsInvalid(nDoS) && (futureblock == 0 || nDoS >= 100))
+                {
+                    MarkBlockAsReceived(hash);
+                    Misbehaving(pfrom->GetId(), nDoS);
+                    return error("invalid header received in cmpctblock");
+                }
+                return true;
+            }
+            UpdateBlockAvailability(pfrom->GetId(), hash);
+
+            if (pindex->nStatus & BLOCK_HAVE_DATA)
+            {
+                MarkBlockAsReceived(hash);
+                return true;
+            }
+
+            std::shared_ptr<PartiallyDownloadedBlock> partialBlock = std::make_shared<PartiallyDownloadedBlock>(&mempool);
+            ReadStatus status = partialBlock->InitData(cmpctblock);
+            if (status == READ_STATUS_INVALID)
+            {
+                MarkBlockAsReceived(hash);
+                Misbehaving(pfrom->GetId(), 100);
+                return error("invalid cmpctblock %s from peer=%d", hash.ToString(), pfrom->id);
+            }
+            else if (status == READ_STATUS_FAILED)
+            {
+                // short ID collision, the block is still in flight from this peer, so just ask for all of it
+                pfrom->PushMessage("getdata", std::vector<CInv>(1, CInv(MSG_BLOCK, hash)));
+                return true;
+            }
+
+            BlockTransactionsRequest req;
+            for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++)
+            {
+                if (!partialBlock->IsTxAvailable(i))
+                {
+                    req.indexes.push_back(i);
+                }
             }
+
+            if (req.indexes.empty())
+            {
+                if (partialBlock->FillBlock(block, std::vector<CTransaction>()) == READ_STATUS_OK)
+                {
+                    fBlockReconstructed = true;
+                }
+                else
+                {
+                    pfrom->PushMessage("getdata", std::vector<CInv>(1, CInv(MSG_BLOCK, hash)));
+                }
+            }
+            else
+            {
+                LogPrint("cmpctblock", "requesting %lu of %lu transactions for cmpctblock %s from peer=%d\n",
+                         req.indexes.size(), cmpctblock.BlockTxCount(), hash.ToString(), pfrom->id);
+                itInFlight->second.second->partialBlock = partialBlock;
+                req.blockhash = hash;
+                pfrom->PushMessage("getblocktxn", req);
+            }
+        }
+
+        if (fBlockReconstructed)
+        {
+            ProcessReceivedBlock(pfrom, strCommand, block, chainparams);
+        }
+    }
+
+    else if (strCommand == "getblocktxn")
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        LOCK(cs_main);
+
+        BlockMap::iterator it = mapBlockIndex.find(req.blockhash);
+        if (it == mapBlockIndex.end() || !(it->second->nStatus & BLOCK_HAVE_DATA))
+        {
+            LogPrint("net", "peer=%d sent us a getblocktxn for a block we don't have\n", pfrom->id);
+            return true;
+        }
+
+        if (it->second->GetHeight() < chainActive.Height() - MAX_BLOCKTXN_DEPTH)
+        {
+            // this should not happen in practice, since we only send compact blocks near the tip,
+            // but if it does, answer with the whole block
+            LogPrint("net", "peer=%d sent us a getblocktxn for a block > %i deep\n", pfrom->id, MAX_BLOCKTXN_DEPTH);
+            pfrom->vRecvGetData.push_back(CInv(MSG_BLOCK, req.blockhash));
+            ProcessGetData(pfrom, chainparams.GetConsensus());
+            return true;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, it->second, chainparams.GetConsensus(), 1))
+        {
+            return error("%s: cannot load block %s from disk", __func__, req.blockhash.ToString());
+        }
+
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.indexes.size(); i++)
+        {
+            if (req.indexes[i] >= block.vtx.size())
+            {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("getblocktxn with out-of-bounds tx indices from peer=%d", pfrom->id);
+            }
+            resp.txn[i] = block.vtx[req.indexes[i]];
+        }
+        pfrom->PushMessage("blocktxn", resp);
+    }
+
+    else if (strCommand == "blocktxn" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        LogPrint("net", "received blocktxn %s with %lu transactions peer=%d\n", resp.blockhash.ToString(), resp.txn.size(), pfrom->id);
+
+        CBlock block;
+        bool fBlockReconstructed = false;
+        {
+            LOCK(cs_main);
+
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(resp.blockhash);
+            if (itInFlight == mapBlocksInFlight.end() || !itInFlight->second.second->partialBlock ||
+                itInFlight->second.first != pfrom->GetId())
+            {
+                LogPrint("net", "peer=%d sent us block transactions for a block we weren't expecting\n", pfrom->id);
+                return true;
+            }
+
+            ReadStatus status = itInFlight->second.second->partialBlock->FillBlock(block, resp.txn);
+            if (status == READ_STATUS_INVALID)
+            {
+                MarkBlockAsReceived(resp.blockhash);
+                Misbehaving(pfrom->GetId(), 100);
+                return error("peer=%d sent us invalid compact block or non-matching block transactions", pfrom->id);
+            }
+            else if (status == READ_STATUS_FAILED)
+            {
+                // a short ID probably matched the wrong mempool transaction, so fall back to the full block
+                itInFlight->second.second->partialBlock.reset();
+                pfrom->PushMessage("getdata", std::vector<CInv>(1, CInv(MSG_BLOCK, resp.blockhash)));
+            }
+            else
+            {
+                fBlockReconstructed = true;
+            }
+        }
+
+        if (fBlockReconstructed)
+        {
+            ProcessReceivedBlock(pfrom, strCommand, block, chainparams);
         }
     }
 
@@ -9663,7 +11007,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // message would be undesirable as we transmit it ourselves.
     }
 
-    else if (!(strCommand == "tx" || strCommand == "block" || strCommand == "headers" || strCommand == "alert")) {
+    else if (!(strCommand == "tx" || strCommand == "block" || strCommand == "headers" || strCommand == "alert" ||
+               strCommand == "cmpctblock" || strCommand == "blocktxn")) {
         // Ignore unknown commands for extensibility
         LogPrint("net", "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->id);
     }
@@ -10162,16 +11507,41 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         // Message: getdata (blocks)
         //
         vector<CInv> vGetData;
-        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload(Params())) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        UpdateBlockDownloadDepth(&state, pto->nPingUsecTime);
+        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload(Params())) && state.nBlocksInFlight < state.nBlockDownloadDepth) {
             vector<CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            CBlockIndex *pindexStalled = NULL;
+            FindNextBlocksToDownload(pto->GetId(), state.nBlockDownloadDepth - state.nBlocksInFlight, vToDownload, staller, &pindexStalled);
             for (CBlockIndex *pindex : vToDownload) {
-                vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
+                // a block that extends our tip is mostly made of transactions already in our mempool
+                bool fCompact = fCompactBlocks && pto->nVersion >= COMPACT_BLOCKS_VERSION &&
+                                pindex->pprev == chainActive.Tip() && !IsInitialBlockDownload(Params());
+                vGetData.push_back(CInv(fCompact ? MSG_CMPCT_BLOCK : MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), Params().GetConsensus(), pindex);
                 LogPrint("net", "Requesting block %s (%d) peer=%d\n", pindex->GetBlockHash().ToString(),
                     pindex->GetHeight(), pto->id);
             }
+            if (vToDownload.empty() && staller != -1 && pindexStalled) {
+                // The window is held back by a block in flight from another peer. If that block has waited longer than
+                // this peer, which has room, is expected to take to deliver it, and this peer is the faster of the two,
+                // ask this peer for it instead, before the other peer is disconnected for stalling.
+                CNodeState *stallerState = State(staller);
+                map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itStalled = mapBlocksInFlight.find(pindexStalled->GetBlockHash());
+                int64_t nExpected = ExpectedBlockDeliveryTime(&state);
+                if (stallerState && itStalled != mapBlocksInFlight.end() && nExpected >= 0 &&
+                    state.dBlockBytesPerSecond > stallerState->dBlockBytesPerSecond &&
+                    nNow - itStalled->second.second->nTime > std::max<int64_t>(2 * nExpected, 1000000)) {
+                    LogPrint("net", "Reassigning block %s (%d) from stalling peer=%d to peer=%d\n", pindexStalled->GetBlockHash().ToString(),
+                        pindexStalled->GetHeight(), staller, pto->id);
+                    stallerState->nBlocksReassigned++;
+                    // the slower peer's queue was too deep for the rate it delivers at
+                    stallerState->dBlockBytesPerSecond /= 2;
+                    vGetData.push_back(CInv(MSG_BLOCK, pindexStalled->GetBlockHash()));
+                    MarkBlockAsInFlight(pto->GetId(), pindexStalled->GetBlockHash(), Params().GetConsensus(), pindexStalled);
+                    staller = -1;
+                }
+            }
             if (state.nBlocksInFlight == 0 && staller != -1) {
                 if (State(staller)->nStallingSince == 0) {
                     State(staller)->nStallingSince = nNow;
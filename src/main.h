@@ -32,6 +32,8 @@
 #include "cheatcatcher.h"
 #include "addressindex.h"
 #include "timestampindex.h"
+#include "offerindex.h"
+#include "identityindex.h"
 
 #include <algorithm>
 #include <exception>
@@ -46,9 +48,12 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
+class CCoinsViewDB;
 class CBloomFilter;
 class CChainParams;
 class CInv;
+class CSaplingCheck;
 class CScriptCheck;
 class CValidationInterface;
 class CValidationState;
@@ -74,6 +79,14 @@ static const unsigned int MAX_P2SH_SIGOPS = 15;
 static const unsigned int MAX_STANDARD_TX_SIGOPS = MAX_BLOCK_SIGOPS/5;
 /** Default for -minrelaytxfee, minimum relay fee for transactions */
 static const unsigned int DEFAULT_MIN_RELAY_TX_FEE = 100;
+/** Default for -limitancestorcount, maximum number of in-mempool ancestors of a transaction, counting itself */
+static const unsigned int DEFAULT_ANCESTOR_LIMIT = 25;
+/** Default for -limitancestorsize, maximum kilobytes of a transaction and its in-mempool ancestors, one block */
+static const unsigned int DEFAULT_ANCESTOR_SIZE_LIMIT = MAX_BLOCK_SIZE / 1000;
+/** Default for -limitdescendantcount, maximum number of in-mempool descendants of a transaction, counting itself */
+static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
+/** Default for -limitdescendantsize, maximum kilobytes of a transaction and its in-mempool descendants, one block */
+static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = MAX_BLOCK_SIZE / 1000;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 /** Expiration time for orphan transactions in seconds */
@@ -95,10 +108,25 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
-/** Number of blocks that can be requested at any given time from a single peer. */
-static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** -blockprefetch default (number of blocks past the one being connected that are read and checked ahead of it) */
+static const int DEFAULT_BLOCK_PREFETCH = 16;
+/** Maximum number of blocks that are read ahead, which is limited by how far ActivateBestChainStep looks ahead */
+static const int MAX_BLOCK_PREFETCH = 31;
+/** Maximum number of block prefetch threads */
+static const int MAX_BLOCK_PREFETCH_THREADS = 4;
+/** Time by block timestamps that the best header has to be past a block before -assumevalid skips its checks */
+static const int64_t ASSUMEVALID_MIN_AGE = 60 * 60 * 24 * 7 * 2;
+/** Number of blocks that can be requested at any given time from a single peer, before its delivery rate is known. */
+static const int DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Bounds of the number of blocks in transit from a single peer, once it adapts to the peer's delivery rate. */
+static const int MIN_BLOCKS_IN_TRANSIT_PER_PEER = 2;
+static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 64;
+/** Seconds of a peer's measured block delivery, beyond one round trip, to keep requested from it. */
+static const int BLOCK_DOWNLOAD_QUEUE_SECONDS = 4;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
+/** Default for -compactblocks, requesting blocks that extend the tip as compact blocks */
+static const bool DEFAULT_COMPACT_BLOCKS = true;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 160;
@@ -163,12 +191,20 @@ extern const std::string verusDataSignaturePrefix;
 extern CWaitableCriticalSection csBestBlock;
 extern CConditionVariable cvBlockChange;
 extern bool fExperimentalMode;
+/** Regtest developer option, lets a node accept transactions with invalid scripts and signatures into its mempool and
+ *  block templates. Blocks are always checked. */
+extern bool fDeveloperSkipScriptChecks;
 extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
+extern int nBlockPrefetch;
+/** Block whose ancestors are assumed to have valid scripts, signatures and proofs, or null, see doc/assumevalid.md */
+extern uint256 hashAssumeValid;
 extern bool fTxIndex;
 extern bool fIdIndex;
 extern bool fConversionIndex;
+extern bool fOfferIndex;
+extern bool fIdHistoryIndex;
 
 // START insightexplorer
 extern bool fInsightExplorer;
@@ -191,6 +227,10 @@ extern bool fTimestampIndex;
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+// Release block solutions from the in-memory block index and load them from blocks/index when needed
+extern bool fCompactBlockIndex;
+// Request blocks that extend the tip as compact blocks from peers that support them
+extern bool fCompactBlocks;
 // TODO: remove this flag by structuring our code such that
 // it is unneeded for testing
 extern bool fCoinbaseEnforcedProtectionEnabled;
@@ -208,6 +248,8 @@ static const uint64_t nMinDiskSpace = 52428800;
 /** Pruning-related variables and constants */
 /** True if any block files have ever been pruned. */
 extern bool fHavePruned;
+/** Height of the chain snapshot that this node was started from, if any, below which it has no blocks */
+extern int nSnapshotHeight;
 /** True if we're running in -prune mode. */
 extern bool fPruneMode;
 /** Number of MiB of block files that we're trying to stay below. */
@@ -270,6 +312,16 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the Sapling proof checking thread */
+void ThreadSaplingCheck();
+/** Run an instance of the header checking thread */
+void ThreadHeaderCheck();
+/** Run an instance of the block prefetch thread */
+void ThreadBlockPrefetch();
+/** Set the coins database that block prefetch threads read inputs from, or NULL to stop reading them */
+void SetBlockPrefetchCoinsView(CCoinsViewDB *pcoinsdb);
+/** Rate in headers per second at which new headers were added to the block index over the last minute */
+double GetHeaderSyncRate();
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(const CChainParams&), CCriticalSection& cs, const CBlockIndex *const &bestHeader);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -325,7 +377,8 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                         bool* pfMissingInputs, bool fRejectAbsurdFee=false, int dosLevel=-1);
 bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree, bool fLimitDust,
                            bool* pfMissingInputs, bool fRejectAbsurdFee=false, int dosLevel=-1, int32_t simHeight = 0,
-                           int expireThreshold=TX_EXPIRING_SOON_THRESHOLD);
+                           int expireThreshold=TX_EXPIRING_SOON_THRESHOLD, std::vector<CSaplingCheck> *pvSaplingChecks = NULL,
+                           bool fExpensiveChecks = true, bool fSkipScriptChecks = false, bool fLimitPackages = true);
 
 
 struct CNodeStateStats {
@@ -333,6 +386,11 @@ struct CNodeStateStats {
     int nSyncHeight;
     int nCommonHeight;
     std::vector<int> vHeightInFlight;
+    int nBlockDownloadDepth;
+    double dBlockBytesPerSecond;
+    int64_t nBlockLatency;
+    int nBlocksDownloaded;
+    int nBlocksReassigned;
 };
 
 CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowFree);
@@ -376,17 +434,26 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& ma
 /**
  * Check whether all inputs of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set. If pvChecks is not NULL, script checks are pushed onto it
- * instead of being performed inline.
+ * instead of being performed inline. If pReserveDesc is not NULL, it is the reserve transaction descriptor of tx for
+ * this view and spend height, which is then not built again.
  */
 bool ContextualCheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &view, uint32_t spendHeight, bool fScriptChecks,
                            unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata,
                            const Consensus::Params& consensusParams, uint32_t consensusBranchId,
-                           std::vector<CScriptCheck> *pvChecks = NULL);
+                           std::vector<CScriptCheck> *pvChecks = NULL,
+                           const CReserveTransactionDescriptor *pReserveDesc = NULL);
 
-/** Check a transaction contextually against a set of consensus rules */
+/** Check a transaction contextually against a set of consensus rules.
+ * If pvSaplingChecks is not NULL, Sapling proof and signature checks are pushed onto it
+ * instead of being performed inline.
+ */
 bool ContextualCheckTransaction(const CTransaction& tx, CValidationState &state,
                                 const CChainParams& chainparams, int nHeight, int dosLevel,
-                                bool (*isInitBlockDownload)(const CChainParams&) = IsInitialBlockDownload);
+                                bool (*isInitBlockDownload)(const CChainParams&) = IsInitialBlockDownload,
+                                std::vector<CSaplingCheck> *pvSaplingChecks = NULL);
+
+/** Verify the Sapling spends, outputs and binding signature of a transaction */
+bool CheckSaplingProofs(const CTransaction& tx, const uint256 &dataToBeSigned, CValidationState &state);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -407,9 +474,11 @@ namespace Consensus {
 /**
  * Check whether all inputs of this transaction are valid (no double spends and amounts)
  * This does not modify the UTXO set. This does not check scripts and sigs.
+ * pReserveDesc is as for ContextualCheckInputs.
  * Preconditions: tx.IsCoinBase() is false.
  */
-bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, uint32_t nSpendHeight, const Consensus::Params& consensusParams);
+bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, uint32_t nSpendHeight, const Consensus::Params& consensusParams,
+                   const CReserveTransactionDescriptor *pReserveDesc = NULL);
 
 } // namespace Consensus
 
@@ -484,9 +553,108 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the Sapling spend, output and binding signature checks of one transaction.
+ * Each check uses its own verification context, so transactions of a block can be verified in parallel.
+ */
+class CSaplingCheck
+{
+private:
+    const CTransaction *ptx;
+    uint256 dataToBeSigned;
+    std::string strRejectReason;
+
+public:
+    CSaplingCheck(): ptx(0) {}
+    CSaplingCheck(const CTransaction& txIn, const uint256 &dataToBeSignedIn) : ptx(&txIn), dataToBeSigned(dataToBeSignedIn) {}
+
+    bool operator()();
+
+    void swap(CSaplingCheck &check) {
+        std::swap(ptx, check.ptx);
+        std::swap(dataToBeSigned, check.dataToBeSigned);
+        strRejectReason.swap(check.strRejectReason);
+    }
+
+    const std::string &GetRejectReason() const { return strRejectReason; }
+};
+
+/** The hash of one header of a headers message, and whether it passed the checks that need no block index */
+struct CHeaderCheckResult
+{
+    uint256 hash;
+    bool fChecked;
+    bool fValid;
+
+    CHeaderCheckResult() : fChecked(false), fValid(false) {}
+};
+
+/**
+ * Closure representing the hashing and context free proof of work check of one received header. With VerusHash,
+ * hashing is most of the cost of accepting a header, so the headers of a message are checked in parallel before
+ * cs_main is taken, and only connected to the block index under it.
+ */
+class CHeaderCheck
+{
+private:
+    const CBlockHeader *pheader;
+    CHeaderCheckResult *presult;
+
+public:
+    CHeaderCheck(): pheader(0), presult(0) {}
+    CHeaderCheck(const CBlockHeader &header, CHeaderCheckResult &result) : pheader(&header), presult(&result) {}
+
+    bool operator()();
+
+    void swap(CHeaderCheck &check) {
+        std::swap(pheader, check.pheader);
+        std::swap(presult, check.presult);
+    }
+};
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+bool GetOfferIndexValue(const CTransaction &tx, const CCoinsViewCache &view, int height, COfferIndexValue &offer);
+bool GetOfferIndex(unsigned int type, const uint160 &primaryID, const uint160 &secondaryID, uint32_t height, std::vector<COfferIndexDbEntry> &offers);
+
+// The offer index changes of one block, collected as its transactions are connected or disconnected and written
+// together. Requires cs_main.
+class COfferIndexUpdate
+{
+public:
+    std::vector<COfferIndexDbEntry> offers;
+    std::vector<COfferOutPointDbEntry> outPoints;
+    std::vector<COfferExpiryDbEntry> expiries;
+
+    // closes the offers whose outputs tx spends and indexes an offer that it posts, before its inputs are spent in view
+    void ConnectTransaction(const CTransaction &tx, const CCoinsViewCache &view, uint32_t height);
+
+    // after the transactions of a block are connected, closes the offers that expire at its height
+    void ExpireOffers(uint32_t height);
+
+    // removes the offers that tx posted and collects those it took or closed, in reverse block order
+    void DisconnectTransaction(const CTransaction &tx);
+
+    // after the transactions of a block are disconnected, reopens the offers that it took, closed or expired and
+    // that are still open in view
+    void ReopenOffers(const CCoinsViewCache &view, uint32_t height);
+
+    bool Write() const;
+
+private:
+    std::multimap<COutPoint, COfferIndexValue> blockOffers;
+    std::vector<COfferIndexValue> reopenedOffers;
+    std::set<uint256> removedOffers;
+};
+
 bool GetAddressIndex(const uint160& addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
+bool GetIdentityRevision(const CIdentityRevisionKey &key, CIdentityRevisionValue &revision);
+bool GetIdentityRevisions(const uint160 &identityID, std::vector<CIdentityRevisionDbEntry> &revisions, int start = 0, int end = 0);
+bool GetIdentityContent(const uint160 &identityID, const uint160 &vdxfKey, std::vector<CIdentityContentDbEntry> &content, int start = 0, int end = 0);
+// gets the identity history index entries of a block, which are written when it is connected and erased when it is disconnected
+void GetIdentityHistoryIndexEntries(const CBlock &block, const CBlockIndex *pindex,
+                                    std::vector<CIdentityRevisionDbEntry> &revisions,
+                                    std::vector<CIdentityContentDbEntry> &content);
 bool GetAddressUnspent(const uint160& addressHash, int type, std::vector<CAddressUnspentDbEntry>& unspentOutputs);
 
 /** Functions for disk access for blocks */
@@ -494,6 +662,8 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
 bool ReadBlockFromDisk(int32_t height, CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool checkPOW);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool checkPOW);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart);
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -503,21 +673,28 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
  *  of problems. Note that in any case, coins may be modified. */
 bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, bool* pfClean = NULL);
 
-/** Apply the effects of this block (with given index) on the UTXO set represented by coins */
+/** Apply the effects of this block (with given index) on the UTXO set represented by coins.
+ *  fTransactionsChecked says CheckBlockTransactions already passed, with proofs verified if
+ *  fTransactionsCheckedExpensive. It is only relied on if that matches ExpensiveChecksEnabled for the block. */
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins,
-                  const CChainParams& chainparams, bool fJustCheck = false,bool fCheckPOW = false);
+                  const CChainParams& chainparams, bool fJustCheck = false,bool fCheckPOW = false,
+                  bool fTransactionsChecked = false, bool fTransactionsCheckedExpensive = false);
 
-/** Context-independent validity checks */
-bool CheckBlockHeader(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, bool fCheckPOW = true);
+/** Context-independent validity checks. fCheckSolution false skips the Equihash solution check of a header already checked by the header check queue */
+bool CheckBlockHeader(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, bool fCheckPOW = true, bool fCheckSolution = true);
 bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const CBlock& block, CValidationState& state, const CChainParams& chainparams,
                 libzcash::ProofVerifier& verifier,
                 bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckTxInputs = true);
+/** The part of CheckBlock that needs nothing but the block: merkle root, size, coinbase and transaction checks */
+bool CheckBlockTransactions(const CBlock& block, CValidationState& state, libzcash::ProofVerifier& verifier, bool fCheckMerkleRoot = true);
 
 /** Context-dependent validity checks.
  *  By "context", we mean only the previous block headers, but not the UTXO
  *  set; UTXO-related validity checks are done in ConnectBlock(). */
 bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& state,
                                 const CChainParams& chainparams, CBlockIndex *pindexPrev);
+bool ContextualCheckBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state,
+                                const CChainParams& chainparams, CBlockIndex *pindexPrev);
 bool ContextualCheckBlock(const CBlock& block, CValidationState& state,
                           const CChainParams& chainparams, CBlockIndex *pindexPrev);
 
@@ -568,6 +745,9 @@ extern CChain chainActive;
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
+/** Global variable that points to the coin database under pcoinsTip, which is owned by init */
+extern CCoinsViewDB *pcoinsdbview;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
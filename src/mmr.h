@@ -26,6 +26,7 @@
 #include "streams.h"
 #include "hash.h"
 #include "arith_uint256.h"
+#include "crypto/blake2b.h"
 
 
 #ifndef BEGIN
@@ -75,6 +76,16 @@ public:
         return CMMRNode(hw.GetHash());
     }
 
+    // create the parents of count adjacent pairs of children at once, which hash algorithms that can
+    // hash many nodes in parallel specialize
+    static void CreateParentNodes(const CMMRNode *children, CMMRNode *parents, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            parents[i] = children[i << 1].CreateParentNode(children[(i << 1) + 1]);
+        }
+    }
+
     std::vector<uint256> GetProofHash(const CMMRNode &opposite) const
     {
         return {hash};
@@ -90,6 +101,19 @@ public:
         return 0;
     }
 };
+
+// a BLAKE2b parent is the hash of exactly the 64 bytes of its two children's hashes, so an array of
+// children is already the input for hashing a whole layer with the multi-lane BLAKE2b implementation
+template <>
+inline void CMMRNode<CBLAKE2bWriter>::CreateParentNodes(const CMMRNode<CBLAKE2bWriter> *children, CMMRNode<CBLAKE2bWriter> *parents, size_t count)
+{
+    static_assert(sizeof(CMMRNode<CBLAKE2bWriter>) == sizeof(uint256), "BLAKE2b MMR nodes must be only a hash");
+    if (count)
+    {
+        BLAKE2b64(parents[0].hash.begin(), children[0].hash.begin(), count, BLAKE2Bpersonal);
+    }
+}
+
 typedef CMMRNode<CBLAKE2bWriter> CDefaultMMRNode;
 typedef CMMRNode<CKeccack256Writer> CDefaultETHNode;
 
@@ -158,6 +182,14 @@ public:
         return CMMRPowerNode(hw.GetHash(), nodePower);
     }
 
+    static void CreateParentNodes(const CMMRPowerNode *children, CMMRPowerNode *parents, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            parents[i] = children[i << 1].CreateParentNode(children[(i << 1) + 1]);
+        }
+    }
+
     std::vector<uint256> GetProofHash(const CMMRPowerNode &proving) const
     {
         return {hash, ArithToUint256((Stake() + proving.Stake()) << 128 | (Work() + proving.Work()))};
@@ -944,6 +976,48 @@ public:
         return layer0.size() - 1;
     }
 
+    // add a range of leaf nodes and return the index of the last one. instead of combining nodes as each leaf
+    // is added, each layer above is extended by all of its new parents at once, which yields the same
+    // mountain range as adding the leaves one at a time
+    uint64_t Add(const std::vector<NODE_TYPE> &leaves)
+    {
+        for (auto &leaf : leaves)
+        {
+            layer0.push_back(leaf);
+        }
+
+        std::vector<NODE_TYPE> children, parents;
+        uint64_t layerSize = layer0.size();
+        for (uint32_t height = 0; layerSize > 1; height++)
+        {
+            if (height == upperNodes.size())
+            {
+                upperNodes.resize(upperNodes.size() + 1);
+            }
+
+            uint64_t curSizeAbove = upperNodes[height].size();
+            uint64_t newSizeAbove = layerSize >> 1;
+            if (newSizeAbove > curSizeAbove)
+            {
+                // gather the uncombined pairs of this layer, which may be spread over chunks, into one array
+                uint64_t count = newSizeAbove - curSizeAbove;
+                children.resize(count << 1);
+                parents.resize(count);
+                for (uint64_t i = 0; i < (count << 1); i++)
+                {
+                    children[i] = height ? upperNodes[height - 1][(curSizeAbove << 1) + i] : layer0[(curSizeAbove << 1) + i];
+                }
+                NODE_TYPE::CreateParentNodes(&children[0], &parents[0], count);
+                for (auto &parent : parents)
+                {
+                    upperNodes[height].push_back(parent);
+                }
+            }
+            layerSize = newSizeAbove;
+        }
+        return layer0.size() - 1;
+    }
+
     // add a default node
     uint64_t Add()
     {
@@ -1162,31 +1236,19 @@ public:
             {
                 peakMerkle.push_back(std::vector<NODE_TYPE>());
 
-                uint64_t i;
                 uint32_t layerIndex = layerNum ? layerNum - 1 : 0;      // layerNum is base 1
+                const std::vector<NODE_TYPE> &layerBelow = layerNum ? peakMerkle[layerIndex] : peaks;
+                std::vector<NODE_TYPE> &layer = peakMerkle.back();
 
-                for (i = 0; i < (layerSize >> 1); i++)
+                layer.resize(layerSize >> 1);
+                if (layer.size())
                 {
-                    if (layerNum)
-                    {
-                        peakMerkle.back().push_back(peakMerkle[layerIndex][i << 1].CreateParentNode(peakMerkle[layerIndex][(i << 1) + 1]));
-                    }
-                    else
-                    {
-                        peakMerkle.back().push_back(peaks[i << 1].CreateParentNode(peaks[(i << 1) + 1]));
-                    }
+                    NODE_TYPE::CreateParentNodes(&layerBelow[0], &layer[0], layer.size());
                 }
                 if (passThrough)
                 {
-                    if (layerNum)
-                    {
-                        // pass the end of the prior layer through
-                        peakMerkle.back().push_back(peakMerkle[layerIndex].back());
-                    }
-                    else
-                    {
-                        peakMerkle.back().push_back(peaks.back());
-                    }
+                    // pass the end of the prior layer through
+                    layer.push_back(layerBelow.back());
                 }
                 // each entry in the next layer should be either combined two of the prior layer, or a duplicate of the prior layer's end
                 layerSize = peakMerkle.back().size();
@@ -0,0 +1,142 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_OFFERINDEX_H
+#define BITCOIN_OFFERINDEX_H
+
+#include "uint256.h"
+#include "amount.h"
+#include "serialize.h"
+#include "primitives/transaction.h"
+
+// Each open on-chain offer is indexed twice, once under the currency or ID it offers and once under the currency or
+// ID it requests in exchange. Within one pair of primary and secondary currency or ID, entries are sorted by price,
+// which is the amount of the secondary per whole unit of the primary. An ID counts as one whole unit.
+struct COfferIndexKey {
+    enum EIndexTypes {
+        OFFERED = 1,                // primary is what is offered, price is the asking price
+        REQUESTED = 2               // primary is what is requested, price is what the offer pays per unit
+    };
+
+    unsigned int type;
+    uint160 primaryID;
+    uint160 secondaryID;
+    int64_t price;
+    uint256 txhash;                 // transaction with the offer output, which is always output 0
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 81;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        primaryID.Serialize(s);
+        secondaryID.Serialize(s);
+        // big endian, so that entries are sorted by price
+        ser_writedata64be(s, price);
+        txhash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        primaryID.Unserialize(s);
+        secondaryID.Unserialize(s);
+        price = ser_readdata64be(s);
+        txhash.Unserialize(s);
+    }
+
+    COfferIndexKey(unsigned int indexType, const uint160 &primary, const uint160 &secondary=uint160(), int64_t offerPrice=0, const uint256 &txid=uint256()) :
+        type(indexType), primaryID(primary), secondaryID(secondary), price(offerPrice), txhash(txid) {}
+
+    COfferIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        primaryID.SetNull();
+        secondaryID.SetNull();
+        price = 0;
+        txhash.SetNull();
+    }
+
+    bool operator<(const COfferIndexKey &b) const {
+        if (type != b.type) return type < b.type;
+        if (primaryID != b.primaryID) return primaryID < b.primaryID;
+        if (secondaryID != b.secondaryID) return secondaryID < b.secondaryID;
+        if (price != b.price) return price < b.price;
+        return txhash < b.txhash;
+    }
+};
+
+struct COfferIndexValue {
+    enum EFlags {
+        FLAG_OFFERS_ID = 1,         // offered is an ID, not a currency
+        FLAG_REQUESTS_ID = 2        // requested is an ID, not a currency
+    };
+
+    uint32_t flags;
+    uint160 offeredID;
+    uint160 requestedID;
+    CAmount offeredAmount;          // 0 for an ID
+    CAmount requestedAmount;        // 0 for an ID
+    int blockHeight;                // -1 while in the mempool
+    uint32_t expiryHeight;          // expiry height of the offer transaction
+    COutPoint offerOutput;          // output that holds the posted offer
+    COutPoint fundingOutput;        // output that the offer transaction spends to pay what it offers
+    uint256 postingTxid;            // transaction that carries the offer transaction in its op_return
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(flags);
+        READWRITE(offeredID);
+        READWRITE(requestedID);
+        READWRITE(offeredAmount);
+        READWRITE(requestedAmount);
+        READWRITE(blockHeight);
+        READWRITE(expiryHeight);
+        READWRITE(offerOutput);
+        READWRITE(fundingOutput);
+        READWRITE(postingTxid);
+    }
+
+    COfferIndexValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        flags = 0;
+        offeredID.SetNull();
+        requestedID.SetNull();
+        offeredAmount = 0;
+        requestedAmount = 0;
+        blockHeight = 0;
+        expiryHeight = 0;
+        offerOutput.SetNull();
+        fundingOutput.SetNull();
+        postingTxid.SetNull();
+    }
+
+    bool IsNull() const {
+        return offerOutput.IsNull();
+    }
+
+    bool OffersID() const { return flags & FLAG_OFFERS_ID; }
+    bool RequestsID() const { return flags & FLAG_REQUESTS_ID; }
+
+    // price of one whole unit of the primary in the secondary
+    static int64_t Price(CAmount secondaryAmount, bool secondaryIsID, CAmount primaryAmount, bool primaryIsID);
+
+    COfferIndexKey GetKey(unsigned int type) const {
+        if (type == COfferIndexKey::OFFERED)
+        {
+            return COfferIndexKey(type, offeredID, requestedID, Price(requestedAmount, RequestsID(), offeredAmount, OffersID()), offerOutput.hash);
+        }
+        return COfferIndexKey(type, requestedID, offeredID, Price(offeredAmount, OffersID(), requestedAmount, RequestsID()), offerOutput.hash);
+    }
+};
+
+#endif // BITCOIN_OFFERINDEX_H
@@ -0,0 +1,524 @@
+/********************************************************************
+ * (C) 2023 The Verus developers
+ *
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ *
+ * In memory graph of currency converters and conversion routes through them.
+ *
+ */
+
+#include "main.h"
+#include "key_io.h"
+#include "rpc/server.h"
+#include "pbaas/pbaas.h"
+#include "pbaas/converters.h"
+
+#include <functional>
+
+CConverterGraph ConverterGraph;
+
+UniValue CConversionHop::ToUniValue() const
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("converter", EncodeDestination(CIdentityID(converterID)));
+    ret.pushKV("inputcurrencyid", EncodeDestination(CIdentityID(sourceID)));
+    ret.pushKV("inputamount", ValueFromAmount(amountIn));
+    ret.pushKV("conversionfee", ValueFromAmount(conversionFee));
+    ret.pushKV("outputcurrencyid", EncodeDestination(CIdentityID(destID)));
+    ret.pushKV("estimatedcurrencyout", ValueFromAmount(amountOut));
+    ret.pushKV("spotcurrencyout", ValueFromAmount(spotAmountOut));
+    return ret;
+}
+
+int64_t CConversionRoute::Slippage() const
+{
+    // multiply the ratio of estimated to spot output of each hop
+    arith_uint256 bigRatio(SATOSHIDEN);
+    for (auto &oneHop : hops)
+    {
+        if (oneHop.spotAmountOut <= 0)
+        {
+            return 0;
+        }
+        bigRatio = (bigRatio * arith_uint256(std::max(oneHop.amountOut, (CAmount)0))) / arith_uint256(oneHop.spotAmountOut);
+    }
+    int64_t ratio = bigRatio > arith_uint256(SATOSHIDEN) ? SATOSHIDEN : (int64_t)bigRatio.GetLow64();
+    return SATOSHIDEN - ratio;
+}
+
+UniValue CConversionRoute::ToUniValue() const
+{
+    UniValue ret(UniValue::VOBJ);
+    UniValue hopsUni(UniValue::VARR);
+    for (auto &oneHop : hops)
+    {
+        hopsUni.push_back(oneHop.ToUniValue());
+    }
+    if (hops.size())
+    {
+        ret.pushKV("inputcurrencyid", EncodeDestination(CIdentityID(hops.front().sourceID)));
+        ret.pushKV("inputamount", ValueFromAmount(hops.front().amountIn));
+        ret.pushKV("outputcurrencyid", EncodeDestination(CIdentityID(hops.back().destID)));
+    }
+    ret.pushKV("estimatedcurrencyout", ValueFromAmount(amountOut));
+    ret.pushKV("slippage", ValueFromAmount(Slippage()));
+    ret.pushKV("hops", hopsUni);
+    return ret;
+}
+
+bool CConverterGraph::IsConverterState(const CCoinbaseCurrencyState &curState)
+{
+    // the same qualifications as the converter index, and the launch must be complete to convert
+    int32_t nativeReserveIdx;
+    std::map<uint160, int32_t> reserveIdxMap;
+    return curState.IsValid() &&
+           curState.IsFractional() &&
+           curState.IsLaunchConfirmed() &&
+           curState.IsLaunchCompleteMarker() &&
+           (reserveIdxMap = curState.GetReserveMap()).count(ASSETCHAINS_CHAINID) &&
+           curState.weights[nativeReserveIdx = reserveIdxMap[ASSETCHAINS_CHAINID]] > curState.IndexConverterReserveRatio() &&
+           curState.reserves[nativeReserveIdx] > curState.IndexConverterReserveMinimum();
+}
+
+void CConverterGraph::SetConverter(const uint160 &currencyID, const CConverter &converter)
+{
+    EraseConverter(currencyID);
+    converters[currencyID] = converter;
+    currencyConverters.insert(std::make_pair(currencyID, currencyID));
+    for (auto &oneCurrency : converter.state.currencies)
+    {
+        currencyConverters.insert(std::make_pair(oneCurrency, currencyID));
+    }
+}
+
+void CConverterGraph::EraseConverter(const uint160 &currencyID)
+{
+    auto converterIt = converters.find(currencyID);
+    if (converterIt == converters.end())
+    {
+        return;
+    }
+    std::vector<uint160> members(converterIt->second.state.currencies);
+    members.push_back(currencyID);
+    for (auto &oneCurrency : members)
+    {
+        auto range = currencyConverters.equal_range(oneCurrency);
+        for (auto it = range.first; it != range.second; )
+        {
+            it = (it->second == currencyID) ? currencyConverters.erase(it) : std::next(it);
+        }
+    }
+    converters.erase(converterIt);
+}
+
+void CConverterGraph::Initialize()
+{
+    AssertLockHeld(cs_main);
+
+    std::vector<CAddressUnspentDbEntry> converterNotarizations;
+    if (!GetAddressUnspent(CCoinbaseCurrencyState::IndexConverterKey(ASSETCHAINS_CHAINID), CScript::P2IDX, converterNotarizations))
+    {
+        LogPrintf("%s: Error reading unspent index\n", __func__);
+        return;
+    }
+
+    LOCK(cs);
+    converters.clear();
+    currencyConverters.clear();
+
+    for (auto &oneNotarization : converterNotarizations)
+    {
+        CPBaaSNotarization pbn(oneNotarization.second.script);
+        if (!pbn.IsValid() ||
+            !IsConverterState(pbn.currencyState) ||
+            ConnectedChains.GetCachedCurrency(pbn.currencyID).systemID != ASSETCHAINS_CHAINID)
+        {
+            continue;
+        }
+        auto converterIt = converters.find(pbn.currencyID);
+        if (converterIt != converters.end() && converterIt->second.height > oneNotarization.second.blockHeight)
+        {
+            continue;
+        }
+        SetConverter(pbn.currencyID, CConverter(pbn.currencyState,
+                                                oneNotarization.second.blockHeight,
+                                                CUTXORef(oneNotarization.first.txhash, oneNotarization.first.index)));
+    }
+    initialized = true;
+
+    LogPrint("pbaas", "%s: loaded %lu currency converters\n", __func__, converters.size());
+}
+
+void CConverterGraph::ConnectBlock(const CBlock &block, uint32_t height)
+{
+    LOCK(cs);
+    if (!initialized)
+    {
+        return;
+    }
+
+    for (auto &tx : block.vtx)
+    {
+        for (int i = 0; i < tx.vout.size(); i++)
+        {
+            COptCCParams p;
+            CPBaaSNotarization pbn;
+            if (!(tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+                  p.IsValid() &&
+                  (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION) &&
+                  p.vData.size() &&
+                  (pbn = CPBaaSNotarization(p.vData[0])).IsValid()))
+            {
+                continue;
+            }
+            if (IsConverterState(pbn.currencyState))
+            {
+                if (converters.count(pbn.currencyID) ||
+                    ConnectedChains.GetCachedCurrency(pbn.currencyID).systemID == ASSETCHAINS_CHAINID)
+                {
+                    SetConverter(pbn.currencyID, CConverter(pbn.currencyState, height, CUTXORef(tx.GetHash(), i)));
+                }
+            }
+            else if (converters.count(pbn.currencyID))
+            {
+                // no longer qualifies
+                EraseConverter(pbn.currencyID);
+            }
+        }
+    }
+}
+
+void CConverterGraph::DisconnectBlock(const CBlock &block)
+{
+    LOCK(cs);
+    if (!initialized)
+    {
+        return;
+    }
+
+    for (auto &tx : block.vtx)
+    {
+        for (auto &oneOut : tx.vout)
+        {
+            COptCCParams p;
+            CPBaaSNotarization pbn;
+            if (oneOut.scriptPubKey.IsPayToCryptoCondition(p) &&
+                p.IsValid() &&
+                (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION) &&
+                p.vData.size() &&
+                (pbn = CPBaaSNotarization(p.vData[0])).IsValid() &&
+                (converters.count(pbn.currencyID) || IsConverterState(pbn.currencyState)))
+            {
+                initialized = false;
+                return;
+            }
+        }
+    }
+}
+
+void CConverterGraph::AddMempoolTransaction(const CTransaction &tx)
+{
+    std::vector<CPendingConversion> conversions;
+    for (auto &oneOut : tx.vout)
+    {
+        COptCCParams p;
+        CReserveTransfer rt;
+        if (!(oneOut.scriptPubKey.IsPayToCryptoCondition(p) &&
+              p.IsValid() &&
+              p.evalCode == EVAL_RESERVE_TRANSFER &&
+              p.vData.size() &&
+              (rt = CReserveTransfer(p.vData[0])).IsValid() &&
+              rt.IsConversion() &&
+              !rt.IsPreConversion() &&
+              !rt.IsCrossSystem()))
+        {
+            continue;
+        }
+        CAmount conversionFee = CReserveTransactionDescriptor::CalculateConversionFeeNoMin(rt.FirstValue());
+        if (rt.IsReserveToReserve())
+        {
+            conversionFee <<= 1;
+        }
+        CPendingConversion oneConversion;
+        oneConversion.converterID = rt.GetImportCurrency();
+        oneConversion.sourceID = rt.FirstCurrency();
+        oneConversion.destID = rt.IsReserveToReserve() ? rt.secondReserveID : rt.destCurrencyID;
+        oneConversion.amount = std::max(rt.FirstValue() - conversionFee, (CAmount)0);
+        conversions.push_back(oneConversion);
+    }
+    if (!conversions.size())
+    {
+        return;
+    }
+
+    uint256 txid = tx.GetHash();
+    LOCK(cs);
+    if (mempoolConversions.count(txid))
+    {
+        return;
+    }
+    for (int i = 0; i < conversions.size(); i++)
+    {
+        pendingByConverter.insert(std::make_pair(conversions[i].converterID, std::make_pair(txid, i)));
+    }
+    mempoolConversions[txid] = conversions;
+}
+
+void CConverterGraph::RemoveMempoolTransaction(const uint256 &txid)
+{
+    LOCK(cs);
+    auto txIt = mempoolConversions.find(txid);
+    if (txIt == mempoolConversions.end())
+    {
+        return;
+    }
+    for (auto &oneConversion : txIt->second)
+    {
+        auto range = pendingByConverter.equal_range(oneConversion.converterID);
+        for (auto it = range.first; it != range.second; )
+        {
+            it = (it->second.first == txid) ? pendingByConverter.erase(it) : std::next(it);
+        }
+    }
+    mempoolConversions.erase(txIt);
+}
+
+std::vector<CConverterGraph::CConverter> CConverterGraph::GetConverters() const
+{
+    LOCK(cs);
+    std::vector<CConverter> retVal;
+    for (auto &oneConverter : converters)
+    {
+        retVal.push_back(oneConverter.second);
+    }
+    return retVal;
+}
+
+bool CConverterGraph::EstimateHop(const CConverter &converter,
+                                  const uint160 &sourceID,
+                                  const uint160 &destID,
+                                  CAmount amount,
+                                  bool includePending,
+                                  uint32_t height,
+                                  CConversionHop &hop) const
+{
+    const CCoinbaseCurrencyState &curState = converter.state;
+    uint160 converterID = curState.GetID();
+    std::map<uint160, int32_t> reserveMap = curState.GetReserveMap();
+
+    bool fromFractional = sourceID == converterID;
+    bool toFractional = destID == converterID;
+    if (amount <= 0 ||
+        sourceID == destID ||
+        (!fromFractional && !reserveMap.count(sourceID)) ||
+        (!toFractional && !reserveMap.count(destID)))
+    {
+        return false;
+    }
+
+    int numCurrencies = curState.currencies.size();
+    std::vector<CAmount> reserveIn(numCurrencies, 0);
+    std::vector<CAmount> fractionalIn(numCurrencies, 0);
+    std::vector<std::vector<CAmount>> crossConversions(numCurrencies, std::vector<CAmount>(numCurrencies, 0));
+    bool hasCrossConversions = false;
+
+    // all conversions in one import are priced together, so our conversion is added to any pending ones
+    auto addConversion = [&](const uint160 &fromID, const uint160 &toID, CAmount netAmount)
+    {
+        if (fromID == converterID)
+        {
+            fractionalIn[reserveMap[toID]] += netAmount;
+        }
+        else
+        {
+            reserveIn[reserveMap[fromID]] += netAmount;
+            if (toID != converterID)
+            {
+                crossConversions[reserveMap[fromID]][reserveMap[toID]] += netAmount;
+                hasCrossConversions = true;
+            }
+        }
+    };
+
+    if (includePending)
+    {
+        LOCK(cs);
+        auto range = pendingByConverter.equal_range(converterID);
+        for (auto it = range.first; it != range.second; it++)
+        {
+            const CPendingConversion &oneConversion = mempoolConversions.at(it->second.first)[it->second.second];
+            if (oneConversion.sourceID == oneConversion.destID ||
+                (oneConversion.sourceID != converterID && !reserveMap.count(oneConversion.sourceID)) ||
+                (oneConversion.destID != converterID && !reserveMap.count(oneConversion.destID)))
+            {
+                continue;
+            }
+            addConversion(oneConversion.sourceID, oneConversion.destID, oneConversion.amount);
+        }
+    }
+
+    hop.converterID = converterID;
+    hop.sourceID = sourceID;
+    hop.destID = destID;
+    hop.amountIn = amount;
+    hop.conversionFee = CReserveTransactionDescriptor::CalculateConversionFeeNoMin(amount);
+    if (hop.IsReserveToReserve())
+    {
+        hop.conversionFee <<= 1;
+    }
+    hop.conversionFee = std::min(hop.conversionFee, amount);
+    CAmount netAmount = amount - hop.conversionFee;
+
+    addConversion(sourceID, destID, netAmount);
+
+    CCurrencyState newState;
+    CValidationState state;
+    std::vector<CAmount> viaPrices(curState.viaConversionPrice);
+    std::vector<CAmount> newPrices = curState.ConvertAmounts(reserveIn,
+                                                             fractionalIn,
+                                                             newState,
+                                                             ConnectedChains.IsPromoteExchangeRate(height),
+                                                             ConnectedChains.IsPBaaSRefundFixActive(height),
+                                                             state,
+                                                             &crossConversions,
+                                                             &viaPrices);
+    if (state.IsError() || !newState.IsValid() || newPrices.size() != numCurrencies)
+    {
+        return false;
+    }
+    if (!hasCrossConversions || viaPrices.size() != numCurrencies)
+    {
+        viaPrices = newPrices;
+    }
+
+    auto amountOut = [&](const std::vector<CAmount> &prices, const std::vector<CAmount> &secondPrices)
+    {
+        if (fromFractional)
+        {
+            return CCurrencyState::NativeToReserveRaw(netAmount, prices[reserveMap[destID]]);
+        }
+        CAmount fractionalOut = CCurrencyState::ReserveToNativeRaw(netAmount, prices[reserveMap[sourceID]]);
+        return toFractional ? fractionalOut : CCurrencyState::NativeToReserveRaw(fractionalOut, secondPrices[reserveMap[destID]]);
+    };
+
+    std::vector<CAmount> spotPrices = curState.PricesInReserve();
+    hop.amountOut = amountOut(newPrices, viaPrices);
+    hop.spotAmountOut = amountOut(spotPrices, spotPrices);
+    return hop.amountOut > 0;
+}
+
+std::vector<CConversionRoute> CConverterGraph::GetBestRoutes(const uint160 &sourceID,
+                                                             const uint160 &destID,
+                                                             CAmount amount,
+                                                             int maxHops,
+                                                             int maxRoutes,
+                                                             CAmount maxSlippage,
+                                                             bool includePending,
+                                                             uint32_t height) const
+{
+    LOCK(cs);
+
+    std::vector<CConversionRoute> routes;
+    if (!initialized || amount <= 0 || sourceID == destID || !currencyConverters.count(sourceID) || !currencyConverters.count(destID))
+    {
+        return routes;
+    }
+    maxHops = std::max(1, std::min(maxHops, (int)MAX_ROUTE_HOPS));
+
+    auto getMembers = [this](const uint160 &converterID)
+    {
+        std::vector<uint160> members(converters.at(converterID).state.currencies);
+        members.push_back(converterID);
+        return members;
+    };
+
+    // the fewest conversions from each currency to the destination, searched backward from the destination, so that
+    // routes only follow conversions that can still reach it
+    std::map<uint160, int> hopsToDest({{destID, 0}});
+    std::vector<uint160> frontier({destID});
+    for (int i = 1; i < maxHops && frontier.size(); i++)
+    {
+        std::vector<uint160> nextFrontier;
+        for (auto &oneCurrency : frontier)
+        {
+            auto range = currencyConverters.equal_range(oneCurrency);
+            for (auto it = range.first; it != range.second; it++)
+            {
+                for (auto &oneMember : getMembers(it->second))
+                {
+                    if (!hopsToDest.count(oneMember))
+                    {
+                        hopsToDest[oneMember] = i;
+                        nextFrontier.push_back(oneMember);
+                    }
+                }
+            }
+        }
+        frontier = nextFrontier;
+    }
+
+    // depth first over conversions, using each converter and visiting each currency at most once in a route
+    CConversionRoute route;
+    std::set<uint160> usedConverters;
+    std::set<uint160> visitedCurrencies({sourceID});
+
+    std::function<void(const uint160 &, CAmount, int)> findRoutes = [&](const uint160 &fromID, CAmount fromAmount, int hopsLeft)
+    {
+        auto range = currencyConverters.equal_range(fromID);
+        for (auto it = range.first; it != range.second; it++)
+        {
+            if (usedConverters.count(it->second))
+            {
+                continue;
+            }
+            for (auto &toID : getMembers(it->second))
+            {
+                auto distIt = hopsToDest.find(toID);
+                if (toID == fromID ||
+                    visitedCurrencies.count(toID) ||
+                    distIt == hopsToDest.end() ||
+                    distIt->second > hopsLeft - 1)
+                {
+                    continue;
+                }
+
+                CConversionHop hop;
+                if (!EstimateHop(converters.at(it->second), fromID, toID, fromAmount, includePending, height, hop))
+                {
+                    continue;
+                }
+
+                route.hops.push_back(hop);
+                if (toID == destID)
+                {
+                    route.amountOut = hop.amountOut;
+                    if (!maxSlippage || route.Slippage() <= maxSlippage)
+                    {
+                        routes.push_back(route);
+                    }
+                }
+                else
+                {
+                    usedConverters.insert(it->second);
+                    visitedCurrencies.insert(toID);
+                    findRoutes(toID, hop.amountOut, hopsLeft - 1);
+                    visitedCurrencies.erase(toID);
+                    usedConverters.erase(it->second);
+                }
+                route.hops.pop_back();
+            }
+        }
+    };
+    findRoutes(sourceID, amount, maxHops);
+
+    std::stable_sort(routes.begin(), routes.end(), [](const CConversionRoute &a, const CConversionRoute &b)
+    {
+        return a.amountOut > b.amountOut || (a.amountOut == b.amountOut && a.hops.size() < b.hops.size());
+    });
+    if (maxRoutes > 0 && routes.size() > maxRoutes)
+    {
+        routes.resize(maxRoutes);
+    }
+    return routes;
+}
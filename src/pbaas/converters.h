@@ -0,0 +1,146 @@
+/********************************************************************
+ * (C) 2023 The Verus developers
+ *
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ *
+ * This keeps the latest confirmed state of every fractional currency on
+ * this chain that qualifies as a currency converter, along with the
+ * conversions waiting in the mempool for each of them, so that routes of
+ * one or more conversions through those baskets can be found and priced
+ * in memory.
+ *
+ */
+
+#ifndef CONVERTERS_H
+#define CONVERTERS_H
+
+#include "sync.h"
+#include "primitives/transaction.h"
+#include "pbaas/reserves.h"
+
+class CBlock;
+class CTransaction;
+
+// one conversion through one basket
+class CConversionHop
+{
+public:
+    uint160 converterID;                    // basket that the conversion goes through
+    uint160 sourceID;                       // currency in
+    uint160 destID;                         // currency out
+    CAmount amountIn;
+    CAmount conversionFee;                  // in the source currency
+    CAmount amountOut;                      // estimated amount out after fees and slippage
+    CAmount spotAmountOut;                  // amount out at the last price with fees, but no slippage
+
+    CConversionHop() : amountIn(0), conversionFee(0), amountOut(0), spotAmountOut(0) {}
+
+    bool IsReserveToReserve() const
+    {
+        return sourceID != converterID && destID != converterID;
+    }
+
+    UniValue ToUniValue() const;
+};
+
+class CConversionRoute
+{
+public:
+    std::vector<CConversionHop> hops;
+    CAmount amountOut;
+
+    CConversionRoute() : amountOut(0) {}
+
+    // slippage of the whole route relative to its spot output, where SATOSHIDEN is 100%
+    int64_t Slippage() const;
+
+    UniValue ToUniValue() const;
+};
+
+class CConverterGraph
+{
+public:
+    // latest confirmed state of one converter
+    struct CConverter
+    {
+        CCoinbaseCurrencyState state;
+        uint32_t height;
+        CUTXORef notarizationOutput;
+        CConverter() : height(0) {}
+        CConverter(const CCoinbaseCurrencyState &curState, uint32_t nHeight, const CUTXORef &output) :
+            state(curState), height(nHeight), notarizationOutput(output) {}
+    };
+
+    // one conversion waiting in the mempool, with its conversion fee already taken out of amount
+    struct CPendingConversion
+    {
+        uint160 converterID;
+        uint160 sourceID;
+        uint160 destID;
+        CAmount amount;
+    };
+
+    static const int MAX_ROUTE_HOPS = 3;
+
+    mutable CCriticalSection cs;
+
+    CConverterGraph() : initialized(false) {}
+
+    // true if this is the state of a fractional currency on this chain that is a converter
+    static bool IsConverterState(const CCoinbaseCurrencyState &curState);
+
+    bool IsInitialized() const
+    {
+        LOCK(cs);
+        return initialized;
+    }
+
+    // loads all converters from the unspent converter index, needs cs_main
+    void Initialize();
+
+    // updates converters from the notarizations in a connected block, needs cs_main
+    void ConnectBlock(const CBlock &block, uint32_t height);
+
+    // the prior state of a converter is not in a disconnected block, so converters are reloaded on next use
+    void DisconnectBlock(const CBlock &block);
+
+    void AddMempoolTransaction(const CTransaction &tx);
+    void RemoveMempoolTransaction(const uint256 &txid);
+
+    std::vector<CConverter> GetConverters() const;
+
+    // returns up to maxRoutes routes of up to maxHops conversions from source to destination, best first,
+    // leaving out routes with more than maxSlippage, if it is not 0
+    std::vector<CConversionRoute> GetBestRoutes(const uint160 &sourceID,
+                                                const uint160 &destID,
+                                                CAmount amount,
+                                                int maxHops,
+                                                int maxRoutes,
+                                                CAmount maxSlippage,
+                                                bool includePending,
+                                                uint32_t height) const;
+
+    // estimates one conversion through one converter, batched with any pending conversions through it
+    bool EstimateHop(const CConverter &converter,
+                     const uint160 &sourceID,
+                     const uint160 &destID,
+                     CAmount amount,
+                     bool includePending,
+                     uint32_t height,
+                     CConversionHop &hop) const;
+
+protected:
+    bool initialized;
+    std::map<uint160, CConverter> converters;
+    std::multimap<uint160, uint160> currencyConverters;                 // currency to each converter it can convert through
+    std::map<uint256, std::vector<CPendingConversion>> mempoolConversions;
+    std::multimap<uint160, std::pair<uint256, int>> pendingByConverter; // converter to mempool transaction and conversion index
+
+    void SetConverter(const uint160 &currencyID, const CConverter &converter);
+    void EraseConverter(const uint160 &currencyID);
+};
+
+extern CConverterGraph ConverterGraph;
+
+#endif // CONVERTERS_H
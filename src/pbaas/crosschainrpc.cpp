@@ -157,48 +157,255 @@ static CCrossChainRPCData LoadFromConfig(std::string name)
     return ret;
 }
 
-// credentials for now are "user:password"
-UniValue RPCCall(const string& strMethod, const UniValue& params, const string credentials, int port, const string host, int timeout)
+// reply context for pooled connections, which stay open after the reply, so the event loop must be
+// broken explicitly rather than running until no more events are pending
+struct HTTPPooledReply : public HTTPReply
 {
-    // Used for inter-daemon communicatoin to enable merge mining and notarization without a client
-    //
+    HTTPPooledReply(struct event_base *Base) : base(Base) {}
+
+    struct event_base *base;
+};
 
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
+static void http_pooled_request_done(struct evhttp_request *req, void *ctx)
+{
+    http_request_done(req, ctx);
+    event_base_loopbreak(static_cast<HTTPPooledReply*>(ctx)->base);
+}
 
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-    evhttp_connection_set_timeout(evcon.get(), timeout);
+class CRPCPooledConnection
+{
+public:
+    raii_event_base base;
+    raii_evhttp_connection evcon;
+    std::string host;
+    std::string authHeader;
+    int64_t lastUsed;
+    uint64_t useCount;
+
+    CRPCPooledConnection(const std::string &Host, int port, const std::string &credentials) :
+        base(obtain_event_base()),
+        evcon(obtain_evhttp_connection_base(base.get(), Host, port)),
+        host(Host),
+        authHeader(std::string("Basic ") + EncodeBase64(credentials)),
+        lastUsed(GetTime()),
+        useCount(0) {}
+
+    // returns false if the request could not be sent, otherwise waits for the reply or connection error
+    bool Send(const std::string &strRequest, int timeout, HTTPPooledReply &response)
+    {
+        evhttp_connection_set_timeout(evcon.get(), timeout);
 
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == NULL)
-        throw std::runtime_error("create http request failed");
+        raii_evhttp_request req = obtain_evhttp_request(http_pooled_request_done, (void*)&response);
+        if (req == NULL)
+            throw std::runtime_error("create http request failed");
 #if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
+        evhttp_request_set_error_cb(req.get(), http_error_cb);
 #endif
 
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(credentials)).c_str());
-
-    // Attach request data
-    std::string strRequest = JSONRPCRequest(strMethod, params, 1);
-    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
-    assert(output_buffer);
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
-    req.release(); // ownership moved to evcon in above call
-    if (r != 0) {
-        throw CConnectionFailed("send http request failed");
+        struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+        assert(output_headers);
+        evhttp_add_header(output_headers, "Host", host.c_str());
+        evhttp_add_header(output_headers, "Connection", "keep-alive");
+        evhttp_add_header(output_headers, "Authorization", authHeader.c_str());
+
+        struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+        assert(output_buffer);
+        evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+        int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
+        req.release(); // ownership moved to evcon in above call
+        if (r != 0) {
+            return false;
+        }
+
+        event_base_dispatch(base.get());
+
+        useCount++;
+        lastUsed = GetTime();
+        return true;
+    }
+};
+
+CRPCClientPool rpcClientPool;
+
+UniValue CRPCEndpointStats::ToUniValue() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("requests", (uint64_t)requests));
+    obj.push_back(Pair("httprequests", (uint64_t)httpRequests));
+    obj.push_back(Pair("batches", (uint64_t)batches));
+    obj.push_back(Pair("failures", (uint64_t)failures));
+    obj.push_back(Pair("retries", (uint64_t)retries));
+    obj.push_back(Pair("connectionsopened", (uint64_t)connectionsOpened));
+    obj.push_back(Pair("inflight", (uint64_t)inFlight));
+    uint64_t completed = httpRequests - inFlight;
+    obj.push_back(Pair("averagelatencyms", completed ? (double)totalMicros / (completed * 1000.0) : 0.0));
+    obj.push_back(Pair("maxlatencyms", (double)maxMicros / 1000.0));
+    obj.push_back(Pair("lastlatencyms", (double)lastMicros / 1000.0));
+    return obj;
+}
+
+CRPCClientPool::CRPCClientPool() {}
+
+CRPCClientPool::~CRPCClientPool()
+{
+    Clear();
+}
+
+void CRPCClientPool::Clear()
+{
+    LOCK(cs);
+    for (auto &oneEndpoint : idleConnections)
+    {
+        for (auto pConnection : oneEndpoint.second)
+        {
+            delete pConnection;
+        }
+    }
+    idleConnections.clear();
+}
+
+CRPCPooledConnection *CRPCClientPool::Acquire(const CEndpointKey &key, int timeout, bool fresh)
+{
+    if (!fresh)
+    {
+        LOCK(cs);
+        auto it = idleConnections.find(key);
+        if (it != idleConnections.end())
+        {
+            int64_t now = GetTime();
+            while (it->second.size())
+            {
+                CRPCPooledConnection *pConnection = it->second.back();
+                it->second.pop_back();
+                if ((now - pConnection->lastUsed) <= MAX_IDLE_SECONDS)
+                {
+                    return pConnection;
+                }
+                delete pConnection;
+            }
+        }
     }
 
-    event_base_dispatch(base.get());
+    CRPCPooledConnection *pConnection = new CRPCPooledConnection(std::get<0>(key), std::get<1>(key), std::get<2>(key));
+    LOCK(cs);
+    endpointStats[key].connectionsOpened++;
+    return pConnection;
+}
+
+void CRPCClientPool::Release(const CEndpointKey &key, CRPCPooledConnection *pConnection, bool reusable)
+{
+    {
+        LOCK(cs);
+        std::vector<CRPCPooledConnection *> &idle = idleConnections[key];
+        if (reusable && idle.size() < MAX_IDLE_CONNECTIONS_PER_ENDPOINT)
+        {
+            idle.push_back(pConnection);
+            return;
+        }
+    }
+    delete pConnection;
+}
+
+bool CRPCClientPool::IsRetriable(const std::string &strMethod)
+{
+    // calls that only read state, so that sending one a second time after an unknown outcome has no effect
+    static const std::set<std::string> readOnlyMethods({
+        "getbestproofroot",
+        "getblockcount",
+        "getcurrency",
+        "getexports",
+        "getidentity",
+        "getinfo",
+        "getlastimportfrom",
+        "getlaunchinfo",
+        "getminingdistribution",
+        "getnotarizationdata",
+        "getnotarizationproofs"
+    });
+    return readOnlyMethods.count(strMethod) != 0;
+}
 
-    if (response.status == 0)
+std::string CRPCClientPool::Post(const CEndpointKey &key, const std::string &strRequest, int timeout, bool isBatch, int64_t nRequests, bool retriable)
+{
+    {
+        LOCK(cs);
+        CRPCEndpointStats &stats = endpointStats[key];
+        stats.requests += nRequests;
+        stats.httpRequests++;
+        stats.inFlight++;
+        if (isBatch)
+        {
+            stats.batches++;
+        }
+    }
+
+    int64_t nStart = GetTimeMicros();
+    HTTPPooledReply response(nullptr);
+    bool sent = false;
+
+    try
+    {
+        for (bool fresh = false; ; fresh = true)
+        {
+            CRPCPooledConnection *pConnection = Acquire(key, timeout, fresh);
+            bool reused = pConnection->useCount != 0;
+            response = HTTPPooledReply(pConnection->base.get());
+            try
+            {
+                sent = pConnection->Send(strRequest, timeout, response);
+            }
+            catch (...)
+            {
+                Release(key, pConnection, false);
+                throw;
+            }
+            bool succeeded = sent && response.status != 0;
+            Release(key, pConnection, succeeded);
+
+            // the server may have closed an idle keep-alive connection, which we only learn about when we try to use it,
+            // so retry once on a new connection before reporting failure. we cannot tell whether the server received
+            // the request, so only requests that are safe to repeat are retried, and only within the original timeout.
+            int remaining = timeout - (int)((GetTimeMicros() - nStart) / 1000000);
+            if (!succeeded && reused && !fresh && retriable && remaining > 0)
+            {
+                timeout = remaining;
+                LOCK(cs);
+                endpointStats[key].retries++;
+                continue;
+            }
+            break;
+        }
+    }
+    catch (...)
+    {
+        LOCK(cs);
+        CRPCEndpointStats &stats = endpointStats[key];
+        stats.inFlight--;
+        stats.failures++;
+        throw;
+    }
+
+    int64_t nElapsed = GetTimeMicros() - nStart;
+    bool failed = !sent || response.status == 0 || response.status == HTTP_UNAUTHORIZED ||
+                  (response.status >= 400 && response.status != HTTP_BAD_REQUEST && response.status != HTTP_NOT_FOUND && response.status != HTTP_INTERNAL_SERVER_ERROR);
+    {
+        LOCK(cs);
+        CRPCEndpointStats &stats = endpointStats[key];
+        stats.inFlight--;
+        stats.totalMicros += nElapsed;
+        stats.lastMicros = nElapsed;
+        stats.maxMicros = std::max(stats.maxMicros, nElapsed);
+        if (failed)
+        {
+            stats.failures++;
+        }
+    }
+    LogPrint("rpcclient", "%s:%d %s round trip in %.3fms\n", std::get<0>(key), std::get<1>(key), isBatch ? "batch" : "request", nElapsed * 0.001);
+
+    if (!sent)
+        throw CConnectionFailed("send http request failed");
+    else if (response.status == 0)
         throw CConnectionFailed(strprintf("couldn't connect to server: %s (code %d)\n(make sure server is running and you are connecting to the correct RPC port)", http_errorstring(response.error), response.error));
     else if (response.status == HTTP_UNAUTHORIZED)
         throw std::runtime_error("incorrect rpcuser or rpcpassword (authorization failed)");
@@ -207,9 +414,16 @@ UniValue RPCCall(const string& strMethod, const UniValue& params, const string c
     else if (response.body.empty())
         throw std::runtime_error("no response from server");
 
+    return response.body;
+}
+
+UniValue CRPCClientPool::Call(const std::string &strMethod, const UniValue &params, const std::string &credentials, int port, const std::string &host, int timeout)
+{
+    std::string body = Post(CEndpointKey(host, port, credentials), JSONRPCRequest(strMethod, params, 1), timeout, false, 1, IsRetriable(strMethod));
+
     // Parse reply
     UniValue valReply(UniValue::VSTR);
-    if (!valReply.read(response.body))
+    if (!valReply.read(body))
         throw std::runtime_error("couldn't parse reply from server");
     const UniValue& reply = valReply.get_obj();
     if (reply.empty())
@@ -218,16 +432,115 @@ UniValue RPCCall(const string& strMethod, const UniValue& params, const string c
     return reply;
 }
 
-UniValue RPCCallRoot(const string& strMethod, const UniValue& params, int timeout)
+std::vector<UniValue> CRPCClientPool::CallBatch(const std::vector<std::pair<std::string, UniValue>> &calls,
+                                                const std::string &credentials,
+                                                int port,
+                                                const std::string &host,
+                                                int timeout)
+{
+    std::vector<UniValue> replies;
+    if (!calls.size())
+    {
+        return replies;
+    }
+
+    // ids are the position of each call, so replies can be matched regardless of the order they are returned in
+    UniValue request(UniValue::VARR);
+    bool retriable = true;
+    for (int i = 0; i < calls.size(); i++)
+    {
+        retriable = retriable && IsRetriable(calls[i].first);
+        UniValue oneRequest(UniValue::VOBJ);
+        oneRequest.push_back(Pair("method", calls[i].first));
+        oneRequest.push_back(Pair("params", calls[i].second));
+        oneRequest.push_back(Pair("id", i));
+        request.push_back(oneRequest);
+    }
+
+    std::string body = Post(CEndpointKey(host, port, credentials), request.write() + "\n", timeout, true, calls.size(), retriable);
+
+    UniValue valReply(UniValue::VSTR);
+    if (!valReply.read(body))
+        throw std::runtime_error("couldn't parse reply from server");
+
+    replies.resize(calls.size(), NullUniValue);
+    if (valReply.isObject())
+    {
+        // the whole batch was rejected, so every call gets the same reply
+        for (auto &oneReply : replies)
+        {
+            oneReply = valReply;
+        }
+        return replies;
+    }
+    else if (!valReply.isArray())
+    {
+        throw std::runtime_error("expected batch reply to be an array");
+    }
+
+    for (int i = 0; i < valReply.size(); i++)
+    {
+        const UniValue &id = find_value(valReply[i], "id");
+        if (id.isNum() && id.get_int() >= 0 && id.get_int() < replies.size())
+        {
+            replies[id.get_int()] = valReply[i];
+        }
+    }
+    for (int i = 0; i < replies.size(); i++)
+    {
+        if (replies[i].isNull())
+        {
+            replies[i] = JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_MISC_ERROR, "no reply to batched request"), i);
+        }
+    }
+    return replies;
+}
+
+CRPCEndpointStats CRPCClientPool::GetStats(const std::string &host, int port, const std::string &credentials) const
+{
+    LOCK(cs);
+    auto it = endpointStats.find(CEndpointKey(host, port, credentials));
+    return it == endpointStats.end() ? CRPCEndpointStats() : it->second;
+}
+
+UniValue CRPCClientPool::GetStats() const
+{
+    LOCK(cs);
+    UniValue ret(UniValue::VARR);
+    for (auto &oneEndpoint : endpointStats)
+    {
+        UniValue oneObj = oneEndpoint.second.ToUniValue();
+        oneObj.push_back(Pair("host", std::get<0>(oneEndpoint.first)));
+        oneObj.push_back(Pair("port", std::get<1>(oneEndpoint.first)));
+        auto idleIt = idleConnections.find(oneEndpoint.first);
+        oneObj.push_back(Pair("idleconnections", (int64_t)(idleIt == idleConnections.end() ? 0 : idleIt->second.size())));
+        ret.push_back(oneObj);
+    }
+    return ret;
+}
+
+// credentials for now are "user:password"
+UniValue RPCCall(const string& strMethod, const UniValue& params, const string credentials, int port, const string host, int timeout)
+{
+    // Used for inter-daemon communicatoin to enable merge mining and notarization without a client
+    return rpcClientPool.Call(strMethod, params, credentials, port, host, timeout);
+}
+
+std::vector<UniValue> RPCCallBatch(const std::vector<std::pair<std::string, UniValue>> &calls, const string credentials, int port, const string host, int timeout)
+{
+    return rpcClientPool.CallBatch(calls, credentials, port, host, timeout);
+}
+
+// loads the RPC endpoint of the root chain into PBAAS_HOST, PBAAS_PORT and PBAAS_USERPASS if it is not set yet,
+// returns false if there is none
+static bool GetRootRPCEndpoint()
 {
-    string host, credentials;
-    int port;
     map<string, string> settings;
     map<string, vector<string>> settingsmulti;
 
     if (PBAAS_HOST != "" && PBAAS_PORT != 0)
     {
-        return RPCCall(strMethod, params, PBAAS_USERPASS, PBAAS_PORT, PBAAS_HOST);
+        return true;
     }
     else if ((_IsVerusActive() &&
               ReadConfigFile("veth", settings, settingsmulti)) ||
@@ -250,12 +563,30 @@ UniValue RPCCallRoot(const string& strMethod, const UniValue& params, int timeou
             {
                 PBAAS_HOST = "127.0.0.1";
             }
-            return RPCCall(strMethod, params, credentials, port, host, timeout);
+            return true;
         }
     }
+    return false;
+}
+
+UniValue RPCCallRoot(const string& strMethod, const UniValue& params, int timeout)
+{
+    if (GetRootRPCEndpoint())
+    {
+        return RPCCall(strMethod, params, PBAAS_USERPASS, PBAAS_PORT, PBAAS_HOST, timeout);
+    }
     return UniValue(UniValue::VNULL);
 }
 
+std::vector<UniValue> RPCCallRootBatch(const std::vector<std::pair<std::string, UniValue>> &calls, int timeout)
+{
+    if (GetRootRPCEndpoint())
+    {
+        return RPCCallBatch(calls, PBAAS_USERPASS, PBAAS_PORT, PBAAS_HOST, timeout);
+    }
+    return std::vector<UniValue>(calls.size(), NullUniValue);
+}
+
 UniValue CCrossChainRPCData::ToUniValue() const
 {
     UniValue obj(UniValue::VOBJ);
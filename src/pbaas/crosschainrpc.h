@@ -23,6 +23,7 @@
 #include "boost/algorithm/string.hpp"
 #include "pbaas/vdxf.h"
 #include "utilstrencodings.h"
+#include "sync.h"
 
 static const int DEFAULT_RPC_TIMEOUT=900;
 static const uint32_t PBAAS_VERSION = 1;
@@ -129,6 +130,83 @@ public:
     }
 };
 
+// latency and failure counters for one pooled cross-chain RPC endpoint
+class CRPCEndpointStats
+{
+public:
+    uint64_t requests;                  // individual JSON-RPC requests, including those inside batches
+    uint64_t httpRequests;              // HTTP round trips
+    uint64_t batches;                   // HTTP round trips that carried a batch
+    uint64_t failures;                  // round trips that failed at the connection or HTTP level
+    uint64_t retries;                   // round trips retried on a fresh connection after a stale keep-alive
+    uint64_t connectionsOpened;
+    uint64_t inFlight;
+    int64_t totalMicros;
+    int64_t maxMicros;
+    int64_t lastMicros;
+
+    CRPCEndpointStats() : requests(0), httpRequests(0), batches(0), failures(0), retries(0), connectionsOpened(0),
+                          inFlight(0), totalMicros(0), maxMicros(0), lastMicros(0) {}
+
+    UniValue ToUniValue() const;
+};
+
+class CRPCPooledConnection;
+
+// Keeps persistent, keep-alive HTTP connections to each cross-chain RPC endpoint, identified by
+// host, port and credentials, so that notary, import and merge mining calls do not pay for a new
+// event base, TCP connection and auth header on every request. Each connection has its own event
+// base and is used by one caller at a time, so concurrent callers to the same endpoint each get
+// their own connection and may have requests in flight simultaneously.
+class CRPCClientPool
+{
+public:
+    enum {
+        MAX_IDLE_CONNECTIONS_PER_ENDPOINT = 8,
+        MAX_IDLE_SECONDS = 20                   // below the default -rpcservertimeout, so the server rarely closes first
+    };
+
+    typedef std::tuple<std::string, int, std::string> CEndpointKey;
+
+    CRPCClientPool();
+    ~CRPCClientPool();
+
+    // returns the full reply object, including result, error and id
+    UniValue Call(const std::string &strMethod,
+                  const UniValue &params,
+                  const std::string &credentials,
+                  int port,
+                  const std::string &host,
+                  int timeout=DEFAULT_RPC_TIMEOUT);
+
+    // sends all calls as one JSON-RPC batch and returns one reply object per call, in call order
+    std::vector<UniValue> CallBatch(const std::vector<std::pair<std::string, UniValue>> &calls,
+                                    const std::string &credentials,
+                                    int port,
+                                    const std::string &host,
+                                    int timeout=DEFAULT_RPC_TIMEOUT);
+
+    CRPCEndpointStats GetStats(const std::string &host, int port, const std::string &credentials) const;
+    UniValue GetStats() const;
+
+    // true for read only methods, which are sent again on a new connection if a reused connection fails
+    static bool IsRetriable(const std::string &strMethod);
+
+    // closes all idle connections
+    void Clear();
+
+private:
+    mutable CCriticalSection cs;
+    std::map<CEndpointKey, std::vector<CRPCPooledConnection *>> idleConnections;
+    std::map<CEndpointKey, CRPCEndpointStats> endpointStats;
+
+    CRPCPooledConnection *Acquire(const CEndpointKey &key, int timeout, bool fresh);
+    void Release(const CEndpointKey &key, CRPCPooledConnection *pConnection, bool reusable);
+    std::string Post(const CEndpointKey &key, const std::string &strRequest, int timeout, bool isBatch, int64_t nRequests, bool retriable);
+};
+
+extern CRPCClientPool rpcClientPool;
+
 // credentials for now are "user:password"
 UniValue RPCCall(const std::string& strMethod,
                  const UniValue& params,
@@ -137,8 +215,17 @@ UniValue RPCCall(const std::string& strMethod,
                  const std::string host="127.0.0.1",
                  int timeout=DEFAULT_RPC_TIMEOUT);
 
+std::vector<UniValue> RPCCallBatch(const std::vector<std::pair<std::string, UniValue>> &calls,
+                                   const std::string credentials="user:pass",
+                                   int port=27486,
+                                   const std::string host="127.0.0.1",
+                                   int timeout=DEFAULT_RPC_TIMEOUT);
+
 UniValue RPCCallRoot(const std::string& strMethod, const UniValue& params, int timeout=DEFAULT_RPC_TIMEOUT);
 
+// sends all calls to the root chain in one JSON-RPC batch, returns null replies if there is no root chain endpoint
+std::vector<UniValue> RPCCallRootBatch(const std::vector<std::pair<std::string, UniValue>> &calls, int timeout=DEFAULT_RPC_TIMEOUT);
+
 class CNodeData
 {
 public:
@@ -0,0 +1,237 @@
+/********************************************************************
+ * (C) 2023 The Verus developers
+ *
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ *
+ * Typed PBaaS events of connected and disconnected blocks.
+ *
+ */
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "util.h"
+#include "pbaas/notarization.h"
+#include "pbaas/events.h"
+
+#include <algorithm>
+
+const char *CPBaaSEvent::TypeName(int type)
+{
+    switch (type)
+    {
+        case EVENT_IDENTITY:
+            return "identity";
+        case EVENT_CURRENCYSTATE:
+            return "currencystate";
+        case EVENT_EXPORT:
+            return "export";
+        case EVENT_IMPORT:
+            return "import";
+        case EVENT_RESERVETRANSFER:
+            return "reservetransfer";
+        case EVENT_NOTARIZATION:
+            return "notarization";
+    }
+    return NULL;
+}
+
+void GetBlockPBaaSEvents(const CBlock &block, const CBlockIndex *pindex, bool fConnected, std::vector<CPBaaSEvent> &events)
+{
+    size_t firstEvent = events.size();
+    int32_t nHeight = pindex->GetHeight();
+    uint256 hashBlock = pindex->GetBlockHash();
+
+    for (auto &tx : block.vtx)
+    {
+        uint256 txid;
+        for (int i = 0; i < tx.vout.size(); i++)
+        {
+            COptCCParams p;
+            if (!tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) ||
+                !p.IsValid() ||
+                p.version < COptCCParams::VERSION_V2 ||
+                !p.vData.size())
+            {
+                continue;
+            }
+
+            int type = CPBaaSEvent::EVENT_INVALID;
+            std::vector<unsigned char> vchData;
+            switch (p.evalCode)
+            {
+                case EVAL_IDENTITY_PRIMARY:
+                    type = CPBaaSEvent::EVENT_IDENTITY;
+                    break;
+
+                case EVAL_CURRENCYSTATE:
+                    type = CPBaaSEvent::EVENT_CURRENCYSTATE;
+                    break;
+
+                case EVAL_CROSSCHAIN_EXPORT:
+                    type = CPBaaSEvent::EVENT_EXPORT;
+                    break;
+
+                case EVAL_CROSSCHAIN_IMPORT:
+                    type = CPBaaSEvent::EVENT_IMPORT;
+                    break;
+
+                case EVAL_RESERVE_TRANSFER:
+                    type = CPBaaSEvent::EVENT_RESERVETRANSFER;
+                    break;
+
+                case EVAL_EARNEDNOTARIZATION:
+                case EVAL_ACCEPTEDNOTARIZATION:
+                {
+                    // fractional and other currencies change state through notarizations on this chain
+                    CPBaaSNotarization notarization(p.vData[0]);
+                    if (notarization.IsValid() && notarization.currencyState.IsValid())
+                    {
+                        type = CPBaaSEvent::EVENT_CURRENCYSTATE;
+                        vchData = ::AsVector(notarization.currencyState);
+                    }
+                    break;
+                }
+
+                case EVAL_FINALIZE_NOTARIZATION:
+                {
+                    CObjectFinalization finalization(p.vData[0]);
+                    if (finalization.IsValid() && finalization.IsConfirmed())
+                    {
+                        type = CPBaaSEvent::EVENT_NOTARIZATION;
+                    }
+                    break;
+                }
+            }
+
+            if (type == CPBaaSEvent::EVENT_INVALID)
+            {
+                continue;
+            }
+            if (txid.IsNull())
+            {
+                txid = tx.GetHash();
+            }
+            events.push_back(CPBaaSEvent(type, fConnected, nHeight, hashBlock, txid, i, vchData.size() ? vchData : p.vData[0]));
+        }
+    }
+
+    if (!fConnected)
+    {
+        std::reverse(events.begin() + firstEvent, events.end());
+    }
+}
+
+CPBaaSEventQueue::CPBaaSEventQueue(const PublishFunction &publishFunc) :
+    publish(publishFunc), nDropped(0), fStop(false)
+{
+    for (int i = 0; i <= CPBaaSEvent::EVENT_LAST; i++)
+    {
+        nNextSequence[i] = 0;
+    }
+}
+
+CPBaaSEventQueue::~CPBaaSEventQueue()
+{
+    Stop();
+}
+
+void CPBaaSEventQueue::Start()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (!thread.joinable())
+    {
+        fStop = false;
+        thread = boost::thread(&CPBaaSEventQueue::ThreadPublish, this);
+    }
+}
+
+void CPBaaSEventQueue::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+    }
+    condWork.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+    if (queue.size())
+    {
+        LogPrint("pbaas", "Dropped %u unpublished PBaaS events at shutdown\n", queue.size());
+        queue.clear();
+    }
+}
+
+void CPBaaSEventQueue::PushBlock(const CBlock &block, const CBlockIndex *pindex, bool fConnected)
+{
+    std::vector<CPBaaSEvent> events;
+    GetBlockPBaaSEvents(block, pindex, fConnected, events);
+    PushEvents(events);
+}
+
+void CPBaaSEventQueue::PushEvents(std::vector<CPBaaSEvent> &events)
+{
+    if (!events.size())
+    {
+        return;
+    }
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        for (auto &oneEvent : events)
+        {
+            if (!oneEvent.IsValid())
+            {
+                continue;
+            }
+            oneEvent.nSequence = nNextSequence[oneEvent.nType]++;
+            if (queue.size() < MAX_QUEUED_EVENTS)
+            {
+                queue.push_back(oneEvent);
+            }
+            else if (!nDropped++)
+            {
+                LogPrintf("PBaaS event queue is full, dropping events from %s sequence %lu\n", CPBaaSEvent::TypeName(oneEvent.nType), oneEvent.nSequence);
+            }
+        }
+    }
+    condWork.notify_one();
+}
+
+uint64_t CPBaaSEventQueue::GetNextSequence(int type) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return (type > CPBaaSEvent::EVENT_INVALID && type <= CPBaaSEvent::EVENT_LAST) ? nNextSequence[type] : 0;
+}
+
+void CPBaaSEventQueue::ThreadPublish()
+{
+    RenameThread("verus-pbaasevt");
+
+    std::vector<CPBaaSEvent> batch;
+    while (true)
+    {
+        batch.clear();
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fStop && queue.empty())
+            {
+                condWork.wait(lock);
+            }
+            if (fStop)
+            {
+                return;
+            }
+            size_t batchSize = queue.size() < MAX_BATCH_EVENTS ? queue.size() : MAX_BATCH_EVENTS;
+            batch.assign(queue.begin(), queue.begin() + batchSize);
+            queue.erase(queue.begin(), queue.begin() + batchSize);
+            if (nDropped && queue.empty())
+            {
+                LogPrintf("PBaaS event queue dropped %lu events\n", nDropped);
+                nDropped = 0;
+            }
+        }
+        publish(batch);
+    }
+}
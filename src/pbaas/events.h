@@ -0,0 +1,126 @@
+/********************************************************************
+ * (C) 2023 The Verus developers
+ *
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ *
+ * Typed PBaaS events of connected and disconnected blocks, for the ZMQ
+ * and AMQP notifiers, so that bridges, explorers and wallets can follow
+ * identities, currency states, exports, imports, reserve transfers and
+ * notarizations without polling RPCs.
+ *
+ */
+
+#ifndef PBAAS_EVENTS_H
+#define PBAAS_EVENTS_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+class CBlock;
+class CBlockIndex;
+
+// one PBaaS object in an output of a block that was connected to or disconnected from the chain
+class CPBaaSEvent
+{
+public:
+    enum EEventType {
+        EVENT_INVALID = 0,
+        EVENT_IDENTITY = 1,                 // identity definition or update, CIdentity
+        EVENT_CURRENCYSTATE = 2,            // currency state output or the currency state of a notarization, CCoinbaseCurrencyState
+        EVENT_EXPORT = 3,                   // CCrossChainExport
+        EVENT_IMPORT = 4,                   // CCrossChainImport
+        EVENT_RESERVETRANSFER = 5,          // CReserveTransfer
+        EVENT_NOTARIZATION = 6,             // confirmed notarization finalization, CObjectFinalization
+        EVENT_LAST = EVENT_NOTARIZATION
+    };
+
+    uint64_t nSequence;                     // counts up by one for each event of its type, including those of disconnected blocks
+    uint8_t nType;
+    bool fConnected;                        // false when the block holding the object was disconnected
+    int32_t nHeight;
+    uint256 hashBlock;
+    uint256 txid;
+    int32_t nOut;
+    std::vector<unsigned char> vchData;     // the object, serialized as it is on chain
+
+    CPBaaSEvent() : nSequence(0), nType(EVENT_INVALID), fConnected(false), nHeight(0), nOut(-1) {}
+
+    CPBaaSEvent(uint8_t type, bool connected, int32_t height, const uint256 &blockHash, const uint256 &txHash, int32_t outNum, const std::vector<unsigned char> &data) :
+        nSequence(0), nType(type), fConnected(connected), nHeight(height), hashBlock(blockHash), txid(txHash), nOut(outNum), vchData(data) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nSequence);
+        READWRITE(nType);
+        READWRITE(fConnected);
+        READWRITE(nHeight);
+        READWRITE(hashBlock);
+        READWRITE(txid);
+        READWRITE(nOut);
+        READWRITE(vchData);
+    }
+
+    bool IsValid() const
+    {
+        return nType > EVENT_INVALID && nType <= EVENT_LAST;
+    }
+
+    // name of the event type, which is also its notification topic, or NULL if it is invalid
+    static const char *TypeName(int type);
+};
+
+// appends the events of a block, in block order if it was connected and in reverse order if it was disconnected,
+// so that a subscriber can undo the events of each disconnected block in the order they arrive
+void GetBlockPBaaSEvents(const CBlock &block, const CBlockIndex *pindex, bool fConnected, std::vector<CPBaaSEvent> &events);
+
+// Numbers the events of connected and disconnected blocks on the validation thread, with a sequence per type, since each
+// type is a topic of its own that subscribers may follow alone, and hands them in batches to a publish function on a
+// thread of its own, so that a slow subscriber or broker never holds up validation
+class CPBaaSEventQueue
+{
+public:
+    typedef std::function<void (const std::vector<CPBaaSEvent> &)> PublishFunction;
+
+    static const size_t MAX_QUEUED_EVENTS = 100000;
+    static const size_t MAX_BATCH_EVENTS = 1000;
+
+    CPBaaSEventQueue(const PublishFunction &publishFunc);
+    ~CPBaaSEventQueue();
+
+    void Start();
+
+    // stops the publish thread, dropping what is not published yet
+    void Stop();
+
+    // numbers and queues the events of a block without waiting, events that do not fit in the queue are dropped,
+    // which subscribers see as a gap in the sequence of their type
+    void PushBlock(const CBlock &block, const CBlockIndex *pindex, bool fConnected);
+
+    // numbers and queues events as if they were from one block
+    void PushEvents(std::vector<CPBaaSEvent> &events);
+
+    uint64_t GetNextSequence(int type) const;
+
+private:
+    PublishFunction publish;
+    mutable boost::mutex mutex;
+    boost::condition_variable condWork;
+    std::deque<CPBaaSEvent> queue;
+    uint64_t nNextSequence[CPBaaSEvent::EVENT_LAST + 1];
+    uint64_t nDropped;
+    bool fStop;
+    boost::thread thread;
+
+    void ThreadPublish();
+};
+
+#endif // PBAAS_EVENTS_H
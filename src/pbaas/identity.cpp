@@ -342,10 +342,21 @@ CIdentity::LookupIdentities(const CIdentityID &nameID,
     std::vector<CAddressIndexDbEntry> identityIndex;
     std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> mempoolIdentities;
 
+    // with the identity history index, all revisions of an identity are one range scan that needs no transactions
+    std::vector<CIdentityRevisionDbEntry> indexedRevisions;
+    bool useRevisionIndex = fIdHistoryIndex && !_indexKeys.size();
+
     std::vector<std::pair<uint160, int32_t>> indexVec;
     for (auto &oneKey : indexKeys)
     {
-        GetAddressIndex(oneKey, CScript::P2IDX, identityIndex, gteHeight, lteHeight);
+        if (useRevisionIndex)
+        {
+            GetIdentityRevisions(nameID, indexedRevisions, gteHeight, lteHeight);
+        }
+        else
+        {
+            GetAddressIndex(oneKey, CScript::P2IDX, identityIndex, gteHeight, lteHeight);
+        }
         indexVec.push_back({oneKey, CScript::P2IDX});
     }
 
@@ -377,8 +388,35 @@ CIdentity::LookupIdentities(const CIdentityID &nameID,
     }
 
     // order from first that spends unknown to last that has no spender
-    if (identityIndex.size() || mempoolIdentities.size())
+    if (indexedRevisions.size() || identityIndex.size() || mempoolIdentities.size())
     {
+        for (auto &oneRevision : indexedRevisions)
+        {
+            CTransaction identityTx;
+            CIdentity identity(oneRevision.second.identity);
+            uint256 blkHash;
+            BlockMap::iterator oneBlockIt;
+            if (!identity.IsValid() ||
+                (oneBlockIt = mapBlockIndex.find(oneRevision.second.blockHash)) == mapBlockIndex.end() ||
+                !chainActive.Contains(oneBlockIt->second) ||
+                (getProofs && !myGetTransaction(oneRevision.first.txhash, identityTx, blkHash)))
+            {
+                LogPrintf("Invalid identity transaction %s:\n", oneRevision.first.txhash.GetHex().c_str());
+                return retVal;
+            }
+            retVal.push_back({identity,
+                              oneBlockIt->first,
+                              oneBlockIt->second->GetHeight(),
+                              CUTXORef(oneRevision.first.txhash, oneRevision.first.voutNum),
+                              getProofs ?
+                                CPartialTransactionProof(identityTx,
+                                                        std::vector<int>(),
+                                                        std::vector<int>({(int)oneRevision.first.voutNum}),
+                                                        oneBlockIt->second,
+                                                        proofHeight) :
+                                CPartialTransactionProof()});
+        }
+
         std::vector<int> toRemove;
         std::map<COutPoint, int> outputMap;
         for (int i = 0; i < identityIndex.size(); i++)
@@ -390,6 +428,28 @@ CIdentity::LookupIdentities(const CIdentityID &nameID,
                 uint256 blkHash;
                 COptCCParams fP;
                 BlockMap::iterator oneBlockIt;
+                CIdentityRevisionValue indexedRevision;
+
+                // when the revision is indexed, only proofs need the transaction
+                if (fIdHistoryIndex &&
+                    !getProofs &&
+                    GetIdentityRevision(CIdentityRevisionKey(nameID,
+                                                             identityIndex[i].first.blockHeight,
+                                                             identityIndex[i].first.txindex,
+                                                             identityIndex[i].first.txhash,
+                                                             identityIndex[i].first.index), indexedRevision) &&
+                    (identity = CIdentity(indexedRevision.identity)).IsValid() &&
+                    (oneBlockIt = mapBlockIndex.find(indexedRevision.blockHash)) != mapBlockIndex.end() &&
+                    chainActive.Contains(oneBlockIt->second))
+                {
+                    retVal.push_back({identity,
+                                      oneBlockIt->first,
+                                      oneBlockIt->second->GetHeight(),
+                                      CUTXORef(identityIndex[i].first.txhash, identityIndex[i].first.index),
+                                      CPartialTransactionProof()});
+                    continue;
+                }
+
                 if (!myGetTransaction(identityIndex[i].first.txhash, identityTx, blkHash) ||
                     (oneBlockIt = mapBlockIndex.find(blkHash)) == mapBlockIndex.end() ||
                     !chainActive.Contains(oneBlockIt->second) ||
@@ -450,6 +510,63 @@ CIdentity::LookupIdentities(const CIdentityID &nameID,
     return retVal;
 }
 
+// applies one serialized content multimap remove action to an aggregated content multimap
+static void ApplyContentMultiMapRemove(const std::vector<unsigned char> &removeData,
+                                       std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> &retMap)
+{
+    CDataStream ss(removeData, PROTOCOL_VERSION, SER_DISK);
+    uint160 objTypeKey;
+    uint32_t serVersion;
+    size_t serSize;
+    CContentMultiMapRemove removeAction;
+
+    ss >> objTypeKey;
+    ss >> VARINT(serVersion);
+    ss >> VARINT(serSize);
+    ss >> removeAction;
+
+    if (objTypeKey != CVDXF_Data::ContentMultiMapRemoveKey() ||
+        !removeAction.IsValid())
+    {
+        return;
+    }
+    if (removeAction.action == removeAction.ACTION_CLEAR_MAP)
+    {
+        retMap.clear();
+    }
+    else if (removeAction.action == removeAction.ACTION_REMOVE_ALL_KEY)
+    {
+        retMap.erase(removeAction.entryKey);
+    }
+    else if (removeAction.action == removeAction.ACTION_REMOVE_ALL_KEYVALUE || removeAction.action == removeAction.ACTION_REMOVE_ONE_KEYVALUE)
+    {
+        // all other actions require referencing specific keyed elements
+        auto removeItemRange = retMap.equal_range(removeAction.entryKey);
+        std::vector<std::multimap<uint160,
+                        std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>::iterator>
+            itemsToRemove;
+        for (auto removeItemCursor = removeItemRange.first; removeItemCursor != removeItemRange.second; removeItemCursor++)
+        {
+            CNativeHashWriter hw;
+            hw.write((char *)&(std::get<0>(removeItemCursor->second)[0]), std::get<0>(removeItemCursor->second).size());
+
+            uint256 hashVal = hw.GetHash();
+            if (hashVal == removeAction.valueHash)
+            {
+                itemsToRemove.push_back(removeItemCursor);
+                if (removeAction.action == removeAction.ACTION_REMOVE_ONE_KEYVALUE)
+                {
+                    break;
+                }
+            }
+        }
+        for (auto &oneCursor : itemsToRemove)
+        {
+            retMap.erase(oneCursor);
+        }
+    }
+}
+
 std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>
 CIdentity::GetAggregatedIdentityMultimap(const uint160 &idID,
                                          uint32_t startHeight,
@@ -488,57 +605,7 @@ CIdentity::GetAggregatedIdentityMultimap(const uint160 &idID,
             if (it->first == CVDXF_Data::ContentMultiMapRemoveKey() &&
                 it->second.size())
             {
-                CDataStream ss(it->second, PROTOCOL_VERSION, SER_DISK);
-                uint160 objTypeKey;
-                uint32_t serVersion;
-                size_t serSize;
-                CContentMultiMapRemove removeAction;
-
-                ss >> objTypeKey;
-                ss >> VARINT(serVersion);
-                ss >> VARINT(serSize);
-                ss >> removeAction;
-
-                if (objTypeKey != CVDXF_Data::ContentMultiMapRemoveKey() ||
-                    !removeAction.IsValid())
-                {
-                    continue;
-                }
-                if (removeAction.action == removeAction.ACTION_CLEAR_MAP)
-                {
-                    retMap.clear();
-                }
-                else if (removeAction.action == removeAction.ACTION_REMOVE_ALL_KEY)
-                {
-                    retMap.erase(removeAction.entryKey);
-                }
-                else if (removeAction.action == removeAction.ACTION_REMOVE_ALL_KEYVALUE || removeAction.action == removeAction.ACTION_REMOVE_ONE_KEYVALUE)
-                {
-                    // all other actions require referencing specific keyed elements
-                    auto removeItemRange = retMap.equal_range(removeAction.entryKey);
-                    std::vector<std::multimap<uint160,
-                                    std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>::iterator>
-                        itemsToRemove;
-                    for (auto removeItemCursor = removeItemRange.first; removeItemCursor != removeItemRange.second; removeItemCursor++)
-                    {
-                        CNativeHashWriter hw;
-                        hw.write((char *)&(std::get<0>(removeItemCursor->second)[0]), std::get<0>(removeItemCursor->second).size());
-
-                        uint256 hashVal = hw.GetHash();
-                        if (hashVal == removeAction.valueHash)
-                        {
-                            itemsToRemove.push_back(removeItemCursor);
-                            if (removeAction.action == removeAction.ACTION_REMOVE_ONE_KEYVALUE)
-                            {
-                                break;
-                            }
-                        }
-                    }
-                    for (auto &oneCursor : itemsToRemove)
-                    {
-                        retMap.erase(oneCursor);
-                    }
-                }
+                ApplyContentMultiMapRemove(it->second, retMap);
             }
             else
             {
@@ -560,6 +627,66 @@ CIdentity::GetIdentityContentByKey(const uint160 &idID,
                                    bool keepDeleted,
                                    bool sorted)
 {
+    // the content index has every confirmed entry of this key and every remove action in order, so unless the
+    // mempool or proofs are needed, aggregating them does not need any identity or transaction
+    if (fIdHistoryIndex && !checkMempool && !getProofs)
+    {
+        if (!endHeight || endHeight == -1)
+        {
+            endHeight = chainActive.Height();
+        }
+
+        std::vector<CIdentityContentDbEntry> keyEntries, removeEntries;
+        if (!GetIdentityContent(idID, vdxfKey, keyEntries, startHeight, endHeight) ||
+            !GetIdentityContent(idID, CVDXF_Data::ContentMultiMapRemoveKey(), removeEntries, startHeight, endHeight))
+        {
+            return std::vector<std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>();
+        }
+
+        std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> aggregatedMap;
+        auto keyIt = keyEntries.begin();
+        auto removeIt = removeEntries.begin();
+        while (keyIt != keyEntries.end() || removeIt != removeEntries.end())
+        {
+            if (removeIt == removeEntries.end() ||
+                (keyIt != keyEntries.end() && keyIt->first.AppliesBefore(removeIt->first)))
+            {
+                BlockMap::iterator blockIt = mapBlockIndex.find(keyIt->second.blockHash);
+                if (blockIt != mapBlockIndex.end() && chainActive.Contains(blockIt->second))
+                {
+                    aggregatedMap.insert(std::make_pair(vdxfKey,
+                                                        std::make_tuple(keyIt->second.data,
+                                                                        keyIt->second.blockHash,
+                                                                        keyIt->first.blockHeight,
+                                                                        CUTXORef(keyIt->first.txhash, keyIt->first.voutNum),
+                                                                        CPartialTransactionProof())));
+                }
+                keyIt++;
+            }
+            else
+            {
+                // when keeping deleted entries, only removals in revisions that also update this key apply
+                bool applies = !keepDeleted ||
+                               std::find_if(keyEntries.begin(), keyEntries.end(), [&removeIt](const CIdentityContentDbEntry &oneEntry)
+                               {
+                                   return oneEntry.first.SameRevision(removeIt->first);
+                               }) != keyEntries.end();
+                if (applies && removeIt->second.data.size())
+                {
+                    ApplyContentMultiMapRemove(removeIt->second.data, aggregatedMap);
+                }
+                removeIt++;
+            }
+        }
+
+        std::vector<std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> retVec;
+        for (auto &oneEntry : aggregatedMap)
+        {
+            retVec.push_back(oneEntry.second);
+        }
+        return retVec;
+    }
+
     uint160 lookupKey = CCrossChainRPCData::GetConditionID(CVDXF_Data::MultiMapKey(), CCrossChainRPCData::GetConditionID(vdxfKey, idID));
 
     if (LogAcceptCategory("oracles"))
@@ -4423,6 +4423,142 @@ CPBaaSNotarization IsValidPrimaryChainEvidence(const CCurrencyDefinition &extern
     return retVal;
 }
 
+CNotarizationDataCache NotarizationDataCache;
+
+bool CNotarizationDataCache::Get(const uint160 &currencyID,
+                                 bool enhancedOrder,
+                                 CChainNotarizationData &notarizationData,
+                                 std::vector<std::pair<CTransaction, uint256>> &txesAndBlocks) const
+{
+    LOCK(cs);
+    auto it = entries.find(currencyID);
+    if (it == entries.end() || it->second.enhancedOrder != enhancedOrder)
+    {
+        return false;
+    }
+    notarizationData = it->second.notarizationData;
+    txesAndBlocks = it->second.txesAndBlocks;
+    return true;
+}
+
+void CNotarizationDataCache::Put(const uint160 &currencyID,
+                                 uint64_t generation,
+                                 bool enhancedOrder,
+                                 const CChainNotarizationData &notarizationData,
+                                 const std::vector<std::pair<CTransaction, uint256>> &txesAndBlocks)
+{
+    LOCK(cs);
+    auto genIt = generations.find(currencyID);
+    if ((genIt == generations.end() ? 0 : genIt->second) != generation)
+    {
+        return;
+    }
+    CEntry &entry = entries[currencyID];
+    entry.generation = generation;
+    entry.enhancedOrder = enhancedOrder;
+    entry.notarizationData = notarizationData;
+    entry.txesAndBlocks = txesAndBlocks;
+}
+
+uint64_t CNotarizationDataCache::GetGeneration(const uint160 &currencyID) const
+{
+    LOCK(cs);
+    auto genIt = generations.find(currencyID);
+    return genIt == generations.end() ? 0 : genIt->second;
+}
+
+void CNotarizationDataCache::Invalidate(const std::set<uint160> &currencyIDs)
+{
+    LOCK(cs);
+    for (auto &oneCurrencyID : currencyIDs)
+    {
+        entries.erase(oneCurrencyID);
+        generations[oneCurrencyID] = nextGeneration++;
+    }
+}
+
+void CNotarizationDataCache::Clear()
+{
+    LOCK(cs);
+    for (auto &oneEntry : entries)
+    {
+        generations[oneEntry.first] = nextGeneration++;
+    }
+    entries.clear();
+}
+
+void CNotarizationDataCache::GetNotarizationCurrencies(const CTxOut &output, std::set<uint160> &currencyIDs)
+{
+    COptCCParams p;
+    if (!(output.scriptPubKey.IsPayToCryptoCondition(p) && p.IsValid() && p.vData.size()))
+    {
+        return;
+    }
+    if (p.evalCode == EVAL_FINALIZE_NOTARIZATION)
+    {
+        CObjectFinalization of(p.vData[0]);
+        if (of.IsValid())
+        {
+            currencyIDs.insert(of.currencyID);
+        }
+    }
+    else if (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION)
+    {
+        CPBaaSNotarization notarization(p.vData[0]);
+        if (notarization.IsValid())
+        {
+            currencyIDs.insert(notarization.currencyID);
+        }
+    }
+}
+
+void CNotarizationDataCache::GetNotarizationCurrencies(const CTransaction &tx, const CCoinsViewCache &view, std::set<uint160> &currencyIDs)
+{
+    for (auto &oneOut : tx.vout)
+    {
+        GetNotarizationCurrencies(oneOut, currencyIDs);
+    }
+    if (!tx.IsCoinBase())
+    {
+        for (auto &oneIn : tx.vin)
+        {
+            const CCoins *coins = view.AccessCoins(oneIn.prevout.hash);
+            if (coins && coins->IsAvailable(oneIn.prevout.n))
+            {
+                GetNotarizationCurrencies(coins->vout[oneIn.prevout.n], currencyIDs);
+            }
+        }
+    }
+}
+
+void CNotarizationDataCache::AddMempoolTransaction(const CTransaction &tx, const CCoinsViewCache &view)
+{
+    std::set<uint160> currencyIDs;
+    GetNotarizationCurrencies(tx, view, currencyIDs);
+    if (currencyIDs.size())
+    {
+        Invalidate(currencyIDs);
+        LOCK(cs);
+        mempoolCurrencies[tx.GetHash()] = currencyIDs;
+    }
+}
+
+void CNotarizationDataCache::RemoveMempoolTransaction(const uint256 &txid)
+{
+    std::set<uint160> currencyIDs;
+    {
+        LOCK(cs);
+        auto it = mempoolCurrencies.find(txid);
+        if (it == mempoolCurrencies.end())
+        {
+            return;
+        }
+        currencyIDs = it->second;
+        mempoolCurrencies.erase(it);
+    }
+    Invalidate(currencyIDs);
+}
+
 // gets the last confirmed notarization for a particular currency confirmed on or before a particular height
 // do not use for heights more than 10 blocks before the tip
 std::tuple<uint32_t, CUTXORef, CPBaaSNotarization> GetLastConfirmedNotarization(uint160 curID, uint32_t height)
@@ -5674,7 +5810,7 @@ bool ProvePosBlock(uint32_t lastProofRootHeight, const CBlockIndex *pindex, CNot
     }
 
     uint32_t heightAfterFirstEntropy = firstHeight + 1;
-    if (!(CConstVerusSolutionVector::Version(chainActive[heightAfterFirstEntropy]->nSolution.nSolution()) >= CActivationHeight::ACTIVATE_PBAAS))
+    if (!(chainActive[heightAfterFirstEntropy]->GetSolutionVersion() >= CActivationHeight::ACTIVATE_PBAAS))
     {
         heightAfterFirstEntropy++;
     }
@@ -587,6 +587,60 @@ CPBaaSNotarization IsValidPrimaryChainEvidence(const CCurrencyDefinition &extern
                                                uint32_t height,
                                                uint256 *pOptEntropyHash=nullptr, // only needed when responding to a challenge
                                                const CProofRoot &challengeProofRoot=CProofRoot(CProofRoot::TYPE_PBAAS, CProofRoot::VERSION_INVALID));
+// Keeps the cross-chain notarization data of each currency that GetNotarizationData last built, until a block or
+// mempool transaction that creates or spends a notarization or finalization of that currency makes it stale.
+// A currency's generation changes each time its entry is invalidated, so that data built from a state that changed
+// while it was being built is never stored.
+class CNotarizationDataCache
+{
+public:
+    struct CEntry
+    {
+        uint64_t generation;
+        bool enhancedOrder;             // notarization order rule the data was built with
+        CChainNotarizationData notarizationData;
+        std::vector<std::pair<CTransaction, uint256>> txesAndBlocks;
+    };
+
+    CNotarizationDataCache() : nextGeneration(1) {}
+
+    // returns a copy of the currency's data if it is current
+    bool Get(const uint160 &currencyID,
+             bool enhancedOrder,
+             CChainNotarizationData &notarizationData,
+             std::vector<std::pair<CTransaction, uint256>> &txesAndBlocks) const;
+
+    // stores data that was built starting at generation
+    void Put(const uint160 &currencyID,
+             uint64_t generation,
+             bool enhancedOrder,
+             const CChainNotarizationData &notarizationData,
+             const std::vector<std::pair<CTransaction, uint256>> &txesAndBlocks);
+
+    uint64_t GetGeneration(const uint160 &currencyID) const;
+
+    void Invalidate(const std::set<uint160> &currencyIDs);
+    void Clear();
+
+    // adds the currency of an output if it is a notarization or finalization
+    static void GetNotarizationCurrencies(const CTxOut &output, std::set<uint160> &currencyIDs);
+
+    // adds the currencies of the notarizations and finalizations a transaction creates or spends, from the view
+    static void GetNotarizationCurrencies(const CTransaction &tx, const CCoinsViewCache &view, std::set<uint160> &currencyIDs);
+
+    void AddMempoolTransaction(const CTransaction &tx, const CCoinsViewCache &view);
+    void RemoveMempoolTransaction(const uint256 &txid);
+
+protected:
+    mutable CCriticalSection cs;
+    uint64_t nextGeneration;
+    std::map<uint160, CEntry> entries;
+    std::map<uint160, uint64_t> generations;
+    std::map<uint256, std::set<uint160>> mempoolCurrencies;
+};
+
+extern CNotarizationDataCache NotarizationDataCache;
+
 extern string PBAAS_HOST, PBAAS_USERPASS, ASSETCHAINS_RPCHOST, ASSETCHAINS_RPCCREDENTIALS;;
 extern int32_t PBAAS_PORT;
 
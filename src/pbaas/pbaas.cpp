@@ -6198,13 +6198,23 @@ bool CConnectedChains::CheckVerusPBaaSAvailable()
         try
         {
             UniValue params(UniValue::VARR);
-            chainInfo = find_value(RPCCallRoot("getinfo", params), "result");
+            std::vector<std::pair<std::string, UniValue>> calls({{"getinfo", params}});
+            bool isLaunchSystem = FirstNotaryChain().chainDefinition.launchSystemID == ASSETCHAINS_CHAINID;
+            if (!isLaunchSystem)
+            {
+                UniValue currencyParams(UniValue::VARR);
+                currencyParams.push_back(EncodeDestination(CIdentityID(FirstNotaryChain().chainDefinition.GetID())));
+                calls.push_back(std::make_pair(std::string("getcurrency"), currencyParams));
+            }
+
+            // get the chain info and definition in one round trip
+            std::vector<UniValue> replies = RPCCallRootBatch(calls);
+            chainInfo = find_value(replies[0], "result");
             if (!chainInfo.isNull())
             {
-                params.push_back(EncodeDestination(CIdentityID(FirstNotaryChain().chainDefinition.GetID())));
-                chainDef = FirstNotaryChain().chainDefinition.launchSystemID == ASSETCHAINS_CHAINID ?
+                chainDef = isLaunchSystem ?
                             FirstNotaryChain().chainDefinition.ToUniValue() :
-                            find_value(RPCCallRoot("getcurrency", params), "result");
+                            find_value(replies[1], "result");
 
                 if (!chainDef.isNull() && CheckVerusPBaaSAvailable(chainInfo, chainDef))
                 {
@@ -9,6 +9,7 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "mmr.h"
 
 extern uint32_t ASSETCHAINS_ALGO, ASSETCHAINS_VERUSHASH;
@@ -482,15 +483,19 @@ uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
     bool mutated = false;
     for (int nSize = leaves.size(); nSize > 1; nSize = (nSize + 1) / 2)
     {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+        if (nSize % 2 == 0 && vMerkleTree[j+nSize-2] == vMerkleTree[j+nSize-1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        // Each pair of adjacent hashes is one 64-byte input, so all full pairs of a level are
+        // hashed with a single multi-way call.
+        size_t nPairs = nSize / 2;
+        size_t nLevelStart = vMerkleTree.size();
+        vMerkleTree.resize(nLevelStart + (nSize + 1) / 2);
+        SHA256D64(vMerkleTree[nLevelStart].begin(), vMerkleTree[j].begin(), nPairs);
+        if (nSize % 2 == 1) {
+            vMerkleTree[nLevelStart + nPairs] = Hash(BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]),
+                                                     BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]));
         }
         j += nSize;
     }
@@ -598,10 +603,13 @@ BlockMMRange CBlock::BuildBlockMMRTree(const uint256 &entropyHash) const
     // at some point, we should replace the txid with a fully hashed transaction tree and deprecate standard
     // txids altogether.
     BlockMMRange mmRange(BlockMMRNodeLayer(*this));
+    std::vector<CDefaultMMRNode> leaves;
+    leaves.reserve(vtx.size());
     for (auto &tx : vtx)
     {
-        mmRange.Add(tx.GetDefaultMMRNode());
+        leaves.push_back(tx.GetDefaultMMRNode());
     }
+    mmRange.Add(leaves);
 
     if (IsAdvancedHeader() != 0)
     {
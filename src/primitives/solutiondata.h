@@ -679,6 +679,12 @@ class CCompactSolutionVector
             return tVch;
         }
 
+        // heap bytes held by this vector, used to account for memory released from the block index
+        size_t DynamicMemoryUsage() const
+        {
+            return vch.capacity() + ofsAndRepeat.capacity() * sizeof(std::pair<uint16_t,uint16_t>);
+        }
+
         static bool IsCompressionOn()
         {
             return useCompression;
@@ -208,14 +208,17 @@ uint256 CMutableTransaction::GetHash() const
 
 CTransactionMap::CTransactionMap(const CTransaction &tx)
 {
-    // hash header information and put in MMR and map, followed by all elements in order
+    // hash header information and put in MMR and map, followed by all elements in order. the leaves are
+    // collected first, so the MMR layers above them are built with one multi-node hash call per layer.
     int32_t idx = 0;
     CTransactionHeader txHeader(tx);
+    std::vector<CDefaultMMRNode> leaves;
+    leaves.reserve(txHeader.nVins * 2 + txHeader.nVouts + txHeader.nShieldedSpends + txHeader.nShieldedOutputs + 1);
 
     {
         auto hw = CDefaultMMRNode::GetHashWriter();
         hw << txHeader;
-        transactionMMR.Add(CDefaultMMRNode(hw.GetHash()));
+        leaves.push_back(CDefaultMMRNode(hw.GetHash()));
         elementHashMap[std::make_pair((int16_t)CTransactionHeader::TX_HEADER, (int16_t)0)] = idx++;
     }
 
@@ -226,12 +229,12 @@ CTransactionMap::CTransactionMap(const CTransaction &tx)
 
         auto hw = CDefaultMMRNode::GetHashWriter();
         hw << txHeader;
-        transactionMMR.Add(CDefaultMMRNode(hw.GetHash()));
+        leaves.push_back(CDefaultMMRNode(hw.GetHash()));
         elementHashMap[std::make_pair((int16_t)CTransactionHeader::TX_HEADER, (int16_t)1)] = idx++;
 
         hw = CDefaultMMRNode::GetHashWriter();
         hw << txHeader;
-        transactionMMR.Add(CDefaultMMRNode(hw.GetHash()));
+        leaves.push_back(CDefaultMMRNode(hw.GetHash()));
         elementHashMap[std::make_pair((int16_t)CTransactionHeader::TX_HEADER, (int16_t)2)] = idx++;
     }
 
@@ -239,21 +242,21 @@ CTransactionMap::CTransactionMap(const CTransaction &tx)
         auto hw = CDefaultMMRNode::GetHashWriter();
         hw << tx.vin[n].prevout;
         hw << tx.vin[n].nSequence;
-        transactionMMR.Add(CDefaultMMRNode(hw.GetHash()));
+        leaves.push_back(CDefaultMMRNode(hw.GetHash()));
         elementHashMap[std::make_pair((int16_t)CTransactionHeader::TX_PREVOUTSEQ, (int16_t)n)] = idx++;
     }
 
     for (unsigned int n = 0; n < txHeader.nVins; n++) {
         auto hw = CDefaultMMRNode::GetHashWriter();
         hw << tx.vin[n];
-        transactionMMR.Add(CDefaultMMRNode(hw.GetHash()));
+        leaves.push_back(CDefaultMMRNode(hw.GetHash()));
         elementHashMap[std::make_pair((int16_t)CTransactionHeader::TX_SIGNATURE, (int16_t)n)] = idx++;
     }
 
     for (unsigned int n = 0; n < txHeader.nVouts; n++) {
         auto hw = CDefaultMMRNode::GetHashWriter();
         hw << tx.vout[n];
-        transactionMMR.Add(CDefaultMMRNode(hw.GetHash()));
+        leaves.push_back(CDefaultMMRNode(hw.GetHash()));
         elementHashMap[std::make_pair((int16_t)CTransactionHeader::TX_OUTPUT, (int16_t)n)] = idx++;
     }
 
@@ -264,16 +267,18 @@ CTransactionMap::CTransactionMap(const CTransaction &tx)
         hw << tx.vShieldedSpend[n].nullifier;
         hw << tx.vShieldedSpend[n].rk;
         hw << tx.vShieldedSpend[n].zkproof;
-        transactionMMR.Add(CDefaultMMRNode(hw.GetHash()));
+        leaves.push_back(CDefaultMMRNode(hw.GetHash()));
         elementHashMap[std::make_pair((int16_t)CTransactionHeader::TX_SHIELDEDSPEND, (int16_t)n)] = idx++;
     }
 
     for (unsigned int n = 0; n < txHeader.nShieldedOutputs; n++) {
         auto hw = CDefaultMMRNode::GetHashWriter();
         hw << tx.vShieldedOutput[n];
-        transactionMMR.Add(CDefaultMMRNode(hw.GetHash()));
+        leaves.push_back(CDefaultMMRNode(hw.GetHash()));
         elementHashMap[std::make_pair((int16_t)CTransactionHeader::TX_SHIELDEDOUTPUT, (int16_t)n)] = idx++;
     }
+
+    transactionMMR.Add(leaves);
 }
 
 void CTransaction::UpdateHash() const
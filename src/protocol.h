@@ -154,6 +154,9 @@ enum {
     // Nodes may always request a MSG_FILTERED_BLOCK in a getdata, however,
     // MSG_FILTERED_BLOCK should not appear in any invs except as a part of getdata.
     MSG_FILTERED_BLOCK,
+    // MSG_CMPCT_BLOCK is only used in getdata, to peers at or above COMPACT_BLOCKS_VERSION,
+    // and is answered with a "cmpctblock" message for recent blocks or a "block" message otherwise.
+    MSG_CMPCT_BLOCK,
 };
 
 #endif // BITCOIN_PROTOCOL_H
@@ -6,11 +6,13 @@
 #include "amount.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "crosschain.h"
 #include "base58.h"
 #include "consensus/validation.h"
 #include "cc/eval.h"
+#include "jsonstream.h"
 #include "key_io.h"
 #include "main.h"
 #include "primitives/transaction.h"
@@ -147,7 +149,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.push_back(Pair("finalsaplingroot", blockindex->hashFinalSaplingRoot.GetHex()));
     result.push_back(Pair("time", (int64_t)blockindex->nTime));
     result.push_back(Pair("nonce", blockindex->nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(blockindex->nSolution.nSolution())));
+    result.push_back(Pair("solution", HexStr(blockindex->GetSolution())));
     result.push_back(Pair("bits", strprintf("%08x", blockindex->nBits)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->chainPower.chainWork.GetHex()));
@@ -391,6 +393,52 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     return result;
 }
 
+/**
+ * Writes the same JSON as blockToJSON(block, blockindex, txDetails), followed by the members of extra, holding only
+ * one transaction's JSON at a time. cs_main is taken for the block's own fields and then for each transaction in
+ * turn, rather than for the whole block.
+ */
+void WriteBlockJSON(CJSONStreamWriter& writer, const CBlock& block, const CBlockIndex* blockindex, bool txDetails, const UniValue& extra)
+{
+    UniValue blockUni;
+    {
+        LOCK(cs_main);
+        blockUni = blockToJSON(block, blockindex, false);
+    }
+    if (extra.isObject())
+    {
+        blockUni.pushKVs(extra);
+    }
+
+    const std::vector<std::string> &keys = blockUni.getKeys();
+    const std::vector<UniValue> &values = blockUni.getValues();
+
+    writer.BeginObject();
+    for (int i = 0; i < keys.size(); i++)
+    {
+        if (txDetails && keys[i] == "tx")
+        {
+            writer.Key(keys[i]);
+            writer.BeginArray();
+            for (auto &tx : block.vtx)
+            {
+                UniValue objTx(UniValue::VOBJ);
+                {
+                    LOCK(cs_main);
+                    TxToJSON(tx, uint256(), objTx);
+                }
+                writer.Value(objTx);
+            }
+            writer.EndArray();
+        }
+        else
+        {
+            writer.KeyValue(keys[i], values[i]);
+        }
+    }
+    writer.EndObject();
+}
+
 UniValue getblockcount(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -476,12 +524,16 @@ UniValue mempoolToJSON(bool fVerbose = false)
             info.push_back(Pair("height", (int)e.GetHeight()));
             info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
             info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
-            const CTransaction& tx = e.GetTx();
+            info.push_back(Pair("descendantcount", e.GetCountWithDescendants()));
+            info.push_back(Pair("descendantsize", e.GetSizeWithDescendants()));
+            info.push_back(Pair("descendantfees", e.GetModFeesWithDescendants()));
+            info.push_back(Pair("ancestorcount", e.GetCountWithAncestors()));
+            info.push_back(Pair("ancestorsize", e.GetSizeWithAncestors()));
+            info.push_back(Pair("ancestorfees", e.GetModFeesWithAncestors()));
             set<string> setDepends;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
+            BOOST_FOREACH(const CTxMemPool::txiter& parentIt, mempool.GetMemPoolParents(mempool.mapTx.find(hash)))
             {
-                if (mempool.exists(txin.prevout.hash))
-                    setDepends.insert(txin.prevout.hash.ToString());
+                setDepends.insert(parentIt->GetTx().GetHash().ToString());
             }
 
             UniValue depends(UniValue::VARR);
@@ -530,6 +582,12 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             "    \"height\" : n,           (numeric) block height when transaction entered pool\n"
             "    \"startingpriority\" : n, (numeric) priority when transaction entered pool\n"
             "    \"currentpriority\" : n,  (numeric) transaction priority now\n"
+            "    \"descendantcount\" : n,  (numeric) number of in-mempool descendant transactions (including this one)\n"
+            "    \"descendantsize\" : n,   (numeric) size of in-mempool descendants (including this one)\n"
+            "    \"descendantfees\" : n,   (numeric) fees in satoshis, including prioritisation, of in-mempool descendants (including this one)\n"
+            "    \"ancestorcount\" : n,    (numeric) number of in-mempool ancestor transactions (including this one)\n"
+            "    \"ancestorsize\" : n,     (numeric) size of in-mempool ancestors (including this one)\n"
+            "    \"ancestorfees\" : n,     (numeric) fees in satoshis, including prioritisation, of in-mempool ancestors (including this one)\n"
             "    \"depends\" : [           (array) unconfirmed transactions used as inputs for this transaction\n"
             "        \"transactionid\",    (string) parent transaction id\n"
             "       ... ]\n"
@@ -1135,15 +1193,30 @@ UniValue getblock(const UniValue& params, bool fHelp)
         std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
         return strHex;
     }
-    UniValue blockUni = blockToJSON(block, pblockindex, verbosity >= 2);
+
+    UniValue proofUni(UniValue::VOBJ);
     if (pblockindex)
     {
-        blockUni.pushKV("proofroot", CProofRoot::GetProofRoot(pblockindex->GetHeight()).ToUniValue());
+        proofUni.pushKV("proofroot", CProofRoot::GetProofRoot(pblockindex->GetHeight()).ToUniValue());
         if (CConstVerusSolutionVector::GetVersionByHeight(pblockindex->GetHeight()) >= CActivationHeight::ACTIVATE_PBAAS_HEADER)
         {
-            blockUni.pushKV("prevmmrroot", block.GetPrevMMRRoot().GetHex());
+            proofUni.pushKV("prevmmrroot", block.GetPrevMMRRoot().GetHex());
         }
     }
+
+    // with transaction details, a block can be far larger as JSON than on disk, so when called for an HTTP
+    // request, it is written straight into the reply, one transaction at a time, after cs_main is released
+    if (verbosity >= 2 && RPCCanStreamResult())
+    {
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(std::move(block));
+        RPCStreamResult([pblock, pblockindex, proofUni](CJSONStreamWriter& writer) {
+            WriteBlockJSON(writer, *pblock, pblockindex, true, proofUni);
+        });
+        return NullUniValue;
+    }
+
+    UniValue blockUni = blockToJSON(block, pblockindex, verbosity >= 2);
+    blockUni.pushKVs(proofUni);
     return blockUni;
 }
 
@@ -1185,6 +1258,45 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+UniValue getdbstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns read and block cache counters of each open database since startup.\n"
+            "Bulk scans do not fill the block cache, so a low cache hit rate during point reads means the cache is too small.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"name\",         (string) the database directory\n"
+            "    \"reads\": n,             (numeric) point reads\n"
+            "    \"readsfound\": n,        (numeric) point reads that found their key\n"
+            "    \"cachelookups\": n,      (numeric) block cache lookups\n"
+            "    \"cachehits\": n,         (numeric) block cache lookups that did not read from disk\n"
+            "    \"cachehitrate\": x.xxx   (numeric) cachehits / cachelookups\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (const CDBStats &stats : GetDBStats())
+    {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("name", stats.name));
+        entry.push_back(Pair("reads", (uint64_t)stats.reads));
+        entry.push_back(Pair("readsfound", (uint64_t)stats.readsFound));
+        entry.push_back(Pair("cachelookups", (uint64_t)stats.cacheLookups));
+        entry.push_back(Pair("cachehits", (uint64_t)stats.cacheHits));
+        entry.push_back(Pair("cachehitrate", stats.cacheLookups ? (double)stats.cacheHits / stats.cacheLookups : 0.0));
+        ret.push_back(entry);
+    }
+    return ret;
+}
+
 #include "komodo_defs.h"
 #include "komodo_structs.h"
 
@@ -1591,6 +1703,63 @@ UniValue verifychain(const UniValue& params, bool fHelp)
     return CVerifyDB().VerifyDB(Params(), pcoinsTip, nCheckLevel, nCheckDepth);
 }
 
+UniValue dumpsnapshot(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumpsnapshot \"filename\"\n"
+            "\nWrites a snapshot of the chain at the current tip, which a new node can start from with -loadsnapshot.\n"
+            "The snapshot has the block index, coins, indexes and unspent transactions, but no other blocks.\n"
+            "Overwriting an existing file is not permitted.\n"
+            "\nArguments:\n"
+            "1. \"filename\"    (string, required) The filename, saved in folder set by verusd -exportdir option\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"path\": \"xxxx\",          (string) The full path of the snapshot\n"
+            "  \"version\": n,              (numeric) snapshot format version\n"
+            "  \"height\": n,               (numeric) height of the last block of the snapshot\n"
+            "  \"blockhash\": \"xxxx\",     (string) hash of the last block of the snapshot\n"
+            "  \"mmrroot\": \"xxxx\",       (string) root of the chain MMR at that block\n"
+            "  \"contenthash\": \"xxxx\",   (string) content hash to pin or to pass to -snapshothash\n"
+            "  \"records\": { ... }         (object) number of records of each section\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumpsnapshot", "\"snapshot\"")
+            + HelpExampleRpc("dumpsnapshot", "\"snapshot\"")
+        );
+
+    boost::filesystem::path exportdir;
+    try {
+        exportdir = GetExportDir();
+    } catch (const std::runtime_error& e) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, e.what());
+    }
+    if (exportdir.empty()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Cannot write a snapshot until the verusd -exportdir option has been set");
+    }
+
+    std::string unclean = params[0].get_str();
+    std::string clean = SanitizeFilename(unclean);
+    if (clean.compare(unclean) != 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Filename is invalid as only alphanumeric characters are allowed.  Try '%s' instead.", clean));
+    }
+    boost::filesystem::path exportfilepath = exportdir / clean;
+
+    if (boost::filesystem::exists(exportfilepath)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot overwrite existing file " + exportfilepath.string());
+    }
+
+    CChainSnapshotHeader header;
+    std::string strError;
+    if (!DumpChainSnapshot(Params(), exportfilepath, header, strError)) {
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+    }
+
+    UniValue result = header.ToUniValue();
+    result.pushKV("path", exportfilepath.string());
+    return result;
+}
+
 /** Implementation of IsSuperMajority with better feedback */
 static UniValue SoftForkMajorityDesc(int minVersion, CBlockIndex* pindex, int nRequired, const Consensus::Params& consensusParams)
 {
@@ -1668,11 +1837,13 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
             "  \"chainid\": \"xxxx\",      (string) blockchain ID (i-address of the native blockchain currency)\n"
             "  \"blocks\": xxxxxx,         (numeric) the current number of blocks processed in the server\n"
             "  \"headers\": xxxxxx,        (numeric) the current number of headers we have validated\n"
+            "  \"headerssyncrate\": x.xx,  (numeric) new headers added per second over the last minute\n"
             "  \"bestblockhash\": \"...\", (string) the hash of the currently best block\n"
             "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
             "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
             "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
             "  \"size_on_disk\": xxxxxx,       (numeric) the estimated size of the block and undo files on disk\n"
+            "  \"snapshotheight\": xxxxxx,  (numeric) height of the chain snapshot this node was started from, 0 if none\n"
             "  \"commitments\": xxxxxx,    (numeric) the current number of note commitments in the commitment tree\n"
             "  \"softforks\": [            (array) status of softforks in progress\n"
             "     {\n"
@@ -1719,6 +1890,7 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("chainid",               EncodeDestination(CIdentityID(ConnectedChains.ThisChain().GetID()))));
     obj.push_back(Pair("blocks",                (int)chainActive.Height()));
     obj.push_back(Pair("headers",               pindexBestHeader ? pindexBestHeader->GetHeight() : -1));
+    obj.push_back(Pair("headerssyncrate",       GetHeaderSyncRate()));
     obj.push_back(Pair("bestblockhash",         chainActive.LastTip()->GetBlockHash().GetHex()));
     obj.push_back(Pair("difficulty",            (double)GetNetworkDifficulty()));
     obj.push_back(Pair("verificationprogress",  progress));
@@ -1729,6 +1901,7 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     }
     obj.push_back(Pair("pruned",                fPruneMode));
     obj.push_back(Pair("size_on_disk",          CalculateCurrentUsage()));
+    obj.push_back(Pair("snapshotheight",        nSnapshotHeight));
 
     SproutMerkleTree tree;
     pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), tree);
@@ -2009,7 +2182,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "clearrawmempool",        &clearrawmempool,        true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
+    { "blockchain",         "dumpsnapshot",           &dumpsnapshot,           true  },
 
     // insightexplorer
     { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
@@ -109,7 +109,12 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "    \"inflight\": [\n"
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
-            "    ]\n"
+            "    ],\n"
+            "    \"blockdownloaddepth\": n,   (numeric) The number of blocks we keep in flight from this peer, adapted to its delivery rate\n"
+            "    \"blockdownloadrate\": n,    (numeric) The rate in bytes per second at which this peer has recently delivered requested blocks\n"
+            "    \"blocklatency\": n,         (numeric) The recent time in seconds from requesting a block of this peer to receiving it\n"
+            "    \"blocksdownloaded\": n,     (numeric) The number of requested blocks this peer has delivered\n"
+            "    \"blocksreassigned\": n,     (numeric) The number of blocks requested from another peer instead, because this one was stalling\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -161,6 +166,11 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
                 heights.push_back(height);
             }
             obj.push_back(Pair("inflight", heights));
+            obj.push_back(Pair("blockdownloaddepth", statestats.nBlockDownloadDepth));
+            obj.push_back(Pair("blockdownloadrate", statestats.dBlockBytesPerSecond));
+            obj.push_back(Pair("blocklatency", statestats.nBlockLatency / 1e6));
+            obj.push_back(Pair("blocksdownloaded", statestats.nBlocksDownloaded));
+            obj.push_back(Pair("blocksreassigned", statestats.nBlocksReassigned));
         }
         obj.pushKV("addr_processed", stats.m_addr_processed);
         obj.pushKV("addr_rate_limited", stats.m_addr_rate_limited);
@@ -35,6 +35,7 @@
 #include <univalue.h>
 
 #include "rpc/pbaasrpc.h"
+#include "pbaas/converters.h"
 #include "coincontrol.h"
 
 #include <librustzcash.h>
@@ -1904,6 +1905,36 @@ bool GetOpRetChainOffer(const CTransaction &postedTx,
 
 LRUCache<std::tuple<int, uint256, uint160>, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>> OfferMapCache(50);
 
+// Gets the offer outputs of all open offers of or for a currency or ID from the offer index, ordered by what they
+// are in exchange for and then by price, in the same form as the address index returns the outputs at offer keys
+bool GetIndexedOfferOutputs(const uint160 &currencyOrId, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> &offerOutputs)
+{
+    std::vector<COfferIndexDbEntry> offers;
+    uint32_t height = chainActive.Height();
+
+    if (!GetOfferIndex(COfferIndexKey::OFFERED, currencyOrId, uint160(), height, offers))
+    {
+        return false;
+    }
+    std::vector<COfferIndexDbEntry> offersFor;
+    if (!GetOfferIndex(COfferIndexKey::REQUESTED, currencyOrId, uint160(), height, offersFor))
+    {
+        return false;
+    }
+    offers.insert(offers.end(), offersFor.begin(), offersFor.end());
+
+    std::set<uint256> offerTxes;
+    for (auto &oneOffer : offers)
+    {
+        if (offerTxes.insert(oneOffer.second.offerOutput.hash).second)
+        {
+            offerOutputs.push_back(std::make_pair(CAddressUnspentKey(CScript::P2PKH, currencyOrId, oneOffer.second.offerOutput.hash, oneOffer.second.offerOutput.n),
+                                                  CAddressUnspentValue(0, CScript(), oneOffer.second.blockHeight)));
+        }
+    }
+    return true;
+}
+
 // Get internal, compact form of an offer map (on-chain order book) for a currency or ID
 //
 // This will retrieve all offers for the indicated currency in all currencies or as specified in the filter,
@@ -1958,21 +1989,27 @@ GetOfferMap(const uint160 &currencyOrId, bool isCurrency, bool acceptOnlyCurrenc
     std::multimap<std::pair<uint160, CAmount>, UniValue> uniSellToCurrency;
 
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputOffers;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs = OfferMapCache.Get({(int)isCurrency, chainActive[height]->GetBlockHash(), currencyOrId});
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
 
     //printf("%s: looking up keys: %s, %s\n", __func__, EncodeDestination(CKeyID(lookupID)).c_str(), EncodeDestination(CKeyID(lookupForID)).c_str());
 
-    if (!unspentOutputs.size() &&
-        (!GetAddressUnspent(lookupID, CScript::P2PKH, unspentOutputOffers) ||
-         !GetAddressUnspent(lookupForID, CScript::P2PKH, unspentOutputs) ||
-         (!unspentOutputOffers.size() && !unspentOutputs.size())))
+    // with an offer index, only open offers are candidates and they need no cache
+    if (fOfferIndex ?
+            (!GetIndexedOfferOutputs(currencyOrId, unspentOutputs) || !unspentOutputs.size()) :
+            (!(unspentOutputs = OfferMapCache.Get({(int)isCurrency, chainActive[height]->GetBlockHash(), currencyOrId})).size() &&
+             (!GetAddressUnspent(lookupID, CScript::P2PKH, unspentOutputOffers) ||
+              !GetAddressUnspent(lookupForID, CScript::P2PKH, unspentOutputs) ||
+              (!unspentOutputOffers.size() && !unspentOutputs.size()))))
     {
         return retVal;
     }
     else
     {
-        unspentOutputs.insert(unspentOutputs.end(), unspentOutputOffers.begin(), unspentOutputOffers.end());
-        OfferMapCache.Put({(int)isCurrency, chainActive[height]->GetBlockHash(), currencyOrId}, unspentOutputs);
+        if (!fOfferIndex)
+        {
+            unspentOutputs.insert(unspentOutputs.end(), unspentOutputOffers.begin(), unspentOutputOffers.end());
+            OfferMapCache.Put({(int)isCurrency, chainActive[height]->GetBlockHash(), currencyOrId}, unspentOutputs);
+        }
 
         for (auto &oneOffer : unspentOutputs)
         {
@@ -4360,8 +4397,6 @@ void CChainNotarizationData::SetBestChain(const CCurrencyDefinition &fromChainDe
 }
 
 // since same chain notarizations are always up to date, we only need to cache cross-chain notarizations that require analysis
-LRUCache<std::pair<uint160, uint256>, std::pair<CChainNotarizationData, std::vector<std::pair<CTransaction, uint256>>>> crossChainNotarizationDataCache(100, 0.3);
-
 bool GetNotarizationData(const uint160 &currencyID,
                          CChainNotarizationData &notarizationData,
                          std::vector<std::pair<CTransaction, uint256>> *optionalTxOut,
@@ -4387,6 +4422,7 @@ bool GetNotarizationData(const uint160 &currencyID,
     // if we are being asked for a notarization of the current chain, we make one
     uint32_t height = chainActive.Height();
     bool cacheFound = false;
+    uint64_t cacheGeneration = NotarizationDataCache.GetGeneration(currencyID);
 
     if ((IsVerusActive() || height == 0) && currencyID == ASSETCHAINS_CHAINID)
     {
@@ -4426,14 +4462,13 @@ bool GetNotarizationData(const uint160 &currencyID,
     }
     else if (!chainDef.IsToken() && height > 0)
     {
-        std::pair<CChainNotarizationData, std::vector<std::pair<CTransaction, uint256>>> cacheResult;
-        if (crossChainNotarizationDataCache.Get(std::make_pair(currencyID, chainActive[height]->GetBlockHash()), cacheResult))
+        std::vector<std::pair<CTransaction, uint256>> cachedTxes;
+        if (NotarizationDataCache.Get(currencyID, ConnectedChains.IsEnhancedNotarizationOrder(height), notarizationData, cachedTxes))
         {
             cacheFound = true;
-            notarizationData = cacheResult.first;
             if (notarizationData.IsValid())
             {
-                *optionalTxOut = cacheResult.second;
+                *optionalTxOut = cachedTxes;
             }
             if (!pCounterEvidence && !pEvidence)
             {
@@ -4666,7 +4701,7 @@ bool GetNotarizationData(const uint160 &currencyID,
             notarizationData.SetBestChain(chainDef, *optionalTxOut);
         }
 
-        crossChainNotarizationDataCache.Put(std::make_pair(currencyID, chainActive.LastTip()->GetBlockHash()), std::make_pair(notarizationData, *optionalTxOut));
+        NotarizationDataCache.Put(currencyID, cacheGeneration, ConnectedChains.IsEnhancedNotarizationOrder(height), notarizationData, *optionalTxOut);
     }
 
     // TODO: POST HARDENING - add an LRU cache
@@ -4783,6 +4818,42 @@ bool GetNotarizationData(const uint160 &currencyID,
     return notarizationData.IsValid() && notarizationData.vtx.size() != 0;
 }
 
+UniValue getrpcclientstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+    {
+        throw runtime_error(
+            "getrpcclientstats\n"
+            "\nReturns connection and latency statistics for the pooled RPC connections this daemon keeps open\n"
+            "to notary, root and merge mined chain daemons.\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"host\" : \"xxx\",              (string) endpoint host\n"
+            "    \"port\" : n,                    (numeric) endpoint port\n"
+            "    \"requests\" : n,                (numeric) JSON-RPC requests sent, including those inside batches\n"
+            "    \"httprequests\" : n,            (numeric) HTTP round trips\n"
+            "    \"batches\" : n,                 (numeric) HTTP round trips that carried a batch request\n"
+            "    \"failures\" : n,                (numeric) round trips that failed at the connection or HTTP level\n"
+            "    \"retries\" : n,                 (numeric) read only round trips retried after a closed keep-alive connection\n"
+            "    \"connectionsopened\" : n,       (numeric) connections opened to this endpoint\n"
+            "    \"inflight\" : n,                (numeric) round trips currently in progress\n"
+            "    \"averagelatencyms\" : n,        (numeric) average round trip time in milliseconds\n"
+            "    \"maxlatencyms\" : n,            (numeric) longest round trip time in milliseconds\n"
+            "    \"lastlatencyms\" : n,           (numeric) most recent round trip time in milliseconds\n"
+            "    \"idleconnections\" : n          (numeric) open connections waiting for reuse\n"
+            "  }, ...\n"
+            "]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcclientstats", "")
+            + HelpExampleRpc("getrpcclientstats", "")
+        );
+    }
+    return rpcClientPool.GetStats();
+}
+
 UniValue getnotarizationdata(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 3)
@@ -7306,6 +7377,133 @@ UniValue estimateconversion(const UniValue& params, bool fHelp)
     return retVal;
 }
 
+UniValue getconversionroutes(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+    {
+        throw runtime_error(
+            "getconversionroutes '{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n,\"maxhops\":n,\"maxroutes\":n,\"slippage\":n,\"includepending\":bool}'\n"
+            "\nFinds the best routes of one or more conversions through currency converters on this chain from one currency to\n"
+            "another. Each route is estimated from the latest confirmed state of each converter it uses, priced together with\n"
+            "conversions waiting in the mempool, and with conversion fees, but without the transfer fees of each step.\n"
+
+            "\nArguments:\n"
+            "1. {\n"
+            "      \"currency\": \"name\"       (string, optional)  Name of the source currency, defaults to native of chain\n"
+            "      \"convertto\": \"name\"      (string, required)  Currency to convert to\n"
+            "      \"amount\": n                (numeric, required) Amount of source currency to convert\n"
+            "      \"maxhops\": n               (numeric, optional) Most conversions in a route, 1 to 3 (default=3)\n"
+            "      \"maxroutes\": n             (numeric, optional) Most routes to return (default=5)\n"
+            "      \"slippage\": n              (numeric, optional) Max slippage of a route, 0.01 = 1 percent (default=no limit)\n"
+            "      \"includepending\": bool     (bool, optional)    Price with conversions in the mempool (default=true)\n"
+            "   }\n"
+
+            "\nResult:\n"
+            "   [\n"
+            "      {\n"
+            "         \"inputcurrencyid\": iaddress          i-address of source currency\n"
+            "         \"inputamount\": value                 amount of source currency\n"
+            "         \"outputcurrencyid\": iaddress         i-address of destination currency\n"
+            "         \"estimatedcurrencyout\": value        estimated amount out in destination currency\n"
+            "         \"slippage\": value                    slippage of the route relative to spot prices\n"
+            "         \"hops\": [                            each conversion in order\n"
+            "            {\n"
+            "               \"converter\": iaddress          converter of this conversion\n"
+            "               \"inputcurrencyid\": iaddress\n"
+            "               \"inputamount\": value\n"
+            "               \"conversionfee\": value         conversion fee in input currency\n"
+            "               \"outputcurrencyid\": iaddress\n"
+            "               \"estimatedcurrencyout\": value\n"
+            "               \"spotcurrencyout\": value       amount out with fees at the last price, without slippage\n"
+            "            }, ...\n"
+            "         ]\n"
+            "      }, ...\n"
+            "   ]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getconversionroutes", "'{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n}'")
+            + HelpExampleRpc("getconversionroutes", "'{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n}'")
+        );
+    }
+
+    CheckPBaaSAPIsValid();
+
+    if (!params[0].isObject())
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Parameter must be a JSON object.");
+    }
+
+    std::string currencyStr = uni_get_str(find_value(params[0], "currency"));
+    std::string convertToStr = uni_get_str(find_value(params[0], "convertto"));
+    CAmount amount = AmountFromValue(find_value(params[0], "amount"));
+    int maxHops = uni_get_int(find_value(params[0], "maxhops"), CConverterGraph::MAX_ROUTE_HOPS);
+    int maxRoutes = uni_get_int(find_value(params[0], "maxroutes"), 5);
+    CAmount maxSlippage = AmountFromValueNoErr(find_value(params[0], "slippage"));
+    bool includePending = uni_get_bool(find_value(params[0], "includepending"), true);
+
+    if (amount <= 0)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Amount to convert must be greater than 0");
+    }
+    if (maxHops < 1 || maxHops > CConverterGraph::MAX_ROUTE_HOPS)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "\"maxhops\" must be from 1 to " + std::to_string(CConverterGraph::MAX_ROUTE_HOPS));
+    }
+    if (maxRoutes < 1)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "\"maxroutes\" must be at least 1");
+    }
+    if (maxSlippage < 0)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "\"slippage\" must not be negative");
+    }
+
+    uint160 sourceCurrencyID, convertToCurrencyID;
+    uint32_t nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height();
+
+        if (currencyStr.empty())
+        {
+            sourceCurrencyID = ASSETCHAINS_CHAINID;
+        }
+        else if ((sourceCurrencyID = ValidateCurrencyName(currencyStr, true)).IsNull())
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "If source currency is specified, it must be valid.");
+        }
+        if (convertToStr.empty() || (convertToCurrencyID = ValidateCurrencyName(convertToStr, true)).IsNull())
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Must specify a valid \"convertto\" currency");
+        }
+        if (sourceCurrencyID == convertToCurrencyID)
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Source and \"convertto\" currency must be different");
+        }
+
+        // converters are only loaded once, then kept current as blocks are connected
+        if (!ConverterGraph.IsInitialized())
+        {
+            ConverterGraph.Initialize();
+        }
+    }
+
+    std::vector<CConversionRoute> routes = ConverterGraph.GetBestRoutes(sourceCurrencyID,
+                                                                        convertToCurrencyID,
+                                                                        amount,
+                                                                        maxHops,
+                                                                        maxRoutes,
+                                                                        maxSlippage,
+                                                                        includePending,
+                                                                        nHeight + 1);
+    UniValue ret(UniValue::VARR);
+    for (auto &oneRoute : routes)
+    {
+        ret.push_back(oneRoute.ToUniValue());
+    }
+    return ret;
+}
+
 bool find_utxos(const CTxDestination &fromtaddr_, std::vector<COutput> &t_inputs_)
 {
     std::set<CTxDestination> destinations;
@@ -9337,16 +9535,19 @@ UniValue IdOfferInfo(const CIdentity &identityOffer)
 
 UniValue getoffers(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() < 1 || params.size() > 3)
+    if (fHelp || params.size() < 1 || params.size() > 5)
     {
         throw runtime_error(
-            "getoffers \"currencyorid\" (iscurrency) (withtx)\n"
+            "getoffers \"currencyorid\" (iscurrency) (withtx) (start) (count)\n"
             "\nReturns all open offers for a specific currency or ID\n"
 
             "\nArguments\n"
             "1. \"currencyorid\"        (string, required) The currency or ID to check for offers, both sale and purchase\n"
             "2. \"iscurrency\"          (bool, optional)   default=false, if false, this looks for ID offers, if true, currencies\n"
             "3. \"withtx\"              (bool, optional)   default=false, if true, this returns serialized hex of the exchange transaction for signing\n"
+            "4. \"start\"               (int, optional)    default=0, number of offers to skip. with -offerindex, offers are in order of\n"
+            "                                             what they are exchanged for and then price\n"
+            "5. \"count\"               (int, optional)    default=0, if greater than 0, the maximum number of offers to return\n"
 
             "\nResult:\n"
             "all available offers for or in the indicated currency or ID are displayed\n"
@@ -9371,6 +9572,20 @@ UniValue getoffers(const UniValue& params, bool fHelp)
         withTx = uni_get_bool(params[2]);
     }
 
+    int64_t start = 0, count = 0;
+    if (params.size() > 3)
+    {
+        start = uni_get_int64(params[3]);
+    }
+    if (params.size() > 4)
+    {
+        count = uni_get_int64(params[4]);
+    }
+    if (start < 0 || count < 0)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "start and count must not be negative");
+    }
+
     uint160 lookupID, lookupForID;
 
     CCurrencyDefinition currencyDef;
@@ -9424,7 +9639,9 @@ UniValue getoffers(const UniValue& params, bool fHelp)
 
     //printf("%s: looking up keys: %s, %s\n", __func__, EncodeDestination(CKeyID(lookupID)).c_str(), EncodeDestination(CKeyID(lookupForID)).c_str());
 
-    if (!GetAddressUnspent(lookupID, CScript::P2PKH, unspentOutputOffers) || !GetAddressUnspent(lookupForID, CScript::P2PKH, unspentOutputs))
+    if (fOfferIndex ?
+            !GetIndexedOfferOutputs(currencyOrIdID, unspentOutputs) :
+            (!GetAddressUnspent(lookupID, CScript::P2PKH, unspentOutputOffers) || !GetAddressUnspent(lookupForID, CScript::P2PKH, unspentOutputs)))
     {
         return false;
     }
@@ -9433,6 +9650,20 @@ UniValue getoffers(const UniValue& params, bool fHelp)
         UniValue retVal(UniValue::VOBJ);
         unspentOutputs.insert(unspentOutputs.end(), unspentOutputOffers.begin(), unspentOutputOffers.end());
 
+        // only the requested page of offers is read and checked
+        if (start >= (int64_t)unspentOutputs.size())
+        {
+            unspentOutputs.clear();
+        }
+        else
+        {
+            unspentOutputs.erase(unspentOutputs.begin(), unspentOutputs.begin() + start);
+            if (count > 0 && count < (int64_t)unspentOutputs.size())
+            {
+                unspentOutputs.resize(count);
+            }
+        }
+
         for (auto &oneOffer : unspentOutputs)
         {
             CTransaction postedTx, offerTx, inputToOfferTx;
@@ -18003,6 +18234,7 @@ static const CRPCCommand commands[] =
     { "multichain",   "setcurrencytrust",             &setcurrencytrust,       true  },
     { "multichain",   "getcurrencytrust",             &getcurrencytrust,       true  },
     { "multichain",   "estimateconversion",           &estimateconversion,     true  },
+    { "multichain",   "getconversionroutes",          &getconversionroutes,    true  },
     { "marketplace",  "makeoffer",                    &makeoffer,              true  },
     { "marketplace",  "takeoffer",                    &takeoffer,              true  },
     { "marketplace",  "getoffers",                    &getoffers,              true  },
@@ -18014,6 +18246,7 @@ static const CRPCCommand commands[] =
     { "multichain",   "getcurrency",                  &getcurrency,            true  },
     { "multichain",   "getreservedeposits",           &getreservedeposits,     true  },
     { "multichain",   "getnotarizationdata",          &getnotarizationdata,    true  },
+    { "multichain",   "getrpcclientstats",            &getrpcclientstats,      true  },
     { "multichain",   "getlaunchinfo",                &getlaunchinfo,          true  },
     { "multichain",   "getbestproofroot",             &getbestproofroot,       true  },
     { "multichain",   "submitacceptednotarization",   &submitacceptednotarization, true },
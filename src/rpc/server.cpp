@@ -39,6 +39,9 @@ static bool fRPCNeedUnlocked = false;
 static std::string rpcWarmupStatus("RPC server started");
 static CCriticalSection cs_rpcWarmup;
 /* Timer-creating functions */
+static thread_local CRPCStreamScope *rpcStreamScope = nullptr;
+static thread_local int rpcCallDepth = 0;
+
 static std::vector<RPCTimerInterface*> timerInterfaces;
 /* Map of name to timer.
  * @note Can be changed to std::unique_ptr when C++11 */
@@ -736,6 +739,13 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    // commands called from within a command cannot stream their result
+    struct CCallDepth
+    {
+        CCallDepth() { rpcCallDepth++; }
+        ~CCallDepth() { rpcCallDepth--; }
+    } callDepth;
+
     try
     {
         // Execute
@@ -749,6 +759,27 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     g_rpcSignals.PostCommand(*pcmd);
 }
 
+CRPCStreamScope::CRPCStreamScope() : priorScope(rpcStreamScope)
+{
+    rpcStreamScope = this;
+}
+
+CRPCStreamScope::~CRPCStreamScope()
+{
+    rpcStreamScope = priorScope;
+}
+
+bool RPCCanStreamResult()
+{
+    return rpcStreamScope && rpcCallDepth == 1 && !rpcStreamScope->resultWriter;
+}
+
+void RPCStreamResult(const RPCResultWriter &writer)
+{
+    assert(RPCCanStreamResult());
+    rpcStreamScope->resultWriter = writer;
+}
+
 std::string HelpExampleCli(const std::string& methodname, const std::string& args)
 {
     return "> verus " + methodname + " " + args + "\n";
@@ -16,6 +16,8 @@
 #include <string>
 #include <memory>
 
+#include <functional>
+
 #include <boost/function.hpp>
 
 #include <univalue.h>
@@ -33,6 +35,7 @@ namespace RPCServer
 
 class CBlockIndex;
 class CNetAddr;
+class CJSONStreamWriter;
 
 class JSONRequest
 {
@@ -161,6 +164,29 @@ public:
 
 extern CRPCTable tableRPC;
 
+/** Writes the result of an RPC call straight into the reply, instead of it being returned as a UniValue */
+typedef std::function<void(CJSONStreamWriter&)> RPCResultWriter;
+
+/**
+ * While one of these is open on a thread, the RPC command called on that thread may pass a writer for its result
+ * to RPCStreamResult and return NullUniValue. Whoever opened the scope then runs the writer to send the result.
+ */
+class CRPCStreamScope
+{
+public:
+    RPCResultWriter resultWriter;
+
+    CRPCStreamScope();
+    ~CRPCStreamScope();
+
+private:
+    CRPCStreamScope *priorScope;
+};
+
+/** True if the RPC command being executed on this thread, and not one called from within it, can stream its result */
+bool RPCCanStreamResult();
+void RPCStreamResult(const RPCResultWriter &writer);
+
 /**
  * Utilities: convert hex-encoded Values
  * (throws error if not hex).
@@ -377,6 +403,7 @@ extern UniValue getblock(const UniValue& params, bool fHelp);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp);
 extern UniValue gettxout(const UniValue& params, bool fHelp);
 extern UniValue verifychain(const UniValue& params, bool fHelp);
+extern UniValue dumpsnapshot(const UniValue& params, bool fHelp);
 extern UniValue getchaintips(const UniValue& params, bool fHelp);
 extern UniValue z_gettreestate(const UniValue& params, bool fHelp);
 extern UniValue getchaintxstats(const UniValue& params, bool fHelp);
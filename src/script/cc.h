@@ -49,6 +49,20 @@ CC* CCNewHashedSecp256k1(CKeyID keyID);
 CC* CCNewThreshold(int t, std::vector<CC*> v);
 
 
+/*
+ * Keeps a crypto-condition arena open on this thread for its lifetime, so that the ASN.1
+ * structures of every condition and fulfillment read in the scope are released together
+ */
+class CCArenaScope
+{
+public:
+    CCArenaScope() { cc_arenaBegin(); }
+    ~CCArenaScope() { cc_arenaEnd(); }
+    CCArenaScope(const CCArenaScope&) = delete;
+    CCArenaScope& operator=(const CCArenaScope&) = delete;
+};
+
+
 /*
  * Turn a condition into a scriptPubKey or just the vector inside
  */
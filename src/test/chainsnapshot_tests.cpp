@@ -0,0 +1,118 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "chainsnapshot.h"
+#include "random.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost::filesystem;
+
+BOOST_FIXTURE_TEST_SUITE(chainsnapshot_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(chainsnapshot_roundtrip)
+{
+    path ph = temp_directory_path() / unique_path();
+
+    // values large enough that the records cross from one mapped window into the next
+    std::vector<std::pair<std::string, std::string>> records;
+    for (int i = 0; i < 80; i++)
+    {
+        std::string value(1 << 20, (char)i);
+        records.push_back(std::make_pair(std::string(1, 'c') + GetRandHash().GetHex(), value));
+    }
+    records.push_back(std::make_pair(std::string("empty"), std::string()));
+
+    CChainSnapshotHeader header;
+    header.hashGenesisBlock = GetRandHash();
+    header.hashBlock = GetRandHash();
+    header.nHeight = 1234;
+    header.hashMMRRoot = GetRandHash();
+    {
+        CChainSnapshotWriter writer(ph);
+        writer.WriteRecord(CChainSnapshotHeader::SECTION_BLOCKINDEX, "block", "index");
+        for (auto &record : records)
+        {
+            writer.WriteRecord(CChainSnapshotHeader::SECTION_CHAINSTATE, record.first, record.second);
+        }
+        // sections must not go back
+        BOOST_CHECK_THROW(writer.WriteRecord(CChainSnapshotHeader::SECTION_BLOCKINDEX, "block", "index"), std::logic_error);
+        writer.Finish(header);
+    }
+    BOOST_CHECK_EQUAL(header.nRecords[CChainSnapshotHeader::SECTION_BLOCKINDEX - 1], 1);
+    BOOST_CHECK_EQUAL(header.nRecords[CChainSnapshotHeader::SECTION_CHAINSTATE - 1], records.size());
+    BOOST_CHECK_EQUAL(header.nRecords[CChainSnapshotHeader::SECTION_TRANSACTIONS - 1], 0);
+    BOOST_CHECK_EQUAL(header.nRecords[CChainSnapshotHeader::SECTION_BLOCKS - 1], 0);
+
+    {
+        CChainSnapshotReader reader(ph);
+        CChainSnapshotHeader readHeader;
+        reader.ReadHeader(readHeader);
+        BOOST_CHECK_EQUAL(readHeader.nVersion, CChainSnapshotHeader::VERSION_CURRENT);
+        BOOST_CHECK(readHeader.hashGenesisBlock == header.hashGenesisBlock);
+        BOOST_CHECK(readHeader.hashBlock == header.hashBlock);
+        BOOST_CHECK_EQUAL(readHeader.nHeight, 1234);
+        BOOST_CHECK(readHeader.hashMMRRoot == header.hashMMRRoot);
+        BOOST_CHECK(readHeader.hashContent == header.hashContent);
+        BOOST_CHECK(reader.HashContent() == header.hashContent);
+
+        int section;
+        std::string key, value;
+        reader.ReadRecord(section, key, value);
+        BOOST_CHECK_EQUAL(section, CChainSnapshotHeader::SECTION_BLOCKINDEX);
+        BOOST_CHECK_EQUAL(key, "block");
+        BOOST_CHECK_EQUAL(value, "index");
+        for (auto &record : records)
+        {
+            reader.ReadRecord(section, key, value);
+            BOOST_CHECK_EQUAL(section, CChainSnapshotHeader::SECTION_CHAINSTATE);
+            BOOST_CHECK(key == record.first);
+            BOOST_CHECK(value == record.second);
+        }
+        BOOST_CHECK(reader.eof());
+        BOOST_CHECK_THROW(reader.ReadRecord(section, key, value), std::ios_base::failure);
+    }
+
+    // the same records give the same content hash, a changed byte does not
+    path ph2 = temp_directory_path() / unique_path();
+    {
+        CChainSnapshotHeader header2 = header;
+        CChainSnapshotWriter writer(ph2);
+        writer.WriteRecord(CChainSnapshotHeader::SECTION_BLOCKINDEX, "block", "index");
+        for (auto &record : records)
+        {
+            writer.WriteRecord(CChainSnapshotHeader::SECTION_CHAINSTATE, record.first, record.second);
+        }
+        writer.Finish(header2);
+        BOOST_CHECK(header2.hashContent == header.hashContent);
+    }
+    {
+        FILE *file = fopen(ph2.string().c_str(), "rb+");
+        BOOST_REQUIRE(file);
+        fseek(file, CChainSnapshotHeader::SERIALIZED_SIZE + 3, SEEK_SET);
+        fputc('X', file);
+        fclose(file);
+        CChainSnapshotReader reader(ph2);
+        BOOST_CHECK(reader.HashContent() != header.hashContent);
+    }
+
+    // anything else is not a snapshot
+    {
+        FILE *file = fopen(ph2.string().c_str(), "rb+");
+        BOOST_REQUIRE(file);
+        fputc('X', file);
+        fclose(file);
+        CChainSnapshotReader reader(ph2);
+        CChainSnapshotHeader readHeader;
+        BOOST_CHECK_THROW(reader.ReadHeader(readHeader), std::ios_base::failure);
+    }
+
+    remove(ph);
+    remove(ph2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1091,4 +1091,46 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_AUTO_TEST_CASE(coins_prefetch)
+{
+    CCoinsViewTest base;
+    CCoinsViewCache cache(&base);
+
+    uint256 txid1 = GetRandHash();
+    uint256 txid2 = GetRandHash();
+
+    CCoins coins1;
+    coins1.nHeight = 10;
+    coins1.vout.resize(2);
+    coins1.vout[1].nValue = 5000;
+    size_t usage = coins1.DynamicMemoryUsage();
+
+    // prefetched coins are cached as they are, and are not written back
+    BOOST_CHECK(cache.PrefetchCoins(txid1, coins1));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1);
+    BOOST_CHECK(cache.DynamicMemoryUsage() >= usage);
+    const CCoins *pcoins = cache.AccessCoins(txid1);
+    BOOST_CHECK(pcoins != NULL);
+    BOOST_CHECK_EQUAL(pcoins->nHeight, 10);
+    BOOST_CHECK(pcoins->IsAvailable(1));
+    BOOST_CHECK_EQUAL(pcoins->vout[1].nValue, 5000);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!base.HaveCoins(txid1));
+
+    // an entry that is already cached is left alone
+    {
+        CCoinsModifier modifier = cache.ModifyCoins(txid2);
+        modifier->nHeight = 20;
+        modifier->vout.resize(1);
+        modifier->vout[0].nValue = 1000;
+    }
+    CCoins coins2;
+    coins2.nHeight = 30;
+    coins2.vout.resize(1);
+    coins2.vout[0].nValue = 3000;
+    BOOST_CHECK(!cache.PrefetchCoins(txid2, coins2));
+    BOOST_CHECK_EQUAL(cache.AccessCoins(txid2)->nHeight, 20);
+    BOOST_CHECK_EQUAL(cache.AccessCoins(txid2)->vout[0].nValue, 1000);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
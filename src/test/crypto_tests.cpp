@@ -2,12 +2,15 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
+#include "crypto/blake2b.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
+#include "mmr.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
@@ -168,6 +171,73 @@ BOOST_AUTO_TEST_CASE(sha512_testvectors) {
                "37de8c3ef5459d76a52cedc02dc499a3c9ed9dedbfb3281afd9653b8a112fafc");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    // every multi-buffer width, plus a remainder that falls through to the narrower ones
+    for (int i = 1; i <= 35; i++) {
+        std::vector<unsigned char> in(64 * i);
+        std::vector<unsigned char> out1(32 * i), out2(32 * i);
+        for (size_t j = 0; j < in.size(); j++) {
+            in[j] = insecure_rand() & 0xff;
+        }
+        for (int j = 0; j < i; j++) {
+            unsigned char tmp[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write(&in[64 * j], 64).Finalize(tmp);
+            CSHA256().Write(tmp, sizeof(tmp)).Finalize(&out1[32 * j]);
+        }
+        SHA256D64(&out2[0], &in[0], i);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blake2b64)
+{
+    // a remainder after the multi-lane groups falls through to the single hash
+    for (int i = 0; i <= 11; i++) {
+        std::vector<unsigned char> in(64 * i + 1);
+        std::vector<unsigned char> out1(32 * i + 1), out2(32 * i + 1);
+        for (size_t j = 0; j < in.size(); j++) {
+            in[j] = insecure_rand() & 0xff;
+        }
+        for (int j = 0; j < i; j++) {
+            CBLAKE2bWriter hw(SER_GETHASH, 0);
+            hw.write((const char *)&in[64 * j], 64);
+            uint256 hash = hw.GetHash();
+            memcpy(&out1[32 * j], hash.begin(), 32);
+        }
+        BLAKE2b64(&out2[0], &in[0], i, BLAKE2Bpersonal);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mmr_add_layers)
+{
+    // adding leaves a range at a time must build the same mountain range as adding them one by one
+    for (int nLeaves = 1; nLeaves <= 70; nLeaves += 3) {
+        std::vector<CDefaultMMRNode> leaves;
+        for (int i = 0; i < nLeaves; i++) {
+            leaves.push_back(CDefaultMMRNode(GetRandHash()));
+        }
+
+        CMerkleMountainRange<CDefaultMMRNode> mmrOne, mmrRanges;
+        for (auto &leaf : leaves) {
+            mmrOne.Add(leaf);
+        }
+        for (int i = 0; i < nLeaves; i += 5) {
+            mmrRanges.Add(std::vector<CDefaultMMRNode>(leaves.begin() + i, leaves.begin() + std::min(i + 5, nLeaves)));
+        }
+
+        BOOST_CHECK_EQUAL(mmrOne.height(), mmrRanges.height());
+        for (uint32_t ht = 1; ht < mmrOne.height(); ht++) {
+            BOOST_CHECK_EQUAL(mmrOne.upperNodes[ht - 1].size(), mmrRanges.upperNodes[ht - 1].size());
+        }
+        for (int size = 1; size <= nLeaves; size++) {
+            CMerkleMountainView<CDefaultMMRNode> viewOne(mmrOne, size), viewRanges(mmrRanges, size);
+            BOOST_CHECK_EQUAL(viewOne.GetRoot().GetHex(), viewRanges.GetRoot().GetHex());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(hmac_sha256_testvectors) {
     // test cases 1, 2, 3, 4, 6 and 7 of RFC 4231
     TestHMACSHA256("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
@@ -147,6 +147,56 @@ BOOST_AUTO_TEST_CASE(iterator_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(scan_iterator_snapshot)
+{
+    path ph = temp_directory_path() / unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false);
+    for (int x=0x00; x<16; ++x) {
+        BOOST_CHECK(dbw.Write((uint8_t)x, (uint32_t)x));
+    }
+
+    // writes and erases after the scan starts are not seen by it
+    boost::scoped_ptr<CDBIterator> it(dbw.NewScanIterator());
+    BOOST_CHECK(dbw.Write((uint8_t)0x20, (uint32_t)0x20));
+    BOOST_CHECK(dbw.Erase((uint8_t)0x00));
+
+    int count = 0;
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        uint8_t key;
+        BOOST_CHECK(it->GetKey(key));
+        BOOST_CHECK_EQUAL(key, count);
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, 16);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_stats)
+{
+    path ph = temp_directory_path() / unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false);
+    char key = 'k';
+    uint256 in = GetRandHash();
+    uint256 res;
+    BOOST_CHECK(dbw.Write(key, in));
+
+    CDBStats before = dbw.GetStats();
+    BOOST_CHECK(dbw.Read(key, res));
+    BOOST_CHECK(!dbw.Read('m', res));
+    BOOST_CHECK(dbw.Exists(key));
+
+    CDBStats after = dbw.GetStats();
+    BOOST_CHECK_EQUAL(after.name, ph.filename().string());
+    BOOST_CHECK_EQUAL(after.reads - before.reads, 3);
+    BOOST_CHECK_EQUAL(after.readsFound - before.readsFound, 2);
+    BOOST_CHECK(after.cacheHits <= after.cacheLookups);
+
+    bool found = false;
+    for (const CDBStats &stats : GetDBStats()) {
+        found = found || stats.name == after.name;
+    }
+    BOOST_CHECK(found);
+}
+
 struct StringContentsSerializer {
     // Used to make two serialized objects the same while letting them have different lengths
     // This is a terrible idea
@@ -10,6 +10,7 @@
 #include "test/test_bitcoin.h"
 
 #include <boost/test/unit_test.hpp>
+#include <limits>
 #include <list>
 
 BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
@@ -157,6 +158,147 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     BOOST_CHECK(it == pool.mapTx.get<1>().end());
 }
 
+BOOST_AUTO_TEST_CASE(MempoolPackageStatsTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // parent -> child -> grandchild
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(1);
+    txParent.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txParent.vout[0].nValue = 33000LL;
+
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].scriptSig = CScript() << OP_11;
+    txChild.vin[0].prevout = COutPoint(txParent.GetHash(), 0);
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild.vout[0].nValue = 22000LL;
+
+    CMutableTransaction txGrandChild;
+    txGrandChild.vin.resize(1);
+    txGrandChild.vin[0].scriptSig = CScript() << OP_11;
+    txGrandChild.vin[0].prevout = COutPoint(txChild.GetHash(), 0);
+    txGrandChild.vout.resize(1);
+    txGrandChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txGrandChild.vout[0].nValue = 11000LL;
+
+    pool.addUnchecked(txParent.GetHash(), entry.Fee(10000LL).FromTx(txParent));
+    pool.addUnchecked(txChild.GetHash(), entry.Fee(20000LL).FromTx(txChild));
+    pool.addUnchecked(txGrandChild.GetHash(), entry.Fee(30000LL).FromTx(txGrandChild));
+
+    CTxMemPool::txiter parentIt = pool.mapTx.find(txParent.GetHash());
+    CTxMemPool::txiter childIt = pool.mapTx.find(txChild.GetHash());
+    CTxMemPool::txiter grandChildIt = pool.mapTx.find(txGrandChild.GetHash());
+    uint64_t nTotalSize = parentIt->GetTxSize() + childIt->GetTxSize() + grandChildIt->GetTxSize();
+
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithDescendants(), 3);
+    BOOST_CHECK_EQUAL(parentIt->GetSizeWithDescendants(), nTotalSize);
+    BOOST_CHECK_EQUAL(parentIt->GetModFeesWithDescendants(), 60000LL);
+    BOOST_CHECK_EQUAL(childIt->GetCountWithAncestors(), 2);
+    BOOST_CHECK_EQUAL(childIt->GetCountWithDescendants(), 2);
+    BOOST_CHECK_EQUAL(grandChildIt->GetCountWithAncestors(), 3);
+    BOOST_CHECK_EQUAL(grandChildIt->GetSizeWithAncestors(), nTotalSize);
+    BOOST_CHECK_EQUAL(grandChildIt->GetModFeesWithAncestors(), 60000LL);
+    BOOST_CHECK_EQUAL(pool.GetMemPoolParents(childIt).size(), 1);
+    BOOST_CHECK_EQUAL(pool.GetMemPoolChildren(childIt).size(), 1);
+
+    // The parent is mined, its descendants stay and lose it from their ancestor state
+    std::list<CTransaction> removed;
+    pool.remove(txParent, removed, false);
+    BOOST_CHECK_EQUAL(removed.size(), 1);
+    removed.clear();
+    childIt = pool.mapTx.find(txChild.GetHash());
+    grandChildIt = pool.mapTx.find(txGrandChild.GetHash());
+    BOOST_CHECK_EQUAL(childIt->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(childIt->GetModFeesWithAncestors(), 20000LL);
+    BOOST_CHECK_EQUAL(childIt->GetCountWithDescendants(), 2);
+    BOOST_CHECK_EQUAL(grandChildIt->GetCountWithAncestors(), 2);
+    BOOST_CHECK_EQUAL(grandChildIt->GetModFeesWithAncestors(), 50000LL);
+    BOOST_CHECK(pool.GetMemPoolParents(childIt).empty());
+
+    // A reorg returns the parent while its descendants are still in the mempool
+    pool.addUnchecked(txParent.GetHash(), entry.Fee(10000LL).FromTx(txParent));
+    parentIt = pool.mapTx.find(txParent.GetHash());
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithDescendants(), 3);
+    BOOST_CHECK_EQUAL(parentIt->GetModFeesWithDescendants(), 60000LL);
+    BOOST_CHECK_EQUAL(childIt->GetCountWithAncestors(), 2);
+    BOOST_CHECK_EQUAL(grandChildIt->GetCountWithAncestors(), 3);
+    BOOST_CHECK_EQUAL(grandChildIt->GetSizeWithAncestors(), nTotalSize);
+
+    // Prioritisation is reflected in every package the entry belongs to
+    pool.PrioritiseTransaction(txChild.GetHash(), txChild.GetHash().ToString(), 0.0, 5000LL);
+    BOOST_CHECK_EQUAL(childIt->GetModifiedFee(), 25000LL);
+    BOOST_CHECK_EQUAL(parentIt->GetModFeesWithDescendants(), 65000LL);
+    BOOST_CHECK_EQUAL(grandChildIt->GetModFeesWithAncestors(), 65000LL);
+
+    // Recursive removal takes the descendants, reports them after their parents and leaves the
+    // parent as a package of one
+    pool.remove(txChild, removed, true);
+    BOOST_CHECK_EQUAL(removed.size(), 2);
+    BOOST_CHECK_EQUAL(removed.front().GetHash().ToString(), txChild.GetHash().ToString());
+    BOOST_CHECK_EQUAL(removed.back().GetHash().ToString(), txGrandChild.GetHash().ToString());
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithDescendants(), 1);
+    BOOST_CHECK_EQUAL(parentIt->GetSizeWithDescendants(), parentIt->GetTxSize());
+    BOOST_CHECK_EQUAL(parentIt->GetModFeesWithDescendants(), 10000LL);
+    BOOST_CHECK(pool.GetMemPoolChildren(parentIt).empty());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolAncestorLimitTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+
+    // a chain of three in the mempool, with a fourth to add at its end
+    std::vector<CMutableTransaction> chain(4);
+    for (int i = 0; i < chain.size(); i++)
+    {
+        chain[i].vin.resize(1);
+        chain[i].vin[0].scriptSig = CScript() << OP_11;
+        if (i)
+            chain[i].vin[0].prevout = COutPoint(chain[i - 1].GetHash(), 0);
+        chain[i].vout.resize(1);
+        chain[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        chain[i].vout[0].nValue = (10 - i) * COIN;
+        if (i < 3)
+            pool.addUnchecked(chain[i].GetHash(), entry.Fee(10000LL).FromTx(chain[i]));
+    }
+    CTxMemPoolEntry last = entry.Fee(10000LL).FromTx(chain[3]);
+    uint64_t nChainSize = pool.mapTx.find(chain[2].GetHash())->GetSizeWithAncestors() + last.GetTxSize();
+
+    CTxMemPool::setEntries setAncestors;
+    std::string errString;
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(last, setAncestors, 4, nChainSize, 4, nChainSize, errString));
+    BOOST_CHECK_EQUAL(setAncestors.size(), 3);
+
+    // each limit is exceeded by one
+    setAncestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(last, setAncestors, 3, nNoLimit, nNoLimit, nNoLimit, errString));
+    BOOST_CHECK(errString.find("ancestors") != std::string::npos);
+    setAncestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(last, setAncestors, nNoLimit, nChainSize - 1, nNoLimit, nNoLimit, errString));
+    BOOST_CHECK(errString.find("ancestor size") != std::string::npos);
+    setAncestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(last, setAncestors, nNoLimit, nNoLimit, 3, nNoLimit, errString));
+    BOOST_CHECK(errString.find("descendants") != std::string::npos);
+    setAncestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(last, setAncestors, nNoLimit, nNoLimit, nNoLimit, nChainSize - 1, errString));
+    BOOST_CHECK(errString.find("descendant size") != std::string::npos);
+
+    // once the first of the chain is mined, the same limits leave room for one more
+    std::list<CTransaction> removed;
+    pool.remove(chain[0], removed, false);
+    setAncestors.clear();
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(last, setAncestors, 3, nNoLimit, 3, nNoLimit, errString));
+    BOOST_CHECK_EQUAL(setAncestors.size(), 2);
+}
+
 BOOST_AUTO_TEST_CASE(RemoveWithoutBranchId) {
     CTxMemPool pool(CFeeRate(0));
     TestMemPoolEntryHelper entry;
@@ -0,0 +1,169 @@
+// Copyright (c) 2023 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "cc/CCinclude.h"
+#include "chain.h"
+#include "hash.h"
+#include "pbaas/events.h"
+#include "pbaas/notarization.h"
+#include "random.h"
+#include "streams.h"
+#include "utiltime.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pbaasevents_tests, BasicTestingSetup)
+
+static uint160 RandomID()
+{
+    uint256 hash = GetRandHash();
+    return Hash160(hash.begin(), hash.end());
+}
+
+// a block with a coinbase, a reserve transfer and, in a second transaction, a confirmed and a pending notarization
+// finalization and an export
+static CBlock EventsBlock(const uint160 &currencyID)
+{
+    std::vector<CTxDestination> dests({CTxDestination(CKeyID(RandomID()))});
+    CBlock block;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.push_back(CTxOut(1, CScript() << OP_TRUE));
+    block.vtx.push_back(coinbase);
+
+    CReserveTransfer rt(CReserveTransfer::VERSION_CURRENT);
+    rt.nFees = 20000;
+    CMutableTransaction tx1;
+    tx1.vin.push_back(CTxIn(GetRandHash(), 0));
+    tx1.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CReserveTransfer>(EVAL_RESERVE_TRANSFER, dests, 1, &rt))));
+    tx1.vout.push_back(CTxOut(1, CScript() << OP_TRUE));
+    block.vtx.push_back(tx1);
+
+    CObjectFinalization confirmed(CObjectFinalization::FINALIZE_NOTARIZATION, currencyID, GetRandHash(), 1);
+    confirmed.SetConfirmed();
+    CObjectFinalization pending(CObjectFinalization::FINALIZE_NOTARIZATION, currencyID, GetRandHash(), 1);
+    CCrossChainExport ccx;
+    CMutableTransaction tx2;
+    tx2.vin.push_back(CTxIn(GetRandHash(), 0));
+    tx2.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CObjectFinalization>(EVAL_FINALIZE_NOTARIZATION, dests, 1, &confirmed))));
+    tx2.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CObjectFinalization>(EVAL_FINALIZE_NOTARIZATION, dests, 1, &pending))));
+    tx2.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CCrossChainExport>(EVAL_CROSSCHAIN_EXPORT, dests, 1, &ccx))));
+    block.vtx.push_back(tx2);
+
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(pbaasevents_block)
+{
+    uint160 currencyID = RandomID();
+    CBlock block = EventsBlock(currencyID);
+    uint256 hashBlock = block.GetHash();
+    CBlockIndex index;
+    index.SetHeight(100);
+    index.phashBlock = &hashBlock;
+
+    std::vector<CPBaaSEvent> events;
+    GetBlockPBaaSEvents(block, &index, true, events);
+    BOOST_REQUIRE_EQUAL(events.size(), 3);
+
+    BOOST_CHECK_EQUAL(events[0].nType, CPBaaSEvent::EVENT_RESERVETRANSFER);
+    BOOST_CHECK(events[0].txid == block.vtx[1].GetHash());
+    BOOST_CHECK_EQUAL(events[0].nOut, 0);
+    BOOST_CHECK_EQUAL(CReserveTransfer(events[0].vchData).nFees, 20000);
+
+    BOOST_CHECK_EQUAL(events[1].nType, CPBaaSEvent::EVENT_NOTARIZATION);
+    BOOST_CHECK(events[1].txid == block.vtx[2].GetHash());
+    BOOST_CHECK_EQUAL(events[1].nOut, 0);
+    CObjectFinalization finalization(events[1].vchData);
+    BOOST_CHECK(finalization.IsConfirmed() && finalization.currencyID == currencyID);
+
+    BOOST_CHECK_EQUAL(events[2].nType, CPBaaSEvent::EVENT_EXPORT);
+    BOOST_CHECK_EQUAL(events[2].nOut, 2);
+
+    for (auto &oneEvent : events)
+    {
+        BOOST_CHECK(oneEvent.fConnected);
+        BOOST_CHECK_EQUAL(oneEvent.nHeight, 100);
+        BOOST_CHECK(oneEvent.hashBlock == hashBlock);
+    }
+
+    // the events of a disconnected block come in reverse order
+    std::vector<CPBaaSEvent> undoEvents;
+    GetBlockPBaaSEvents(block, &index, false, undoEvents);
+    BOOST_REQUIRE_EQUAL(undoEvents.size(), events.size());
+    for (int i = 0; i < events.size(); i++)
+    {
+        const CPBaaSEvent &undo = undoEvents[undoEvents.size() - 1 - i];
+        BOOST_CHECK(!undo.fConnected);
+        BOOST_CHECK_EQUAL(undo.nType, events[i].nType);
+        BOOST_CHECK(undo.txid == events[i].txid && undo.nOut == events[i].nOut);
+        BOOST_CHECK(undo.vchData == events[i].vchData);
+    }
+
+    BOOST_CHECK_EQUAL(std::string(CPBaaSEvent::TypeName(CPBaaSEvent::EVENT_RESERVETRANSFER)), "reservetransfer");
+    BOOST_CHECK(CPBaaSEvent::TypeName(CPBaaSEvent::EVENT_INVALID) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(pbaasevents_queue)
+{
+    CBlock block = EventsBlock(RandomID());
+    uint256 hashBlock = block.GetHash();
+    CBlockIndex index;
+    index.SetHeight(100);
+    index.phashBlock = &hashBlock;
+
+    boost::mutex mutex;
+    std::vector<CPBaaSEvent> published;
+    CPBaaSEventQueue queue([&](const std::vector<CPBaaSEvent> &events) {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        for (auto &oneEvent : events)
+        {
+            // what subscribers receive
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << oneEvent;
+            CPBaaSEvent received;
+            ss >> received;
+            published.push_back(received);
+        }
+    });
+
+    // events queued before the thread starts are kept, and the sequence of each type continues through a reorg
+    queue.PushBlock(block, &index, true);
+    queue.Start();
+    queue.PushBlock(block, &index, false);
+    queue.PushBlock(block, &index, true);
+    BOOST_CHECK_EQUAL(queue.GetNextSequence(CPBaaSEvent::EVENT_RESERVETRANSFER), 3);
+    BOOST_CHECK_EQUAL(queue.GetNextSequence(CPBaaSEvent::EVENT_NOTARIZATION), 3);
+    BOOST_CHECK_EQUAL(queue.GetNextSequence(CPBaaSEvent::EVENT_EXPORT), 3);
+    BOOST_CHECK_EQUAL(queue.GetNextSequence(CPBaaSEvent::EVENT_IDENTITY), 0);
+
+    for (int i = 0; i < 500; i++)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (published.size() == 9)
+            {
+                break;
+            }
+        }
+        MilliSleep(10);
+    }
+    queue.Stop();
+
+    BOOST_REQUIRE_EQUAL(published.size(), 9);
+    for (int i = 0; i < published.size(); i++)
+    {
+        // each block has one event of each of its types
+        BOOST_CHECK_EQUAL(published[i].nSequence, i / 3);
+        BOOST_CHECK_EQUAL(published[i].fConnected, i < 3 || i >= 6);
+    }
+    BOOST_CHECK_EQUAL(published[3].nType, CPBaaSEvent::EVENT_EXPORT);
+    BOOST_CHECK_EQUAL(published[5].nType, CPBaaSEvent::EVENT_RESERVETRANSFER);
+    BOOST_CHECK(published[6].vchData == published[0].vchData);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,8 @@
 #include "test_bitcoin.h"
 
 #include "crypto/common.h"
+#include "crypto/blake2b.h"
+#include "crypto/sha256.h"
 
 #include "key.h"
 #include "main.h"
@@ -72,6 +74,8 @@ JoinSplitTestingSetup::~JoinSplitTestingSetup()
 BasicTestingSetup::BasicTestingSetup()
 {
     assert(init_and_check_sodium() != -1);
+    SHA256AutoDetect();
+    BLAKE2b64AutoDetect();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
@@ -15,6 +15,72 @@
 #include <boost/variant.hpp>
 #include <librustzcash.h>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+PreparedSaplingSpend PrepareSaplingSpend(const SpendDescriptionInfo &spend)
+{
+    PreparedSaplingSpend prepared;
+    auto cm = spend.note.cm();
+    auto nf = spend.note.nullifier(spend.expsk.full_viewing_key(), spend.witness.position());
+    if (cm && nf) {
+        prepared.nf = nf;
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << spend.witness.path();
+        prepared.witness.assign(ss.begin(), ss.end());
+    }
+    return prepared;
+}
+
+PreparedSaplingOutput PrepareSaplingOutput(const OutputDescriptionInfo &output)
+{
+    PreparedSaplingOutput prepared;
+    prepared.cm = output.note.cm();
+    if (prepared.cm) {
+        libzcash::SaplingNotePlaintext notePlaintext(output.note, output.memo);
+        prepared.enc = notePlaintext.encrypt(output.note.pk_d);
+    }
+    return prepared;
+}
+
+// calls prepare for each index from 0 to count - 1, spread over up to nThreads threads, including this one,
+// and rethrows the first exception any of them threw
+void ParallelPrepare(size_t count, int nThreads, const std::function<void(size_t)> &prepare)
+{
+    std::atomic<size_t> next(0);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        try {
+            for (size_t i = next++; i < count; i = next++) {
+                prepare(i);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            next = count;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads && (size_t)i < count; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}
+
 SpendDescriptionInfo::SpendDescriptionInfo(
     libzcash::SaplingExpandedSpendingKey expsk,
     libzcash::SaplingNote note,
@@ -278,6 +344,23 @@ void TransactionBuilder::SendChangeTo(const CTxDestination &changeAddr)
     sproutChangeAddr = boost::none;
 }
 
+void TransactionBuilder::PrepareSaplingDescriptions(std::vector<PreparedSaplingSpend> &preparedSpends,
+                                                    std::vector<PreparedSaplingOutput> &preparedOutputs) const
+{
+    preparedSpends.assign(spends.size(), PreparedSaplingSpend());
+    preparedOutputs.assign(outputs.size(), PreparedSaplingOutput());
+    ParallelPrepare(spends.size() + outputs.size(), nPrepareThreads > 0 ? nPrepareThreads : GetNumCores(), [&](size_t i) {
+        if (i < spends.size())
+        {
+            preparedSpends[i] = PrepareSaplingSpend(spends[i]);
+        }
+        else
+        {
+            preparedOutputs[i - spends.size()] = PrepareSaplingOutput(outputs[i - spends.size()]);
+        }
+    });
+}
+
 TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
 {
     //
@@ -455,22 +538,23 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
     // Sapling spends and outputs
     //
 
+    // Everything about each spend and output except its proof is prepared on worker threads, because the
+    // proving context has to create the proofs one at a time, in the order of their descriptions
+    std::vector<PreparedSaplingSpend> preparedSpends;
+    std::vector<PreparedSaplingOutput> preparedOutputs;
+    PrepareSaplingDescriptions(preparedSpends, preparedOutputs);
+
     auto ctx = librustzcash_sapling_proving_ctx_init();
 
     // Create Sapling SpendDescriptions
-    for (auto spend : spends) {
-        auto cm = spend.note.cm();
-        auto nf = spend.note.nullifier(
-            spend.expsk.full_viewing_key(), spend.witness.position());
-        if (!cm || !nf) {
+    for (size_t i = 0; i < spends.size(); i++) {
+        const SpendDescriptionInfo &spend = spends[i];
+        const PreparedSaplingSpend &prepared = preparedSpends[i];
+        if (!prepared.nf) {
             librustzcash_sapling_proving_ctx_free(ctx);
             return TransactionBuilderResult("Spend is invalid");
         }
 
-        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-        ss << spend.witness.path();
-        std::vector<unsigned char> witness(ss.begin(), ss.end());
-
         SpendDescription sdesc;
         if (!librustzcash_sapling_spend_proof(
                 ctx,
@@ -481,7 +565,7 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
                 spend.alpha.begin(),
                 spend.note.value(),
                 spend.anchor.begin(),
-                witness.data(),
+                prepared.witness.data(),
                 sdesc.cv.begin(),
                 sdesc.rk.begin(),
                 sdesc.zkproof.data())) {
@@ -490,26 +574,23 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
         }
 
         sdesc.anchor = spend.anchor;
-        sdesc.nullifier = *nf;
+        sdesc.nullifier = *prepared.nf;
         mtx.vShieldedSpend.push_back(sdesc);
     }
 
     // Create Sapling OutputDescriptions
-    for (auto output : outputs) {
-        auto cm = output.note.cm();
-        if (!cm) {
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const OutputDescriptionInfo &output = outputs[i];
+        const PreparedSaplingOutput &prepared = preparedOutputs[i];
+        if (!prepared.cm) {
             librustzcash_sapling_proving_ctx_free(ctx);
             return TransactionBuilderResult("Output is invalid");
         }
-
-        libzcash::SaplingNotePlaintext notePlaintext(output.note, output.memo);
-
-        auto res = notePlaintext.encrypt(output.note.pk_d);
-        if (!res) {
+        if (!prepared.enc) {
             librustzcash_sapling_proving_ctx_free(ctx);
             return TransactionBuilderResult("Failed to encrypt note");
         }
-        auto enc = res.get();
+        auto enc = prepared.enc.get();
         auto encryptor = enc.second;
 
         OutputDescription odesc;
@@ -526,7 +607,7 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
             return TransactionBuilderResult("Output proof failed");
         }
 
-        odesc.cm = *cm;
+        odesc.cm = *prepared.cm;
         odesc.ephemeralKey = encryptor.get_epk();
         odesc.encCiphertext = enc.first;
 
@@ -45,6 +45,18 @@ struct OutputDescriptionInfo {
         std::array<unsigned char, ZC_MEMO_SIZE> memo) : ovk(ovk), note(note), memo(memo) {}
 };
 
+// nullifier and serialized witness path of a spend, the nullifier is empty if the spend is invalid
+struct PreparedSaplingSpend {
+    boost::optional<uint256> nf;
+    std::vector<unsigned char> witness;
+};
+
+// note commitment and encrypted note of an output, either is empty if it could not be made
+struct PreparedSaplingOutput {
+    boost::optional<uint256> cm;
+    boost::optional<libzcash::SaplingNotePlaintextEncryptionResult> enc;
+};
+
 struct TransparentInputInfo {
     CScript scriptPubKey;
     CAmount value;
@@ -80,6 +92,7 @@ private:
     CCriticalSection* cs_coinsView;
     CAmount fee = 10000;
     CCurrencyValueMap reserveFee;
+    int nPrepareThreads = 0;
 
     std::vector<SpendDescriptionInfo> spends;
     std::vector<OutputDescriptionInfo> outputs;
@@ -108,6 +121,18 @@ public:
 
     void SetExpiryHeight(uint32_t nExpiryHeight);
 
+    // threads that prepare Sapling spends and outputs for their proofs, 0 for one per core, the proofs
+    // themselves are always made one at a time
+    void SetPrepareThreads(int nThreads)
+    {
+        nPrepareThreads = nThreads;
+    }
+
+    // prepares everything about each Sapling spend and output added so far except its proof, which is the part
+    // of Build that runs on the threads set with SetPrepareThreads
+    void PrepareSaplingDescriptions(std::vector<PreparedSaplingSpend> &preparedSpends,
+                                    std::vector<PreparedSaplingOutput> &preparedOutputs) const;
+
     void SetFee(CAmount fee);
     CAmount GetFee() const
     {
@@ -11,6 +11,9 @@
 #include "pow.h"
 #include "uint256.h"
 #include "core_io.h"
+#include "offerindex.h"
+#include "identityindex.h"
+#include "chainsnapshot.h"
 
 #include <stdint.h>
 
@@ -33,6 +36,11 @@ static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_OFFERINDEX = 'O';
+static const char DB_OFFEROUTPOINTINDEX = 'o';
+static const char DB_OFFEREXPIRYINDEX = 'e';
+static const char DB_IDREVISIONINDEX = 'I';
+static const char DB_IDCONTENTINDEX = 'V';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_SPROUT_ANCHOR = 'a';
@@ -40,16 +48,17 @@ static const char DB_BEST_SAPLING_ANCHOR = 'z';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_SNAPSHOT_HEIGHT = 'H';
 
 // Zcash defines are slightly different - commenting rather than removing
 // in case there is ever a related error
 //static const char DB_TIMESTAMPINDEX = 'T';
 //static const char DB_BLOCKHASHINDEX = 'h';
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe), nWriteSequence(0) {
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe), nWriteSequence(0)
 {
 }
 
@@ -200,7 +209,10 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
         batch.Write(DB_BEST_SAPLING_ANCHOR, hashSaplingAnchor);
 
     LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return db.WriteBatch(batch);
+    nWriteSequence++;
+    bool ret = db.WriteBatch(batch);
+    nWriteSequence++;
+    return ret;
 }
 
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
@@ -227,10 +239,7 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 }
 
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
-    /* It seems that there are no "const iterators" for LevelDB.  Since we
-       only need read operations on it, use a const-cast to get around
-       that restriction.  */
-    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewScanIterator());
     pcursor->Seek(DB_COINS);
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
@@ -272,6 +281,45 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     return true;
 }
 
+static bool WriteRawRecords(CDBWrapper &db, const std::vector<std::pair<std::string, std::string>> &records)
+{
+    CDBBatch batch(db);
+    for (auto &record : records)
+    {
+        batch.WriteRaw(record.first, record.second);
+    }
+    return db.WriteBatch(batch, true);
+}
+
+bool CCoinsViewDB::WriteChainSnapshot(CDBIterator &cursor, CChainSnapshotWriter &writer, std::vector<std::pair<int, uint256>> &unspentTxids) const
+{
+    for (cursor.SeekToFirst(); cursor.Valid(); cursor.Next())
+    {
+        boost::this_thread::interruption_point();
+        std::string key = cursor.GetRawKey();
+        if (key.size() && key[0] == DB_COINS)
+        {
+            std::pair<char, uint256> coinsKey;
+            CCoins coins;
+            if (!cursor.GetKey(coinsKey) || !cursor.GetValue(coins))
+            {
+                return error("%s: unable to read coins of %s", __func__, HexStr(key));
+            }
+            unspentTxids.push_back(std::make_pair(coins.nHeight, coinsKey.second));
+        }
+        writer.WriteRecord(CChainSnapshotHeader::SECTION_CHAINSTATE, key, cursor.GetRawValue());
+    }
+    return true;
+}
+
+bool CCoinsViewDB::WriteSnapshotRecords(const std::vector<std::pair<std::string, std::string>> &records)
+{
+    nWriteSequence++;
+    bool ret = WriteRawRecords(db, records);
+    nWriteSequence++;
+    return ret;
+}
+
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
@@ -284,6 +332,14 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadBlockSolution(const uint256 &hash, std::vector<unsigned char> &solution) {
+    CDiskBlockIndex diskindex;
+    if (!Read(make_pair(DB_BLOCK_INDEX, hash), diskindex))
+        return false;
+    solution = diskindex.nSolution.nSolution();
+    return true;
+}
+
 bool CBlockTreeDB::EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
@@ -333,7 +389,7 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDb
 
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(NewScanIterator());
 
     pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
 
@@ -384,7 +440,7 @@ bool CBlockTreeDB::ReadAddressIndex(
         std::vector<CAddressIndexDbEntry> &addressIndex,
         int start, int end)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(NewScanIterator());
 
     if (start > 0 && end > 0) {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
@@ -430,7 +486,7 @@ UniValue CBlockTreeDB::Snapshot(int top)
 {
     int64_t total = 0; int64_t totalAddresses = 0; std::string address;
     int64_t utxos = 0; int64_t ignoredAddresses;
-    boost::scoped_ptr<CDBIterator> iter(NewIterator());
+    boost::scoped_ptr<CDBIterator> iter(NewScanIterator());
     std::map <std::string, CAmount> addressAmounts;
     std::vector <std::pair<CAmount, std::string>> vaddr;
     UniValue result(UniValue::VOBJ);
@@ -568,7 +624,7 @@ bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex)
 
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(NewScanIterator());
 
     pcursor->Seek(make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
 
@@ -617,6 +673,254 @@ bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &lt
     return true;
 }
 
+bool CBlockTreeDB::UpdateOfferIndex(const std::vector<COfferIndexDbEntry> &offers, const std::vector<COfferOutPointDbEntry> &outPoints, const std::vector<COfferExpiryDbEntry> &expiries) {
+    CDBBatch batch(*this);
+    for (auto &oneOffer : offers) {
+        if (oneOffer.second.IsNull()) {
+            batch.Erase(make_pair(DB_OFFERINDEX, oneOffer.first));
+        } else {
+            batch.Write(make_pair(DB_OFFERINDEX, oneOffer.first), oneOffer.second);
+        }
+    }
+    for (auto &oneOutPoint : outPoints) {
+        if (oneOutPoint.second.IsNull()) {
+            batch.Erase(make_pair(DB_OFFEROUTPOINTINDEX, oneOutPoint.first));
+        } else {
+            batch.Write(make_pair(DB_OFFEROUTPOINTINDEX, oneOutPoint.first), oneOutPoint.second);
+        }
+    }
+    for (auto &oneExpiry : expiries) {
+        if (oneExpiry.second.IsNull()) {
+            batch.Erase(make_pair(DB_OFFEREXPIRYINDEX, oneExpiry.first));
+        } else {
+            batch.Write(make_pair(DB_OFFEREXPIRYINDEX, oneExpiry.first), oneExpiry.second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+// reads all offers of one index type for the primary currency or ID, in order of secondary and price, or if
+// secondaryID is not null, only those in exchange for it, in order of price
+bool CBlockTreeDB::ReadOfferIndex(unsigned int type, const uint160 &primaryID, const uint160 &secondaryID, std::vector<COfferIndexDbEntry> &offers)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_OFFERINDEX, COfferIndexKey(type, primaryID, secondaryID)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, COfferIndexKey> keyObj;
+            pcursor->GetKey(keyObj);
+            const COfferIndexKey &indexKey = keyObj.second;
+
+            if (keyObj.first == DB_OFFERINDEX &&
+                indexKey.type == type &&
+                indexKey.primaryID == primaryID &&
+                (secondaryID.IsNull() || indexKey.secondaryID == secondaryID)) {
+                try {
+                    COfferIndexValue offer;
+                    pcursor->GetValue(offer);
+                    offers.push_back(make_pair(indexKey, offer));
+                    pcursor->Next();
+                } catch (const std::exception& e) {
+                    return error("failed to get offer index value");
+                }
+            } else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+// reads all offers that are posted in, funded by or carried in an op_return by the output
+bool CBlockTreeDB::ReadOfferOutPoint(const COutPoint &outPoint, std::vector<COfferIndexValue> &offers)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_OFFEROUTPOINTINDEX, make_pair(outPoint, uint256())));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, pair<COutPoint, uint256>> keyObj;
+            pcursor->GetKey(keyObj);
+
+            if (keyObj.first == DB_OFFEROUTPOINTINDEX && keyObj.second.first == outPoint) {
+                try {
+                    COfferIndexValue offer;
+                    pcursor->GetValue(offer);
+                    offers.push_back(offer);
+                    pcursor->Next();
+                } catch (const std::exception& e) {
+                    return error("failed to get offer outpoint index value");
+                }
+            } else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+// reads every output that has offers in the offer outpoint index
+bool CBlockTreeDB::ReadOfferOutPoints(std::set<COutPoint> &outPoints)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(DB_OFFEROUTPOINTINDEX);
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, pair<COutPoint, uint256>> keyObj;
+            pcursor->GetKey(keyObj);
+
+            if (keyObj.first == DB_OFFEROUTPOINTINDEX) {
+                outPoints.insert(keyObj.second.first);
+                pcursor->Next();
+            } else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+// reads all offers that expire at expiryHeight
+bool CBlockTreeDB::ReadOfferExpiries(uint32_t expiryHeight, std::vector<COfferIndexValue> &offers)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_OFFEREXPIRYINDEX, make_pair(expiryHeight, uint256())));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, pair<uint32_t, uint256>> keyObj;
+            pcursor->GetKey(keyObj);
+
+            if (keyObj.first == DB_OFFEREXPIRYINDEX && keyObj.second.first == expiryHeight) {
+                try {
+                    COfferIndexValue offer;
+                    pcursor->GetValue(offer);
+                    offers.push_back(offer);
+                    pcursor->Next();
+                } catch (const std::exception& e) {
+                    return error("failed to get offer expiry index value");
+                }
+            } else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::WriteIdentityIndex(const std::vector<CIdentityRevisionDbEntry> &revisions, const std::vector<CIdentityContentDbEntry> &content) {
+    CDBBatch batch(*this);
+    for (auto &oneRevision : revisions)
+        batch.Write(make_pair(DB_IDREVISIONINDEX, oneRevision.first), oneRevision.second);
+    for (auto &oneEntry : content)
+        batch.Write(make_pair(DB_IDCONTENTINDEX, oneEntry.first), oneEntry.second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseIdentityIndex(const std::vector<CIdentityRevisionDbEntry> &revisions, const std::vector<CIdentityContentDbEntry> &content) {
+    CDBBatch batch(*this);
+    for (auto &oneRevision : revisions)
+        batch.Erase(make_pair(DB_IDREVISIONINDEX, oneRevision.first));
+    for (auto &oneEntry : content)
+        batch.Erase(make_pair(DB_IDCONTENTINDEX, oneEntry.first));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadIdentityRevision(const CIdentityRevisionKey &key, CIdentityRevisionValue &revision) {
+    return Read(make_pair(DB_IDREVISIONINDEX, key), revision);
+}
+
+// reads the revisions of an identity in the order they were mined. as with the address index, the start height is
+// only used with an end height
+bool CBlockTreeDB::ReadIdentityRevisions(const uint160 &identityID, std::vector<CIdentityRevisionDbEntry> &revisions, int start, int end)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_IDREVISIONINDEX, CIdentityRevisionKey(identityID, (start > 0 && end > 0) ? start : 0)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CIdentityRevisionKey> keyObj;
+            pcursor->GetKey(keyObj);
+            const CIdentityRevisionKey &indexKey = keyObj.second;
+
+            if (keyObj.first == DB_IDREVISIONINDEX && indexKey.identityID == identityID) {
+                if (end > 0 && indexKey.blockHeight > end) {
+                    break;
+                }
+                try {
+                    CIdentityRevisionValue revision;
+                    pcursor->GetValue(revision);
+                    revisions.push_back(make_pair(indexKey, revision));
+                    pcursor->Next();
+                } catch (const std::exception& e) {
+                    return error("failed to get identity revision index value");
+                }
+            } else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+// reads the content multimap entries of an identity under one VDXF key, in the order they were mined
+bool CBlockTreeDB::ReadIdentityContent(const uint160 &identityID, const uint160 &vdxfKey, std::vector<CIdentityContentDbEntry> &content, int start, int end)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_IDCONTENTINDEX, CIdentityContentKey(identityID, vdxfKey, (start > 0 && end > 0) ? start : 0)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CIdentityContentKey> keyObj;
+            pcursor->GetKey(keyObj);
+            const CIdentityContentKey &indexKey = keyObj.second;
+
+            if (keyObj.first == DB_IDCONTENTINDEX && indexKey.identityID == identityID && indexKey.vdxfKey == vdxfKey) {
+                if (end > 0 && indexKey.blockHeight > end) {
+                    break;
+                }
+                try {
+                    CIdentityContentValue entry;
+                    pcursor->GetValue(entry);
+                    content.push_back(make_pair(indexKey, entry));
+                    pcursor->Next();
+                } catch (const std::exception& e) {
+                    return error("failed to get identity content index value");
+                }
+            } else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -629,6 +933,113 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+// writes the block index records of the chain without their block and undo file positions, which are local to this node
+bool CBlockTreeDB::WriteChainSnapshotBlockIndex(CDBIterator &cursor, const boost::function<bool(const uint256&)> &isInChain, CChainSnapshotWriter &writer)
+{
+    for (cursor.Seek(make_pair(DB_BLOCK_INDEX, uint256())); cursor.Valid(); cursor.Next())
+    {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (!cursor.GetKey(key) || key.first != DB_BLOCK_INDEX)
+        {
+            break;
+        }
+        if (!isInChain(key.second))
+        {
+            continue;
+        }
+        CDiskBlockIndex diskindex;
+        if (!cursor.GetValue(diskindex))
+        {
+            return error("%s: unable to read block index of %s", __func__, key.second.GetHex());
+        }
+        diskindex.nStatus &= (BLOCK_VALID_MASK | BLOCK_ACTIVATES_UPGRADE);
+        diskindex.nFile = 0;
+        diskindex.nDataPos = 0;
+        diskindex.nUndoPos = 0;
+
+        CDataStream ss(SER_DISK, SNAPSHOT_STREAM_VERSION);
+        ss << diskindex;
+        writer.WriteRecord(CChainSnapshotHeader::SECTION_BLOCKINDEX, cursor.GetRawKey(), ss.str());
+    }
+    return true;
+}
+
+// writes the address, spent, timestamp, offer and identity indexes and the index flags, leaving out timestamp entries
+// of blocks that are no longer in the chain and the transaction index, which is rebuilt from the snapshot
+bool CBlockTreeDB::WriteChainSnapshotIndexes(CDBIterator &cursor, const boost::function<bool(const uint256&)> &isInChain, CChainSnapshotWriter &writer)
+{
+    for (cursor.SeekToFirst(); cursor.Valid(); cursor.Next())
+    {
+        boost::this_thread::interruption_point();
+        std::string key = cursor.GetRawKey();
+        if (!key.size())
+        {
+            continue;
+        }
+        switch (key[0])
+        {
+            case DB_ADDRESSINDEX:
+            case DB_ADDRESSUNSPENTINDEX:
+            case DB_SPENTINDEX:
+            case DB_OFFERINDEX:
+            case DB_OFFEROUTPOINTINDEX:
+            case DB_OFFEREXPIRYINDEX:
+            case DB_IDREVISIONINDEX:
+            case DB_IDCONTENTINDEX:
+                break;
+
+            case DB_TIMESTAMPINDEX:
+            {
+                std::pair<char, CTimestampIndexKey> timestampKey;
+                if (!cursor.GetKey(timestampKey) || !isInChain(timestampKey.second.blockHash))
+                {
+                    continue;
+                }
+                break;
+            }
+
+            case DB_BLOCKHASHINDEX:
+            {
+                std::pair<char, CTimestampBlockIndexKey> blockHashKey;
+                if (!cursor.GetKey(blockHashKey) || !isInChain(blockHashKey.second.blockHash))
+                {
+                    continue;
+                }
+                break;
+            }
+
+            case DB_FLAG:
+            {
+                std::pair<char, std::string> flagKey;
+                if (!cursor.GetKey(flagKey) || flagKey.second == "prunedblockfiles")
+                {
+                    continue;
+                }
+                break;
+            }
+
+            default:
+                continue;
+        }
+        writer.WriteRecord(CChainSnapshotHeader::SECTION_INDEXES, key, cursor.GetRawValue());
+    }
+    return true;
+}
+
+bool CBlockTreeDB::WriteSnapshotRecords(const std::vector<std::pair<std::string, std::string>> &records)
+{
+    return WriteRawRecords(*this, records);
+}
+
+bool CBlockTreeDB::WriteSnapshotHeight(int nHeight) {
+    return Write(DB_SNAPSHOT_HEIGHT, nHeight);
+}
+
+bool CBlockTreeDB::ReadSnapshotHeight(int &nHeight) {
+    return Read(DB_SNAPSHOT_HEIGHT, nHeight);
+}
+
 void komodo_index2pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,int32_t height);
 
 bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
@@ -644,7 +1055,7 @@ bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
 
 bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(NewScanIterator());
 
     pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
 
@@ -676,6 +1087,9 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                 pindexNew->nBits          = diskindex.nBits;
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nSolution      = diskindex.nSolution;
+                pindexNew->nSolutionVersion = diskindex.nSolutionVersion;
+                pindexNew->hashPrevMMRRoot = diskindex.hashPrevMMRRoot;
+                pindexNew->hashBlockMMRRoot = diskindex.hashBlockMMRRoot;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
                 pindexNew->nTx            = diskindex.nTx;
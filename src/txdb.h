@@ -10,7 +10,9 @@
 #include "dbwrapper.h"
 #include "chain.h"
 
+#include <atomic>
 #include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,6 +21,7 @@
 #include <boost/function.hpp>
 
 class CBlockIndex;
+class CChainSnapshotWriter;
 struct CDiskTxPos;
 struct CAddressUnspentKey;
 struct CAddressUnspentValue;
@@ -31,10 +34,21 @@ struct CTimestampIndexKey;
 struct CTimestampIndexIteratorKey;
 struct CTimestampBlockIndexKey;
 struct CTimestampBlockIndexValue;
+struct COfferIndexKey;
+struct COfferIndexValue;
+struct CIdentityRevisionKey;
+struct CIdentityRevisionValue;
+struct CIdentityContentKey;
+struct CIdentityContentValue;
 
 typedef std::pair<CAddressUnspentKey, CAddressUnspentValue> CAddressUnspentDbEntry;
 typedef std::pair<CAddressIndexKey, CAmount> CAddressIndexDbEntry;
 typedef std::pair<CSpentIndexKey, CSpentIndexValue> CSpentIndexDbEntry;
+typedef std::pair<COfferIndexKey, COfferIndexValue> COfferIndexDbEntry;
+typedef std::pair<std::pair<COutPoint, uint256>, COfferIndexValue> COfferOutPointDbEntry;
+typedef std::pair<std::pair<uint32_t, uint256>, COfferIndexValue> COfferExpiryDbEntry;
+typedef std::pair<CIdentityRevisionKey, CIdentityRevisionValue> CIdentityRevisionDbEntry;
+typedef std::pair<CIdentityContentKey, CIdentityContentValue> CIdentityContentDbEntry;
 
 class uint256;
 
@@ -75,10 +89,14 @@ class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
+    // odd while a batch is being written, so readers on other threads can tell whether it changed under them
+    std::atomic<uint64_t> nWriteSequence;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
+    uint64_t GetWriteSequence() const { return nWriteSequence; }
+
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
     bool GetNullifier(const uint256 &nf, ShieldedType type) const;
@@ -95,6 +113,13 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+
+    //! iterator that reads from its own snapshot of the coin database
+    CDBIterator *NewScanIterator() const { return db.NewScanIterator(); }
+    //! writes every record read by cursor to a chain snapshot, and returns the height and txid of every transaction with unspent outputs
+    bool WriteChainSnapshot(CDBIterator &cursor, CChainSnapshotWriter &writer, std::vector<std::pair<int, uint256>> &unspentTxids) const;
+    //! writes serialized records read from a chain snapshot
+    bool WriteSnapshotRecords(const std::vector<std::pair<std::string, std::string>> &records);
 };
 
 /** Access to the block database (blocks/index/) */
@@ -108,6 +133,7 @@ private:
 public:
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
+    bool ReadBlockSolution(const uint256 &hash, std::vector<unsigned char> &solution);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
@@ -125,11 +151,26 @@ public:
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+    bool UpdateOfferIndex(const std::vector<COfferIndexDbEntry> &offers, const std::vector<COfferOutPointDbEntry> &outPoints, const std::vector<COfferExpiryDbEntry> &expiries);
+    bool ReadOfferIndex(unsigned int type, const uint160 &primaryID, const uint160 &secondaryID, std::vector<COfferIndexDbEntry> &offers);
+    bool ReadOfferOutPoint(const COutPoint &outPoint, std::vector<COfferIndexValue> &offers);
+    bool ReadOfferOutPoints(std::set<COutPoint> &outPoints);
+    bool ReadOfferExpiries(uint32_t expiryHeight, std::vector<COfferIndexValue> &offers);
+    bool WriteIdentityIndex(const std::vector<CIdentityRevisionDbEntry> &revisions, const std::vector<CIdentityContentDbEntry> &content);
+    bool EraseIdentityIndex(const std::vector<CIdentityRevisionDbEntry> &revisions, const std::vector<CIdentityContentDbEntry> &content);
+    bool ReadIdentityRevision(const CIdentityRevisionKey &key, CIdentityRevisionValue &revision);
+    bool ReadIdentityRevisions(const uint160 &identityID, std::vector<CIdentityRevisionDbEntry> &revisions, int start = 0, int end = 0);
+    bool ReadIdentityContent(const uint160 &identityID, const uint160 &vdxfKey, std::vector<CIdentityContentDbEntry> &content, int start = 0, int end = 0);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
     bool blockOnchainActive(const uint256 &hash);
     UniValue Snapshot(int top);
+    bool WriteChainSnapshotBlockIndex(CDBIterator &cursor, const boost::function<bool(const uint256&)> &isInChain, CChainSnapshotWriter &writer);
+    bool WriteChainSnapshotIndexes(CDBIterator &cursor, const boost::function<bool(const uint256&)> &isInChain, CChainSnapshotWriter &writer);
+    bool WriteSnapshotRecords(const std::vector<std::pair<std::string, std::string>> &records);
+    bool WriteSnapshotHeight(int nHeight);
+    bool ReadSnapshotHeight(int &nHeight);
 };
 
 #endif // BITCOIN_TXDB_H
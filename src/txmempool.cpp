@@ -20,12 +20,15 @@
 #include "pbaas/pbaas.h"
 #include "pbaas/identity.h"
 #include "pbaas/notarization.h"
+#include "pbaas/converters.h"
 
 using namespace std;
 
 CTxMemPoolEntry::CTxMemPoolEntry():
     nFee(0), nTxSize(0), nModSize(0), nUsageSize(0), nTime(0), dPriority(0.0),
-    hadNoDependencies(false), spendsCoinbase(false), hasReserve(false), feeDelta(0)
+    hadNoDependencies(false), spendsCoinbase(false), hasReserve(false), feeDelta(0),
+    nCountWithAncestors(1), nSizeWithAncestors(0), nModFeesWithAncestors(0),
+    nCountWithDescendants(1), nSizeWithDescendants(0), nModFeesWithDescendants(0)
 {
     nHeight = MEMPOOL_HEIGHT;
 }
@@ -42,6 +45,13 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
     nModSize = _tx.CalculateModifiedSize(nTxSize);
     nUsageSize = RecursiveDynamicUsage(*tx) + memusage::DynamicUsage(tx);
     feeRate = CFeeRate(nFee, nTxSize);
+
+    nCountWithAncestors = 1;
+    nSizeWithAncestors = nTxSize;
+    nModFeesWithAncestors = GetModifiedFee();
+    nCountWithDescendants = 1;
+    nSizeWithDescendants = nTxSize;
+    nModFeesWithDescendants = GetModifiedFee();
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
@@ -60,6 +70,31 @@ CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
     return dResult;
 }
 
+void CTxMemPoolEntry::UpdateFeeDelta(int64_t FeeDelta)
+{
+    nModFeesWithAncestors += FeeDelta - feeDelta;
+    nModFeesWithDescendants += FeeDelta - feeDelta;
+    feeDelta = FeeDelta;
+}
+
+void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithAncestors += modifySize;
+    assert(int64_t(nSizeWithAncestors) > 0);
+    nModFeesWithAncestors += modifyFee;
+    nCountWithAncestors += modifyCount;
+    assert(int64_t(nCountWithAncestors) > 0);
+}
+
+void CTxMemPoolEntry::UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithDescendants += modifySize;
+    assert(int64_t(nSizeWithDescendants) > 0);
+    nModFeesWithDescendants += modifyFee;
+    nCountWithDescendants += modifyCount;
+    assert(int64_t(nCountWithDescendants) > 0);
+}
+
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee) :
     nTransactionsUpdated(0)
 {
@@ -117,16 +152,222 @@ void CTxMemPool::AddTransactionsUpdated(unsigned int n)
 }
 
 
+void CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, bool fSearchForParents) const
+{
+    setEntries parentHashes;
+    const CTransaction &tx = entry.GetTx();
+
+    if (fSearchForParents) {
+        // Get parents of this transaction that are in the mempool
+        if (!tx.IsCoinImport()) {
+            for (unsigned int i = 0; i < tx.vin.size(); i++) {
+                txiter piter = mapTx.find(tx.vin[i].prevout.hash);
+                if (piter != mapTx.end())
+                    parentHashes.insert(piter);
+            }
+        }
+    } else {
+        // If we're not searching for parents, we require this to be an
+        // entry in the mempool already.
+        txiter it = mapTx.iterator_to(entry);
+        parentHashes = GetMemPoolParents(it);
+    }
+
+    while (!parentHashes.empty()) {
+        txiter stageit = *parentHashes.begin();
+        setAncestors.insert(stageit);
+        parentHashes.erase(stageit);
+
+        const setEntries &setMemPoolParents = GetMemPoolParents(stageit);
+        BOOST_FOREACH(const txiter &phash, setMemPoolParents) {
+            // If this is a new ancestor, add it.
+            if (setAncestors.count(phash) == 0)
+                parentHashes.insert(phash);
+        }
+    }
+}
+
+bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount,
+                                           uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize,
+                                           std::string &errString) const
+{
+    setEntries parentHashes;
+    const CTransaction &tx = entry.GetTx();
+
+    if (!tx.IsCoinImport()) {
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            txiter piter = mapTx.find(tx.vin[i].prevout.hash);
+            if (piter != mapTx.end()) {
+                parentHashes.insert(piter);
+                if (parentHashes.size() + 1 > limitAncestorCount) {
+                    errString = strprintf("too many unconfirmed parents [limit: %u]", limitAncestorCount);
+                    return false;
+                }
+            }
+        }
+    }
+
+    uint64_t totalSizeWithAncestors = entry.GetTxSize();
+    while (!parentHashes.empty()) {
+        txiter stageit = *parentHashes.begin();
+        setAncestors.insert(stageit);
+        parentHashes.erase(stageit);
+        totalSizeWithAncestors += stageit->GetTxSize();
+
+        if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
+            errString = strprintf("exceeds descendant size limit for tx %s [limit: %u]", stageit->GetTx().GetHash().ToString(), limitDescendantSize);
+            return false;
+        } else if (stageit->GetCountWithDescendants() + 1 > limitDescendantCount) {
+            errString = strprintf("too many descendants for tx %s [limit: %u]", stageit->GetTx().GetHash().ToString(), limitDescendantCount);
+            return false;
+        } else if (totalSizeWithAncestors > limitAncestorSize) {
+            errString = strprintf("exceeds ancestor size limit [limit: %u]", limitAncestorSize);
+            return false;
+        }
+
+        const setEntries &setMemPoolParents = GetMemPoolParents(stageit);
+        BOOST_FOREACH(const txiter &phash, setMemPoolParents) {
+            // If this is a new ancestor, add it.
+            if (setAncestors.count(phash) == 0)
+                parentHashes.insert(phash);
+            if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
+                errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants) const
+{
+    setEntries stage;
+    if (setDescendants.count(entryit) == 0)
+        stage.insert(entryit);
+    // Traverse down the children of entry, only adding children that are not
+    // accounted for in setDescendants already (because those children have either
+    // already been walked, or will be walked in this iteration).
+    while (!stage.empty()) {
+        txiter it = *stage.begin();
+        setDescendants.insert(it);
+        stage.erase(it);
+
+        const setEntries &setChildren = GetMemPoolChildren(it);
+        BOOST_FOREACH(const txiter &childiter, setChildren) {
+            if (setDescendants.count(childiter) == 0)
+                stage.insert(childiter);
+        }
+    }
+}
+
+const CTxMemPool::setEntries &CTxMemPool::GetMemPoolParents(txiter entry) const
+{
+    assert(entry != mapTx.end());
+    txlinksMap::const_iterator it = mapLinks.find(entry);
+    assert(it != mapLinks.end());
+    return it->second.parents;
+}
+
+const CTxMemPool::setEntries &CTxMemPool::GetMemPoolChildren(txiter entry) const
+{
+    assert(entry != mapTx.end());
+    txlinksMap::const_iterator it = mapLinks.find(entry);
+    assert(it != mapLinks.end());
+    return it->second.children;
+}
+
+void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
+{
+    setEntries s;
+    if (add && mapLinks[entry].parents.insert(parent).second) {
+        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
+    } else if (!add && mapLinks[entry].parents.erase(parent)) {
+        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    }
+}
+
+void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
+{
+    setEntries s;
+    if (add && mapLinks[entry].children.insert(child).second) {
+        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
+    } else if (!add && mapLinks[entry].children.erase(child)) {
+        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    }
+}
+
+void CTxMemPool::RecalculatePackageState(txiter it)
+{
+    setEntries setAncestors;
+    CalculateMemPoolAncestors(*it, setAncestors, false);
+    int64_t ancestorSize = it->GetTxSize();
+    CAmount ancestorFees = it->GetModifiedFee();
+    BOOST_FOREACH(const txiter &ancestorIt, setAncestors) {
+        ancestorSize += ancestorIt->GetTxSize();
+        ancestorFees += ancestorIt->GetModifiedFee();
+    }
+    mapTx.modify(it, update_ancestor_state(ancestorSize - it->GetSizeWithAncestors(),
+                                           ancestorFees - it->GetModFeesWithAncestors(),
+                                           int64_t(setAncestors.size() + 1) - it->GetCountWithAncestors()));
+
+    setEntries setDescendants;
+    CalculateDescendants(it, setDescendants);
+    int64_t descendantSize = 0;
+    CAmount descendantFees = 0;
+    BOOST_FOREACH(const txiter &descendantIt, setDescendants) {
+        descendantSize += descendantIt->GetTxSize();
+        descendantFees += descendantIt->GetModifiedFee();
+    }
+    mapTx.modify(it, update_descendant_state(descendantSize - it->GetSizeWithDescendants(),
+                                             descendantFees - it->GetModFeesWithDescendants(),
+                                             int64_t(setDescendants.size()) - it->GetCountWithDescendants()));
+}
+
 bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, bool fCurrentEstimate)
 {
     // Add to memory pool without checking anything.
     // Used by main.cpp AcceptToMemoryPool(), which DOES do
     // all the appropriate checks.
     LOCK(cs);
-    mapTx.insert(entry);
-    const CTransaction& tx = mapTx.find(hash)->GetTx();
+    txiter newit = mapTx.insert(entry).first;
+    mapLinks.insert(make_pair(newit, TxLinks()));
+
+    // Apply any prioritisation made before the transaction entered the mempool
+    std::map<uint256, std::pair<double, CAmount> >::const_iterator pos = mapDeltas.find(hash);
+    if (pos != mapDeltas.end() && pos->second.second != newit->GetModifiedFee() - newit->GetFee()) {
+        mapTx.modify(newit, update_fee_delta(pos->second.second));
+    }
+
+    const CTransaction& tx = newit->GetTx();
     mapRecentlyAddedTx[tx.GetHash()] = &tx;
     nRecentlyAddedSequence += 1;
+
+    // Link to parents in the mempool, and to any children that are already here, which happens
+    // when a disconnected block returns its transactions to the mempool
+    setEntries setParentTransactions;
+    if (!tx.IsCoinImport()) {
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            txiter piter = mapTx.find(tx.vin[i].prevout.hash);
+            if (piter != mapTx.end())
+                setParentTransactions.insert(piter);
+        }
+    }
+    setEntries setChildTransactions;
+    std::map<COutPoint, CInPoint>::iterator nextIt = mapNextTx.lower_bound(COutPoint(hash, 0));
+    for (; nextIt != mapNextTx.end() && nextIt->first.hash == hash; nextIt++) {
+        txiter childit = mapTx.find(nextIt->second.ptx->GetHash());
+        assert(childit != mapTx.end());
+        setChildTransactions.insert(childit);
+    }
+    BOOST_FOREACH(const txiter &piter, setParentTransactions) {
+        UpdateParent(newit, piter, true);
+        UpdateChild(piter, newit, true);
+    }
+    BOOST_FOREACH(const txiter &citer, setChildTransactions) {
+        UpdateChild(newit, citer, true);
+        UpdateParent(citer, newit, true);
+    }
+
     if (!tx.IsCoinImport()) {
         for (unsigned int i = 0; i < tx.vin.size(); i++)
             mapNextTx[tx.vin[i].prevout] = CInPoint(&tx, i);
@@ -139,9 +380,32 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     for (const SpendDescription &spendDescription : tx.vShieldedSpend) {
         mapSaplingNullifiers[spendDescription.nullifier] = &tx;
     }
+
+    setEntries setAncestors;
+    CalculateMemPoolAncestors(*newit, setAncestors, false);
+    if (setChildTransactions.empty()) {
+        // A new leaf adds itself to the descendant state of each of its ancestors
+        int64_t updateSize = 0;
+        CAmount updateFee = 0;
+        BOOST_FOREACH(const txiter &ancestorIt, setAncestors) {
+            mapTx.modify(ancestorIt, update_descendant_state(newit->GetTxSize(), newit->GetModifiedFee(), 1));
+            updateSize += ancestorIt->GetTxSize();
+            updateFee += ancestorIt->GetModifiedFee();
+        }
+        mapTx.modify(newit, update_ancestor_state(updateSize, updateFee, setAncestors.size()));
+    } else {
+        // Descendants may already share some of the new entry's ancestors, so recompute the
+        // affected packages rather than adding the new entry's aggregates to them
+        setEntries setAffected(setAncestors);
+        CalculateDescendants(newit, setAffected);
+        BOOST_FOREACH(const txiter &affectedIt, setAffected) {
+            RecalculatePackageState(affectedIt);
+        }
+    }
+
     nTransactionsUpdated++;
-    totalTxSize += entry.GetTxSize();
-    cachedInnerUsage += entry.DynamicMemoryUsage();
+    totalTxSize += newit->GetTxSize();
+    cachedInnerUsage += newit->DynamicMemoryUsage();
     minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
 
     return true;
@@ -362,14 +626,130 @@ bool CTxMemPool::removeSpentIndex(const uint256 txhash)
     return true;
 }
 
+void CTxMemPool::addOfferIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
+{
+    LOCK(cs);
+    const CTransaction& tx = entry.GetTx();
+    COfferIndexValue offer;
+    if (GetOfferIndexValue(tx, view, -1, offer))
+    {
+        std::vector<COfferIndexKey> inserted({offer.GetKey(COfferIndexKey::OFFERED), offer.GetKey(COfferIndexKey::REQUESTED)});
+        for (auto &oneKey : inserted)
+        {
+            mapOffers.insert(make_pair(oneKey, offer));
+        }
+        mapOffersInserted.insert(make_pair(tx.GetHash(), inserted));
+    }
+}
+
+void CTxMemPool::getOfferIndex(unsigned int type, const uint160 &primaryID, const uint160 &secondaryID, std::vector<std::pair<COfferIndexKey, COfferIndexValue>> &offers)
+{
+    LOCK(cs);
+    for (auto it = mapOffers.lower_bound(COfferIndexKey(type, primaryID, secondaryID));
+         it != mapOffers.end() &&
+            it->first.type == type &&
+            it->first.primaryID == primaryID &&
+            (secondaryID.IsNull() || it->first.secondaryID == secondaryID);
+         it++)
+    {
+        offers.push_back(*it);
+    }
+}
+
+bool CTxMemPool::removeOfferIndex(const uint256 txhash)
+{
+    LOCK(cs);
+    auto it = mapOffersInserted.find(txhash);
+
+    if (it != mapOffersInserted.end()) {
+        for (auto &oneKey : it->second) {
+            mapOffers.erase(oneKey);
+        }
+        mapOffersInserted.erase(it);
+    }
+
+    return true;
+}
+
+void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants)
+{
+    // Remaining descendants of a transaction that leaves the mempool without them, such as one
+    // that was mined, lose it from their ancestor state
+    if (updateDescendants) {
+        BOOST_FOREACH(const txiter &removeIt, entriesToRemove) {
+            setEntries setDescendants;
+            CalculateDescendants(removeIt, setDescendants);
+            setDescendants.erase(removeIt);
+            BOOST_FOREACH(const txiter &descendantIt, setDescendants) {
+                if (!entriesToRemove.count(descendantIt))
+                    mapTx.modify(descendantIt, update_ancestor_state(-(int64_t)removeIt->GetTxSize(), -removeIt->GetModifiedFee(), -1));
+            }
+        }
+    }
+    // All ancestors lose the removed transactions from their descendant state. This has to be
+    // finished for every entry before any links are cut, or later entries would miss ancestors.
+    BOOST_FOREACH(const txiter &removeIt, entriesToRemove) {
+        setEntries setAncestors;
+        CalculateMemPoolAncestors(*removeIt, setAncestors, false);
+        BOOST_FOREACH(const txiter &ancestorIt, setAncestors) {
+            mapTx.modify(ancestorIt, update_descendant_state(-(int64_t)removeIt->GetTxSize(), -removeIt->GetModifiedFee(), -1));
+        }
+    }
+    BOOST_FOREACH(const txiter &removeIt, entriesToRemove) {
+        BOOST_FOREACH(const txiter &childIt, GetMemPoolChildren(removeIt)) {
+            UpdateParent(childIt, removeIt, false);
+        }
+        BOOST_FOREACH(const txiter &parentIt, GetMemPoolParents(removeIt)) {
+            UpdateChild(parentIt, removeIt, false);
+        }
+    }
+}
+
+void CTxMemPool::removeUnchecked(txiter it)
+{
+    const uint256 hash = it->GetTx().GetHash();
+    const CTransaction& tx = it->GetTx();
+
+    mapRecentlyAddedTx.erase(hash);
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+        mapNextTx.erase(txin.prevout);
+    BOOST_FOREACH(const JSDescription& joinsplit, tx.vJoinSplit) {
+        BOOST_FOREACH(const uint256& nf, joinsplit.nullifiers) {
+            mapSproutNullifiers.erase(nf);
+        }
+    }
+    for (const SpendDescription &spendDescription : tx.vShieldedSpend) {
+        mapSaplingNullifiers.erase(spendDescription.nullifier);
+    }
+
+    totalTxSize -= it->GetTxSize();
+    cachedInnerUsage -= it->DynamicMemoryUsage();
+    cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
+    mapLinks.erase(it);
+    mapTx.erase(it);
+    nTransactionsUpdated++;
+    minerPolicyEstimator->removeTx(hash);
+    if (fAddressIndex)
+        removeAddressIndex(hash);
+    if (fSpentIndex)
+        removeSpentIndex(hash);
+    if (fOfferIndex)
+        removeOfferIndex(hash);
+    ConverterGraph.RemoveMempoolTransaction(hash);
+    NotarizationDataCache.RemoveMempoolTransaction(hash);
+    ClearPrioritisation(hash);
+}
+
 void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& removed, bool fRecursive)
 {
     // Remove transaction from memory pool
     {
         LOCK(cs);
-        std::deque<uint256> txToRemove;
-        txToRemove.push_back(origTx.GetHash());
-        if (fRecursive && !mapTx.count(origTx.GetHash())) {
+        setEntries txToRemove;
+        txiter origit = mapTx.find(origTx.GetHash());
+        if (origit != mapTx.end()) {
+            txToRemove.insert(origit);
+        } else if (fRecursive) {
             // If recursively removing but origTx isn't in the mempool
             // be sure to remove any children that are in the pool. This can
             // happen during chain re-orgs if origTx isn't re-accepted into
@@ -378,46 +758,32 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
                 std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(COutPoint(origTx.GetHash(), i));
                 if (it == mapNextTx.end())
                     continue;
-                txToRemove.push_back(it->second.ptx->GetHash());
+                txiter nextit = mapTx.find(it->second.ptx->GetHash());
+                assert(nextit != mapTx.end());
+                txToRemove.insert(nextit);
             }
         }
-        while (!txToRemove.empty())
-        {
-            uint256 hash = txToRemove.front();
-            txToRemove.pop_front();
-            if (!mapTx.count(hash))
-                continue;
-            const CTransaction& tx = mapTx.find(hash)->GetTx();
-            if (fRecursive) {
-                for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                    std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(COutPoint(hash, i));
-                    if (it == mapNextTx.end())
-                        continue;
-                    txToRemove.push_back(it->second.ptx->GetHash());
-                }
-            }
-            mapRecentlyAddedTx.erase(hash);
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
-                mapNextTx.erase(txin.prevout);
-            BOOST_FOREACH(const JSDescription& joinsplit, tx.vJoinSplit) {
-                BOOST_FOREACH(const uint256& nf, joinsplit.nullifiers) {
-                    mapSproutNullifiers.erase(nf);
-                }
-            }
-            for (const SpendDescription &spendDescription : tx.vShieldedSpend) {
-                mapSaplingNullifiers.erase(spendDescription.nullifier);
+        setEntries setAllRemoves;
+        if (fRecursive) {
+            BOOST_FOREACH(const txiter &it, txToRemove) {
+                CalculateDescendants(it, setAllRemoves);
             }
-            removed.push_back(tx);
-            totalTxSize -= mapTx.find(hash)->GetTxSize();
-            cachedInnerUsage -= mapTx.find(hash)->DynamicMemoryUsage();
-            mapTx.erase(hash);
-            nTransactionsUpdated++;
-            minerPolicyEstimator->removeTx(hash);
-            if (fAddressIndex)
-                removeAddressIndex(hash);
-            if (fSpentIndex)
-                removeSpentIndex(hash);
-            ClearPrioritisation(tx.GetHash());
+        } else {
+            setAllRemoves.swap(txToRemove);
+        }
+
+        // report parents before their children
+        std::vector<txiter> vRemoves(setAllRemoves.begin(), setAllRemoves.end());
+        std::stable_sort(vRemoves.begin(), vRemoves.end(), [](const txiter &a, const txiter &b) {
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        });
+        BOOST_FOREACH(const txiter &it, vRemoves) {
+            removed.push_back(it->GetTx());
+        }
+
+        UpdateForRemoveFromMempool(setAllRemoves, !fRecursive);
+        BOOST_FOREACH(const txiter &it, vRemoves) {
+            removeUnchecked(it);
         }
     }
 }
@@ -847,6 +1213,7 @@ void CTxMemPool::removeWithoutBranchId(uint32_t nMemPoolBranchId)
 void CTxMemPool::clear()
 {
     LOCK(cs);
+    mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
     mapReserveTransactions.clear();
@@ -879,7 +1246,12 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         checkTotal += it->GetTxSize();
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
+        txlinksMap::const_iterator linksiter = mapLinks.find(it);
+        assert(linksiter != mapLinks.end());
+        const TxLinks &links = linksiter->second;
+        innerUsage += memusage::DynamicUsage(links.parents) + memusage::DynamicUsage(links.children);
         bool fDependsWait = false;
+        setEntries setParentCheck;
         BOOST_FOREACH(const CTxIn &txin, tx.vin) {
             // Check that every mempool transaction's inputs refer to available coins, or other mempool tx's.
             indexed_transaction_set::const_iterator it2 = mapTx.find(txin.prevout.hash);
@@ -887,6 +1259,8 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
                 const CTransaction& tx2 = it2->GetTx();
                 assert(tx2.vout.size() > txin.prevout.n && !tx2.vout[txin.prevout.n].IsNull());
                 fDependsWait = true;
+                if (!tx.IsCoinImport())
+                    setParentCheck.insert(it2);
             } else {
                 const CCoins* coins = pcoins->AccessCoins(txin.prevout.hash);
                 assert(coins && coins->IsAvailable(txin.prevout.n));
@@ -898,6 +1272,41 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
             assert(it3->second.n == i);
             i++;
         }
+        assert(setParentCheck == GetMemPoolParents(it));
+
+        // Check the package statistics against the ancestors and descendants reachable by links
+        setEntries setAncestors;
+        CalculateMemPoolAncestors(*it, setAncestors, true);
+        uint64_t nSizeCheck = it->GetTxSize();
+        CAmount nFeesCheck = it->GetModifiedFee();
+        BOOST_FOREACH(const txiter &ancestorIt, setAncestors) {
+            nSizeCheck += ancestorIt->GetTxSize();
+            nFeesCheck += ancestorIt->GetModifiedFee();
+        }
+        assert(it->GetCountWithAncestors() == setAncestors.size() + 1);
+        assert(it->GetSizeWithAncestors() == nSizeCheck);
+        assert(it->GetModFeesWithAncestors() == nFeesCheck);
+
+        setEntries setChildrenCheck;
+        std::map<COutPoint, CInPoint>::const_iterator iter = mapNextTx.lower_bound(COutPoint(tx.GetHash(), 0));
+        for (; iter != mapNextTx.end() && iter->first.hash == tx.GetHash(); iter++) {
+            txiter childit = mapTx.find(iter->second.ptx->GetHash());
+            assert(childit != mapTx.end()); // mapNextTx points to in-mempool transactions
+            setChildrenCheck.insert(childit);
+        }
+        assert(setChildrenCheck == GetMemPoolChildren(it));
+
+        setEntries setDescendants;
+        CalculateDescendants(it, setDescendants);
+        nSizeCheck = 0;
+        nFeesCheck = 0;
+        BOOST_FOREACH(const txiter &descendantIt, setDescendants) {
+            nSizeCheck += descendantIt->GetTxSize();
+            nFeesCheck += descendantIt->GetModifiedFee();
+        }
+        assert(it->GetCountWithDescendants() == setDescendants.size());
+        assert(it->GetSizeWithDescendants() == nSizeCheck);
+        assert(it->GetModFeesWithDescendants() == nFeesCheck);
 
         boost::unordered_map<uint256, SproutMerkleTree, CCoinsKeyHasher> intermediates;
 
@@ -1083,6 +1492,23 @@ void CTxMemPool::PrioritiseTransaction(const uint256 &hash, const string strHash
         std::pair<double, CAmount> &deltas = mapDeltas[hash];
         deltas.first += dPriorityDelta;
         deltas.second += nFeeDelta;
+
+        // keep the modified fees of the entry and of every package it belongs to current
+        txiter it = mapTx.find(hash);
+        if (it != mapTx.end() && nFeeDelta) {
+            mapTx.modify(it, update_fee_delta(deltas.second));
+            setEntries setAncestors;
+            CalculateMemPoolAncestors(*it, setAncestors, false);
+            BOOST_FOREACH(const txiter &ancestorIt, setAncestors) {
+                mapTx.modify(ancestorIt, update_descendant_state(0, nFeeDelta, 0));
+            }
+            setEntries setDescendants;
+            CalculateDescendants(it, setDescendants);
+            setDescendants.erase(it);
+            BOOST_FOREACH(const txiter &descendantIt, setDescendants) {
+                mapTx.modify(descendantIt, update_ancestor_state(0, nFeeDelta, 0));
+            }
+        }
     }
     if (fDebug)
     {
@@ -1244,5 +1670,5 @@ bool CCoinsViewMemPool::HaveCoins(const uint256 &txid) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 6 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 6 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapDeltas) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 6 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapDeltas) + cachedInnerUsage;
 }
@@ -10,6 +10,7 @@
 
 #include "addressindex.h"
 #include "spentindex.h"
+#include "offerindex.h"
 #include "amount.h"
 #include "coins.h"
 #include "primitives/transaction.h"
@@ -61,6 +62,14 @@ private:
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     uint32_t nBranchId; //! Branch ID this transaction is known to commit to, cached for efficiency
 
+    // Package statistics, maintained incrementally by the mempool. Both include this transaction.
+    uint64_t nCountWithAncestors; //! number of in-mempool ancestors, plus one
+    uint64_t nSizeWithAncestors; //! ... and their total size
+    CAmount nModFeesWithAncestors; //! ... and their total fees, including prioritisation deltas
+    uint64_t nCountWithDescendants; //! number of in-mempool descendants, plus one
+    uint64_t nSizeWithDescendants; //! ... and their total size
+    CAmount nModFeesWithDescendants; //! ... and their total fees, including prioritisation deltas
+
 public:
     CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
                     int64_t _nTime, double _dPriority, unsigned int _nHeight,
@@ -72,7 +81,7 @@ public:
     std::shared_ptr<const CTransaction> GetSharedTx() const { return this->tx; }
     double GetPriority(unsigned int currentHeight) const;
     CAmount GetFee() const { return nFee; }
-    void UpdateFeeDelta(int64_t FeeDelta) { feeDelta = FeeDelta; }
+    void UpdateFeeDelta(int64_t FeeDelta);
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     CFeeRate GetFeeRate() const { return feeRate; }
     size_t GetTxSize() const { return nTxSize; }
@@ -83,6 +92,17 @@ public:
 
     bool GetSpendsCoinbase() const { return spendsCoinbase; }
     uint32_t GetValidatedBranchId() const { return nBranchId; }
+
+    // Adjusts the package statistics when ancestors or descendants enter or leave the mempool
+    void UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+
+    uint64_t GetCountWithAncestors() const { return nCountWithAncestors; }
+    uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
+    CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
+    uint64_t GetCountWithDescendants() const { return nCountWithDescendants; }
+    uint64_t GetSizeWithDescendants() const { return nSizeWithDescendants; }
+    CAmount GetModFeesWithDescendants() const { return nModFeesWithDescendants; }
 };
 
 struct update_fee_delta
@@ -95,6 +115,32 @@ private:
     int64_t feeDelta;
 };
 
+struct update_ancestor_state
+{
+    update_ancestor_state(int64_t _modifySize, CAmount _modifyFee, int64_t _modifyCount) :
+        modifySize(_modifySize), modifyFee(_modifyFee), modifyCount(_modifyCount) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.UpdateAncestorState(modifySize, modifyFee, modifyCount); }
+
+private:
+    int64_t modifySize;
+    CAmount modifyFee;
+    int64_t modifyCount;
+};
+
+struct update_descendant_state
+{
+    update_descendant_state(int64_t _modifySize, CAmount _modifyFee, int64_t _modifyCount) :
+        modifySize(_modifySize), modifyFee(_modifyFee), modifyCount(_modifyCount) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.UpdateDescendantState(modifySize, modifyFee, modifyCount); }
+
+private:
+    int64_t modifySize;
+    CAmount modifyFee;
+    int64_t modifyCount;
+};
+
 // extracts a TxMemPoolEntry's transaction hash
 struct mempoolentry_txid
 {
@@ -108,7 +154,7 @@ struct mempoolentry_txid
 class CompareTxMemPoolEntryByFee
 {
 public:
-    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b)
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
     {
         if (a.GetFeeRate() == b.GetFeeRate())
             return a.GetTime() < b.GetTime();
@@ -214,11 +260,35 @@ public:
     mutable CCriticalSection cs;
     indexed_transaction_set mapTx;
 
+    typedef indexed_transaction_set::nth_index<0>::type::const_iterator txiter;
+    struct CompareIteratorByHash {
+        bool operator()(const txiter &a, const txiter &b) const {
+            return a->GetTx().GetHash() < b->GetTx().GetHash();
+        }
+    };
+    typedef std::set<txiter, CompareIteratorByHash> setEntries;
+
 private:
     std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> mapAddress;
     std::map<uint256, std::vector<CMempoolAddressDeltaKey> > mapAddressInserted;
     std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpent;
     std::map<uint256, std::vector<CSpentIndexKey>> mapSpentInserted;
+    std::map<COfferIndexKey, COfferIndexValue> mapOffers;
+    std::map<uint256, std::vector<COfferIndexKey>> mapOffersInserted;
+
+    // in-mempool parents and children of each entry, kept in step with mapNextTx
+    struct TxLinks {
+        setEntries parents;
+        setEntries children;
+    };
+    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
+    txlinksMap mapLinks;
+
+    void UpdateParent(txiter entry, txiter parent, bool add);
+    void UpdateChild(txiter entry, txiter child, bool add);
+    void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants);
+    void RecalculatePackageState(txiter it);
+    void removeUnchecked(txiter it);
 
 public:
     std::map<COutPoint, CInPoint> mapNextTx;
@@ -246,6 +316,10 @@ public:
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool getSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
     bool removeSpentIndex(const uint256 txhash);
+
+    void addOfferIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
+    void getOfferIndex(unsigned int type, const uint160 &primaryID, const uint160 &secondaryID, std::vector<std::pair<COfferIndexKey, COfferIndexValue>> &offers);
+    bool removeOfferIndex(const uint256 txhash);
     void remove(const CTransaction &tx, std::list<CTransaction>& removed, bool fRecursive = false);
     void removeWithAnchor(const uint256 &invalidRoot, ShieldedType type);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
@@ -256,6 +330,26 @@ public:
                         std::list<CTransaction>& conflicts, bool fCurrentEstimate = true);
     void removeWithoutBranchId(uint32_t nMemPoolBranchId);
     void clear();
+
+    /**
+     * Collect all in-mempool ancestors of entry. If fSearchForParents is false, entry must be in
+     * the mempool and its parents are taken from its links rather than looked up by its inputs.
+     */
+    void CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, bool fSearchForParents = true) const;
+    /**
+     * Collect the in-mempool ancestors of an entry that is not in the mempool yet, failing with errString as soon as
+     * the entry would have more than limitAncestorCount ancestors or limitAncestorSize bytes of them, counting itself,
+     * or one of them would have more than limitDescendantCount descendants or limitDescendantSize bytes of them, so
+     * that a long chain costs no more than the limits to check.
+     */
+    bool CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount,
+                                   uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize,
+                                   std::string &errString) const;
+    /** Add it and all of its in-mempool descendants to setDescendants, stopping at entries already in the set. */
+    void CalculateDescendants(txiter it, setEntries &setDescendants) const;
+    const setEntries &GetMemPoolParents(txiter entry) const;
+    const setEntries &GetMemPoolChildren(txiter entry) const;
+
     void queryHashes(std::vector<uint256>& vtxid);
     void pruneSpent(const uint256& hash, CCoins &coins);
     unsigned int GetTransactionsUpdated() const;
@@ -9,7 +9,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 170010;
+static const int PROTOCOL_VERSION = 170011;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -35,6 +35,9 @@ static const int MEMPOOL_GD_VERSION = 60002;
 //! "filter*" commands are disabled without NODE_BLOOM after and including this version
 static const int NO_BLOOM_VERSION = 170004;
 
+//! "cmpctblock", "getblocktxn" and "blocktxn" messages and MSG_CMPCT_BLOCK getdata start with this version
+static const int COMPACT_BLOCKS_VERSION = 170011;
+
 #define KOMODO_VERSION "0.2.1"
 #define VERUS_VERSION "1.2.9-4"
 
@@ -3,9 +3,11 @@
 #include <sodium.h>
 
 #include "base58.h"
+#include "cc/CCinclude.h"
 #include "chainparams.h"
 #include "key_io.h"
 #include "main.h"
+#include "pbaas/reserves.h"
 #include "primitives/block.h"
 #include "random.h"
 #include "transaction_builder.h"
@@ -2082,3 +2084,328 @@ TEST(WalletTests, SaplingNoteLocking) {
     EXPECT_FALSE(wallet.IsLockedNote(sop1));
     EXPECT_FALSE(wallet.IsLockedNote(sop2));
 }
+
+TEST(WalletTests, BalanceTotals) {
+    uint160 currencyA = uint160(ParseHex("0101010101010101010101010101010101010101"));
+    uint160 currencyB = uint160(ParseHex("0202020202020202020202020202020202020202"));
+
+    CWalletTxBalances totals, tx1, tx2;
+    EXPECT_TRUE(tx1.IsEmpty());
+
+    tx1.native[CWalletTxBalances::AVAILABLE] = 5 * COIN;
+    tx1.reserve[CWalletTxBalances::AVAILABLE].valueMap[currencyA] = 2 * COIN;
+    tx2.native[CWalletTxBalances::AVAILABLE] = 3 * COIN;
+    tx2.reserve[CWalletTxBalances::AVAILABLE].valueMap[currencyA] = COIN;
+    tx2.reserve[CWalletTxBalances::IMMATURE].valueMap[currencyB] = 7 * COIN;
+    EXPECT_FALSE(tx1.IsEmpty());
+
+    tx1.AddTo(totals);
+    tx2.AddTo(totals);
+    EXPECT_EQ(8 * COIN, totals.native[CWalletTxBalances::AVAILABLE]);
+    EXPECT_EQ(3 * COIN, totals.reserve[CWalletTxBalances::AVAILABLE].valueMap[currencyA]);
+    EXPECT_EQ(7 * COIN, totals.reserve[CWalletTxBalances::IMMATURE].valueMap[currencyB]);
+
+    // Removing a transaction leaves no zero entries behind
+    tx2.SubtractFrom(totals);
+    EXPECT_TRUE(totals == tx1);
+    EXPECT_EQ(0, totals.reserve[CWalletTxBalances::IMMATURE].valueMap.size());
+
+    tx1.SubtractFrom(totals);
+    EXPECT_TRUE(totals.IsEmpty());
+}
+
+TEST(WalletTests, BalanceTotalsMatchRecalculation) {
+    SelectParams(CBaseChainParams::TESTNET);
+
+    CWallet wallet("wallet_balances.dat");
+    bool fFirstRun;
+    ASSERT_EQ(DB_LOAD_OK, wallet.LoadWallet(fFirstRun));
+
+    CKey key;
+    key.MakeNewKey(true);
+    ASSERT_TRUE(wallet.AddKey(key));
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+    CScript scriptOther = CScript() << OP_TRUE;
+
+    // received in a block
+    CMutableTransaction mtx1;
+    mtx1.vin.push_back(CTxIn(GetRandHash(), 0));
+    mtx1.vout.push_back(CTxOut(5 * COIN, scriptMine));
+    CTransaction tx1(mtx1);
+
+    CBlock block1;
+    block1.vtx.push_back(tx1);
+    block1.hashMerkleRoot = block1.BuildMerkleTree();
+    auto blockHash1 = block1.GetHash();
+    CBlockIndex index1 {block1};
+    index1.SetHeight(0);
+    mapBlockIndex.insert(std::make_pair(blockHash1, &index1));
+
+    chainActive.SetTip(&index1);
+    wallet.SyncTransaction(tx1, &block1);
+    EXPECT_TRUE(wallet.CheckBalances());
+    EXPECT_EQ(5 * COIN, wallet.GetBalance());
+
+    // spent, with change, in the next block
+    CMutableTransaction mtx2;
+    mtx2.vin.push_back(CTxIn(tx1.GetHash(), 0));
+    mtx2.vout.push_back(CTxOut(2 * COIN, scriptMine));
+    mtx2.vout.push_back(CTxOut(3 * COIN, scriptOther));
+    CTransaction tx2(mtx2);
+
+    CBlock block2;
+    block2.vtx.push_back(tx2);
+    block2.hashMerkleRoot = block2.BuildMerkleTree();
+    auto blockHash2 = block2.GetHash();
+    CBlockIndex index2 {block2};
+    index2.pprev = &index1;
+    index2.SetHeight(1);
+    mapBlockIndex.insert(std::make_pair(blockHash2, &index2));
+
+    chainActive.SetTip(&index2);
+    wallet.SyncTransaction(tx2, &block2);
+    EXPECT_TRUE(wallet.CheckBalances());
+    EXPECT_EQ(2 * COIN, wallet.GetBalance());
+
+    // reorg the spend out, in the order DisconnectTip notifies the wallet, which leaves it conflicted
+    chainActive.SetTip(&index1);
+    wallet.SyncTransaction(tx2, NULL);
+    EXPECT_TRUE(wallet.CheckBalances());
+    EXPECT_EQ(5 * COIN, wallet.GetBalance());
+
+    // and connect a competing block, which is updated incrementally from the last query
+    CMutableTransaction mtx3;
+    mtx3.vin.push_back(CTxIn(GetRandHash(), 0));
+    mtx3.vout.push_back(CTxOut(COIN, scriptMine));
+    CTransaction tx3(mtx3);
+
+    CBlock block3;
+    block3.vtx.push_back(tx3);
+    block3.hashMerkleRoot = block3.BuildMerkleTree();
+    auto blockHash3 = block3.GetHash();
+    CBlockIndex index3 {block3};
+    index3.pprev = &index1;
+    index3.SetHeight(1);
+    mapBlockIndex.insert(std::make_pair(blockHash3, &index3));
+
+    chainActive.SetTip(&index3);
+    wallet.SyncTransaction(tx3, &block3);
+    EXPECT_TRUE(wallet.CheckBalances());
+    EXPECT_EQ(6 * COIN, wallet.GetBalance());
+
+    wallet.MarkDirty();
+    EXPECT_TRUE(wallet.CheckBalances());
+    EXPECT_EQ(6 * COIN, wallet.GetBalance());
+
+    // Tear down
+    chainActive.SetTip(NULL);
+    mapBlockIndex.erase(blockHash1);
+    mapBlockIndex.erase(blockHash2);
+    mapBlockIndex.erase(blockHash3);
+}
+
+// the outputs, depths and spendability returned by a coin query
+static std::set<std::tuple<uint256, int, int, bool>> CoinSet(const std::vector<COutput> &vCoins)
+{
+    std::set<std::tuple<uint256, int, int, bool>> coins;
+    for (auto &coin : vCoins)
+    {
+        coins.insert(std::make_tuple(coin.tx->GetHash(), coin.i, coin.nDepth, coin.fSpendable));
+    }
+    return coins;
+}
+
+// runs the coin queries against the incrementally maintained spendable output index and
+// again after a full rebuild of it from mapWallet, expects them to match, and returns the
+// number of coins each query found
+static std::vector<size_t> ExpectAvailableCoinsMatchFullScan(CWallet &wallet, const CTxDestination &dest, const uint160 &currency)
+{
+    CCurrencyValueMap onlyCurrency(std::vector<uint160>({currency}), std::vector<int64_t>({1}));
+    std::vector<std::set<std::tuple<uint256, int, int, bool>>> results[2];
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1)
+        {
+            wallet.InvalidateSpendableOutputs();
+        }
+        std::vector<COutput> vCoins;
+        wallet.AvailableCoins(vCoins, true);
+        results[pass].push_back(CoinSet(vCoins));
+        wallet.AvailableCoins(vCoins, false, NULL, true);
+        results[pass].push_back(CoinSet(vCoins));
+        wallet.AvailableReserveCoins(vCoins, true, NULL, true);
+        results[pass].push_back(CoinSet(vCoins));
+        wallet.AvailableReserveCoins(vCoins, true, NULL, true, true, &dest);
+        results[pass].push_back(CoinSet(vCoins));
+        wallet.AvailableReserveCoins(vCoins, true, NULL, true, false, nullptr, &onlyCurrency);
+        results[pass].push_back(CoinSet(vCoins));
+        wallet.AvailableReserveCoins(vCoins, true, NULL, true, false, &dest, &onlyCurrency);
+        results[pass].push_back(CoinSet(vCoins));
+    }
+
+    std::vector<size_t> counts;
+    for (int i = 0; i < results[0].size(); i++)
+    {
+        EXPECT_TRUE(results[0][i] == results[1][i]) << "coin query " << i << " differs from a full scan";
+        counts.push_back(results[1][i].size());
+    }
+    return counts;
+}
+
+TEST(WalletTests, SpendableOutputIndexMatchesFullScan) {
+    SelectParams(CBaseChainParams::TESTNET);
+
+    CWallet wallet("wallet_spendable.dat");
+    bool fFirstRun;
+    ASSERT_EQ(DB_LOAD_OK, wallet.LoadWallet(fFirstRun));
+
+    uint160 currencyA = uint160(ParseHex("0101010101010101010101010101010101010101"));
+
+    CKey key, importKey;
+    key.MakeNewKey(true);
+    importKey.MakeNewKey(true);
+    ASSERT_TRUE(wallet.AddKey(key));
+    CTxDestination destMine = CTxDestination(key.GetPubKey().GetID());
+    CTxDestination destImport = CTxDestination(importKey.GetPubKey().GetID());
+    CScript scriptMine = GetScriptForDestination(destMine);
+    CScript scriptImport = GetScriptForDestination(destImport);
+    CScript scriptOther = CScript() << OP_TRUE;
+
+    // received in a block, native to two destinations, and currencyA to each of them
+    CTokenOutput tokenMine(currencyA, 4 * COIN);
+    CTokenOutput tokenImport(currencyA, 2 * COIN);
+    CMutableTransaction mtx1;
+    mtx1.vin.push_back(CTxIn(GetRandHash(), 0));
+    mtx1.vout.push_back(CTxOut(5 * COIN, scriptMine));
+    mtx1.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CTokenOutput>(EVAL_RESERVE_OUTPUT, {destMine}, 1, &tokenMine))));
+    mtx1.vout.push_back(CTxOut(3 * COIN, scriptImport));
+    mtx1.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CTokenOutput>(EVAL_RESERVE_OUTPUT, {destImport}, 1, &tokenImport))));
+    CTransaction tx1(mtx1);
+
+    CBlock block1;
+    block1.vtx.push_back(tx1);
+    block1.hashMerkleRoot = block1.BuildMerkleTree();
+    auto blockHash1 = block1.GetHash();
+    CBlockIndex index1 {block1};
+    index1.SetHeight(0);
+    mapBlockIndex.insert(std::make_pair(blockHash1, &index1));
+
+    chainActive.SetTip(&index1);
+    wallet.SyncTransaction(tx1, &block1);
+    std::vector<size_t> counts = ExpectAvailableCoinsMatchFullScan(wallet, destMine, currencyA);
+    EXPECT_EQ(1, counts[0]);
+    EXPECT_EQ(2, counts[1]);
+    EXPECT_EQ(1, counts[4]);
+    EXPECT_EQ(1, counts[5]);
+
+    // spent, with change, in the next block
+    CMutableTransaction mtx2;
+    mtx2.vin.push_back(CTxIn(tx1.GetHash(), 0));
+    mtx2.vout.push_back(CTxOut(2 * COIN, scriptMine));
+    mtx2.vout.push_back(CTxOut(3 * COIN, scriptOther));
+    CTransaction tx2(mtx2);
+
+    CBlock block2;
+    block2.vtx.push_back(tx2);
+    block2.hashMerkleRoot = block2.BuildMerkleTree();
+    auto blockHash2 = block2.GetHash();
+    CBlockIndex index2 {block2};
+    index2.pprev = &index1;
+    index2.SetHeight(1);
+    mapBlockIndex.insert(std::make_pair(blockHash2, &index2));
+
+    chainActive.SetTip(&index2);
+    wallet.SyncTransaction(tx2, &block2);
+    counts = ExpectAvailableCoinsMatchFullScan(wallet, destMine, currencyA);
+    EXPECT_EQ(1, counts[0]);
+    EXPECT_EQ(2, counts[3]);
+    EXPECT_EQ(1, counts[5]);
+
+    // reorg the spend out, in the order DisconnectTip notifies the wallet
+    chainActive.SetTip(&index1);
+    wallet.SyncTransaction(tx2, NULL);
+    ExpectAvailableCoinsMatchFullScan(wallet, destMine, currencyA);
+
+    // and connect a competing block, which is updated incrementally from the last query
+    CMutableTransaction mtx3;
+    mtx3.vin.push_back(CTxIn(GetRandHash(), 0));
+    mtx3.vout.push_back(CTxOut(COIN, scriptMine));
+    CTransaction tx3(mtx3);
+
+    CBlock block3;
+    block3.vtx.push_back(tx3);
+    block3.hashMerkleRoot = block3.BuildMerkleTree();
+    auto blockHash3 = block3.GetHash();
+    CBlockIndex index3 {block3};
+    index3.pprev = &index1;
+    index3.SetHeight(1);
+    mapBlockIndex.insert(std::make_pair(blockHash3, &index3));
+
+    chainActive.SetTip(&index3);
+    wallet.SyncTransaction(tx3, &block3);
+    ExpectAvailableCoinsMatchFullScan(wallet, destMine, currencyA);
+
+    // importing the key of the other destination makes its native and currencyA outputs spendable
+    ASSERT_TRUE(wallet.AddKey(importKey));
+    counts = ExpectAvailableCoinsMatchFullScan(wallet, destImport, currencyA);
+    EXPECT_EQ(2, counts[4]);
+    EXPECT_EQ(1, counts[5]);
+
+    // and watching a script adds the output of the reorged spend that paid it
+    ASSERT_TRUE(wallet.AddWatchOnly(scriptOther));
+    ExpectAvailableCoinsMatchFullScan(wallet, destMine, currencyA);
+
+    // Tear down
+    chainActive.SetTip(NULL);
+    mapBlockIndex.erase(blockHash1);
+    mapBlockIndex.erase(blockHash2);
+    mapBlockIndex.erase(blockHash3);
+}
+
+TEST(WalletTests, LoadWalletTransactionsInParallel) {
+    SelectParams(CBaseChainParams::TESTNET);
+    int nPrevScriptCheckThreads = nScriptCheckThreads;
+    nScriptCheckThreads = 4;
+
+    // enough transactions for several batches on each thread
+    std::vector<CWalletTx> vWtx;
+    {
+        CWalletDB walletdb("wallet_loadtxs.dat", "cr+");
+        for (int i = 0; i < 2000; i++) {
+            CMutableTransaction mtx;
+            mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+            mtx.vout.push_back(CTxOut(i + 1, CScript() << OP_TRUE));
+            CWalletTx wtx(NULL, mtx);
+            wtx.nOrderPos = i;
+            ASSERT_TRUE(walletdb.WriteTx(wtx.GetHash(), wtx));
+            vWtx.push_back(wtx);
+        }
+    }
+
+    bool fFirstRun;
+    {
+        CWallet wallet("wallet_loadtxs.dat");
+        ASSERT_EQ(DB_LOAD_OK, wallet.LoadWallet(fFirstRun));
+        ASSERT_EQ(vWtx.size(), wallet.mapWallet.size());
+        for (auto &wtx : vWtx) {
+            auto it = wallet.mapWallet.find(wtx.GetHash());
+            ASSERT_TRUE(it != wallet.mapWallet.end());
+            EXPECT_EQ(wtx.nOrderPos, it->second.nOrderPos);
+            EXPECT_EQ(wtx.vout[0].nValue, it->second.vout[0].nValue);
+        }
+    }
+
+    // a record whose transaction does not match its key is skipped, and only reported
+    {
+        CWalletDB walletdb("wallet_loadtxs.dat");
+        ASSERT_TRUE(walletdb.WriteTx(GetRandHash(), vWtx[0]));
+    }
+    {
+        CWallet wallet("wallet_loadtxs.dat");
+        EXPECT_EQ(DB_NONCRITICAL_ERROR, wallet.LoadWallet(fFirstRun));
+        EXPECT_EQ(vWtx.size(), wallet.mapWallet.size());
+    }
+
+    nScriptCheckThreads = nPrevScriptCheckThreads;
+    mapArgs.erase("-rescan");
+}
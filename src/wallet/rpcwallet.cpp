@@ -5488,12 +5488,64 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             sample_times.push_back(benchmark_listunspent());
         } else if (benchmarktype == "createsaplingspend") {
             sample_times.push_back(benchmark_create_sapling_spend());
+        } else if (benchmarktype == "preparesaplingdescriptions") {
+            // Number of spends in the transaction and threads that prepare them
+            int nSpends = params.size() >= 3 ? params[2].get_int() : 10;
+            int nPrepareThreads = params.size() >= 4 ? params[3].get_int() : GetNumCores();
+            if (nSpends <= 0 || nPrepareThreads <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid spend or thread count");
+            }
+            sample_times.push_back(benchmark_prepare_sapling_descriptions(nSpends, nPrepareThreads));
         } else if (benchmarktype == "createsaplingoutput") {
             sample_times.push_back(benchmark_create_sapling_output());
         } else if (benchmarktype == "verifysaplingspend") {
             sample_times.push_back(benchmark_verify_sapling_spend());
         } else if (benchmarktype == "verifysaplingoutput") {
             sample_times.push_back(benchmark_verify_sapling_output());
+        } else if (benchmarktype == "verifysaplingblock") {
+            // Number of spends in the simulated block and number of verification threads
+            int nSpends = params.size() >= 3 ? params[2].get_int() : 100;
+            int nThreads = params.size() >= 4 ? params[3].get_int() : std::max(nScriptCheckThreads, 1);
+            if (nSpends <= 0 || nThreads <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid spend or thread count");
+            }
+            sample_times.push_back(benchmark_verify_sapling_block(nSpends, nThreads));
+        } else if (benchmarktype == "merkleroot") {
+            // Number of transactions in the block whose merkle root is computed
+            int nTxs = params.size() >= 3 ? params[2].get_int() : 10000;
+            if (nTxs <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid transaction count");
+            }
+            sample_times.push_back(benchmark_merkle_root(nTxs));
+        } else if (benchmarktype == "mmradd" || benchmarktype == "mmraddlayers") {
+            // Number of leaves in the merkle mountain range
+            int nLeaves = params.size() >= 3 ? params[2].get_int() : 100000;
+            if (nLeaves <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid leaf count");
+            }
+            sample_times.push_back(benchmark_mmr_build(nLeaves, benchmarktype == "mmraddlayers"));
+        } else if (benchmarktype == "availablereservecoins") {
+            // Number of unspent outputs in the synthetic wallet
+            int nUTXOs = params.size() >= 3 ? params[2].get_int() : 500000;
+            if (nUTXOs <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid output count");
+            }
+            sample_times.push_back(benchmark_available_reserve_coins(nUTXOs));
+        } else if (benchmarktype == "readccfulfillment" || benchmarktype == "readccfulfillmentarena") {
+            // Number of fulfillments read, each as one script check would
+            int nReads = params.size() >= 3 ? params[2].get_int() : 100000;
+            if (nReads <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid read count");
+            }
+            sample_times.push_back(benchmark_read_cc_fulfillment(nReads, benchmarktype == "readccfulfillmentarena"));
+        } else if (benchmarktype == "blockjson" || benchmarktype == "blockjsonstream") {
+            // Height of the block to write, the tip by default
+            int nHeight;
+            {
+                LOCK(cs_main);
+                nHeight = params.size() >= 3 ? params[2].get_int() : chainActive.Height();
+            }
+            sample_times.push_back(benchmark_block_json(nHeight, benchmarktype == "blockjsonstream"));
         } else {
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid benchmarktype");
         }
@@ -53,6 +53,7 @@ CFeeRate payTxFee(DEFAULT_TRANSACTION_FEE);
 CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
 unsigned int nTxConfirmTarget = DEFAULT_TX_CONFIRM_TARGET;
 bool bSpendZeroConfChange = true;
+bool fCheckWalletBalances = false;
 bool fSendFreeTransactions = false;
 bool fPayAtLeastCustomFee = true;
 #include "komodo_defs.h"
@@ -359,6 +360,10 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
         return false;
 
+    // outputs to this key that the wallet already holds may now be spendable
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
+
     // check if we need to remove from watch-only
     CScript script;
     script = GetScriptForDestination(pubkey.GetID());
@@ -552,6 +557,8 @@ bool CWallet::AddCScript(const CScript& redeemScript)
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteCScript(ScriptOrIdentityID(redeemScript), redeemScript);
@@ -580,6 +587,8 @@ bool CWallet::AddIdentity(const CIdentityMapKey &mapKey, const CIdentityMapValue
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddIdentity(mapKey, identity))
         return false;
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -592,6 +601,8 @@ bool CWallet::UpdateIdentity(const CIdentityMapKey &mapKey, const CIdentityMapVa
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::UpdateIdentity(mapKey, identity))
         return false;
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -604,6 +615,8 @@ bool CWallet::AddUpdateIdentity(const CIdentityMapKey &mapKey, const CIdentityMa
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddUpdateIdentity(mapKey, identity))
         return false;
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -623,6 +636,8 @@ void CWallet::ClearIdentities(uint32_t fromHeight)
     }
 
     CCryptoKeyStore::ClearIdentities(fromHeight);
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
 }
 
 bool CWallet::RemoveIdentity(const CIdentityMapKey &mapKey, const uint256 &txid)
@@ -655,6 +670,8 @@ bool CWallet::RemoveIdentity(const CIdentityMapKey &mapKey, const uint256 &txid)
     }
     if (!CCryptoKeyStore::RemoveIdentity(mapKey, txid))
         return false;
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
     if (!fFileBacked)
         return true;
 
@@ -811,6 +828,8 @@ bool CWallet::AddWatchOnly(const CScript &dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
     nTimeFirstKey = 1; // No birthday information for watch-only keys.
     NotifyWatchonlyChanged(true);
     if (!fFileBacked)
@@ -823,6 +842,8 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    InvalidateBalances();
+    InvalidateSpendableOutputs();
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (fFileBacked)
@@ -2309,6 +2330,8 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
+        InvalidateBalances();
+        InvalidateSpendableOutputs();
         BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
             item.second.MarkDirty();
     }
@@ -3480,8 +3503,20 @@ void CWallet::EraseFromWallet(const uint256 &hash)
         return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        auto wtxIt = mapWallet.find(hash);
+        if (wtxIt != mapWallet.end())
+        {
+            // outputs this spent are no longer spent
+            for (auto &txin : wtxIt->second.vin)
+            {
+                MarkBalanceDirty(txin.prevout.hash);
+                MarkSpendableOutputsDirty(txin.prevout.hash);
+            }
+            mapWallet.erase(wtxIt);
             CWalletDB(strWalletFile).EraseTx(hash);
+            MarkBalanceDirty(hash);
+            MarkSpendableOutputsDirty(hash);
+        }
     }
     return;
 }
@@ -5000,222 +5035,546 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime)
 
 
 
-/** @defgroup Actions
- *
- * @{
- */
-
-
-CAmount CWallet::GetBalance(bool includeIDLocked) const
+bool CWalletTxBalances::IsEmpty() const
 {
-    CAmount nTotal = 0;
+    for (int i = 0; i < BALANCE_TYPE_COUNT; i++)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        if (native[i] || reserve[i].valueMap.size())
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit(includeIDLocked, includeIDLocked);
+            return false;
         }
     }
-
-    return nTotal;
+    return true;
 }
 
-CAmount CWallet::GetSharedBalance(bool includeIDLocked) const
+void CWalletTxBalances::AddTo(CWalletTxBalances &totals) const
 {
-    CAmount nTotal = 0;
+    for (int i = 0; i < BALANCE_TYPE_COUNT; i++)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        totals.native[i] += native[i];
+        for (auto &oneCur : reserve[i].valueMap)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit(includeIDLocked, includeIDLocked, ISMINE_SHARED);
+            // updated in place, since the totals may hold many currencies
+            CAmount &total = totals.reserve[i].valueMap[oneCur.first];
+            total += oneCur.second;
+            if (!total)
+            {
+                totals.reserve[i].valueMap.erase(oneCur.first);
+            }
         }
     }
-
-    return nTotal;
 }
 
-CCurrencyValueMap CWallet::GetReserveBalance(bool includeIDLocked) const
+void CWalletTxBalances::SubtractFrom(CWalletTxBalances &totals) const
 {
-    CCurrencyValueMap retVal;
+    for (int i = 0; i < BALANCE_TYPE_COUNT; i++)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        totals.native[i] -= native[i];
+        for (auto &oneCur : reserve[i].valueMap)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                retVal += pcoin->GetAvailableReserveCredit(includeIDLocked, includeIDLocked);
+            CAmount &total = totals.reserve[i].valueMap[oneCur.first];
+            total -= oneCur.second;
+            if (!total)
+            {
+                totals.reserve[i].valueMap.erase(oneCur.first);
+            }
         }
     }
-
-    return retVal;
 }
 
-CCurrencyValueMap CWallet::GetSharedReserveBalance(bool includeIDLocked) const
+bool CWalletTxBalances::operator==(const CWalletTxBalances &operand) const
 {
-    CCurrencyValueMap retVal;
+    for (int i = 0; i < BALANCE_TYPE_COUNT; i++)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        if (native[i] != operand.native[i] || !(reserve[i] == operand.reserve[i]))
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                retVal += pcoin->GetAvailableReserveCredit(includeIDLocked, includeIDLocked, ISMINE_SHARED);
+            return false;
         }
     }
+    return true;
+}
 
-    return retVal;
+void CWalletTx::MarkWalletCachesDirty()
+{
+    if (pwallet)
+    {
+        pwallet->MarkBalanceDirty(GetHash());
+        pwallet->MarkSpendableOutputsDirty(GetHash());
+    }
 }
 
-CAmount CWallet::GetUnconfirmedBalance() const
+void CWallet::MarkBalanceDirty(const uint256 &hash) const
 {
-    CAmount nTotal = 0;
+    LOCK(cs_wallet);
+    // if the balances are not valid, they will all be recalculated anyhow
+    if (fBalancesValid)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
-                nTotal += pcoin->GetAvailableCredit();
-        }
+        setBalancesDirty.insert(hash);
     }
-    return nTotal;
 }
 
-CCurrencyValueMap CWallet::GetUnconfirmedReserveBalance() const
+void CWallet::InvalidateBalances()
 {
-    CCurrencyValueMap retVal;
+    LOCK(cs_wallet);
+    fBalancesValid = false;
+    setBalancesDirty.clear();
+}
+
+// the contribution of one transaction to each balance total, calculated the same way as when summing over all of mapWallet
+CWalletTxBalances CWallet::CalcTxBalances(const CWalletTx &wtx) const
+{
+    CWalletTxBalances retVal;
+
+    bool isFinal = CheckFinalTx(wtx);
+    int nDepth = wtx.GetDepthInMainChain();
+    bool isTrusted = wtx.IsTrusted();
+
+    if (isTrusted)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        retVal.native[CWalletTxBalances::AVAILABLE] = wtx.GetAvailableCredit(true, true);
+        retVal.native[CWalletTxBalances::AVAILABLE_UNLOCKED] = wtx.GetAvailableCredit(false, false);
+        retVal.native[CWalletTxBalances::SHARED] = wtx.GetAvailableCredit(true, true, ISMINE_SHARED);
+        retVal.native[CWalletTxBalances::SHARED_UNLOCKED] = wtx.GetAvailableCredit(false, false, ISMINE_SHARED);
+        retVal.native[CWalletTxBalances::WATCH_AVAILABLE] = wtx.GetAvailableWatchOnlyCredit();
+
+        retVal.reserve[CWalletTxBalances::AVAILABLE] = wtx.GetAvailableReserveCredit(true, true).CanonicalMap();
+        retVal.reserve[CWalletTxBalances::AVAILABLE_UNLOCKED] = wtx.GetAvailableReserveCredit(false, false).CanonicalMap();
+        retVal.reserve[CWalletTxBalances::SHARED] = wtx.GetAvailableReserveCredit(true, true, ISMINE_SHARED).CanonicalMap();
+        retVal.reserve[CWalletTxBalances::SHARED_UNLOCKED] = wtx.GetAvailableReserveCredit(false, false, ISMINE_SHARED).CanonicalMap();
+        retVal.reserve[CWalletTxBalances::WATCH_AVAILABLE] = wtx.GetAvailableWatchOnlyReserveCredit().CanonicalMap();
+    }
+
+    if (!isFinal || (!isTrusted && nDepth == 0))
+    {
+        retVal.native[CWalletTxBalances::UNCONFIRMED] = wtx.GetAvailableCredit();
+        retVal.native[CWalletTxBalances::WATCH_UNCONFIRMED] = wtx.GetAvailableWatchOnlyCredit();
+
+        retVal.reserve[CWalletTxBalances::UNCONFIRMED] = wtx.GetAvailableReserveCredit().CanonicalMap();
+        retVal.reserve[CWalletTxBalances::WATCH_UNCONFIRMED] = wtx.GetAvailableWatchOnlyReserveCredit().CanonicalMap();
+    }
+
+    retVal.native[CWalletTxBalances::IMMATURE] = wtx.GetImmatureCredit();
+    retVal.native[CWalletTxBalances::WATCH_IMMATURE] = wtx.GetImmatureWatchOnlyCredit();
+    retVal.reserve[CWalletTxBalances::IMMATURE] = wtx.GetImmatureReserveCredit().CanonicalMap();
+    retVal.reserve[CWalletTxBalances::WATCH_IMMATURE] = wtx.GetImmatureWatchOnlyReserveCredit().CanonicalMap();
+
+    // unconfirmed transactions can leave the mempool or be conflicted, and non-final or immature ones change
+    // with the chain, all without being marked dirty
+    retVal.fVolatile = !isFinal || nDepth <= 0 || (wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0);
+
+    // whether outputs to an ID are locked depends on the height
+    for (auto &oneOut : wtx.vout)
+    {
+        CTxDestination checkDest;
+        if (ExtractDestination(oneOut.scriptPubKey, checkDest) && checkDest.which() == COptCCParams::ADDRTYPE_ID)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
-                retVal += pcoin->GetAvailableReserveCredit();
+            retVal.fIDSensitive = true;
+            break;
         }
     }
     return retVal;
 }
 
-CAmount CWallet::GetImmatureBalance() const
+void CWallet::UpdateTxBalances(const uint256 &hash) const
 {
-    CAmount nTotal = 0;
+    auto recordIt = mapTxBalances.find(hash);
+    if (recordIt != mapTxBalances.end())
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureCredit();
-        }
+        recordIt->second.SubtractFrom(balanceTotals);
+        mapTxBalances.erase(recordIt);
+    }
+    setBalancesVolatile.erase(hash);
+    setBalancesIDSensitive.erase(hash);
+
+    // erased transactions are only removed from the totals
+    auto wtxIt = mapWallet.find(hash);
+    if (wtxIt == mapWallet.end())
+    {
+        return;
+    }
+
+    CWalletTxBalances txBalances = CalcTxBalances(wtxIt->second);
+    if (txBalances.fVolatile)
+    {
+        setBalancesVolatile.insert(hash);
+    }
+    if (txBalances.fIDSensitive)
+    {
+        setBalancesIDSensitive.insert(hash);
+    }
+    // most transactions in a large wallet are spent, so only keep records of those that contribute
+    if (!txBalances.IsEmpty())
+    {
+        txBalances.AddTo(balanceTotals);
+        mapTxBalances.insert(std::make_pair(hash, txBalances));
     }
-    return nTotal;
 }
 
-CCurrencyValueMap CWallet::GetImmatureReserveBalance() const
+void CWallet::RebuildBalances() const
 {
-    CCurrencyValueMap retVal;
+    mapTxBalances.clear();
+    setBalancesDirty.clear();
+    setBalancesVolatile.clear();
+    setBalancesIDSensitive.clear();
+    balanceTotals = CWalletTxBalances();
+
+    for (auto &txidAndWtx : mapWallet)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            retVal += pcoin->GetImmatureReserveCredit();
-        }
+        UpdateTxBalances(txidAndWtx.first);
     }
-    return retVal;
+    fBalancesValid = true;
 }
 
-CAmount CWallet::GetWatchOnlyBalance() const
+// the balance totals summed over all of mapWallet, without the records kept for incremental updates
+CWalletTxBalances CWallet::RecalculateBalances() const
 {
-    CAmount nTotal = 0;
+    CWalletTxBalances totals;
+    for (auto &txidAndWtx : mapWallet)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        CalcTxBalances(txidAndWtx.second).AddTo(totals);
+    }
+    return totals;
+}
+
+const CWalletTxBalances &CWallet::GetBalances() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    const CBlockIndex *pindexTip = chainActive.LastTip();
+
+    if (!fBalancesValid || (pBalancesTip && !chainActive.Contains(pBalancesTip)))
+    {
+        RebuildBalances();
+    }
+    else
+    {
+        std::set<uint256> toUpdate;
+        toUpdate.swap(setBalancesDirty);
+
+        if (pBalancesTip != pindexTip)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
+            toUpdate.insert(setBalancesIDSensitive.begin(), setBalancesIDSensitive.end());
+        }
+
+        // when a spend of our outputs leaves the mempool or is conflicted, the outputs it spent become available again
+        for (auto &hash : setBalancesVolatile)
+        {
+            toUpdate.insert(hash);
+            auto wtxIt = mapWallet.find(hash);
+            if (wtxIt != mapWallet.end())
+            {
+                for (auto &txin : wtxIt->second.vin)
+                {
+                    if (mapWallet.count(txin.prevout.hash))
+                    {
+                        toUpdate.insert(txin.prevout.hash);
+                    }
+                }
+            }
+        }
+
+        for (auto &hash : toUpdate)
+        {
+            UpdateTxBalances(hash);
+        }
+    }
+    pBalancesTip = pindexTip;
+
+    if (fCheckWalletBalances)
+    {
+        if (!(RecalculateBalances() == balanceTotals))
+        {
+            LogPrintf("ERROR: %s: incrementally maintained wallet balances do not match a full recalculation, rebuilding\n", __func__);
+            RebuildBalances();
         }
     }
+    return balanceTotals;
+}
+
+bool CWallet::CheckBalances() const
+{
+    LOCK2(cs_main, cs_wallet);
+    const CWalletTxBalances &totals = GetBalances();
+    return RecalculateBalances() == totals;
+}
+
+/** @defgroup Actions
+ *
+ * @{
+ */
+
+
+CAmount CWallet::GetBalance(bool includeIDLocked) const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().native[includeIDLocked ? CWalletTxBalances::AVAILABLE : CWalletTxBalances::AVAILABLE_UNLOCKED];
+}
+
+CAmount CWallet::GetSharedBalance(bool includeIDLocked) const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().native[includeIDLocked ? CWalletTxBalances::SHARED : CWalletTxBalances::SHARED_UNLOCKED];
+}
+
+CCurrencyValueMap CWallet::GetReserveBalance(bool includeIDLocked) const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().reserve[includeIDLocked ? CWalletTxBalances::AVAILABLE : CWalletTxBalances::AVAILABLE_UNLOCKED];
+}
+
+CCurrencyValueMap CWallet::GetSharedReserveBalance(bool includeIDLocked) const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().reserve[includeIDLocked ? CWalletTxBalances::SHARED : CWalletTxBalances::SHARED_UNLOCKED];
+}
+
+CAmount CWallet::GetUnconfirmedBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().native[CWalletTxBalances::UNCONFIRMED];
+}
+
+CCurrencyValueMap CWallet::GetUnconfirmedReserveBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().reserve[CWalletTxBalances::UNCONFIRMED];
+}
+
+CAmount CWallet::GetImmatureBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().native[CWalletTxBalances::IMMATURE];
+}
+
+CCurrencyValueMap CWallet::GetImmatureReserveBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().reserve[CWalletTxBalances::IMMATURE];
+}
 
-    return nTotal;
+CAmount CWallet::GetWatchOnlyBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().native[CWalletTxBalances::WATCH_AVAILABLE];
 }
 
 CCurrencyValueMap CWallet::GetWatchOnlyReserveBalance() const
 {
-    CCurrencyValueMap retVal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().reserve[CWalletTxBalances::WATCH_AVAILABLE];
+}
+
+CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().native[CWalletTxBalances::WATCH_UNCONFIRMED];
+}
+
+CCurrencyValueMap CWallet::GetUnconfirmedWatchOnlyReserveBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().reserve[CWalletTxBalances::WATCH_UNCONFIRMED];
+}
+
+CAmount CWallet::GetImmatureWatchOnlyBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().native[CWalletTxBalances::WATCH_IMMATURE];
+}
+
+CCurrencyValueMap CWallet::GetImmatureWatchOnlyReserveBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().reserve[CWalletTxBalances::WATCH_IMMATURE];
+}
+
+void CWallet::MarkSpendableOutputsDirty(const uint256 &hash) const
+{
+    LOCK(cs_wallet);
+    if (fSpendableOutputsValid)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        setSpendableOutputsDirty.insert(hash);
+    }
+}
+
+void CWallet::InvalidateSpendableOutputs()
+{
+    LOCK(cs_wallet);
+    fSpendableOutputsValid = false;
+    setSpendableOutputsDirty.clear();
+}
+
+// spent by a wallet transaction in a block on the main chain, which can only be undone by a reorg
+bool CWallet::IsSpentInMainChain(const uint256 &hash, unsigned int n) const
+{
+    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(hash, n));
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it)
+    {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && mit->second.GetDepthInMainChain() >= 1)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                retVal += pcoin->GetAvailableWatchOnlyReserveCredit();
+            return true;
         }
     }
-
-    return retVal;
+    return false;
 }
 
-CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
+void CWallet::IndexSpendableOutputs(const uint256 &hash) const
 {
-    CAmount nTotal = 0;
+    auto wtxIt = mapWallet.find(hash);
+    if (wtxIt == mapWallet.end())
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        return;
+    }
+    const CWalletTx &wtx = wtxIt->second;
+
+    for (int i = 0; i < wtx.vout.size(); i++)
+    {
+        const CTxOut &txOut = wtx.vout[i];
+        isminetype mine = IsMine(txOut);
+        if (mine == ISMINE_NO || IsSpentInMainChain(hash, i))
+        {
+            continue;
+        }
+
+        COptCCParams p;
+        CCurrencyValueMap reserveValues = txOut.scriptPubKey.ReserveOutValue(p, true);
+        if (p.IsValid() && !txOut.scriptPubKey.IsSpendableOutputType(p))
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
+            continue;
+        }
+
+        std::vector<uint160> destinationIDs;
+        if (p.IsValid())
+        {
+            for (auto &oneDest : p.vKeys)
+            {
+                destinationIDs.push_back(GetDestinationID(oneDest));
+            }
         }
+        else
+        {
+            // P2PK or P2PKH
+            CTxDestination dest;
+            if (ExtractDestination(txOut.scriptPubKey, dest))
+            {
+                destinationIDs.push_back(GetDestinationID(dest));
+            }
+        }
+
+        COutPoint outPoint(hash, i);
+        CSpendableOutput spendable(mine, reserveValues.CanonicalMap(), destinationIDs);
+
+        std::vector<uint160> currencies;
+        if (txOut.nValue)
+        {
+            currencies.push_back(uint160());
+        }
+        for (auto &oneCur : spendable.reserveValues.valueMap)
+        {
+            currencies.push_back(oneCur.first);
+        }
+        if (!destinationIDs.size())
+        {
+            destinationIDs.push_back(uint160());
+        }
+        for (auto &oneCur : currencies)
+        {
+            for (auto &oneDestID : destinationIDs)
+            {
+                setSpendableOutputsByCurrency.insert(std::make_tuple(oneCur, oneDestID, outPoint));
+            }
+        }
+        mapSpendableOutputs.insert(std::make_pair(outPoint, spendable));
     }
-    return nTotal;
 }
 
-CCurrencyValueMap CWallet::GetUnconfirmedWatchOnlyReserveBalance() const
+void CWallet::UnindexSpendableOutputs(const uint256 &hash) const
 {
-    CCurrencyValueMap retVal;
+    auto it = mapSpendableOutputs.lower_bound(COutPoint(hash, 0));
+    while (it != mapSpendableOutputs.end() && it->first.hash == hash)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<uint160> destinationIDs = it->second.destinationIDs;
+        if (!destinationIDs.size())
+        {
+            destinationIDs.push_back(uint160());
+        }
+        for (auto &oneDestID : destinationIDs)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
-                retVal += pcoin->GetAvailableWatchOnlyReserveCredit();
+            setSpendableOutputsByCurrency.erase(std::make_tuple(uint160(), oneDestID, it->first));
+            for (auto &oneCur : it->second.reserveValues.valueMap)
+            {
+                setSpendableOutputsByCurrency.erase(std::make_tuple(oneCur.first, oneDestID, it->first));
+            }
         }
+        it = mapSpendableOutputs.erase(it);
     }
-    return retVal;
 }
 
-CAmount CWallet::GetImmatureWatchOnlyBalance() const
+void CWallet::UpdateSpendableOutputs() const
 {
-    CAmount nTotal = 0;
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    const CBlockIndex *pindexTip = chainActive.LastTip();
+
+    if (!fSpendableOutputsValid || (pSpendableOutputsTip && !chainActive.Contains(pSpendableOutputsTip)))
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        mapSpendableOutputs.clear();
+        setSpendableOutputsByCurrency.clear();
+        setSpendableOutputsDirty.clear();
+        for (auto &txidAndWtx : mapWallet)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit();
+            IndexSpendableOutputs(txidAndWtx.first);
         }
+        fSpendableOutputsValid = true;
     }
-    return nTotal;
+    else
+    {
+        std::set<uint256> toUpdate;
+        toUpdate.swap(setSpendableOutputsDirty);
+        for (auto &hash : toUpdate)
+        {
+            UnindexSpendableOutputs(hash);
+            IndexSpendableOutputs(hash);
+        }
+    }
+    pSpendableOutputsTip = pindexTip;
 }
 
-CCurrencyValueMap CWallet::GetImmatureWatchOnlyReserveBalance() const
+// the outputs that may be spendable and that hold any of the currencies, if specified, in wallet order
+void CWallet::GetSpendableOutputCandidates(std::vector<COutPoint> &candidates, const std::set<uint160> *pCurrencies, const CTxDestination *pOnlyFromDest) const
 {
-    CCurrencyValueMap retVal;
+    candidates.clear();
+    uint160 destID = pOnlyFromDest ? GetDestinationID(*pOnlyFromDest) : uint160();
+
+    if (!pCurrencies)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (auto &oneOutput : mapSpendableOutputs)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            retVal += pcoin->GetImmatureWatchOnlyReserveCredit();
+            if (!pOnlyFromDest || oneOutput.second.HasDestination(destID))
+            {
+                candidates.push_back(oneOutput.first);
+            }
         }
+        return;
     }
-    return retVal;
+
+    for (auto &oneCur : *pCurrencies)
+    {
+        auto it = setSpendableOutputsByCurrency.lower_bound(std::make_tuple(oneCur, destID, COutPoint(uint256(), 0)));
+        for (; it != setSpendableOutputsByCurrency.end() && std::get<0>(*it) == oneCur; it++)
+        {
+            if (pOnlyFromDest && std::get<1>(*it) != destID)
+            {
+                break;
+            }
+            candidates.push_back(std::get<2>(*it));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
 }
 
 /**
@@ -5232,103 +5591,111 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
     {
         LOCK2(cs_main, cs_wallet);
         uint32_t nHeight = chainActive.Height() + 1;
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+
+        // unless zero valued outputs are wanted, only those with native value
+        std::set<uint160> nativeOnly({uint160()});
+        std::vector<COutPoint> candidates;
+        UpdateSpendableOutputs();
+        GetSpendableOutputCandidates(candidates, fIncludeZeroValue ? nullptr : &nativeOnly, nullptr);
+
+        const CWalletTx* pcoin = nullptr;
+        bool skipTx = true;
+        int nDepth = 0;
+        for (auto &candidate : candidates)
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const uint256& wtxid = candidate.hash;
+            int i = candidate.n;
 
-            if (!CheckFinalTx(*pcoin))
-                continue;
+            if (!pcoin || pcoin->GetHash() != wtxid)
+            {
+                auto wtxIt = mapWallet.find(wtxid);
+                pcoin = wtxIt == mapWallet.end() ? nullptr : &wtxIt->second;
+                skipTx = true;
 
-            if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
+                if (!pcoin)
+                    continue;
 
-            bool isCoinbase = pcoin->IsCoinBase();
-            if (!fIncludeCoinBase && isCoinbase)
-                continue;
+                if (!CheckFinalTx(*pcoin))
+                    continue;
 
-            if (!fIncludeImmatureCoins && isCoinbase && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+                if (fOnlyConfirmed && !pcoin->IsTrusted())
+                    continue;
 
-            int nDepth = pcoin->GetDepthInMainChain();
-            if (nDepth < 0)
-                continue;
+                bool isCoinbase = pcoin->IsCoinBase();
+                if (!fIncludeCoinBase && isCoinbase)
+                    continue;
+
+                if (!fIncludeImmatureCoins && isCoinbase && pcoin->GetBlocksToMaturity() > 0)
+                    continue;
+
+                nDepth = pcoin->GetDepthInMainChain();
+                if (nDepth < 0)
+                    continue;
+
+                uint32_t coinHeight = nHeight - nDepth;
+                // even if we should include coinbases, we may opt to exclude protected coinbases, which must only be included when shielding
+                if (isCoinbase &&
+                    !fIncludeProtectedCoinbase &&
+                    Params().GetConsensus().fCoinbaseMustBeProtected &&
+                    CConstVerusSolutionVector::GetVersionByHeight(coinHeight) < CActivationHeight::SOLUTION_VERUSV4 &&
+                    CConstVerusSolutionVector::GetVersionByHeight(nHeight) < CActivationHeight::SOLUTION_VERUSV5)
+                    continue;
 
-            uint32_t coinHeight = nHeight - nDepth;
-            // even if we should include coinbases, we may opt to exclude protected coinbases, which must only be included when shielding
-            if (isCoinbase &&
-                !fIncludeProtectedCoinbase &&
-                Params().GetConsensus().fCoinbaseMustBeProtected &&
-                CConstVerusSolutionVector::GetVersionByHeight(coinHeight) < CActivationHeight::SOLUTION_VERUSV4 &&
-                CConstVerusSolutionVector::GetVersionByHeight(nHeight) < CActivationHeight::SOLUTION_VERUSV5)
+                skipTx = false;
+            }
+            if (skipTx)
                 continue;
 
-            for (int i = 0; i < pcoin->vout.size(); i++)
+            isminetype mine = mapSpendableOutputs.find(candidate)->second.mine;
+            if (!(IsSpent(wtxid, i)) &&
+                !IsLockedCoin(wtxid, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
+                (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected(wtxid, i)))
             {
-                isminetype mine = IsMine(pcoin->vout[i]);
-                if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected((*it).first, i)))
+                if (!fIncludeIDLockedCoins)
                 {
-                    COptCCParams p;
-                    CCurrencyValueMap rOut = pcoin->vout[i].scriptPubKey.ReserveOutValue(p, true);
-
-                    if (p.IsValid() && !pcoin->vout[i].scriptPubKey.IsSpendableOutputType(p))
-                    {
-                        continue;
-                    }
-
-                    if (!fIncludeIDLockedCoins)
+                    // if this is sent to an ID in this wallet, ensure that the ID is unlocked or skip it
+                    CTxDestination checkDest;
+                    std::pair<CIdentityMapKey, CIdentityMapValue> keyAndIdentity;
+                    if (ExtractDestination(pcoin->vout[i].scriptPubKey, checkDest) &&
+                        checkDest.which() == COptCCParams::ADDRTYPE_ID)
                     {
-                        // if this is sent to an ID in this wallet, ensure that the ID is unlocked or skip it
-                        CTxDestination checkDest;
-                        std::pair<CIdentityMapKey, CIdentityMapValue> keyAndIdentity;
-                        if (ExtractDestination(pcoin->vout[i].scriptPubKey, checkDest) &&
-                            checkDest.which() == COptCCParams::ADDRTYPE_ID)
+                        if (GetIdentity(GetDestinationID(checkDest), keyAndIdentity))
                         {
-                            if (GetIdentity(GetDestinationID(checkDest), keyAndIdentity))
+                            if (keyAndIdentity.second.IsLocked(nHeight))
                             {
-                                if (keyAndIdentity.second.IsLocked(nHeight))
-                                {
-                                    continue;
-                                }
-                            }
-                            else
-                            {
-                                //LogPrintf("%s: unable to locate ID %s that should be present in wallet\n", __func__, EncodeDestination(checkDest).c_str());
                                 continue;
                             }
                         }
+                        else
+                        {
+                            //LogPrintf("%s: unable to locate ID %s that should be present in wallet\n", __func__, EncodeDestination(checkDest).c_str());
+                            continue;
+                        }
                     }
+                }
 
-                    if ( KOMODO_EXCHANGEWALLET == 0 )
+                if ( KOMODO_EXCHANGEWALLET == 0 )
+                {
+                    uint32_t locktime; int32_t txheight; CBlockIndex *tipindex;
+                    if ( ASSETCHAINS_SYMBOL[0] == 0 && chainActive.LastTip() != 0 && chainActive.LastTip()->GetHeight() >= 60000 )
                     {
-                        uint32_t locktime; int32_t txheight; CBlockIndex *tipindex;
-                        if ( ASSETCHAINS_SYMBOL[0] == 0 && chainActive.LastTip() != 0 && chainActive.LastTip()->GetHeight() >= 60000 )
+                        if ( pcoin->vout[i].nValue >= 10*COIN )
                         {
-                            if ( pcoin->vout[i].nValue >= 10*COIN )
+                            if ( (tipindex= chainActive.LastTip()) != 0 )
                             {
-                                if ( (tipindex= chainActive.LastTip()) != 0 )
-                                {
-                                    komodo_accrued_interest(&txheight,&locktime,wtxid,i,0,pcoin->vout[i].nValue,(int32_t)tipindex->GetHeight());
-                                    interest = komodo_interestnew(txheight,pcoin->vout[i].nValue,locktime,tipindex->nTime);
-                                } else interest = 0;
-                                //interest = komodo_interestnew(chainActive.LastTip()->GetHeight()+1,pcoin->vout[i].nValue,pcoin->nLockTime,chainActive.LastTip()->nTime);
-                                if ( interest != 0 )
-                                {
-                                    //printf("wallet nValueRet %.8f += interest %.8f ht.%d lock.%u/%u tip.%u\n",(double)pcoin->vout[i].nValue/COIN,(double)interest/COIN,txheight,locktime,pcoin->nLockTime,tipindex->nTime);
-                                    //fprintf(stderr,"wallet nValueRet %.8f += interest %.8f ht.%d lock.%u tip.%u\n",(double)pcoin->vout[i].nValue/COIN,(double)interest/COIN,chainActive.LastTip()->GetHeight()+1,pcoin->nLockTime,chainActive.LastTip()->nTime);
-                                    //ptr = (uint64_t *)&pcoin->vout[i].nValue;
-                                    //(*ptr) += interest;
-                                    ptr = (uint64_t *)&pcoin->vout[i].interest;
-                                    (*ptr) = interest;
-                                    //pcoin->vout[i].nValue += interest;
-                                }
-                                else
-                                {
-                                    ptr = (uint64_t *)&pcoin->vout[i].interest;
-                                    (*ptr) = 0;
-                                }
+                                komodo_accrued_interest(&txheight,&locktime,wtxid,i,0,pcoin->vout[i].nValue,(int32_t)tipindex->GetHeight());
+                                interest = komodo_interestnew(txheight,pcoin->vout[i].nValue,locktime,tipindex->nTime);
+                            } else interest = 0;
+                            //interest = komodo_interestnew(chainActive.LastTip()->GetHeight()+1,pcoin->vout[i].nValue,pcoin->nLockTime,chainActive.LastTip()->nTime);
+                            if ( interest != 0 )
+                            {
+                                //printf("wallet nValueRet %.8f += interest %.8f ht.%d lock.%u/%u tip.%u\n",(double)pcoin->vout[i].nValue/COIN,(double)interest/COIN,txheight,locktime,pcoin->nLockTime,tipindex->nTime);
+                                //fprintf(stderr,"wallet nValueRet %.8f += interest %.8f ht.%d lock.%u tip.%u\n",(double)pcoin->vout[i].nValue/COIN,(double)interest/COIN,chainActive.LastTip()->GetHeight()+1,pcoin->nLockTime,chainActive.LastTip()->nTime);
+                                //ptr = (uint64_t *)&pcoin->vout[i].nValue;
+                                //(*ptr) += interest;
+                                ptr = (uint64_t *)&pcoin->vout[i].interest;
+                                (*ptr) = interest;
+                                //pcoin->vout[i].nValue += interest;
                             }
                             else
                             {
@@ -5342,8 +5709,13 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
                             (*ptr) = 0;
                         }
                     }
-                    vCoins.push_back(COutput(pcoin, i, nDepth, (mine & (fIncludeSharedCoins ? (ISMINE_SPENDABLE | ISMINE_SHARED) : ISMINE_SPENDABLE)) != ISMINE_NO));
+                    else
+                    {
+                        ptr = (uint64_t *)&pcoin->vout[i].interest;
+                        (*ptr) = 0;
+                    }
                 }
+                vCoins.push_back(COutput(pcoin, i, nDepth, (mine & (fIncludeSharedCoins ? (ISMINE_SPENDABLE | ISMINE_SHARED) : ISMINE_SPENDABLE)) != ISMINE_NO));
             }
         }
     }
@@ -5356,114 +5728,114 @@ void CWallet::AvailableReserveCoins(vector<COutput>& vCoins, bool fOnlyConfirmed
     {
         LOCK2(cs_main, cs_wallet);
         uint32_t nHeight = chainActive.Height() + 1;
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+
+        // only visit outputs to pOnlyFromDest, with the native currency or one of the currencies we are looking for
+        std::set<uint160> currencies;
+        if (pOnlyTheseCurrencies)
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            for (auto &oneCur : pOnlyTheseCurrencies->valueMap)
+            {
+                if (oneCur.second)
+                {
+                    currencies.insert(oneCur.first);
+                }
+            }
+            if (fIncludeNative)
+            {
+                currencies.insert(uint160());
+            }
+        }
+        std::vector<COutPoint> candidates;
+        UpdateSpendableOutputs();
+        GetSpendableOutputCandidates(candidates, pOnlyTheseCurrencies ? &currencies : nullptr, pOnlyFromDest);
 
-            if (!CheckFinalTx(*pcoin))
-                continue;
+        const CWalletTx* pcoin = nullptr;
+        bool skipTx = true;
+        int nDepth = 0;
+        for (auto &candidate : candidates)
+        {
+            const uint256& wtxid = candidate.hash;
+            int i = candidate.n;
 
-            if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
+            if (!pcoin || pcoin->GetHash() != wtxid)
+            {
+                auto wtxIt = mapWallet.find(wtxid);
+                pcoin = wtxIt == mapWallet.end() ? nullptr : &wtxIt->second;
+                skipTx = true;
 
-            if (pcoin->IsCoinBase() && !fIncludeCoinBase)
-                continue;
+                if (!pcoin)
+                    continue;
 
-            if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+                if (!CheckFinalTx(*pcoin))
+                    continue;
 
-            int nDepth = pcoin->GetDepthInMainChain();
-            if (nDepth < 0)
+                if (fOnlyConfirmed && !pcoin->IsTrusted())
+                    continue;
+
+                if (pcoin->IsCoinBase() && !fIncludeCoinBase)
+                    continue;
+
+                if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
+                    continue;
+
+                nDepth = pcoin->GetDepthInMainChain();
+                if (nDepth < 0)
+                    continue;
+
+                skipTx = false;
+            }
+            if (skipTx)
                 continue;
 
-            for (int i = 0; i < pcoin->vout.size(); i++)
+            const CSpendableOutput &spendable = mapSpendableOutputs.find(candidate)->second;
+            isminetype mine = spendable.mine;
+            if (!(IsSpent(wtxid, i)) &&
+                !IsLockedCoin(wtxid, i) &&
+                (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected(wtxid, i)))
             {
-                isminetype mine = IsMine(pcoin->vout[i]);
-                if (!(IsSpent(wtxid, i)) &&
-                    mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected((*it).first, i)))
-                {
-                    COptCCParams p;
-                    CCurrencyValueMap rOut = pcoin->vout[i].scriptPubKey.ReserveOutValue(p, true);
+                const CCurrencyValueMap &rOut = spendable.reserveValues;
 
-                    if (p.IsValid() && !pcoin->vout[i].scriptPubKey.IsSpendableOutputType(p))
-                    {
-                        continue;
-                    }
+                // no zero valued outputs
+                if (pOnlyTheseCurrencies &&
+                    !(pOnlyTheseCurrencies->Intersects(rOut) ||
+                      (fIncludeNative && pcoin->vout[i].nValue)))
+                {
+                    continue;
+                }
 
-                    // no zero valued outputs
-                    if (pOnlyTheseCurrencies &&
-                        !(pOnlyTheseCurrencies->Intersects(rOut) ||
-                          (fIncludeNative && pcoin->vout[i].nValue)))
+                if (currencyTrustMode != CRating::TRUSTMODE_NORESTRICTION)
+                {
+                    // if no currencies we will pay attention to and no native, don't return this output
+                    if (!RemoveBlockedCurrencies(rOut).valueMap.size() && !(fIncludeNative && pcoin->vout[i].nValue))
                     {
                         continue;
                     }
+                }
 
-                    if (currencyTrustMode != CRating::TRUSTMODE_NORESTRICTION)
-                    {
-                        // if no currencies we will pay attention to and no native, don't return this output
-                        if (!RemoveBlockedCurrencies(rOut).valueMap.size() && !(fIncludeNative && pcoin->vout[i].nValue))
-                        {
-                            continue;
-                        }
-                    }
-
-                    if (pOnlyFromDest)
+                if (!fIncludeIDLockedCoins)
+                {
+                    // if this is sent to an ID in this wallet, ensure that the ID is unlocked or skip it
+                    CTxDestination checkDest;
+                    std::pair<CIdentityMapKey, CIdentityMapValue> keyAndIdentity;
+                    if (ExtractDestination(pcoin->vout[i].scriptPubKey, checkDest) &&
+                        checkDest.which() == COptCCParams::ADDRTYPE_ID)
                     {
-                        if (p.IsValid())
+                        if (GetIdentity(GetDestinationID(checkDest), keyAndIdentity))
                         {
-                            bool found = false;
-                            for (auto &oneDest : p.vKeys)
-                            {
-                                if (GetDestinationID(oneDest) == GetDestinationID(*pOnlyFromDest))
-                                {
-                                    found = true;
-                                    break;
-                                }
-                            }
-                            if (!found)
+                            if (keyAndIdentity.second.IsLocked(nHeight))
                             {
                                 continue;
                             }
                         }
                         else
                         {
-                            // support P2PK or P2PKH
-                            CTxDestination dest;
-                            if (!ExtractDestination(pcoin->vout[i].scriptPubKey, dest) || GetDestinationID(dest) != GetDestinationID(*pOnlyFromDest))
-                            {
-                                continue;
-                            }
-                        }
-                    }
-
-                    if (!fIncludeIDLockedCoins)
-                    {
-                        // if this is sent to an ID in this wallet, ensure that the ID is unlocked or skip it
-                        CTxDestination checkDest;
-                        std::pair<CIdentityMapKey, CIdentityMapValue> keyAndIdentity;
-                        if (ExtractDestination(pcoin->vout[i].scriptPubKey, checkDest) &&
-                            checkDest.which() == COptCCParams::ADDRTYPE_ID)
-                        {
-                            if (GetIdentity(GetDestinationID(checkDest), keyAndIdentity))
-                            {
-                                if (keyAndIdentity.second.IsLocked(nHeight))
-                                {
-                                    continue;
-                                }
-                            }
-                            else
-                            {
-                                //LogPrintf("%s: unable to locate ID %s that should be present in wallet\n", __func__, EncodeDestination(checkDest).c_str());
-                                continue;
-                            }
+                            //LogPrintf("%s: unable to locate ID %s that should be present in wallet\n", __func__, EncodeDestination(checkDest).c_str());
+                            continue;
                         }
                     }
-
-                    vCoins.push_back(COutput(pcoin, i, nDepth, (mine & (fIncludeSharedCoins ? (ISMINE_SPENDABLE | ISMINE_SHARED) : ISMINE_SPENDABLE)) != ISMINE_NO));
                 }
+
+                vCoins.push_back(COutput(pcoin, i, nDepth, (mine & (fIncludeSharedCoins ? (ISMINE_SPENDABLE | ISMINE_SHARED) : ISMINE_SPENDABLE)) != ISMINE_NO));
             }
         }
     }
@@ -32,6 +32,7 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -46,6 +47,7 @@ extern unsigned int nTxConfirmTarget;
 extern bool bSpendZeroConfChange;
 extern bool fSendFreeTransactions;
 extern bool fPayAtLeastCustomFee;
+extern bool fCheckWalletBalances;
 
 //! -paytxfee default
 static const CAmount DEFAULT_TRANSACTION_FEE = 0.0001 * COIN;
@@ -599,8 +601,13 @@ public:
         fWatchReserveCreditCached = false;
         fImmatureWatchReserveCreditCached = false;
         fAvailableWatchReserveCreditCached = false;
+
+        MarkWalletCachesDirty();
     }
 
+    //! make sure this transaction's contribution to the wallet balance totals and spendable output index is updated
+    void MarkWalletCachesDirty();
+
     void BindWallet(CWallet *pwalletIn)
     {
         pwallet = pwalletIn;
@@ -795,6 +802,68 @@ public:
     CReserveOutSelectionInfo(const CWalletTx *pwtx, int outNum, CCurrencyValueMap curValues) : pWtx(pwtx), n(outNum), outVal(curValues) {}
 };
 
+/**
+ * The contribution of one wallet transaction to each of the wallet balance totals, in the native
+ * currency and in reserve currencies. The wallet keeps one of these per transaction, along with their
+ * sums, so that balance queries only need to revisit transactions that may have changed.
+ */
+class CWalletTxBalances
+{
+public:
+    enum EBalanceType {
+        AVAILABLE = 0,              // trusted and spendable, GetBalance()
+        AVAILABLE_UNLOCKED = 1,     // as above, excluding outputs to locked IDs, GetBalance(false)
+        SHARED = 2,                 // trusted and spendable with other signers, GetSharedBalance()
+        SHARED_UNLOCKED = 3,        // GetSharedBalance(false)
+        UNCONFIRMED = 4,
+        IMMATURE = 5,
+        WATCH_AVAILABLE = 6,
+        WATCH_UNCONFIRMED = 7,
+        WATCH_IMMATURE = 8,
+        BALANCE_TYPE_COUNT = 9
+    };
+
+    CAmount native[BALANCE_TYPE_COUNT];
+    CCurrencyValueMap reserve[BALANCE_TYPE_COUNT];
+
+    bool fVolatile;                 // may change without the transaction being marked dirty, so recalculate on every query
+    bool fIDSensitive;              // pays an ID, so locked amounts may change as the chain advances
+
+    CWalletTxBalances() : fVolatile(false), fIDSensitive(false)
+    {
+        for (int i = 0; i < BALANCE_TYPE_COUNT; i++)
+        {
+            native[i] = 0;
+        }
+    }
+
+    bool IsEmpty() const;
+    void AddTo(CWalletTxBalances &totals) const;
+    void SubtractFrom(CWalletTxBalances &totals) const;
+    bool operator==(const CWalletTxBalances &operand) const;
+};
+
+/**
+ * What coin selection needs to know about an output of a wallet transaction that may be spendable, none of which
+ * changes while the transaction is in the wallet.
+ */
+class CSpendableOutput
+{
+public:
+    isminetype mine;
+    CCurrencyValueMap reserveValues;
+    std::vector<uint160> destinationIDs;    // keys of a smart transaction output, or the destination of any other
+
+    CSpendableOutput() : mine(ISMINE_NO) {}
+    CSpendableOutput(isminetype Mine, const CCurrencyValueMap &ReserveValues, const std::vector<uint160> &DestinationIDs) :
+        mine(Mine), reserveValues(ReserveValues), destinationIDs(DestinationIDs) {}
+
+    bool HasDestination(const uint160 &destID) const
+    {
+        return std::find(destinationIDs.begin(), destinationIDs.end(), destID) != destinationIDs.end();
+    }
+};
+
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
@@ -850,6 +919,42 @@ private:
     void AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Balance totals, maintained from the contributions of each transaction in mapTxBalances. Transactions marked
+     * dirty are recalculated on the next balance query, volatile ones on every query, and ID sensitive ones when the
+     * tip has changed. A reorg past the tip of the last query recalculates everything. All protected by cs_wallet.
+     */
+    mutable bool fBalancesValid;
+    mutable const CBlockIndex *pBalancesTip;
+    mutable std::map<uint256, CWalletTxBalances> mapTxBalances;
+    mutable CWalletTxBalances balanceTotals;
+    mutable std::set<uint256> setBalancesDirty;
+    mutable std::set<uint256> setBalancesVolatile;
+    mutable std::set<uint256> setBalancesIDSensitive;
+
+    CWalletTxBalances CalcTxBalances(const CWalletTx &wtx) const;
+    void UpdateTxBalances(const uint256 &hash) const;
+    void RebuildBalances() const;
+    CWalletTxBalances RecalculateBalances() const;
+    const CWalletTxBalances &GetBalances() const;
+
+    /**
+     * Outputs of wallet transactions that may be spendable, indexed by currency and destination, so that coin
+     * selection only visits the outputs that can contribute. Outputs spent in the main chain are dropped, so the
+     * index is rebuilt after a reorg past the tip it was last updated at. All protected by cs_wallet.
+     */
+    mutable bool fSpendableOutputsValid;
+    mutable const CBlockIndex *pSpendableOutputsTip;
+    mutable std::map<COutPoint, CSpendableOutput> mapSpendableOutputs;
+    mutable std::set<std::tuple<uint160, uint160, COutPoint>> setSpendableOutputsByCurrency; // (currency, destination, output), native is the null currency
+    mutable std::set<uint256> setSpendableOutputsDirty;
+
+    bool IsSpentInMainChain(const uint256 &hash, unsigned int n) const;
+    void IndexSpendableOutputs(const uint256 &hash) const;
+    void UnindexSpendableOutputs(const uint256 &hash) const;
+    void UpdateSpendableOutputs() const;
+    void GetSpendableOutputCandidates(std::vector<COutPoint> &candidates, const std::set<uint160> *pCurrencies, const CTxDestination *pOnlyFromDest) const;
+
 public:
     /*
      * Size of the incremental witness cache for the notes in our wallet.
@@ -988,6 +1093,10 @@ public:
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
         nWitnessCacheSize = 0;
+        fBalancesValid = false;
+        pBalancesTip = NULL;
+        fSpendableOutputsValid = false;
+        pSpendableOutputsTip = NULL;
     }
 
     /**
@@ -1245,6 +1354,12 @@ public:
     TxItems OrderedTxItems(std::list<CAccountingEntry>& acentries, std::string strAccount = "");
 
     void MarkDirty();
+    void MarkBalanceDirty(const uint256 &hash) const;
+    void InvalidateBalances();
+    // true if the incrementally maintained balance totals equal a full recalculation over mapWallet
+    bool CheckBalances() const;
+    void MarkSpendableOutputsDirty(const uint256 &hash) const;
+    void InvalidateSpendableOutputs();
     bool UpdateNullifierNoteMap();
     void UpdateNullifierNoteMapWithTx(const CWalletTx& wtx);
     void UpdateSaplingNullifierNoteMapWithTx(CWalletTx& wtx);
@@ -21,6 +21,8 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 
+#include <atomic>
+
 using namespace std;
 
 static uint64_t nAccountingEntryNumber = 0;
@@ -506,9 +508,92 @@ public:
     }
 };
 
+/**
+ * A transaction record that LoadWallet found in its pass over the database. Records are decoded and checked in
+ * batches on worker threads, then added to the wallet in the order they were read.
+ */
+class CWalletTxRecord {
+public:
+    uint256 hash;
+    CDataStream ssValue;
+    CWalletTx wtx;
+    bool fRead;
+    bool fUpgraded;
+    string strErr;
+
+    CWalletTxRecord(const uint256 &txid, CDataStream &&ssValueIn) :
+        hash(txid), ssValue(std::move(ssValueIn)), fRead(false), fUpgraded(false) {}
+};
+
+// number of transaction records a LoadWallet worker decodes at a time
+static const size_t WALLET_LOAD_TX_BATCH = 256;
+// maximum number of threads that decode transaction records
+static const int MAX_WALLET_LOAD_THREADS = 8;
+
+static bool ReadWalletTx(const uint256 &hash, CDataStream& ssValue, CWalletTx &wtx, bool &fUpgraded, string& strErr)
+{
+    fUpgraded = false;
+    ssValue >> wtx;
+    CValidationState state;
+    auto verifier = libzcash::ProofVerifier::Strict();
+    if (!(CheckTransaction(wtx, state, verifier) && (wtx.GetHash() == hash) && state.IsValid()))
+    {
+        if (wtx.hashBlock.IsNull() && !wtx.vin.size() && !wtx.vout.size() && !wtx.vShieldedSpend.size() && !wtx.vShieldedOutput.size())
+        {
+            strErr = "nulltx";
+        }
+        return false;
+    }
+
+    // Undo serialize changes in 31600
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+    {
+        if (!ssValue.empty())
+        {
+            char fTmp;
+            char fUnused;
+            ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                               wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        }
+        else
+        {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgraded = true;
+    }
+    return true;
+}
+
+static void ReadWalletTxRecords(vector<CWalletTxRecord> &records, std::atomic<size_t> &nextRecord)
+{
+    while (true)
+    {
+        size_t begin = nextRecord.fetch_add(WALLET_LOAD_TX_BATCH);
+        if (begin >= records.size())
+        {
+            break;
+        }
+        size_t end = std::min(begin + WALLET_LOAD_TX_BATCH, records.size());
+        for (size_t i = begin; i < end; i++)
+        {
+            CWalletTxRecord &record = records[i];
+            try {
+                record.fRead = ReadWalletTx(record.hash, record.ssValue, record.wtx, record.fUpgraded, record.strErr);
+            } catch (...) {
+                record.fRead = false;
+            }
+            record.ssValue = CDataStream(SER_DISK, CLIENT_VERSION);
+        }
+    }
+}
+
 bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
-             CWalletScanState &wss, string& strType, string& strErr)
+             CWalletScanState &wss, string& strType, string& strErr,
+             vector<CWalletTxRecord> *pTxRecords=NULL)
 {
     try {
         // Unserialize
@@ -531,36 +616,20 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         {
             uint256 hash;
             ssKey >> hash;
+            if (pTxRecords)
+            {
+                // decoded later on worker threads
+                pTxRecords->push_back(CWalletTxRecord(hash, std::move(ssValue)));
+                return true;
+            }
             CWalletTx wtx;
-            ssValue >> wtx;
-            CValidationState state;
-            auto verifier = libzcash::ProofVerifier::Strict();
-            if (!(CheckTransaction(wtx, state, verifier) && (wtx.GetHash() == hash) && state.IsValid()))
+            bool fUpgraded;
+            if (!ReadWalletTx(hash, ssValue, wtx, fUpgraded, strErr))
             {
-                if (wtx.hashBlock.IsNull() && !wtx.vin.size() && !wtx.vout.size() && !wtx.vShieldedSpend.size() && !wtx.vShieldedOutput.size())
-                {
-                    strErr = "nulltx";
-                }
                 return false;
             }
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+            if (fUpgraded)
             {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
                 wss.vWalletUpgrade.push_back(hash);
             }
 
@@ -1104,6 +1173,9 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
         pwallet->LoadCurrencyTrustMode(CRating::TRUSTMODE_NORESTRICTION);
         pwallet->LoadIdentityTrustMode(CRating::TRUSTMODE_NORESTRICTION);
 
+        // transactions are the bulk of a large wallet, so they are only collected in the pass over the database
+        vector<CWalletTxRecord> txRecords;
+
         while (true)
         {
             // Read next record
@@ -1120,7 +1192,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
 
             // Try to be tolerant of single corrupt records:
             string strType, strErr;
-            if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
+            if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr, &txRecords))
             {
                 // losing keys is considered a catastrophic error, anything else
                 // we assume the user can live with:
@@ -1134,10 +1206,6 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                     {
                         // Rescan if there is a bad transaction record:
                         SoftSetBoolArg("-rescan", true);
-                        if (strErr == "nulltx")
-                        {
-                            fNoncriticalErrors = false;
-                        }
                     }
                 }
             }
@@ -1145,6 +1213,44 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                 LogPrintf("%s\n", strErr);
         }
         pcursor->close();
+
+        // Decode and check the transactions in batches on up to -par threads. Nothing in the wallet changes until
+        // they are all done, then they are added in the order they were read.
+        int64_t nStart = GetTimeMillis();
+        std::atomic<size_t> nextRecord(0);
+        int nThreads = std::min<int>(std::max(nScriptCheckThreads, 1), MAX_WALLET_LOAD_THREADS);
+        nThreads = std::min<int>(nThreads, (txRecords.size() + WALLET_LOAD_TX_BATCH - 1) / WALLET_LOAD_TX_BATCH);
+        boost::thread_group readThreads;
+        for (int i = 1; i < nThreads; i++)
+        {
+            readThreads.create_thread(boost::bind(&ReadWalletTxRecords, boost::ref(txRecords), boost::ref(nextRecord)));
+        }
+        ReadWalletTxRecords(txRecords, nextRecord);
+        readThreads.join_all();
+
+        for (auto &record : txRecords)
+        {
+            if (!record.fRead)
+            {
+                // Rescan if there is a bad transaction record, but do not warn about null transactions:
+                SoftSetBoolArg("-rescan", true);
+                if (record.strErr != "nulltx")
+                {
+                    fNoncriticalErrors = true;
+                }
+            }
+            else
+            {
+                if (record.fUpgraded)
+                    wss.vWalletUpgrade.push_back(record.hash);
+                if (record.wtx.nOrderPos == -1)
+                    wss.fAnyUnordered = true;
+                pwallet->AddToWallet(record.wtx, true, NULL);
+            }
+            if (!record.strErr.empty())
+                LogPrintf("%s\n", record.strErr);
+        }
+        LogPrint("db", "Read %u wallet transactions on %d threads in %dms\n", txRecords.size(), std::max(nThreads, 1), GetTimeMillis() - nStart);
     }
     catch (const boost::thread_interrupted&) {
         throw;
@@ -4,10 +4,14 @@
 #include <thread>
 #include <unistd.h>
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 
+#include "cc/CCinclude.h"
+#include "checkqueue.h"
 #include "coins.h"
 #include "util.h"
 #include "init.h"
+#include "jsonstream.h"
 #include "primitives/transaction.h"
 #include "base58.h"
 #include "crypto/equihash.h"
@@ -17,12 +21,14 @@
 #include "consensus/validation.h"
 #include "main.h"
 #include "miner.h"
+#include "mmr.h"
 #include "pow.h"
 #include "rpc/server.h"
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
 #include "txdb.h"
+#include "transaction_builder.h"
 #include "utiltest.h"
 #include "wallet/wallet.h"
 
@@ -33,6 +39,9 @@
 #include "zcash/Note.hpp"
 #include "librustzcash.h"
 
+extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern void WriteBlockJSON(CJSONStreamWriter& writer, const CBlock& block, const CBlockIndex* blockindex, bool txDetails, const UniValue& extra);
+
 using namespace libzcash;
 // This method is based on Shutdown from init.cpp
 void pre_wallet_load()
@@ -649,6 +658,60 @@ double benchmark_create_sapling_spend()
     return t;
 }
 
+// Prepare the descriptions of a transaction with nSpends Sapling spends and one output on nPrepareThreads
+// threads, as TransactionBuilder::Build does before it makes their proofs, and return its wall time
+double benchmark_prepare_sapling_descriptions(size_t nSpends, int nPrepareThreads)
+{
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto address = sk.default_address();
+
+    std::vector<SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    SaplingMerkleTree tree;
+    for (size_t i = 0; i < nSpends; i++) {
+        SaplingNote note(address, COIN);
+        auto maybe_cm = note.cm();
+        if (!maybe_cm) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not create note commitment");
+        }
+        for (auto &witness : witnesses) {
+            witness.append(maybe_cm.get());
+        }
+        tree.append(maybe_cm.get());
+        witnesses.push_back(tree.witness());
+        notes.push_back(note);
+    }
+
+    int nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height() + 1;
+    }
+    TransactionBuilder builder(Params().GetConsensus(), nHeight);
+    builder.SetPrepareThreads(nPrepareThreads);
+    for (size_t i = 0; i < nSpends; i++) {
+        builder.AddSaplingSpend(expsk, notes[i], tree.root(), witnesses[i]);
+    }
+    builder.AddSaplingOutput(expsk.full_viewing_key().ovk, address, nSpends * COIN - builder.GetFee());
+
+    std::vector<PreparedSaplingSpend> preparedSpends;
+    std::vector<PreparedSaplingOutput> preparedOutputs;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    builder.PrepareSaplingDescriptions(preparedSpends, preparedOutputs);
+    double t = timer_stop(tv_start);
+    for (auto &prepared : preparedSpends) {
+        if (!prepared.nf) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not prepare spend");
+        }
+    }
+    if (!preparedOutputs[0].cm || !preparedOutputs[0].enc) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not prepare output");
+    }
+    return t;
+}
+
 double benchmark_create_sapling_output()
 {
     auto sk = libzcash::SaplingSpendingKey::random();
@@ -690,15 +753,18 @@ double benchmark_create_sapling_output()
     return t;
 }
 
+static const char *SAMPLE_SAPLING_SPEND = "8c6cf86bbb83bf0d075e5bd9bb4b5cd56141577be69f032880b11e26aa32aa5ef09fd00899e4b469fb11f38e9d09dc0379f0b11c23b5fe541765f76695120a03f0261d32af5d2a2b1e5c9a04200cd87d574dc42349de9790012ce560406a8a876a1e54cfcdc0eb74998abec2a9778330eeb2a0ac0e41d0c9ed5824fbd0dbf7da930ab299966ce333fd7bc1321dada0817aac5444e02c754069e218746bf879d5f2a20a8b028324fb2c73171e63336686aa5ec2e6e9a08eb18b87c14758c572f4531ccf6b55d09f44beb8b47563be4eff7a52598d80959dd9c9fee5ac4783d8370cb7d55d460053d3e067b5f9fe75ff2722623fb1825fcba5e9593d4205b38d1f502ff03035463043bd393a5ee039ce75a5d54f21b395255df6627ef96751566326f7d4a77d828aa21b1827282829fcbc42aad59cdb521e1a3aaa08b99ea8fe7fff0a04da31a52260fc6daeccd79bb877bdd8506614282258e15b3fe74bf71a93f4be3b770119edf99a317b205eea7d5ab800362b97384273888106c77d633600";
+static const char *SAMPLE_SAPLING_SPEND_SIGHASH = "0x2dbf83fe7b88a7cbd80fac0c719483906bb9a0c4fc69071e4780d5f2c76e592c";
+
 // Verify Sapling spend from testnet
 // txid: abbd823cbd3d4e3b52023599d81a96b74817e95ce5bb58354f979156bd22ecc8
 // position: 0
 double benchmark_verify_sapling_spend()
 {
     SpendDescription spend;
-    CDataStream ss(ParseHex("8c6cf86bbb83bf0d075e5bd9bb4b5cd56141577be69f032880b11e26aa32aa5ef09fd00899e4b469fb11f38e9d09dc0379f0b11c23b5fe541765f76695120a03f0261d32af5d2a2b1e5c9a04200cd87d574dc42349de9790012ce560406a8a876a1e54cfcdc0eb74998abec2a9778330eeb2a0ac0e41d0c9ed5824fbd0dbf7da930ab299966ce333fd7bc1321dada0817aac5444e02c754069e218746bf879d5f2a20a8b028324fb2c73171e63336686aa5ec2e6e9a08eb18b87c14758c572f4531ccf6b55d09f44beb8b47563be4eff7a52598d80959dd9c9fee5ac4783d8370cb7d55d460053d3e067b5f9fe75ff2722623fb1825fcba5e9593d4205b38d1f502ff03035463043bd393a5ee039ce75a5d54f21b395255df6627ef96751566326f7d4a77d828aa21b1827282829fcbc42aad59cdb521e1a3aaa08b99ea8fe7fff0a04da31a52260fc6daeccd79bb877bdd8506614282258e15b3fe74bf71a93f4be3b770119edf99a317b205eea7d5ab800362b97384273888106c77d633600"), SER_NETWORK, PROTOCOL_VERSION);
+    CDataStream ss(ParseHex(SAMPLE_SAPLING_SPEND), SER_NETWORK, PROTOCOL_VERSION);
     ss >> spend;
-    uint256 dataToBeSigned = uint256S("0x2dbf83fe7b88a7cbd80fac0c719483906bb9a0c4fc69071e4780d5f2c76e592c");
+    uint256 dataToBeSigned = uint256S(SAMPLE_SAPLING_SPEND_SIGHASH);
 
     auto ctx = librustzcash_sapling_verification_ctx_init();
 
@@ -753,3 +819,266 @@ double benchmark_verify_sapling_output()
     }
     return timer_stop(tv_start);
 }
+
+// Sapling spend proof check in its own verification context, scheduled on a CCheckQueue
+// the same way ConnectBlock schedules per transaction Sapling checks
+class CBenchSaplingSpendCheck
+{
+private:
+    const SpendDescription *pspend;
+    const uint256 *pdataToBeSigned;
+
+public:
+    CBenchSaplingSpendCheck() : pspend(nullptr), pdataToBeSigned(nullptr) {}
+    CBenchSaplingSpendCheck(const SpendDescription &spend, const uint256 &dataToBeSigned) : pspend(&spend), pdataToBeSigned(&dataToBeSigned) {}
+
+    bool operator()()
+    {
+        auto ctx = librustzcash_sapling_verification_ctx_init();
+        bool result = librustzcash_sapling_check_spend(
+                    ctx,
+                    pspend->cv.begin(),
+                    pspend->anchor.begin(),
+                    pspend->nullifier.begin(),
+                    pspend->rk.begin(),
+                    pspend->zkproof.begin(),
+                    pspend->spendAuthSig.begin(),
+                    pdataToBeSigned->begin()
+                );
+        librustzcash_sapling_verification_ctx_free(ctx);
+        return result;
+    }
+
+    void swap(CBenchSaplingSpendCheck &check)
+    {
+        std::swap(pspend, check.pspend);
+        std::swap(pdataToBeSigned, check.pdataToBeSigned);
+    }
+};
+
+// Verify a block worth of Sapling spends on a check queue with nThreads threads, including the calling thread,
+// returning the wall time for the whole block
+double benchmark_verify_sapling_block(size_t nSpends, int nThreads)
+{
+    SpendDescription spend;
+    CDataStream ss(ParseHex(SAMPLE_SAPLING_SPEND), SER_NETWORK, PROTOCOL_VERSION);
+    ss >> spend;
+    uint256 dataToBeSigned = uint256S(SAMPLE_SAPLING_SPEND_SIGHASH);
+
+    CCheckQueue<CBenchSaplingSpendCheck> queue(4);
+    boost::thread_group workers;
+    for (int i = 0; i < nThreads - 1; i++)
+    {
+        workers.create_thread([&queue]() { queue.Thread(); });
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+
+    bool result;
+    {
+        CCheckQueueControl<CBenchSaplingSpendCheck> control(&queue);
+        for (size_t i = 0; i < nSpends; i++)
+        {
+            std::vector<CBenchSaplingSpendCheck> vChecks(1, CBenchSaplingSpendCheck(spend, dataToBeSigned));
+            control.Add(vChecks);
+        }
+        result = control.Wait();
+    }
+
+    double t = timer_stop(tv_start);
+    workers.interrupt_all();
+    workers.join_all();
+    if (!result) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "librustzcash_sapling_check_spend() should return true");
+    }
+    return t;
+}
+
+// Compute the merkle root of a block with nTxs transactions, whose hashes are already cached,
+// so that only the tree itself is timed
+double benchmark_merkle_root(size_t nTxs)
+{
+    CBlock block;
+    block.vtx.reserve(nTxs);
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vout.resize(1);
+    for (size_t i = 0; i < nTxs; i++) {
+        mtx.nLockTime = i;
+        block.vtx.push_back(CTransaction(mtx));
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    bool mutated;
+    uint256 root = block.BuildMerkleTree(&mutated);
+    double t = timer_stop(tv_start);
+    if (root.IsNull() || mutated) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "BuildMerkleTree() returned an unexpected root");
+    }
+    return t;
+}
+
+// Build a BLAKE2b merkle mountain range of nLeaves leaves and compute its root, either adding the leaves
+// one at a time or all at once, so that each layer is hashed with a single multi-node call
+double benchmark_mmr_build(size_t nLeaves, bool fLayers)
+{
+    std::vector<CDefaultMMRNode> leaves;
+    leaves.reserve(nLeaves);
+    for (size_t i = 0; i < nLeaves; i++) {
+        leaves.push_back(CDefaultMMRNode(GetRandHash()));
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    CMerkleMountainRange<CDefaultMMRNode> mmr;
+    if (fLayers) {
+        mmr.Add(leaves);
+    } else {
+        for (auto &leaf : leaves) {
+            mmr.Add(leaf);
+        }
+    }
+    CMerkleMountainView<CDefaultMMRNode> mmv(mmr);
+    uint256 root = mmv.GetRoot();
+    double t = timer_stop(tv_start);
+    if (root.IsNull()) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "GetRoot() returned a null root");
+    }
+    return t;
+}
+
+// Find the spendable outputs of one currency in a synthetic wallet of nUTXOs confirmed outputs to one key, spread
+// evenly over the native currency and ten reserve currencies. The wallet's spendable output index is built by an
+// untimed first query, so only the query is timed.
+double benchmark_available_reserve_coins(size_t nUTXOs)
+{
+    const int OUTPUTS_PER_TX = 10;
+    const int NUM_CURRENCIES = 10;
+
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+
+    const CBlockIndex *pindexTip = chainActive.LastTip();
+    if (!pindexTip) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "No chain tip to confirm the wallet transactions in");
+    }
+
+    CKey key;
+    key.MakeNewKey(true);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    std::vector<CTxDestination> dests({CTxDestination(key.GetPubKey().GetID())});
+
+    std::vector<uint160> currencies(NUM_CURRENCIES);
+    for (auto &currencyID : currencies) {
+        GetRandBytes(currencyID.begin(), currencyID.size());
+    }
+
+    size_t nExpected = 0;
+    for (size_t n = 0; n < nUTXOs; n += OUTPUTS_PER_TX) {
+        CMutableTransaction mtx;
+        mtx.nLockTime = n;
+        for (size_t i = n; i < n + OUTPUTS_PER_TX && i < nUTXOs; i++) {
+            int slot = i % (NUM_CURRENCIES + 1);
+            if (slot == NUM_CURRENCIES) {
+                mtx.vout.push_back(CTxOut(COIN, GetScriptForDestination(dests[0])));
+            } else {
+                CTokenOutput to(currencies[slot], COIN);
+                mtx.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CTokenOutput>(EVAL_RESERVE_OUTPUT, dests, 1, &to))));
+                nExpected += slot == 0;
+            }
+        }
+        CWalletTx wtx(&wallet, CTransaction(mtx));
+        wtx.hashBlock = pindexTip->GetBlockHash();
+        wtx.nIndex = 0;
+        wtx.fMerkleVerified = true;
+        wallet.AddToWallet(wtx, true, NULL);
+    }
+
+    CCurrencyValueMap target(std::vector<uint160>({currencies[0]}), std::vector<int64_t>({COIN}));
+    std::vector<COutput> vCoins;
+    wallet.AvailableReserveCoins(vCoins, true, nullptr, false, false, nullptr, &target, false);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    wallet.AvailableReserveCoins(vCoins, true, nullptr, false, false, nullptr, &target, false);
+    double t = timer_stop(tv_start);
+    if (vCoins.size() != nExpected) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("Found %u of %u spendable outputs", vCoins.size(), nExpected));
+    }
+    return t;
+}
+
+// Read and free nReads copies of a signed fulfillment of the usual Verus shape, an eval and a 1 of 2
+// secp256k1 threshold under a 2 of 2 threshold, optionally in a crypto-condition arena for each read
+double benchmark_read_cc_fulfillment(size_t nReads, bool fArena)
+{
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    CC *cond = CCNewThreshold(2, {CCNewEval(std::vector<unsigned char>(1, EVAL_RESERVE_OUTPUT)),
+                                  CCNewThreshold(1, {CCNewSecp256k1(key1.GetPubKey()), CCNewSecp256k1(key2.GetPubKey())})});
+    uint256 msg = GetRandHash();
+    cc_signTreeSecp256k1Msg32(cond, key1.begin(), msg.begin());
+    std::vector<unsigned char> ffill(MAX_BINARY_CC_SIZE);
+    ffill.resize(cc_fulfillmentBinary(cond, ffill.data(), ffill.size()));
+    cc_free(cond);
+    if (ffill.empty()) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not serialize fulfillment");
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (size_t i = 0; i < nReads; i++) {
+        boost::optional<CCArenaScope> arena;
+        if (fArena) {
+            arena.emplace();
+        }
+        CC *readCond = NULL;
+        if (cc_readFulfillmentBinaryExt(ffill.data(), ffill.size(), &readCond) || !readCond) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not read fulfillment");
+        }
+        cc_free(readCond);
+    }
+    return timer_stop(tv_start);
+}
+
+// Write the block at nHeight as JSON with transaction details, either built as a UniValue and then written,
+// as getblock did for every call, or streamed one transaction at a time
+double benchmark_block_json(int nHeight, bool fStream)
+{
+    CBlock block;
+    CBlockIndex *pindex;
+    {
+        LOCK(cs_main);
+        if (nHeight < 0 || nHeight > chainActive.Height()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        }
+        pindex = chainActive[nHeight];
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus(), 1)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        }
+    }
+
+    // the most JSON text held at once, beside the UniValue tree when not streaming
+    size_t nBytes = 0, nLargestPiece = 0;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    if (fStream) {
+        CJSONStreamWriter writer([&nBytes, &nLargestPiece](const char *data, size_t len) {
+            nBytes += len;
+            nLargestPiece = std::max(nLargestPiece, len);
+        });
+        WriteBlockJSON(writer, block, pindex, true, NullUniValue);
+        writer.Flush();
+    } else {
+        LOCK(cs_main);
+        std::string strJSON = blockToJSON(block, pindex, true).write();
+        nBytes = nLargestPiece = strJSON.size();
+    }
+    double t = timer_stop(tv_start);
+    LogPrint("bench", "%s: %u bytes of JSON, at most %u bytes of it held at once\n", __func__, nBytes, nLargestPiece);
+    return t;
+}
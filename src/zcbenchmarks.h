@@ -21,8 +21,15 @@ extern double benchmark_sendtoaddress(CAmount amount);
 extern double benchmark_loadwallet();
 extern double benchmark_listunspent();
 extern double benchmark_create_sapling_spend();
+extern double benchmark_prepare_sapling_descriptions(size_t nSpends, int nPrepareThreads);
 extern double benchmark_create_sapling_output();
 extern double benchmark_verify_sapling_spend();
 extern double benchmark_verify_sapling_output();
+extern double benchmark_verify_sapling_block(size_t nSpends, int nThreads);
+extern double benchmark_merkle_root(size_t nTxs);
+extern double benchmark_mmr_build(size_t nLeaves, bool fLayers);
+extern double benchmark_available_reserve_coins(size_t nUTXOs);
+extern double benchmark_read_cc_fulfillment(size_t nReads, bool fArena);
+extern double benchmark_block_json(int nHeight, bool fStream);
 
 #endif
@@ -8,6 +8,7 @@
 #include "zmqconfig.h"
 
 class CBlockIndex;
+class CPBaaSEvent;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
@@ -35,6 +36,10 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyBlock(const CBlock& pblock);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyPBaaSEvent(const CPBaaSEvent &event);
+
+    // PBaaS event notifiers are called from the PBaaS event queue thread instead of the validation thread
+    virtual bool IsPBaaSEventNotifier() const { return false; }
 
 protected:
     void *psocket;
@@ -9,13 +9,14 @@
 #include "main.h"
 #include "streams.h"
 #include "util.h"
+#include "pbaas/events.h"
 
 void zmqError(const char *str)
 {
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL), pEventQueue(NULL)
 {
 }
 
@@ -40,6 +41,12 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubcheckedblock"] = CZMQAbstractNotifier::Create<CZMQPublishCheckedBlockNotifier>;
+    factories["pubidentity"] = CZMQAbstractNotifier::Create<CZMQPublishIdentityNotifier>;
+    factories["pubcurrencystate"] = CZMQAbstractNotifier::Create<CZMQPublishCurrencyStateNotifier>;
+    factories["pubexport"] = CZMQAbstractNotifier::Create<CZMQPublishExportNotifier>;
+    factories["pubimport"] = CZMQAbstractNotifier::Create<CZMQPublishImportNotifier>;
+    factories["pubreservetransfer"] = CZMQAbstractNotifier::Create<CZMQPublishReserveTransferNotifier>;
+    factories["pubnotarization"] = CZMQAbstractNotifier::Create<CZMQPublishNotarizationNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -104,6 +111,20 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    for (i=notifiers.begin(); i!=notifiers.end(); ++i)
+    {
+        if ((*i)->IsPBaaSEventNotifier())
+        {
+            eventNotifiers.push_back(*i);
+        }
+    }
+
+    if (!eventNotifiers.empty())
+    {
+        pEventQueue = new CPBaaSEventQueue(std::bind(&CZMQNotificationInterface::PublishPBaaSEvents, this, std::placeholders::_1));
+        pEventQueue->Start();
+    }
+
     return true;
 }
 
@@ -111,6 +132,13 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
+    if (pEventQueue)
+    {
+        delete pEventQueue;
+        pEventQueue = NULL;
+    }
+    eventNotifiers.clear();
+
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -179,3 +207,32 @@ void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+void CZMQNotificationInterface::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added)
+{
+    if (pEventQueue && pblock)
+    {
+        pEventQueue->PushBlock(*pblock, pindex, added);
+    }
+}
+
+void CZMQNotificationInterface::PublishPBaaSEvents(const std::vector<CPBaaSEvent> &events)
+{
+    for (auto &oneEvent : events)
+    {
+        for (std::list<CZMQAbstractNotifier*>::iterator i = eventNotifiers.begin(); i!=eventNotifiers.end(); )
+        {
+            CZMQAbstractNotifier *notifier = *i;
+            if (notifier->NotifyPBaaSEvent(oneEvent))
+            {
+                i++;
+            }
+            else
+            {
+                // the socket may be shared with notifiers on the validation thread, so it is closed at shutdown
+                LogPrint("zmq", "zmq: Stopped notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
+                i = eventNotifiers.erase(i);
+            }
+        }
+    }
+}
@@ -11,6 +11,8 @@
 #include <map>
 
 class CBlockIndex;
+class CPBaaSEvent;
+class CPBaaSEventQueue;
 class CZMQAbstractNotifier;
 
 class CZMQNotificationInterface : public CValidationInterface
@@ -28,12 +30,18 @@ protected:
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void BlockChecked(const CBlock& block, const CValidationState& state);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added);
+
+    // called on the PBaaS event queue thread
+    void PublishPBaaSEvents(const std::vector<CPBaaSEvent> &events);
 
 private:
     CZMQNotificationInterface();
 
     void *pcontext;
     std::list<CZMQAbstractNotifier*> notifiers;
+    std::list<CZMQAbstractNotifier*> eventNotifiers;    // PBaaS event notifiers, used only by the event queue thread once it runs
+    CPBaaSEventQueue *pEventQueue;
 };
 
 #endif // BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
@@ -15,6 +15,9 @@ static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_CHECKEDBLOCK = "checkedblock";
 
+// PBaaS event notifiers send from the PBaaS event queue thread and may share a socket with other notifiers
+static CCriticalSection cs_zmqSend;
+
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
 {
@@ -130,6 +133,7 @@ void CZMQAbstractPublishNotifier::Shutdown()
 bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
 {
     assert(psocket);
+    LOCK(cs_zmqSend);
 
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
@@ -206,3 +210,15 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishPBaaSEventNotifier::NotifyPBaaSEvent(const CPBaaSEvent &event)
+{
+    if (event.nType != eventType)
+        return true;
+
+    const char *command = CPBaaSEvent::TypeName(eventType);
+    LogPrint("zmq", "zmq: Publish %s %s:%d, event %lu\n", command, event.txid.GetHex(), event.nOut, event.nSequence);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << event;
+    return SendMessage(command, &(*ss.begin()), ss.size());
+}
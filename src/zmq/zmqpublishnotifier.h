@@ -6,6 +6,7 @@
 #define BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 
 #include "zmqabstractnotifier.h"
+#include "pbaas/events.h"
 
 class CBlockIndex;
 
@@ -58,4 +59,53 @@ public:
     bool NotifyBlock(const CBlock &block);
 };
 
+// publishes the PBaaS events of one type, with the event type name as topic and the serialized CPBaaSEvent as body
+class CZMQPublishPBaaSEventNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    int eventType;
+
+public:
+    CZMQPublishPBaaSEventNotifier(int type) : eventType(type) {}
+
+    bool NotifyPBaaSEvent(const CPBaaSEvent &event);
+    bool IsPBaaSEventNotifier() const { return true; }
+};
+
+class CZMQPublishIdentityNotifier : public CZMQPublishPBaaSEventNotifier
+{
+public:
+    CZMQPublishIdentityNotifier() : CZMQPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_IDENTITY) {}
+};
+
+class CZMQPublishCurrencyStateNotifier : public CZMQPublishPBaaSEventNotifier
+{
+public:
+    CZMQPublishCurrencyStateNotifier() : CZMQPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_CURRENCYSTATE) {}
+};
+
+class CZMQPublishExportNotifier : public CZMQPublishPBaaSEventNotifier
+{
+public:
+    CZMQPublishExportNotifier() : CZMQPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_EXPORT) {}
+};
+
+class CZMQPublishImportNotifier : public CZMQPublishPBaaSEventNotifier
+{
+public:
+    CZMQPublishImportNotifier() : CZMQPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_IMPORT) {}
+};
+
+class CZMQPublishReserveTransferNotifier : public CZMQPublishPBaaSEventNotifier
+{
+public:
+    CZMQPublishReserveTransferNotifier() : CZMQPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_RESERVETRANSFER) {}
+};
+
+class CZMQPublishNotarizationNotifier : public CZMQPublishPBaaSEventNotifier
+{
+public:
+    CZMQPublishNotarizationNotifier() : CZMQPublishPBaaSEventNotifier(CPBaaSEvent::EVENT_NOTARIZATION) {}
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H